@@ -44,11 +44,14 @@ extern const Command diff_state_command;
 extern const Command diff_images_command;
 extern const Command dump_command;
 extern const Command dump_images_command;
+extern const Command export_command;
 extern const Command leaks_command;
 extern const Command pickle_command;
 extern const Command repack_command;
 extern const Command retrace_command;
 extern const Command sed_command;
+extern const Command sink_command;
+extern const Command stats_command;
 extern const Command trace_command;
 extern const Command trim_command;
 extern const Command trim_auto_command;
@@ -26,6 +26,7 @@
  **************************************************************************/
 
 
+#include <stdlib.h>
 #include <string.h>
 #include <limits.h> // for CHAR_MAX
 #include <getopt.h>
@@ -33,11 +34,13 @@
 #include <unistd.h> // for isatty()
 #endif
 
+#include <deque>
 #include <memory>
 #include <fstream>
+#include <sstream>
 #include <string>
 
-#include "cxx_compat.hpp" // for std::to_string, std::make_unique
+#include "cxx_compat.hpp" // for std::to_string
 
 #include "cli.hpp"
 #include "cli_pager.hpp"
@@ -46,6 +49,7 @@
 #include "trace_dump_internal.hpp"
 #include "trace_callset.hpp"
 #include "trace_option.hpp"
+#include "thread_pool.hpp"
 
 
 enum ColorOption {
@@ -60,6 +64,8 @@ static bool verbose = false;
 
 static trace::CallSet calls(trace::FREQUENCY_ALL);
 
+static trace::CallSet frames(trace::FREQUENCY_NONE);
+
 static const char *synopsis = "Dump given trace(s) to standard output.";
 
 static void
@@ -71,7 +77,10 @@ usage(void)
         "\n"
         "    -h, --help           show this help message and exit\n"
         "    -v, --verbose        verbose output\n"
+        "    -j, --jobs=N         dump with N threads [default: 1]\n"
         "    --calls=CALLSET      only dump specified calls\n"
+        "    --frames=FRAMESET    only dump calls in specified frames\n"
+        "    --functions=REGEX    only dump calls to functions matching REGEX\n"
         "    --color[=WHEN]\n"
         "    --colour[=WHEN]      colored syntax highlighting\n"
         "                         WHEN is 'auto', 'always', or 'never'\n"
@@ -85,6 +94,8 @@ usage(void)
 
 enum {
     CALLS_OPT = CHAR_MAX + 1,
+    FRAMES_OPT,
+    FUNCTIONS_OPT,
     COLOR_OPT,
     THREAD_IDS_OPT,
     CALL_NOS_OPT,
@@ -93,13 +104,16 @@ enum {
 };
 
 const static char *
-shortOptions = "hv";
+shortOptions = "hvj:";
 
 const static struct option
 longOptions[] = {
     {"help", no_argument, 0, 'h'},
     {"verbose", no_argument, 0, 'v'},
+    {"jobs", required_argument, 0, 'j'},
     {"calls", required_argument, 0, CALLS_OPT},
+    {"frames", required_argument, 0, FRAMES_OPT},
+    {"functions", required_argument, 0, FUNCTIONS_OPT},
     {"colour", optional_argument, 0, COLOR_OPT},
     {"color", optional_argument, 0, COLOR_OPT},
     {"thread-ids", optional_argument, 0, THREAD_IDS_OPT},
@@ -134,7 +148,11 @@ public:
             stream.close();
         }
 
-        os << pointer << "blob(\"" << fileName << "\")" << normal;
+        write(pointer);
+        write("blob(\"");
+        write(fileName.data(), fileName.size());
+        write("\")");
+        write(normal);
         ++blobNo;
     }
 
@@ -146,11 +164,178 @@ public:
 };
 
 
+static trace::Dumper *
+createDumper(std::ostream &os, trace::DumpFlags dumpFlags, bool blobs)
+{
+    if (blobs) {
+        return new BlobDumper(os, dumpFlags);
+    } else {
+        return new trace::Dumper(os, dumpFlags);
+    }
+}
+
+
+static void
+dumpCalls(trace::Parser &p, trace::Dumper &dumper)
+{
+    trace::Call *call;
+    while ((call = p.parse_call())) {
+        if (verbose ||
+            !(call->flags & trace::CALL_FLAG_VERBOSE)) {
+            dumper.visit(call);
+        }
+        delete call;
+    }
+}
+
+
+/*
+ * Consecutive calls of a trace, dumped into memory by a worker thread.
+ */
+struct Shard
+{
+    trace::Parser parser;
+    trace::CallFilter filter;
+    std::ostringstream os;
+    std::unique_ptr<trace::Dumper> dumper;
+    bool done = false;
+};
+
+
+// Number of selected calls per shard
+static const unsigned shardCalls = 16384;
+
+
+/*
+ * Dump a trace with several threads.
+ *
+ * The trace is scanned once, without decoding values, to split it into shards
+ * of consecutive calls.  Each shard gets its own parser, starting at the
+ * shard's bookmark with a copy of the signatures scanned so far, and is dumped
+ * by a worker into memory.  Finished shards are written out in order, and the
+ * scan waits when too many shards are outstanding, to bound memory usage.
+ *
+ * Output only differs from dumpCalls() for calls which return after later
+ * calls from other threads started a new shard: these are dumped at the end of
+ * their own shard.
+ */
+static bool
+dumpTraceParallel(const char *filename, const trace::CallFilter &filter,
+                  trace::DumpFlags dumpFlags, bool blobs, unsigned jobs)
+{
+    trace::Parser scanner;
+
+    scanner.setFilter(&filter);
+
+    if (!scanner.open(filename)) {
+        return false;
+    }
+
+    if (!scanner.supportsOffsets()) {
+        std::cerr << "warning: " << filename << " does not support random access, dumping with a single thread\n";
+        std::unique_ptr<trace::Dumper> dumper(createDumper(std::cout, dumpFlags, blobs));
+        dumpCalls(scanner, *dumper);
+        return true;
+    }
+
+    ThreadPool pool(jobs);
+    os::mutex mutex;
+    os::condition_variable cond;
+    std::deque<std::unique_ptr<Shard>> shards;
+
+    auto startShard = [&] (void) -> Shard * {
+        std::unique_ptr<Shard> shard(new Shard);
+        if (!shard->parser.open(filename)) {
+            return NULL;
+        }
+        shard->parser.copySignatures(scanner);
+        trace::ParseBookmark bookmark;
+        scanner.getBookmark(bookmark);
+        shard->parser.setBookmark(bookmark);
+        shard->filter = filter;
+        shard->filter.setCallRange(bookmark.next_call_no, std::numeric_limits<trace::CallNo>::max());
+        shard->parser.setFilter(&shard->filter);
+        shard->dumper.reset(createDumper(shard->os, dumpFlags, blobs));
+        shards.push_back(std::move(shard));
+        return shards.back().get();
+    };
+
+    auto dumpShard = [&] (Shard *shard) {
+        pool.enqueue([&, shard] (void) {
+            dumpCalls(shard->parser, *shard->dumper);
+            shard->dumper->flush();
+            shard->parser.close();
+            {
+                os::unique_lock<os::mutex> lock(mutex);
+                shard->done = true;
+            }
+            cond.notify_all();
+        });
+    };
+
+    auto writeShard = [&] (void) {
+        Shard *shard = shards.front().get();
+        {
+            os::unique_lock<os::mutex> lock(mutex);
+            cond.wait(lock, [shard] { return shard->done; });
+        }
+        const std::string output = shard->os.str();
+        std::cout.write(output.data(), output.size());
+        shards.pop_front();
+    };
+
+    bool success = true;
+
+    Shard *shard = startShard();
+    if (!shard) {
+        return false;
+    }
+
+    trace::Call *call;
+    unsigned numCalls = 0;
+    while ((call = scanner.scan_call())) {
+        delete call;
+
+        if (++numCalls < shardCalls) {
+            continue;
+        }
+        numCalls = 0;
+
+        trace::ParseBookmark bookmark;
+        scanner.getBookmark(bookmark);
+        shard->filter.setCallRange(shard->filter.getFirstCall(), bookmark.next_call_no - 1);
+        dumpShard(shard);
+
+        while (shards.size() >= 2 * jobs) {
+            writeShard();
+        }
+
+        shard = startShard();
+        if (!shard) {
+            success = false;
+            break;
+        }
+    }
+
+    if (shard) {
+        dumpShard(shard);
+    }
+
+    while (!shards.empty()) {
+        writeShard();
+    }
+
+    return success;
+}
+
+
 static int
 command(int argc, char *argv[])
 {
     trace::DumpFlags dumpFlags = 0;
     bool blobs = false;
+    unsigned jobs = 1;
+    trace::CallFilter filter;
 
     int opt;
     while ((opt = getopt_long(argc, argv, shortOptions, longOptions, NULL)) != -1) {
@@ -161,9 +346,26 @@ command(int argc, char *argv[])
         case 'v':
             verbose = true;
             break;
+        case 'j':
+            if (atoi(optarg) < 1) {
+                std::cerr << "error: invalid number of jobs " << optarg << "\n";
+                return 1;
+            }
+            jobs = atoi(optarg);
+            break;
         case CALLS_OPT:
             calls.merge(optarg);
             break;
+        case FRAMES_OPT:
+            frames.merge(optarg);
+            filter.setFrames(frames);
+            break;
+        case FUNCTIONS_OPT:
+            if (!filter.setFunctionRegex(optarg)) {
+                usage();
+                return 1;
+            }
+            break;
         case COLOR_OPT:
             if (!optarg ||
                 !strcmp(optarg, "always")) {
@@ -221,31 +423,29 @@ command(int argc, char *argv[])
         dumpFlags |= trace::DUMP_FLAG_NO_COLOR;
     }
 
-    std::unique_ptr<trace::Dumper> dumper;
+    filter.setCalls(calls);
 
-    if (blobs) {
-        dumper = std::make_unique<BlobDumper>(std::cout, dumpFlags);
-    } else {
-        dumper = std::make_unique<trace::Dumper>(std::cout, dumpFlags);
+    if (jobs > 1) {
+        for (int i = optind; i < argc; ++i) {
+            if (!dumpTraceParallel(argv[i], filter, dumpFlags, blobs, jobs)) {
+                return 1;
+            }
+        }
+        return 0;
     }
 
+    std::unique_ptr<trace::Dumper> dumper(createDumper(std::cout, dumpFlags, blobs));
+
     for (int i = optind; i < argc; ++i) {
         trace::Parser p;
 
+        p.setFilter(&filter);
+
         if (!p.open(argv[i])) {
             return 1;
         }
 
-        trace::Call *call;
-        while ((call = p.parse_call())) {
-            if (calls.contains(*call)) {
-                if (verbose ||
-                    !(call->flags & trace::CALL_FLAG_VERBOSE)) {
-                    dumper->visit(call);
-                }
-            }
-            delete call;
-        }
+        dumpCalls(p, *dumper);
     }
 
     return 0;
@@ -0,0 +1,188 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+#include <string.h>
+#include <limits.h> // for CHAR_MAX
+#include <getopt.h>
+
+#include <iostream>
+
+#include "cli.hpp"
+#include "os_string.hpp"
+
+#include "trace_parser.hpp"
+#include "trace_callset.hpp"
+#include "trace_columnar.hpp"
+
+
+static const char *synopsis = "Export given trace's calls for analysis by other tools.";
+
+static void
+usage(void)
+{
+    std::cout
+        << "usage: apitrace export --columnar [OPTIONS] TRACE_FILE\n"
+        << synopsis << "\n"
+        "\n"
+        "    -h, --help           show this help message and exit\n"
+        "    --columnar           write one file per column into a directory\n"
+        "    -o, --output=DIR     output directory [default: TRACE_FILE with\n"
+        "                         its extension replaced by \".columns\"]\n"
+        "    --calls=CALLSET      only export specified calls\n"
+        "    --frames=FRAMESET    only export calls in specified frames\n"
+        "    --functions=REGEX    only export calls to functions matching REGEX\n"
+        "\n"
+        "The columnar format is described in lib/trace/trace_columnar.hpp.\n"
+    ;
+}
+
+enum {
+    COLUMNAR_OPT = CHAR_MAX + 1,
+    CALLS_OPT,
+    FRAMES_OPT,
+    FUNCTIONS_OPT,
+};
+
+const static char *
+shortOptions = "ho:";
+
+const static struct option
+longOptions[] = {
+    {"help", no_argument, 0, 'h'},
+    {"columnar", no_argument, 0, COLUMNAR_OPT},
+    {"output", required_argument, 0, 'o'},
+    {"calls", required_argument, 0, CALLS_OPT},
+    {"frames", required_argument, 0, FRAMES_OPT},
+    {"functions", required_argument, 0, FUNCTIONS_OPT},
+    {0, 0, 0, 0}
+};
+
+
+static bool
+exportColumnar(const char *filename, const char *dirname, const trace::CallFilter &filter)
+{
+    trace::Parser p;
+
+    p.setFilter(&filter);
+
+    if (!p.open(filename)) {
+        std::cerr << "error: failed to open " << filename << "\n";
+        return false;
+    }
+
+    trace::ColumnarWriter writer;
+    if (!writer.open(dirname)) {
+        return false;
+    }
+
+    // Frames are numbered by the parser, which sees every call, including
+    // those the filter skips.
+    trace::Call *call;
+    while ((call = p.parse_call())) {
+        writer.writeCall(call, call->frame_no);
+        delete call;
+    }
+
+    return writer.close();
+}
+
+
+static int
+command(int argc, char *argv[])
+{
+    bool columnar = false;
+    std::string output;
+    trace::CallSet calls(trace::FREQUENCY_ALL);
+    trace::CallSet frames(trace::FREQUENCY_NONE);
+    trace::CallFilter filter;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, shortOptions, longOptions, NULL)) != -1) {
+        switch (opt) {
+        case 'h':
+            usage();
+            return 0;
+        case COLUMNAR_OPT:
+            columnar = true;
+            break;
+        case 'o':
+            output = optarg;
+            break;
+        case CALLS_OPT:
+            calls.merge(optarg);
+            break;
+        case FRAMES_OPT:
+            frames.merge(optarg);
+            filter.setFrames(frames);
+            break;
+        case FUNCTIONS_OPT:
+            if (!filter.setFunctionRegex(optarg)) {
+                usage();
+                return 1;
+            }
+            break;
+        default:
+            std::cerr << "error: unexpected option `" << (char)opt << "`\n";
+            usage();
+            return 1;
+        }
+    }
+
+    if (!columnar) {
+        std::cerr << "error: no export format specified\n";
+        usage();
+        return 1;
+    }
+
+    if (argc != optind + 1) {
+        std::cerr << "error: one trace file must be specified\n";
+        usage();
+        return 1;
+    }
+
+    const char *filename = argv[optind];
+
+    if (output.empty()) {
+        os::String base(filename);
+        base.trimExtension();
+        output = std::string(base.str()) + ".columns";
+    }
+
+    filter.setCalls(calls);
+
+    if (!exportColumnar(filename, output.c_str(), filter)) {
+        return 1;
+    }
+
+    return 0;
+}
+
+const Command export_command = {
+    "export",
+    synopsis,
+    usage,
+    command
+};
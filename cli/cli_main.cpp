@@ -71,9 +71,12 @@ static const Command * commands[] = {
     &diff_images_command,
     &dump_command,
     &dump_images_command,
+    &export_command,
     &leaks_command,
     &pickle_command,
     &sed_command,
+    &sink_command,
+    &stats_command,
     &repack_command,
     &retrace_command,
     &trace_command,
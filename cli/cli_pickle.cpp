@@ -267,20 +267,23 @@ command(int argc, char *argv[])
     PickleWriter writer(std::cout);
     PickleVisitor visitor(writer, symbolic);
 
+    trace::CallFilter filter;
+    filter.setCalls(calls);
+
     for (int i = optind; i < argc; ++i) {
         trace::Parser parser;
 
+        parser.setFilter(&filter);
+
         if (!parser.open(argv[i])) {
             return 1;
         }
 
         trace::Call *call;
         while ((call = parser.parse_call())) {
-            if (calls.contains(*call)) {
-                writer.begin();
-                visitor.visit(call);
-                writer.end();
-            }
+            writer.begin();
+            visitor.visit(call);
+            writer.end();
             delete call;
         }
     }
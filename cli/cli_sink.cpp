@@ -0,0 +1,174 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <limits.h> // for CHAR_MAX
+#include <getopt.h>
+#include <signal.h>
+
+#include <atomic>
+#include <iostream>
+#include <memory>
+
+#include "cli.hpp"
+#include "os_string.hpp"
+
+#include "trace_ostream.hpp"
+#include "trace_shm.hpp"
+
+
+static const char *synopsis = "Write the trace of a process attached to a shared memory sink.";
+
+static void
+usage(void)
+{
+    std::cout
+        << "usage: apitrace sink [OPTIONS] NAME\n"
+        << synopsis << "\n"
+        "\n"
+        "    Create a shared memory ring buffer called NAME, wait for a traced\n"
+        "    process started with TRACE_SINK=NAME to attach to it, and compress\n"
+        "    and write its calls, so that the traced process does not have to.\n"
+        "    The trace is finalized when that process exits, even if it crashes.\n"
+        "\n"
+        "    -h, --help             show this help message and exit\n"
+        "    -o, --output=TRACE     output trace file [default: NAME.trace]\n"
+        "    --buffer-size=MB       size of the ring buffer, in megabytes [default: "
+        << TRACE_SINK_DEFAULT_SIZE / (1024 * 1024) << "]\n"
+        "\n"
+        "`apitrace trace --sink` does all of this on its own.\n"
+    ;
+}
+
+enum {
+    BUFFER_SIZE_OPT = CHAR_MAX + 1,
+};
+
+const static char *
+shortOptions = "ho:";
+
+const static struct option
+longOptions[] = {
+    {"help", no_argument, 0, 'h'},
+    {"output", required_argument, 0, 'o'},
+    {"buffer-size", required_argument, 0, BUFFER_SIZE_OPT},
+    {0, 0, 0, 0}
+};
+
+
+static std::atomic<bool> stopRequested(false);
+
+static void
+signalHandler(int sig)
+{
+    stopRequested = true;
+}
+
+
+static int
+command(int argc, char *argv[])
+{
+    std::string output;
+    size_t bufferSize = TRACE_SINK_DEFAULT_SIZE;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, shortOptions, longOptions, NULL)) != -1) {
+        switch (opt) {
+        case 'h':
+            usage();
+            return 0;
+        case 'o':
+            output = optarg;
+            break;
+        case BUFFER_SIZE_OPT:
+            bufferSize = (size_t)atoi(optarg) * 1024 * 1024;
+            break;
+        default:
+            std::cerr << "error: unexpected option `" << (char)opt << "`\n";
+            usage();
+            return 1;
+        }
+    }
+
+    if (argc != optind + 1) {
+        std::cerr << "error: one sink name must be specified\n";
+        usage();
+        return 1;
+    }
+
+    const char *name = argv[optind];
+
+    if (output.empty()) {
+        os::String base(name);
+        base.trimDirectory();
+        output = std::string(base.str()) + ".trace";
+    }
+
+    trace::ShmSink sink;
+    if (!sink.create(name, bufferSize)) {
+        return 1;
+    }
+
+    std::unique_ptr<trace::OutStream> out(trace::createSnappyStream(output.c_str()));
+    if (!out) {
+        return 1;
+    }
+
+#ifndef _WIN32
+    // The first interrupt stops waiting for a process to attach, the second
+    // one kills the sink as usual.
+    struct sigaction action;
+    memset(&action, 0, sizeof action);
+    action.sa_handler = signalHandler;
+    action.sa_flags = SA_RESETHAND;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+#endif
+
+    std::cerr << "waiting for a process with TRACE_SINK=" << name << "\n";
+
+    bool attached = sink.run(out.get(), stopRequested);
+    out.reset();
+
+    if (!attached) {
+        std::cerr << "error: no process attached to the sink\n";
+        remove(output.c_str());
+        return 1;
+    }
+
+    std::cerr << "wrote " << sink.getBytes() << " bytes to " << output << "\n";
+
+    return 0;
+}
+
+const Command sink_command = {
+    "sink",
+    synopsis,
+    usage,
+    command
+};
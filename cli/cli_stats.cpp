@@ -0,0 +1,464 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h> // for CHAR_MAX
+#include <getopt.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cli.hpp"
+
+#include "trace_parser.hpp"
+#include "thread_pool.hpp"
+
+
+static const char *synopsis = "Print statistics about given trace(s).";
+
+static void
+usage(void)
+{
+    std::cout
+        << "usage: apitrace stats [OPTIONS] TRACE_FILE...\n"
+        << synopsis << "\n"
+        "\n"
+        "    -h, --help           show this help message and exit\n"
+        "    -j, --jobs=N         scan up to N traces at once [default: 1]\n"
+        "    --json               output JSON instead of text\n"
+        "\n"
+        "Calls are scanned without decoding their values, so this runs at\n"
+        "about the speed of decompressing the trace.\n"
+    ;
+}
+
+enum {
+    JSON_OPT = CHAR_MAX + 1,
+};
+
+const static char *
+shortOptions = "hj:";
+
+const static struct option
+longOptions[] = {
+    {"help", no_argument, 0, 'h'},
+    {"jobs", required_argument, 0, 'j'},
+    {"json", no_argument, 0, JSON_OPT},
+    {0, 0, 0, 0}
+};
+
+
+// Blob sizes are binned by their number of significant bits.
+static const unsigned numBlobBins = 65;
+
+
+struct FunctionStats
+{
+    std::string name;
+    unsigned long long calls = 0;
+    unsigned long long blobs = 0;
+    unsigned long long blobBytes = 0;
+};
+
+
+struct FrameStats
+{
+    unsigned long long calls = 0;
+    unsigned long long blobBytes = 0;
+};
+
+
+struct TraceStats
+{
+    bool success = false;
+    unsigned long long calls = 0;
+    unsigned long long blobs = 0;
+    unsigned long long blobBytes = 0;
+
+    // Indexed by function signature ID
+    std::vector<FunctionStats> functions;
+
+    // The last frame is the one still open when the trace ended
+    std::vector<FrameStats> frames;
+
+    std::map<unsigned, unsigned long long> threadCalls;
+
+    unsigned long long blobBins[numBlobBins] = {};
+
+    FunctionStats &
+    function(const trace::FunctionSig *sig) {
+        if (sig->id >= functions.size()) {
+            functions.resize(sig->id + 1);
+        }
+        FunctionStats &stats = functions[sig->id];
+        if (stats.name.empty()) {
+            stats.name = sig->name;
+        }
+        return stats;
+    }
+};
+
+
+/*
+ * Parser which records the size of the blobs it skips, until the call they
+ * belong to is returned.
+ */
+class StatsParser : public trace::Parser
+{
+public:
+    TraceStats &stats;
+
+    // Blob bytes of calls which were not returned yet.  Only calls from
+    // different threads overlap, so this stays short.
+    std::vector<std::pair<trace::Call *, unsigned long long>> pending;
+
+    StatsParser(TraceStats &_stats) :
+        stats(_stats)
+    {
+    }
+
+    unsigned long long
+    takeBlobBytes(trace::Call *call) {
+        for (auto it = pending.begin(); it != pending.end(); ++it) {
+            if (it->first == call) {
+                unsigned long long bytes = it->second;
+                pending.erase(it);
+                return bytes;
+            }
+        }
+        return 0;
+    }
+
+protected:
+    void
+    scanned_blob(trace::Call *call, size_t size) override {
+        unsigned bin = 0;
+        while (bin < 64 && (size >> bin)) {
+            ++bin;
+        }
+        ++stats.blobBins[bin];
+        ++stats.blobs;
+        stats.blobBytes += size;
+        ++stats.function(call->sig).blobs;
+
+        for (auto &entry : pending) {
+            if (entry.first == call) {
+                entry.second += size;
+                return;
+            }
+        }
+        pending.emplace_back(call, size);
+    }
+};
+
+
+static void
+scanTrace(const char *filename, TraceStats &stats)
+{
+    StatsParser parser(stats);
+    if (!parser.open(filename)) {
+        return;
+    }
+
+    stats.frames.resize(1);
+
+    trace::Call *call;
+    while ((call = parser.scan_call())) {
+        unsigned long long blobBytes = parser.takeBlobBytes(call);
+
+        ++stats.calls;
+        ++stats.threadCalls[call->thread_id];
+
+        FunctionStats &function = stats.function(call->sig);
+        ++function.calls;
+        function.blobBytes += blobBytes;
+
+        FrameStats &frame = stats.frames.back();
+        ++frame.calls;
+        frame.blobBytes += blobBytes;
+        if (call->flags & trace::CALL_FLAG_END_FRAME) {
+            stats.frames.emplace_back();
+        }
+
+        delete call;
+    }
+
+    // Don't report an empty trailing frame
+    if (stats.frames.back().calls == 0) {
+        stats.frames.pop_back();
+    }
+
+    stats.success = true;
+}
+
+
+static std::vector<const FunctionStats *>
+sortFunctions(const TraceStats &stats)
+{
+    std::vector<const FunctionStats *> functions;
+    for (const FunctionStats &function : stats.functions) {
+        if (function.calls) {
+            functions.push_back(&function);
+        }
+    }
+    std::stable_sort(functions.begin(), functions.end(),
+        [] (const FunctionStats *a, const FunctionStats *b) {
+            return a->calls > b->calls;
+        });
+    return functions;
+}
+
+
+static unsigned long long
+blobBinLimit(unsigned bin)
+{
+    return bin < 64 ? (1ULL << bin) - 1 : ~0ULL;
+}
+
+
+static void
+printText(const char *filename, const TraceStats &stats)
+{
+    std::cout << "trace: " << filename << "\n";
+    std::cout << "calls: " << stats.calls << "\n";
+    std::cout << "frames: " << stats.frames.size() << "\n";
+    std::cout << "blobs: " << stats.blobs << " (" << stats.blobBytes << " bytes)\n";
+
+    if (!stats.frames.empty()) {
+        unsigned long long minCalls = ~0ULL, maxCalls = 0;
+        unsigned long long maxBlobBytes = 0;
+        size_t maxFrame = 0;
+        for (size_t i = 0; i < stats.frames.size(); ++i) {
+            const FrameStats &frame = stats.frames[i];
+            minCalls = std::min(minCalls, frame.calls);
+            if (frame.calls > maxCalls) {
+                maxCalls = frame.calls;
+                maxFrame = i;
+            }
+            maxBlobBytes = std::max(maxBlobBytes, frame.blobBytes);
+        }
+        std::cout << "calls per frame: min " << minCalls
+                  << ", mean " << stats.calls / stats.frames.size()
+                  << ", max " << maxCalls << " (frame " << maxFrame << ")\n";
+        std::cout << "blob bytes per frame: mean " << stats.blobBytes / stats.frames.size()
+                  << ", max " << maxBlobBytes << "\n";
+    }
+
+    std::cout << "\n";
+    std::cout << "       calls       %        blob bytes  function\n";
+    for (const FunctionStats *function : sortFunctions(stats)) {
+        std::cout << std::setw(12) << function->calls
+                  << std::setw(8) << std::fixed << std::setprecision(2)
+                  << 100.0 * function->calls / stats.calls
+                  << std::setw(18) << function->blobBytes
+                  << "  " << function->name << "\n";
+    }
+
+    std::cout << "\n";
+    std::cout << "      thread       calls\n";
+    for (auto &entry : stats.threadCalls) {
+        std::cout << std::setw(12) << entry.first
+                  << std::setw(12) << entry.second << "\n";
+    }
+
+    if (stats.blobs) {
+        std::cout << "\n";
+        std::cout << "  blob bytes <=       blobs\n";
+        for (unsigned bin = 0; bin < numBlobBins; ++bin) {
+            if (stats.blobBins[bin]) {
+                std::cout << std::setw(15) << blobBinLimit(bin)
+                          << std::setw(12) << stats.blobBins[bin] << "\n";
+            }
+        }
+    }
+}
+
+
+static void
+writeJSONString(const char *s)
+{
+    std::cout << '"';
+    for (; *s; ++s) {
+        unsigned char c = *s;
+        if (c == '"' || c == '\\') {
+            std::cout << '\\' << c;
+        } else if (c < 0x20) {
+            static const char hex[] = "0123456789abcdef";
+            std::cout << "\\u00" << hex[c >> 4] << hex[c & 0xf];
+        } else {
+            std::cout << c;
+        }
+    }
+    std::cout << '"';
+}
+
+
+static void
+printJSON(const char *filename, const TraceStats &stats)
+{
+    std::cout << "{\n";
+    std::cout << "  \"trace\": ";
+    writeJSONString(filename);
+    std::cout << ",\n";
+    std::cout << "  \"calls\": " << stats.calls << ",\n";
+    std::cout << "  \"blobs\": " << stats.blobs << ",\n";
+    std::cout << "  \"blob_bytes\": " << stats.blobBytes << ",\n";
+
+    std::cout << "  \"functions\": [";
+    const char *sep = "\n";
+    for (const FunctionStats *function : sortFunctions(stats)) {
+        std::cout << sep << "    {\"name\": ";
+        writeJSONString(function->name.c_str());
+        std::cout << ", \"calls\": " << function->calls
+                  << ", \"blobs\": " << function->blobs
+                  << ", \"blob_bytes\": " << function->blobBytes << "}";
+        sep = ",\n";
+    }
+    std::cout << "\n  ],\n";
+
+    std::cout << "  \"threads\": [";
+    sep = "\n";
+    for (auto &entry : stats.threadCalls) {
+        std::cout << sep << "    {\"id\": " << entry.first
+                  << ", \"calls\": " << entry.second << "}";
+        sep = ",\n";
+    }
+    std::cout << "\n  ],\n";
+
+    std::cout << "  \"blob_sizes\": [";
+    sep = "\n";
+    for (unsigned bin = 0; bin < numBlobBins; ++bin) {
+        if (stats.blobBins[bin]) {
+            std::cout << sep << "    {\"max_bytes\": " << blobBinLimit(bin)
+                      << ", \"blobs\": " << stats.blobBins[bin] << "}";
+            sep = ",\n";
+        }
+    }
+    std::cout << "\n  ],\n";
+
+    // One [calls, blob bytes] pair per frame, to keep the output compact
+    std::cout << "  \"frames\": [";
+    sep = "\n    ";
+    for (size_t i = 0; i < stats.frames.size(); ++i) {
+        const FrameStats &frame = stats.frames[i];
+        std::cout << sep << "[" << frame.calls << ", " << frame.blobBytes << "]";
+        sep = i % 8 == 7 ? ",\n    " : ", ";
+    }
+    std::cout << "\n  ]\n";
+    std::cout << "}";
+}
+
+
+static int
+command(int argc, char *argv[])
+{
+    unsigned jobs = 1;
+    bool json = false;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, shortOptions, longOptions, NULL)) != -1) {
+        switch (opt) {
+        case 'h':
+            usage();
+            return 0;
+        case 'j':
+            if (atoi(optarg) < 1) {
+                std::cerr << "error: invalid number of jobs " << optarg << "\n";
+                return 1;
+            }
+            jobs = atoi(optarg);
+            break;
+        case JSON_OPT:
+            json = true;
+            break;
+        default:
+            std::cerr << "error: unexpected option `" << (char)opt << "`\n";
+            usage();
+            return 1;
+        }
+    }
+
+    if (optind >= argc) {
+        std::cerr << "error: no trace file specified\n";
+        usage();
+        return 1;
+    }
+
+    // A trace can only be split at bookmarks found by scanning it, which is
+    // all this command does, so parallelism comes from scanning several
+    // traces at once, each into its own statistics.
+    std::vector<TraceStats> stats(argc - optind);
+    {
+        ThreadPool pool(std::min<size_t>(jobs, stats.size()));
+        for (int i = optind; i < argc; ++i) {
+            pool.enqueue([&, i] (void) {
+                scanTrace(argv[i], stats[i - optind]);
+            });
+        }
+    }
+
+    int ret = 0;
+    bool first = true;
+
+    if (json) {
+        std::cout << "[";
+    }
+    for (int i = optind; i < argc; ++i) {
+        const TraceStats &traceStats = stats[i - optind];
+        if (!traceStats.success) {
+            ret = 1;
+            continue;
+        }
+        if (json) {
+            std::cout << (first ? "\n" : ",\n");
+            printJSON(argv[i], traceStats);
+        } else {
+            if (!first) {
+                std::cout << "\n";
+            }
+            printText(argv[i], traceStats);
+        }
+        first = false;
+    }
+    if (json) {
+        std::cout << "\n]\n";
+    }
+
+    return ret;
+}
+
+const Command stats_command = {
+    "stats",
+    synopsis,
+    usage,
+    command
+};
@@ -31,8 +31,11 @@
 #include <stdlib.h>
 #include <getopt.h>
 
+#include <atomic>
 #include <iostream>
 #include <fstream>
+#include <memory>
+#include <thread>
 
 #ifndef __has_feature
 #  define __has_feature(x) 0
@@ -45,6 +48,9 @@
 #include "cli.hpp"
 #include "cli_resources.hpp"
 
+#include "trace_ostream.hpp"
+#include "trace_shm.hpp"
+
 
 #if defined(__APPLE__)
 #define TRACE_VARIABLE "DYLD_FRAMEWORK_PATH"
@@ -92,17 +98,94 @@ copyWrapper(const os::String & wrapperPath,
 #endif /* _WIN32 */
 
 
+/*
+ * Writes the trace of the traced program from a background thread, with the
+ * program only copying its calls into a shared memory ring buffer.
+ */
+class SinkThread
+{
+    os::String name;
+    trace::ShmSink sink;
+    std::unique_ptr<trace::OutStream> out;
+    std::atomic<bool> stop;
+    std::thread thread;
+
+public:
+    SinkThread() : stop(false) {}
+
+    bool
+    start(const char *output, int verbose)
+    {
+        name = os::String::format("apitrace-%u", (unsigned)os::getCurrentProcessId());
+        if (!sink.create(name)) {
+            return false;
+        }
+
+        out.reset(trace::createSnappyStream(output));
+        if (!out) {
+            return false;
+        }
+
+        thread = std::thread(&trace::ShmSink::run, &sink, out.get(), std::cref(stop));
+
+        os::setEnvironment("TRACE_SINK", name);
+        if (verbose) {
+            std::cerr << "TRACE_SINK=" << name << "\n";
+        }
+        return true;
+    }
+
+    ~SinkThread()
+    {
+        if (thread.joinable()) {
+            os::unsetEnvironment("TRACE_SINK");
+            // Let the sink finish once the traced process is gone
+            stop = true;
+            thread.join();
+        }
+    }
+};
+
+
+/*
+ * Trace file name the wrappers would pick for the given program.
+ */
+static os::String
+defaultTraceName(const char *program)
+{
+    os::String process(program);
+#ifdef _WIN32
+    process.trimExtension();
+#endif
+    process.trimDirectory();
+
+    for (unsigned counter = 0; ; ++counter) {
+        os::String filename;
+        if (counter) {
+            filename = os::String::format("%s.%u.trace", process.str(), counter);
+        } else {
+            filename = os::String::format("%s.trace", process.str());
+        }
+        if (!filename.exists()) {
+            return filename;
+        }
+    }
+}
+
+
 static int
 traceProgram(trace::API api,
              char * const *argv,
              const char *output,
              int verbose,
              bool debug,
-             bool mhook)
+             bool mhook,
+             bool sink)
 {
     const char *wrapperFilename;
     std::vector<const char *> args;
     int status = 1;
+    SinkThread sinkThread;
 
     /*
      * TODO: simplify code
@@ -263,7 +346,12 @@ traceProgram(trace::API api,
         }
 #endif /* TRACE_VARIABLE */
 
-        if (output) {
+        if (sink) {
+            os::String filename = output ? os::String(output) : defaultTraceName(argv[0]);
+            if (!sinkThread.start(filename, verbose)) {
+                goto exit;
+            }
+        } else if (output) {
             os::setEnvironment("TRACE_FILE", output);
         }
 
@@ -342,6 +430,8 @@ usage(void)
         "                        default is `gl`\n"
         "    -o, --output=TRACE  specify output trace file;\n"
         "                        default is `PROGRAM.trace`\n"
+        "    -s, --sink          compress and write the trace from this process,\n"
+        "                        instead of the traced one\n"
 #ifdef TRACE_VARIABLE
         "    -d,  --debug        run inside debugger (gdb/lldb)\n"
 #endif
@@ -352,7 +442,7 @@ usage(void)
 }
 
 const static char *
-shortOptions = "+hva:o:dm";
+shortOptions = "+hva:o:dms";
 
 const static struct option
 longOptions[] = {
@@ -362,6 +452,7 @@ longOptions[] = {
     { "output", required_argument, 0, 'o' },
     { "debug", no_argument, 0, 'd' },
     { "mhook", no_argument, 0, 'm' },
+    { "sink", no_argument, 0, 's' },
     { 0, 0, 0, 0 }
 };
 
@@ -373,6 +464,7 @@ command(int argc, char *argv[])
     const char *output = NULL;
     bool debug = false;
     bool mhook = false;
+    bool sink = false;
 
     int opt;
     while ((opt = getopt_long(argc, argv, shortOptions, longOptions, NULL)) != -1) {
@@ -420,6 +512,9 @@ command(int argc, char *argv[])
         case 'm':
             mhook = true;
             break;
+        case 's':
+            sink = true;
+            break;
         default:
             std::cerr << "error: unexpected option `" << (char)opt << "`\n";
             usage();
@@ -434,7 +529,7 @@ command(int argc, char *argv[])
     }
 
     assert(argv[argc] == 0);
-    return traceProgram(api, argv + optind, output, verbose, debug, mhook);
+    return traceProgram(api, argv + optind, output, verbose, debug, mhook, sink);
 }
 
 const Command trace_command = {
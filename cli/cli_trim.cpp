@@ -34,6 +34,7 @@
 #include "os_string.hpp"
 
 #include "trace_callset.hpp"
+#include "trace_fake_memory.hpp"
 #include "trace_parser.hpp"
 #include "trace_writer.hpp"
 
@@ -97,8 +98,18 @@ static int
 trim_trace(const char *filename, struct trim_options *options)
 {
     trace::Parser p;
+    trace::CallFilter filter;
+    trace::FakeMemory fakeMemory;
     unsigned frame;
 
+    /* Let the parser skip calls outside the call set, unless frames are
+     * requested too, since those are counted here and included as well. */
+    if (options->frames.empty()) {
+        filter.setCalls(options->calls);
+        trace::FakeMemory::keepCalls(filter);
+        p.setFilter(&filter);
+    }
+
     if (!p.open(filename)) {
         std::cerr << "error: failed to open " << filename << "\n";
         return 1;
@@ -139,8 +150,10 @@ trim_trace(const char *filename, struct trim_options *options)
 
         /* If this call is included in the user-specified call set,
          * then require it (and all dependencies) in the trimmed
-         * output. */
-        if (options->calls.contains(*call) ||
+         * output.  Fake memory is always kept, as kept calls may refer
+         * to it. */
+        if (fakeMemory.keep(*call) ||
+            options->calls.contains(*call) ||
             options->frames.contains(frame, call->flags)) {
 
             writer.writeCall(call);
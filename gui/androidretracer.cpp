@@ -10,7 +10,6 @@
 #include <QHostAddress>
 #include <QSettings>
 #include <QTime>
-#include <QBuffer>
 
 #include "qubjson.h"
 
@@ -115,7 +114,6 @@ void AndroidRetracer::run()
 
     ImageHash thumbnails;
 
-    QVariantMap parsedJson;
     trace::Profile* profile = isProfiling() ? new trace::Profile() : NULL;
 
     QList<ApiTraceError> errors;
@@ -270,11 +268,7 @@ void AndroidRetracer::run()
         msg = outputBuffer;
 
     if (captureState()) {
-        QBuffer io(&ubjsonBuffer);
-        io.open(QIODevice::ReadOnly);
-
-        parsedJson = decodeUBJSONObject(&io).toMap();
-        ApiTraceState *state = new ApiTraceState(parsedJson);
+        ApiTraceState *state = new ApiTraceState(UBJSONObject::fromData(ubjsonBuffer));
         emit foundState(state);
     }
 
@@ -283,6 +277,7 @@ void AndroidRetracer::run()
     }
 
     if (isProfiling() && profile) {
+        profile->summarize();
         emit foundProfile(profile);
     }
 
@@ -68,6 +68,8 @@ ApiTrace::ApiTrace()
 
 ApiTrace::~ApiTrace()
 {
+    // The saver uses the loader and the calls
+    m_saver->wait();
     m_loaderThread->quit();
     m_loaderThread->deleteLater();
     qDeleteAll(m_frames);
@@ -81,12 +83,22 @@ bool ApiTrace::isEmpty() const
 }
 
 QString ApiTrace::fileName() const
+{
+    return m_fileName;
+}
+
+/*
+ * Edits are saved into an overlay next to the original trace, which the
+ * retracer applies on the fly.  A full trace with the edits is only written
+ * when baked.
+ */
+QString ApiTrace::overlayFileName() const
 {
     if (edited()) {
         return m_tempFileName;
     }
 
-    return m_fileName;
+    return QString();
 }
 
 const QList<ApiTraceFrame*> & ApiTrace::frames() const
@@ -179,7 +191,7 @@ void ApiTrace::callEdited(ApiTraceCall *call)
         // Lets generate a temp filename
         QFileInfo fileInfo(m_fileName);
         m_tempFileName = QDir::temp().filePath(fileInfo.fileName() +
-                                               QString::fromLatin1(".edited"));
+                                               QString::fromLatin1(".overlay"));
     }
     m_editedCalls.insert(call);
     m_needsSaving = true;
@@ -215,7 +227,25 @@ void ApiTrace::save()
     dir.mkpath(fi.absolutePath());
     m_saver->saveFile(m_tempFileName,
                       m_fileName,
-                      m_editedCalls);
+                      m_editedCalls,
+                      m_loader);
+}
+
+void ApiTrace::bake(const QString &fileName)
+{
+    // The bake applies the overlay, so any edits not yet written to it
+    // must be saved, and the save finished, before the bake starts.
+    m_saver->wait();
+    if (m_needsSaving) {
+        save();
+        m_saver->wait();
+        m_needsSaving = false;
+    }
+
+    emit startedSaving();
+    m_saver->bakeFile(fileName,
+                      m_fileName,
+                      m_tempFileName);
 }
 
 void ApiTrace::slotSaved()
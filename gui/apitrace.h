@@ -56,6 +56,7 @@ public:
     bool isEmpty() const;
 
     QString fileName() const;
+    QString overlayFileName() const;
 
     ApiTraceState defaultState() const;
 
@@ -90,6 +91,7 @@ public:
 public slots:
     void setFileName(const QString &name);
     void save();
+    void bake(const QString &fileName);
     void finishedParsing();
     void loadFrame(ApiTraceFrame *frame);
     void findNext(ApiTraceFrame *frame,
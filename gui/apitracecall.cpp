@@ -4,8 +4,11 @@
 #include "traceloader.h"
 #include "trace_model.hpp"
 
+#include <QCache>
 #include <QDebug>
+#include <QFile>
 #include <QLocale>
+#include <QMutex>
 #include <QObject>
 #define QT_USE_FAST_OPERATOR_PLUS
 #include <QStringBuilder>
@@ -153,6 +156,61 @@ apiVariantToString(const QVariant &variant, bool multiLine)
 }
 
 
+/*
+ * Text searched for in calls.  Shared by ApiTraceCall::searchText() and
+ * apiCallSearchText(), so that the model and the search workers always find
+ * the same calls.
+ */
+static QString
+callSearchText(const QString &name,
+               const QStringList &argNames,
+               const QVector<QVariant> &argValues,
+               const QVariant &returnValue)
+{
+    QString text = name + QLatin1Literal("(");
+    for (int i = 0; i < argNames.count(); ++i) {
+        text += argNames[i] +
+                QLatin1Literal(" = ") +
+                apiVariantToString(i < argValues.count() ? argValues[i] : QVariant());
+        if (i < argNames.count() - 1)
+            text += QLatin1String(", ");
+    }
+    text += QLatin1String(")");
+
+    if (returnValue.isValid()) {
+        text += QLatin1Literal(" = ") +
+                apiVariantToString(returnValue);
+    }
+    return text;
+}
+
+static QVariant
+apiValueToVariant(trace::Value *value)
+{
+    if (!value) {
+        return QVariant();
+    }
+    VariantVisitor visitor;
+    value->visit(visitor);
+    return visitor.variant();
+}
+
+QString
+apiCallSearchText(const trace::Call *call)
+{
+    QStringList argNames;
+    QVector<QVariant> argValues;
+    for (unsigned i = 0; i < call->sig->num_args; ++i) {
+        argNames += QString::fromLatin1(call->sig->arg_names[i]);
+        argValues += apiValueToVariant(i < call->args.size() ? call->args[i].value : 0);
+    }
+
+    return callSearchText(QString::fromLatin1(call->sig->name),
+                          argNames, argValues,
+                          apiValueToVariant(call->ret));
+}
+
+
 void VariantVisitor::visit(trace::Null *)
 {
     m_variant = QVariant::fromValue(ApiPointer(0));
@@ -433,24 +491,56 @@ void ApiArray::init(const trace::Array *arr)
 }
 
 ApiTraceState::ApiTraceState()
+    : m_decoded(0)
 {
 }
 
-static ApiTexture getTextureFrom(QVariantMap const &image, QString label)
+/*
+ * Images dumped with `--dump-images` are named after their contents, so
+ * repeated state dumps share both the files and, through this cache, the
+ * loaded data.
+ */
+static QByteArray getImageData(const UBJSONObject &image)
+{
+    static QMutex mutex;
+    static QCache<QString, QByteArray> cache(256 * 1024); // in KiB
+
+    QString fileName = image.value(QLatin1String("__file__")).toString();
+    if (fileName.isEmpty()) {
+        return image.value(QLatin1String("__data__")).toByteArray();
+    }
+
+    QMutexLocker locker(&mutex);
+
+    QByteArray *cached = cache.object(fileName);
+    if (cached) {
+        return *cached;
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qDebug() << "error: could not open" << fileName;
+        return QByteArray();
+    }
+
+    QByteArray data = file.readAll();
+    cache.insert(fileName, new QByteArray(data), qMax(1, data.size() / 1024));
+    return data;
+}
+
+static ApiTexture getTextureFrom(const UBJSONObject &image, QString label)
 {
-    QSize size(image[QLatin1String("__width__")].toInt(),
-               image[QLatin1String("__height__")].toInt());
-    QString cls = image[QLatin1String("__class__")].toString();
+    QSize size(image.value(QLatin1String("__width__")).toInt(),
+               image.value(QLatin1String("__height__")).toInt());
     int depth =
-        image[QLatin1String("__depth__")].toInt();
+        image.value(QLatin1String("__depth__")).toInt();
     QString formatName =
-        image[QLatin1String("__format__")].toString();
+        image.value(QLatin1String("__format__")).toString();
 
-    QByteArray dataArray =
-        image[QLatin1String("__data__")].toByteArray();
+    QByteArray dataArray = getImageData(image);
 
     QString userLabel =
-        image[QLatin1String("__label__")].toString();
+        image.value(QLatin1String("__label__")).toString();
     if (!userLabel.isEmpty()) {
         label += QString(", \"%1\"").arg(userLabel);
     }
@@ -464,117 +554,133 @@ static ApiTexture getTextureFrom(QVariantMap const &image, QString label)
     return tex;
 }
 
-ApiTraceState::ApiTraceState(const QVariantMap &parsedJson)
+static ApiFramebuffer getFramebufferFrom(const UBJSONObject &buffer, QString label)
 {
-    m_parameters = parsedJson[QLatin1String("parameters")].toMap();
-    QVariantMap attachedShaders =
-        parsedJson[QLatin1String("shaders")].toMap();
-    QVariantMap::const_iterator itr;
+    QSize size(buffer.value(QLatin1String("__width__")).toInt(),
+               buffer.value(QLatin1String("__height__")).toInt());
+    int depth = buffer.value(QLatin1String("__depth__")).toInt();
+    QString formatName = buffer.value(QLatin1String("__format__")).toString();
 
+    QByteArray dataArray = getImageData(buffer);
 
-    for (itr = attachedShaders.constBegin(); itr != attachedShaders.constEnd();
-         ++itr) {
-        QString type = itr.key();
-        QString source = itr.value().toString();
-        m_shaderSources[type] = source;
+    QString userLabel =
+        buffer.value(QLatin1String("__label__")).toString();
+    if (!userLabel.isEmpty()) {
+        label += QString(", \"%1\"").arg(userLabel);
     }
 
-    m_uniforms = parsedJson[QLatin1String("uniforms")].toMap();
-
-    m_buffers = parsedJson[QLatin1String("buffers")].toMap();
-
-    m_shaderStorageBufferBlocks =
-        parsedJson[QLatin1String("shaderstoragebufferblocks")].toMap();
-
-    {
-        QVariantMap textures =
-            parsedJson[QLatin1String("textures")].toMap();
-        for (itr = textures.constBegin(); itr != textures.constEnd(); ++itr) {
-            m_textures.append(getTextureFrom(itr.value().toMap(), itr.key()));
-        }
-    }
+    ApiFramebuffer fbo;
+    fbo.setSize(size);
+    fbo.setDepth(depth);
+    fbo.setFormatName(formatName);
+    fbo.setType(label);
+    fbo.setData(dataArray);
+    return fbo;
+}
 
-    QVariantMap fbos =
-        parsedJson[QLatin1String("framebuffer")].toMap();
-    for (itr = fbos.constBegin(); itr != fbos.constEnd(); ++itr) {
-        QVariantMap buffer = itr.value().toMap();
-        QSize size(buffer[QLatin1String("__width__")].toInt(),
-                   buffer[QLatin1String("__height__")].toInt());
-        QString cls = buffer[QLatin1String("__class__")].toString();
-        int depth = buffer[QLatin1String("__depth__")].toInt();
-        QString formatName = buffer[QLatin1String("__format__")].toString();
-
-        QByteArray dataArray =
-            buffer[QLatin1String("__data__")].toByteArray();
-
-        QString label = itr.key();
-        QString userLabel =
-            buffer[QLatin1String("__label__")].toString();
-        if (!userLabel.isEmpty()) {
-            label += QString(", \"%1\"").arg(userLabel);
-        }
+ApiTraceState::ApiTraceState(const UBJSONObject &json)
+    : m_json(json),
+      m_decoded(0)
+{
+}
 
-        ApiFramebuffer fbo;
-        fbo.setSize(size);
-        fbo.setDepth(depth);
-        fbo.setFormatName(formatName);
-        fbo.setType(label);
-        fbo.setData(dataArray);
-        m_framebuffers.append(fbo);
+bool ApiTraceState::needsDecoding(Section section) const
+{
+    if (m_decoded & section) {
+        return false;
     }
+    m_decoded |= section;
+    return true;
 }
 
 const QVariantMap & ApiTraceState::parameters() const
 {
+    if (needsDecoding(PARAMETERS)) {
+        m_parameters = m_json.value(QLatin1String("parameters")).toMap();
+    }
     return m_parameters;
 }
 
 const QMap<QString, QString> & ApiTraceState::shaderSources() const
 {
+    if (needsDecoding(SHADER_SOURCES)) {
+        QVariantMap attachedShaders =
+            m_json.value(QLatin1String("shaders")).toMap();
+        QVariantMap::const_iterator itr;
+        for (itr = attachedShaders.constBegin(); itr != attachedShaders.constEnd();
+             ++itr) {
+            QString type = itr.key();
+            QString source = itr.value().toString();
+            m_shaderSources[type] = source;
+        }
+    }
     return m_shaderSources;
 }
 
 const QVariantMap & ApiTraceState::uniforms() const
 {
+    if (needsDecoding(UNIFORMS)) {
+        m_uniforms = m_json.value(QLatin1String("uniforms")).toMap();
+    }
     return m_uniforms;
 }
 
 const QVariantMap & ApiTraceState::buffers() const
 {
+    if (needsDecoding(BUFFERS)) {
+        m_buffers = m_json.value(QLatin1String("buffers")).toMap();
+    }
     return m_buffers;
 }
 
 const QVariantMap &ApiTraceState::shaderStorageBufferBlocks() const
 {
+    if (needsDecoding(SHADER_STORAGE_BUFFER_BLOCKS)) {
+        m_shaderStorageBufferBlocks =
+            m_json.value(QLatin1String("shaderstoragebufferblocks")).toMap();
+    }
     return m_shaderStorageBufferBlocks;
 }
 
 bool ApiTraceState::isEmpty() const
 {
-    return m_parameters.isEmpty() &&
-           m_shaderSources.isEmpty() &&
-           m_textures.isEmpty() &&
-           m_framebuffers.isEmpty();
+    // Check without decoding anything
+    return m_json.object(QLatin1String("parameters")).isEmpty() &&
+           m_json.object(QLatin1String("shaders")).isEmpty() &&
+           m_json.object(QLatin1String("textures")).isEmpty() &&
+           m_json.object(QLatin1String("framebuffer")).isEmpty();
 }
 
 const QList<ApiTexture> & ApiTraceState::textures() const
 {
+    if (needsDecoding(TEXTURES)) {
+        UBJSONObject textures = m_json.object(QLatin1String("textures"));
+        foreach (const QString &name, textures.keys()) {
+            m_textures.append(getTextureFrom(textures.object(name), name));
+        }
+    }
     return m_textures;
 }
 
 const QList<ApiFramebuffer> & ApiTraceState::framebuffers() const
 {
+    if (needsDecoding(FRAMEBUFFERS)) {
+        UBJSONObject fbos = m_json.object(QLatin1String("framebuffer"));
+        foreach (const QString &name, fbos.keys()) {
+            m_framebuffers.append(getFramebufferFrom(fbos.object(name), name));
+        }
+    }
     return m_framebuffers;
 }
 
 ApiFramebuffer ApiTraceState::colorBuffer() const
 {
-    foreach (ApiFramebuffer fbo, m_framebuffers) {
+    foreach (ApiFramebuffer fbo, framebuffers()) {
         if (fbo.type() == QLatin1String("GL_BACK")) {
             return fbo;
         }
     }
-    foreach (ApiFramebuffer fbo, m_framebuffers) {
+    foreach (ApiFramebuffer fbo, framebuffers()) {
         if (fbo.type() == QLatin1String("GL_FRONT")) {
             return fbo;
         }
@@ -1083,22 +1189,10 @@ QString ApiTraceCall::searchText() const
     if (!m_searchText.isEmpty())
         return m_searchText;
 
-    QVector<QVariant> argValues = arguments();
-    m_searchText = m_signature->name() + QLatin1Literal("(");
-    QStringList argNames = m_signature->argNames();
-    for (int i = 0; i < argNames.count(); ++i) {
-        m_searchText += argNames[i] +
-                        QLatin1Literal(" = ") +
-                        apiVariantToString(argValues[i]);
-        if (i < argNames.count() - 1)
-            m_searchText += QLatin1String(", ");
-    }
-    m_searchText += QLatin1String(")");
-
-    if (m_returnValue.isValid()) {
-        m_searchText += QLatin1Literal(" = ") +
-                        apiVariantToString(m_returnValue);
-    }
+    m_searchText = callSearchText(m_signature->name(),
+                                  m_signature->argNames(),
+                                  arguments(),
+                                  m_returnValue);
     m_searchText.squeeze();
     return m_searchText;
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "apisurface.h"
+#include "qubjson.h"
 
 #include <QStaticText>
 #include <QStringList>
@@ -137,12 +138,19 @@ Q_DECLARE_METATYPE(ApiArray);
 
 QString apiVariantToString(const QVariant &variant, bool multiLine = false);
 
+/*
+ * Same text as ApiTraceCall::searchText(), but computed straight from the
+ * parsed call, without creating any GUI objects.  Safe to call from any
+ * thread.
+ */
+QString apiCallSearchText(const trace::Call *call);
+
 class ApiTraceFrame;
 
 class ApiTraceState {
 public:
     ApiTraceState();
-    explicit ApiTraceState(const QVariantMap &parseJson);
+    explicit ApiTraceState(const UBJSONObject &json);
 
     bool isEmpty() const;
     const QVariantMap & parameters() const;
@@ -155,13 +163,29 @@ public:
 
     ApiFramebuffer colorBuffer() const;
 private:
-    QVariantMap m_parameters;
-    QMap<QString, QString> m_shaderSources;
-    QVariantMap m_uniforms;
-    QVariantMap m_buffers;
-    QVariantMap m_shaderStorageBufferBlocks;
-    QList<ApiTexture> m_textures;
-    QList<ApiFramebuffer> m_framebuffers;
+    enum Section {
+        PARAMETERS                   = 1 << 0,
+        SHADER_SOURCES               = 1 << 1,
+        UNIFORMS                     = 1 << 2,
+        BUFFERS                      = 1 << 3,
+        SHADER_STORAGE_BUFFER_BLOCKS = 1 << 4,
+        TEXTURES                     = 1 << 5,
+        FRAMEBUFFERS                 = 1 << 6,
+    };
+
+    bool needsDecoding(Section section) const;
+
+    // Sections are only decoded when first asked for
+    UBJSONObject m_json;
+    mutable unsigned m_decoded;
+
+    mutable QVariantMap m_parameters;
+    mutable QMap<QString, QString> m_shaderSources;
+    mutable QVariantMap m_uniforms;
+    mutable QVariantMap m_buffers;
+    mutable QVariantMap m_shaderStorageBufferBlocks;
+    mutable QList<ApiTexture> m_textures;
+    mutable QList<ApiFramebuffer> m_framebuffers;
 };
 Q_DECLARE_METATYPE(ApiTraceState);
 
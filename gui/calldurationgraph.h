@@ -4,6 +4,8 @@
 #include "trace_profiler.hpp"
 #include "profiling.h"
 
+#include <algorithm>
+
 /**
  * Wrapper for call duration graphs.
  *
@@ -123,6 +125,46 @@ public:
         }
     }
 
+    virtual qint64 maxValue(qint64 begin, qint64 end) const override
+    {
+        if (!m_profile || begin >= end) {
+            return 0;
+        }
+
+        return m_profile->durations(m_gpu, begin, end).max;
+    }
+
+    virtual qint64 maxSelectedValue(qint64 begin, qint64 end) const override
+    {
+        if (!m_profile || !m_selectionState) {
+            return 0;
+        }
+
+        if (m_selectionState->type == SelectionState::Horizontal) {
+            return maxValue(qMax(begin, m_selectionState->start),
+                            qMin(end, m_selectionState->end));
+        } else if (m_selectionState->type == SelectionState::Vertical) {
+            /* Only visit the calls of the selected program */
+            qint64 program = m_selectionState->start;
+
+            if (program < 0 || program >= (qint64)m_profile->programs.size()) {
+                return 0;
+            }
+
+            const std::vector<unsigned>& calls = m_profile->programs[program].calls;
+            std::vector<unsigned>::const_iterator itr = std::lower_bound(calls.begin(), calls.end(), (unsigned)begin);
+            qint64 max = 0;
+
+            for (; itr != calls.end() && *itr < end; ++itr) {
+                max = qMax(max, value(*itr));
+            }
+
+            return max;
+        }
+
+        return 0;
+    }
+
     virtual void itemDoubleClicked(qint64 index) const override
     {
         if (!m_profile) {
@@ -150,7 +192,7 @@ public:
         const trace::Profile::Call& call = m_profile->calls[index];
 
         QString text;
-        text  = QString::fromStdString(call.name);
+        text  = QString::fromStdString(m_profile->getName(call));
         text += QString("\nCall: %1").arg(call.no);
         text += QString("\nCPU Duration: %1").arg(Profiling::getTimeString(call.cpuDuration));
 
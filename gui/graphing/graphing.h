@@ -1,6 +1,7 @@
 #pragma once
 
 #include <QString>
+#include <QtGlobal>
 
 /**
  * A simple struct to hold a horizontal or vertical selection
@@ -34,6 +35,32 @@ public:
     /* Is the item at index selected */
     virtual bool selected(qint64 index) const = 0;
 
+    /*
+     * Highest value of the items, or of the selected items, within [begin, end).
+     *
+     * Used to draw zoomed out graphs one pixel at a time; providers with
+     * many items should answer from a precomputed summary.
+     */
+    virtual qint64 maxValue(qint64 begin, qint64 end) const
+    {
+        qint64 max = 0;
+        for (qint64 i = begin; i < end; ++i) {
+            max = qMax(max, value(i));
+        }
+        return max;
+    }
+
+    virtual qint64 maxSelectedValue(qint64 begin, qint64 end) const
+    {
+        qint64 max = 0;
+        for (qint64 i = begin; i < end; ++i) {
+            if (selected(i)) {
+                max = qMax(max, value(i));
+            }
+        }
+        return max;
+    }
+
     /* Get mouse hover tooltip for item */
     virtual QString itemTooltip(qint64 index) const = 0;
 
@@ -100,13 +100,8 @@ void HistogramView::update()
     m_graphTop = 0;
 
     if (m_data) {
-        for (qint64 i = m_viewLeft; i < m_viewRight; ++i) {
-            qint64 value = m_data->value(i);
-
-            if (value > m_graphTop) {
-                m_graphTop = value;
-            }
-        }
+        m_graphTop = m_data->maxValue(qMax<qint64>(0, m_viewLeft),
+                                      qMin(m_viewRight, m_data->size()));
     }
 
     GraphView::update();
@@ -145,11 +140,10 @@ void HistogramView::paintEvent(QPaintEvent *)
     bool selection = m_selectionState && m_selectionState->type != SelectionState::None;
 
     if (dxdv < 1.0) {
-        /* Less than one pixel per item */
-        qint64 longestValue = m_graphBottom;
-        qint64 longestSelected = m_graphBottom;
-        int lastX = 0;
-        double x = 0;
+        /* Less than one pixel per item, draw the highest of each pixel */
+        qint64 viewLeft = qMax<qint64>(0, m_viewLeft);
+        qint64 viewRight = qMin(m_viewRight, m_data->size());
+        double dvdx = 1.0 / dxdv;
 
         if (selection) {
             painter.setPen(unselectedPen);
@@ -157,33 +151,25 @@ void HistogramView::paintEvent(QPaintEvent *)
             painter.setPen(selectedPen);
         }
 
-        for (qint64 i = m_viewLeft; i < m_viewRight; ++i) {
-            qint64 value = m_data->value(i);
-            int ix;
-
-            if (value > longestValue) {
-                longestValue = value;
-            }
+        for (int x = 0; x < width(); ++x) {
+            qint64 begin = qMax(viewLeft, m_viewLeft + (qint64)qCeil(x * dvdx));
+            qint64 end = qMin(viewRight, m_viewLeft + (qint64)qCeil((x + 1) * dvdx));
 
-            if (selection && m_data->selected(i) && value > longestSelected) {
-                longestSelected = value;
+            if (begin >= end) {
+                continue;
             }
 
-            x += dxdv;
-            ix = (int)x;
+            qint64 longestValue = m_data->maxValue(begin, end);
+            painter.drawLine(x, height(), x, height() - (longestValue * dydv));
 
-            if (lastX != ix) {
-                painter.drawLine(lastX, height(), lastX, height() - (longestValue * dydv));
+            if (selection) {
+                qint64 longestSelected = m_data->maxSelectedValue(begin, end);
 
-                if (selection && longestSelected > m_graphBottom) {
+                if (longestSelected > m_graphBottom) {
                     painter.setPen(selectedPen);
-                    painter.drawLine(lastX, height(), lastX, height() - (longestSelected * dydv));
+                    painter.drawLine(x, height(), x, height() - (longestSelected * dydv));
                     painter.setPen(unselectedPen);
-                    longestSelected = m_graphBottom;
                 }
-
-                longestValue = m_graphBottom;
-                lastX = ix;
             }
         }
     } else {
@@ -104,6 +104,15 @@ void MainWindow::openTrace()
 
 void MainWindow::saveTrace()
 {
+    if (m_trace->isSaving()) {
+        QMessageBox::warning(
+            this,
+            tr("Trace Saving"),
+            tr("QApiTrace is currently saving the edited trace file. "
+               "Please wait until it finishes and try again."));
+        return;
+    }
+
     QString localFile = m_trace->fileName();
 
     QString fileName =
@@ -123,7 +132,12 @@ void MainWindow::saveTrace()
                         .arg(fileName));
             }
         }
-        QFile::copy(localFile, fileName);
+        if (m_trace->edited()) {
+            // write out a new trace with the edits applied
+            m_trace->bake(fileName);
+        } else {
+            QFile::copy(localFile, fileName);
+        }
     }
 }
 
@@ -495,6 +509,7 @@ void MainWindow::replayTrace(bool dumpState, bool dumpThumbnails)
     }
 
     m_retracer->setFileName(m_trace->fileName());
+    m_retracer->setOverlayFileName(m_trace->overlayFileName());
     m_retracer->setAPI(m_api);
     m_retracer->setCaptureState(dumpState);
     m_retracer->setCaptureThumbnails(dumpThumbnails);
@@ -1534,14 +1549,15 @@ void MainWindow::slotStartedSaving()
 {
     m_progressBar->show();
     statusBar()->showMessage(
-        tr("Saving to %1").arg(m_trace->fileName()));
+        tr("Saving edits to %1").arg(m_trace->overlayFileName()));
 }
 
 void MainWindow::slotSaved()
 {
     statusBar()->showMessage(
-        tr("Saved to %1").arg(m_trace->fileName()), 2000);
+        tr("Saved edits to %1").arg(m_trace->overlayFileName()), 2000);
     m_progressBar->hide();
+    m_retracer->overlaySaved();
 }
 
 void MainWindow::slotGoFrameStart()
@@ -1,6 +1,8 @@
 #include "profiledialog.h"
 #include "profiletablemodel.h"
 #include <QSortFilterProxyModel>
+#include <QFile>
+#include <QDebug>
 
 #include "graphing/histogramview.h"
 #include "graphing/timeaxiswidget.h"
@@ -18,6 +20,44 @@ void Profiling::jumpToCall(int index)
     }
 }
 
+trace::Profile *Profiling::loadProfile(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qDebug() << "error: could not open" << fileName;
+        return NULL;
+    }
+
+    qint64 size = file.size();
+    if (size == 0) {
+        return new trace::Profile();
+    }
+
+    QByteArray contents;
+    const uchar *data = file.map(0, size);
+    if (!data) {
+        /* Fall back to reading when the file system does not support mapping */
+        contents = file.readAll();
+        data = reinterpret_cast<const uchar *>(contents.constData());
+        size = contents.size();
+    }
+
+    trace::Profile *profile = new trace::Profile();
+    if (trace::Profiler::parseBinary(data, size, profile)) {
+        /* Summarize here, as we are called from the retracer thread */
+        profile->summarize();
+    } else {
+        delete profile;
+        profile = NULL;
+    }
+
+    if (contents.isNull()) {
+        file.unmap(const_cast<uchar *>(data));
+    }
+
+    return profile;
+}
+
 /* Provides frame numbers based off call index */
 class FrameCallDataProvider : public FrameDataProvider {
 public:
@@ -3,6 +3,8 @@
 #include "graphing/heatmapview.h"
 #include "profiling.h"
 
+#include <qmath.h>
+
 /**
  * Data providers for a heatmap based off the trace::Profile call data
  */
@@ -14,7 +16,7 @@ public:
         m_step(-1),
         m_stepWidth(1),
         m_stepCount(steps),
-        m_index(0),
+        m_nextStep(0),
         m_timeStart(start),
         m_timeEnd(end),
         m_useGpu(gpu),
@@ -24,112 +26,87 @@ public:
         m_programSelection(false)
     {
         m_timeWidth = m_timeEnd - m_timeStart;
+
+        if (m_program == -1) {
+            m_timeline = m_useGpu ? &m_profile->gpuTimeline : &m_profile->cpuTimeline;
+        } else if (m_useGpu) {
+            m_timeline = &m_profile->programGpuTimelines[m_program];
+        } else {
+            m_timeline = &m_profile->programCpuTimelines[m_program];
+        }
+
+        /* Skip straight to the first visible call */
+        m_index = m_profile->findTimelineCall(*m_timeline, m_useGpu, m_timeStart);
     }
 
+    /*
+     * Calls spanning several steps are returned on their own, with a label.
+     * Otherwise the heat of a step is looked up from the profile timeline
+     * summary, so the cost only depends on the number of steps drawn and
+     * not on the number of calls within them.
+     */
     virtual bool next() override
     {
-        unsigned maxIndex = m_program == -1 ? m_profile->calls.size() : m_profile->programs[m_program].calls.size();
+        if (m_index >= m_timeline->calls.size() || m_nextStep >= m_stepCount) {
+            return false;
+        }
+
+        const trace::Profile::Call& call = m_profile->calls[m_timeline->calls[m_index]];
+        qint64 start = m_useGpu ? call.gpuStart : call.cpuStart;
+        qint64 duration = m_useGpu ? call.gpuDuration : call.cpuDuration;
+        qint64 end = start + duration;
 
-        if (m_index >= maxIndex) {
+        if (start > m_timeEnd) {
             return false;
         }
 
+        int leftStep = qMax(m_nextStep, (int)qFloor(timeToStep(start)));
+        int rightStep = timeToStep(end);
+
         double dtds = m_timeWidth / (double)m_stepCount;
 
-        qint64 heatDuration = 0;
-        qint64 programHeatDuration = 0;
         m_heat = 0.0f;
-        m_step += m_stepWidth;
-        m_stepWidth = 1;
-
+        m_programHeat = 0.0f;
         m_selected = false;
+        m_label = QString();
 
-        /* Iterator through calls until step != lastStep */
-        for (; m_index < maxIndex; ++m_index)
-        {
-            const trace::Profile::Call* call;
+        if (rightStep - leftStep > 1) {
+            m_label = QString::fromStdString(m_profile->getName(call));
+            m_step = leftStep;
+            m_stepWidth = rightStep - leftStep;
+            m_heat = 1.0f;
 
-            if (m_program == -1) {
-                call = &m_profile->calls[m_index];
-            } else {
-                call = &m_profile->calls[ m_profile->programs[m_program].calls[m_index] ];
-            }
-
-            qint64 start, duration, end;
-
-            if (m_useGpu) {
-                start = call->gpuStart;
-                duration = call->gpuDuration;
-
-                if (call->pixels < 0) {
-                    continue;
-                }
-            } else {
-                start = call->cpuStart;
-                duration = call->cpuDuration;
-            }
-
-            end = start + duration;
-
-            if (end < m_timeStart) {
-                continue;
-            }
-
-            if (start > m_timeEnd) {
-                m_index = m_profile->calls.size();
-                break;
-            }
-
-            double left  = timeToStep(start);
-            double right = timeToStep(end);
-
-            int leftStep = left;
-            int rightStep = right;
-
-            if (leftStep > m_step) {
-                break;
-            }
-
-            if (m_programSelection && call->program == m_programSel) {
+            if (m_programSelection && call.program == m_programSel) {
                 m_selected = true;
             }
 
-            if (rightStep - leftStep > 1) {
-                m_label = QString::fromStdString(call->name);
-                m_step = left;
-                m_stepWidth = rightStep - leftStep;
-                heatDuration = dtds;
-                ++m_index;
-                break;
-            }
-
-            if (leftStep < m_step) {
-                qint64 rightTime = stepToTime(rightStep);
-                heatDuration += end - rightTime;
-
-                if (m_programSelection && call->program == m_programSel) {
-                    programHeatDuration += end - rightTime;
-                }
-            } else if (leftStep == rightStep) {
-                heatDuration += duration;
-
-                if (m_programSelection && call->program == m_programSel) {
-                    programHeatDuration += duration;
-                }
-            } else if (rightStep - leftStep == 1) {
-                qint64 rightTime = stepToTime(rightStep);
-                heatDuration += rightTime - start;
-
-                if (m_programSelection && call->program == m_programSel) {
-                    programHeatDuration += rightTime - start;
+            m_nextStep = rightStep;
+            ++m_index;
+        } else {
+            qint64 stepStart = stepToTime(leftStep);
+            qint64 stepEnd = stepToTime(leftStep + 1);
+
+            m_step = leftStep;
+            m_stepWidth = 1;
+            m_heat = m_profile->busyTime(*m_timeline, m_useGpu, stepStart, stepEnd) / dtds;
+
+            if (m_programSelection) {
+                if (m_program == -1) {
+                    if (m_programSel >= 0 && m_programSel < (int)m_profile->programs.size()) {
+                        const trace::Profile::Timeline& selected = m_useGpu ?
+                            m_profile->programGpuTimelines[m_programSel] :
+                            m_profile->programCpuTimelines[m_programSel];
+                        m_programHeat = m_profile->busyTime(selected, m_useGpu, stepStart, stepEnd) / dtds;
+                    }
+                } else if (m_program == m_programSel) {
+                    m_programHeat = m_heat;
                 }
-
-                break;
             }
-        }
 
-        m_heat = heatDuration / dtds;
-        m_programHeat = programHeatDuration / dtds;
+            /* Move on to the first call still running after this step */
+            m_nextStep = leftStep + 1;
+            m_index = m_profile->findTimelineCall(*m_timeline, m_useGpu, stepEnd);
+        }
 
         if (m_timeSelection) {
             qint64 time = stepToTime(m_step);
@@ -218,8 +195,10 @@ private:
     int m_step;
     int m_stepWidth;
     int m_stepCount;
+    int m_nextStep;
 
-    unsigned m_index;
+    const trace::Profile::Timeline* m_timeline;
+    size_t m_index;
 
     float m_heat;
 
@@ -413,7 +392,7 @@ public:
         const trace::Profile::Call& call = m_profile->calls[index];
 
         QString text;
-        text  = QString::fromStdString(call.name);
+        text  = QString::fromStdString(m_profile->getName(call));
 
         text += QString("\nCall: %1").arg(call.no);
         text += QString("\nCPU Start: %1").arg(Profiling::getTimeString(call.cpuStart, 1e3));
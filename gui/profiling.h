@@ -11,6 +11,12 @@ public:
      */
     static void jumpToCall(int index);
 
+    /**
+     * Load a binary profile written by `glretrace --profile-format=binary`.
+     * Returns NULL on failure.
+     */
+    static trace::Profile *loadProfile(const QString &fileName);
+
     /**
      * Convert a CPU / GPU time to a textual representation.
      * This includes automatic unit selection.
@@ -26,6 +26,10 @@
 
 #include "qubjson.h"
 
+#include <limits.h>
+#include <string.h>
+
+#include <QBuffer>
 #include <QDebug>
 #include <QVariant>
 #include <QDataStream>
@@ -296,3 +300,316 @@ QVariant decodeUBJSONObject(QIODevice *io)
     return readVariant(stream, marker);
 }
 
+
+/*
+ * Structure of UBJSON values, used to find their extent without decoding
+ * them.  Sources provide the raw bytes, either from memory, or from a device.
+ */
+
+class MemorySource
+{
+public:
+    const char *ptr;
+    const char *end;
+
+    MemorySource(const char *_ptr, const char *_end) :
+        ptr(_ptr),
+        end(_end)
+    {}
+
+    bool fetch(void *buf, int size) {
+        if (end - ptr < size) {
+            return false;
+        }
+        memcpy(buf, ptr, size);
+        ptr += size;
+        return true;
+    }
+
+    bool skip(qint64 size) {
+        if (end - ptr < size) {
+            return false;
+        }
+        ptr += size;
+        return true;
+    }
+};
+
+
+// Copies the bytes it reads
+class DeviceSource
+{
+public:
+    QIODevice *io;
+    QByteArray &data;
+
+    DeviceSource(QIODevice *_io, QByteArray &_data) :
+        io(_io),
+        data(_data)
+    {}
+
+    bool fetch(void *buf, int size) {
+        if (io->read(static_cast<char *>(buf), size) != size) {
+            return false;
+        }
+        data.append(static_cast<const char *>(buf), size);
+        return true;
+    }
+
+    bool skip(qint64 size) {
+        int offset = data.size();
+        if (size > INT_MAX - offset) {
+            return false;
+        }
+        data.resize(offset + size);
+        return io->read(data.data() + offset, size) == size;
+    }
+};
+
+
+// Size of the payload of fixed size values, or -1
+static int
+scalarSize(Marker type)
+{
+    switch (type) {
+    case MARKER_NULL:
+    case MARKER_NOOP:
+    case MARKER_TRUE:
+    case MARKER_FALSE:
+        return 0;
+    case MARKER_INT8:
+    case MARKER_UINT8:
+    case MARKER_CHAR:
+        return 1;
+    case MARKER_INT16:
+        return 2;
+    case MARKER_INT32:
+    case MARKER_FLOAT32:
+        return 4;
+    case MARKER_INT64:
+    case MARKER_FLOAT64:
+        return 8;
+    default:
+        return -1;
+    }
+}
+
+
+template< class Source >
+static Marker
+scanMarker(Source &source)
+{
+    quint8 byte;
+    if (!source.fetch(&byte, 1)) {
+        return MARKER_EOF;
+    }
+    return static_cast<Marker>(byte);
+}
+
+
+template< class Source >
+static bool
+scanSize(Source &source, Marker type, qint64 &size)
+{
+    char buf[8];
+    switch (type) {
+    case MARKER_INT8:
+        if (!source.fetch(buf, 1)) {
+            return false;
+        }
+        size = static_cast<int8_t>(buf[0]);
+        break;
+    case MARKER_UINT8:
+        if (!source.fetch(buf, 1)) {
+            return false;
+        }
+        size = static_cast<uint8_t>(buf[0]);
+        break;
+    case MARKER_INT16: {
+        uint16_t u;
+        if (!source.fetch(&u, sizeof u)) {
+            return false;
+        }
+        size = static_cast<int16_t>(bigEndian16(u));
+        break;
+    }
+    case MARKER_INT32: {
+        uint32_t u;
+        if (!source.fetch(&u, sizeof u)) {
+            return false;
+        }
+        size = static_cast<int32_t>(bigEndian32(u));
+        break;
+    }
+    case MARKER_INT64: {
+        uint64_t u;
+        if (!source.fetch(&u, sizeof u)) {
+            return false;
+        }
+        size = static_cast<int64_t>(bigEndian64(u));
+        break;
+    }
+    default:
+        return false;
+    }
+    return size >= 0;
+}
+
+
+template< class Source >
+static bool
+scanValue(Source &source, Marker type)
+{
+    int size = scalarSize(type);
+    if (size >= 0) {
+        return source.skip(size);
+    }
+
+    switch (type) {
+    case MARKER_STRING:
+    case MARKER_HIGH_PRECISION: {
+        qint64 length;
+        return scanSize(source, scanMarker(source), length) &&
+               source.skip(length);
+    }
+    case MARKER_ARRAY_BEGIN: {
+        Marker marker = scanMarker(source);
+        if (marker == MARKER_TYPE || marker == MARKER_COUNT) {
+            Marker elementType = MARKER_EOF;
+            if (marker == MARKER_TYPE) {
+                elementType = scanMarker(source);
+                if (scanMarker(source) != MARKER_COUNT) {
+                    return false;
+                }
+            }
+            qint64 count;
+            if (!scanSize(source, scanMarker(source), count) ||
+                count > INT_MAX) {
+                return false;
+            }
+            // Strongly typed arrays of scalars (i.e., blobs) are skipped at once
+            int elementSize = scalarSize(elementType);
+            if (elementSize >= 0) {
+                return source.skip(count * elementSize);
+            }
+            for (qint64 i = 0; i < count; ++i) {
+                Marker element = elementType;
+                if (element == MARKER_EOF) {
+                    element = scanMarker(source);
+                }
+                if (!scanValue(source, element)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        while (marker != MARKER_ARRAY_END) {
+            if (!scanValue(source, marker)) {
+                return false;
+            }
+            marker = scanMarker(source);
+        }
+        return true;
+    }
+    case MARKER_OBJECT_BEGIN: {
+        Marker marker = scanMarker(source);
+        while (marker != MARKER_OBJECT_END) {
+            qint64 length;
+            if (!scanSize(source, marker, length) ||
+                !source.skip(length) ||
+                !scanValue(source, scanMarker(source))) {
+                return false;
+            }
+            marker = scanMarker(source);
+        }
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+
+UBJSONObject
+UBJSONObject::read(QIODevice *io)
+{
+    QByteArray data;
+    DeviceSource source(io, data);
+    Marker marker = scanMarker(source);
+    if (marker != MARKER_OBJECT_BEGIN ||
+        !scanValue(source, marker)) {
+        qDebug() << "error: truncated or malformed UBJSON object";
+        return UBJSONObject();
+    }
+    return UBJSONObject(data, 0);
+}
+
+
+UBJSONObject
+UBJSONObject::fromData(const QByteArray &data)
+{
+    return UBJSONObject(data, 0);
+}
+
+
+UBJSONObject::UBJSONObject(const QByteArray &data, int offset) :
+    m_data(data)
+{
+    const char *begin = m_data.constData();
+    MemorySource source(begin + offset, begin + m_data.size());
+    if (scanMarker(source) != MARKER_OBJECT_BEGIN) {
+        return;
+    }
+
+    Marker marker = scanMarker(source);
+    while (marker != MARKER_OBJECT_END) {
+        qint64 length;
+        if (!scanSize(source, marker, length) ||
+            length > source.end - source.ptr) {
+            qDebug() << "error: malformed UBJSON object";
+            return;
+        }
+        QString name = QString::fromUtf8(source.ptr, int(length));
+        source.ptr += length;
+
+        int valueOffset = source.ptr - begin;
+        if (!scanValue(source, scanMarker(source))) {
+            qDebug() << "error: malformed UBJSON object";
+            return;
+        }
+        m_members[name] = valueOffset;
+
+        marker = scanMarker(source);
+    }
+}
+
+
+QVariant
+UBJSONObject::value(const QString &key) const
+{
+    QMap<QString, int>::const_iterator it = m_members.constFind(key);
+    if (it == m_members.constEnd()) {
+        return QVariant();
+    }
+
+    // Decode in place, without copying the document
+    QByteArray data = QByteArray::fromRawData(m_data.constData() + it.value(),
+                                              m_data.size() - it.value());
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+    QDataStream stream(&buffer);
+    stream.setByteOrder(QDataStream::BigEndian);
+    Marker marker = readMarker(stream);
+    return readVariant(stream, marker);
+}
+
+
+UBJSONObject
+UBJSONObject::object(const QString &key) const
+{
+    QMap<QString, int>::const_iterator it = m_members.constFind(key);
+    if (it == m_members.constEnd()) {
+        return UBJSONObject();
+    }
+    return UBJSONObject(m_data, it.value());
+}
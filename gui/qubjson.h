@@ -27,8 +27,53 @@
 #pragma once
 
 
+#include <QByteArray>
+#include <QMap>
+#include <QStringList>
 #include <QVariantMap>
 
 class QIODevice;
 
 QVariant decodeUBJSONObject(QIODevice *io);
+
+
+/*
+ * UBJSON object whose members are merely located when read, and only decoded
+ * when asked for, so that members nobody looks at (e.g., the images of states
+ * which are never displayed) cost nothing beyond their raw bytes.
+ */
+class UBJSONObject
+{
+public:
+    UBJSONObject() {}
+
+    // Read the raw bytes of the next object in the device
+    static UBJSONObject read(QIODevice *io);
+
+    static UBJSONObject fromData(const QByteArray &data);
+
+    bool isEmpty() const {
+        return m_members.isEmpty();
+    }
+
+    QStringList keys() const {
+        return m_members.keys();
+    }
+
+    bool contains(const QString &key) const {
+        return m_members.contains(key);
+    }
+
+    QVariant value(const QString &key) const;
+
+    // Object member, itself decoded on demand
+    UBJSONObject object(const QString &key) const;
+
+private:
+    UBJSONObject(const QByteArray &data, int offset);
+
+    QByteArray m_data;
+
+    // Offset of each member's value
+    QMap<QString, int> m_members;
+};
@@ -149,6 +149,53 @@ TEST(qubjson, binary_data) {
 }
 
 
+TEST(qubjson, lazy_object) {
+    static const unsigned char X[] = {
+        '{',
+            'U', 1, 'A', 'i', 1,
+            'U', 1, 'B', '{',
+                'U', 1, 'C', '[', '$', 'U', '#', 'U', 3, 'x', 'y', 'z',
+                'U', 1, 'D', '[', 'S', 'U', 1, 'w', 'i', 1, ']',
+            '}',
+        '}',
+        'Z', // trailing bytes
+    };
+    QByteArray bytearray((const char *)X, sizeof X);
+    QBuffer buffer(&bytearray);
+    buffer.open(QIODevice::ReadOnly);
+
+    UBJSONObject object = UBJSONObject::read(&buffer);
+    EXPECT_EQ(1, buffer.bytesAvailable());
+
+    EXPECT_EQ(QStringList() << "A" << "B", object.keys());
+    EXPECT_EQ(QVariant(1), object.value("A"));
+    EXPECT_EQ(QVariant(), object.value("E"));
+
+    UBJSONObject nested = object.object("B");
+    EXPECT_EQ(QStringList() << "C" << "D", nested.keys());
+    EXPECT_EQ(QVariant(QByteArray("xyz")), nested.value("C"));
+
+    QVariantList list;
+    list.append("w");
+    list.append(1);
+    EXPECT_EQ(QVariant(list), nested.value("D"));
+
+    EXPECT_TRUE(object.object("A").isEmpty());
+}
+
+
+TEST(qubjson, lazy_object_truncated) {
+    static const unsigned char X[] = {
+        '{', 'U', 1, 'A', '[', '$', 'U', '#', 'U', 3, 'x', 'y',
+    };
+    QByteArray bytearray((const char *)X, sizeof X);
+    QBuffer buffer(&bytearray);
+    buffer.open(QIODevice::ReadOnly);
+
+    EXPECT_TRUE(UBJSONObject::read(&buffer).isEmpty());
+}
+
+
 int
 main(int argc, char **argv)
 {
@@ -5,16 +5,68 @@
 
 #include "image.hpp"
 
-#include "trace_profiler.hpp"
+#include "profiling.h"
 
+#include <QBuffer>
 #include <QDebug>
+#include <QDateTime>
+#include <QDir>
 #include <QVariant>
 #include <QList>
+#include <QMutex>
 #include <QImage>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTemporaryFile>
 
 #include "qubjson.h"
 
 
+/**
+ * Remove cached images which no state dump has written for a while, along
+ * with temporaries left behind by interrupted dumps.
+ */
+static void
+pruneImageCache(const QString &path)
+{
+    QDateTime now = QDateTime::currentDateTime();
+    QDir dir(path);
+    foreach (const QFileInfo &info, dir.entryInfoList(QDir::Files)) {
+        int maxAge = info.suffix() == QLatin1String("tmp") ? 1 : 7; // days
+        if (info.lastModified().daysTo(now) >= maxAge) {
+            dir.remove(info.fileName());
+        }
+    }
+}
+
+
+/**
+ * Directory shared by all state dumps for their images.  Images are named
+ * after their contents, so the directory can be reused across dumps and runs.
+ * It lives in the per-user cache location, and is pruned once per session.
+ */
+static QString
+imageCacheDirectory(void)
+{
+    static QMutex mutex;
+    static QString path;
+
+    QMutexLocker locker(&mutex);
+    if (path.isEmpty()) {
+        QString cache = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+        if (!cache.isEmpty() && QDir().mkpath(cache + QLatin1String("/images"))) {
+            path = cache + QLatin1String("/images");
+            pruneImageCache(path);
+        } else {
+            // Private and removed on exit, unlike a fixed path under /tmp
+            static QTemporaryDir fallback(QDir::tempPath() + QLatin1String("/qapitrace-images-XXXXXX"));
+            path = fallback.path();
+        }
+    }
+    return path;
+}
+
+
 /**
  * Wrapper around a QProcess which enforces IO to block .
  *
@@ -127,6 +179,169 @@ qint64 BlockingIODevice::writeData(const char * data, qint64 maxSize)
 
 Q_DECLARE_METATYPE(QList<ApiTraceError>);
 
+
+/**
+ * A state lookup, and its outcome.
+ */
+struct StateLookup
+{
+    StateLookup()
+        : call(0),
+          found(false)
+    {}
+
+    QString prog;
+    QStringList arguments;
+    qlonglong call;
+
+    bool found;
+    UBJSONObject json;
+    QString msg;
+    // Everything the server wrote to stderr since it started, so that
+    // errors from earlier lookups are reported again
+    QByteArray errorOutput;
+};
+
+Q_DECLARE_METATYPE(StateLookup *);
+
+
+/**
+ * Owner of the persistent `--server` retrace process used for state lookups.
+ *
+ * The server only replays forward, so as long as the user keeps moving
+ * forward through the trace each lookup merely replays the calls since the
+ * previous one.  Going backwards, changing any option, or saving the
+ * overlay (which the server only reads when it starts) starts a new server.
+ *
+ * A QProcess must be used from the thread that created it, whereas each
+ * lookup comes from a new Retracer::run() thread, so this object lives in a
+ * thread of its own for as long as the Retracer does.
+ */
+class StateServer : public QObject
+{
+    Q_OBJECT
+public:
+    StateServer()
+        : m_process(NULL),
+          m_call(0)
+    {}
+
+public slots:
+    void lookup(StateLookup *lookup);
+    void stop();
+
+private:
+    bool request(StateLookup &lookup, QByteArray &status);
+
+    QProcess *m_process;
+    QStringList m_arguments;
+    qlonglong m_call;
+    QByteArray m_errorOutput;
+};
+
+
+void StateServer::lookup(StateLookup *lookup)
+{
+    QStringList arguments = QStringList() << lookup->prog << lookup->arguments;
+
+    if (m_process &&
+        (m_process->state() != QProcess::Running ||
+         m_arguments != arguments ||
+         lookup->call < m_call)) {
+        stop();
+    }
+
+    while (true) {
+        bool fresh = !m_process;
+        if (fresh) {
+            qDebug() << "Running:" << lookup->prog << lookup->arguments;
+
+            m_process = new QProcess;
+            m_process->start(lookup->prog, lookup->arguments, QIODevice::ReadWrite);
+            if (!m_process->waitForStarted(-1)) {
+                stop();
+                lookup->msg = QLatin1String("Could not start process");
+                return;
+            }
+            m_arguments = arguments;
+            m_call = 0;
+            m_errorOutput.clear();
+        }
+
+        QByteArray status;
+        lookup->found = request(*lookup, status);
+        m_errorOutput += m_process->readAllStandardError();
+        lookup->errorOutput = m_errorOutput;
+        if (lookup->found) {
+            lookup->msg = QLatin1String("Replay finished!");
+            m_call = lookup->call;
+            return;
+        }
+
+        stop();
+
+        // The server may have replayed past the requested call (e.g., due to
+        // calls spanning frames), so replay again from the start, once.
+        if (fresh || status.isEmpty()) {
+            return;
+        }
+    }
+}
+
+
+/**
+ * Send a single `state` request to the server and decode its reply.
+ *
+ * The status is left empty if the server did not reply at all.
+ */
+bool StateServer::request(StateLookup &lookup, QByteArray &status)
+{
+    QByteArray request = "state " + QByteArray::number(lookup.call) + "\n";
+    m_process->write(request);
+    m_process->waitForBytesWritten(-1);
+
+    m_process->setReadChannel(QProcess::StandardOutput);
+    BlockingIODevice io(m_process);
+
+    // "STATUS LENGTH" line, followed by LENGTH bytes of payload
+    QList<QByteArray> header = io.readLine().trimmed().split(' ');
+    if (header.size() != 2) {
+        lookup.msg = QLatin1String("Process crashed");
+        return false;
+    }
+    status = header[0];
+    QByteArray payload = io.read(header[1].toLongLong());
+
+    if (status != "ok") {
+        lookup.msg = QString::fromUtf8(payload);
+        return false;
+    }
+
+    lookup.json = UBJSONObject::fromData(payload);
+    return true;
+}
+
+
+void StateServer::stop()
+{
+    if (!m_process) {
+        return;
+    }
+
+    if (m_process->state() == QProcess::Running) {
+        m_process->write("quit\n");
+        m_process->closeWriteChannel();
+        if (!m_process->waitForFinished(1000)) {
+            m_process->kill();
+            m_process->waitForFinished(-1);
+        }
+    }
+
+    delete m_process;
+    m_process = NULL;
+}
+
+
 Retracer::Retracer(QObject *parent)
     : QThread(parent),
       m_benchmarking(false),
@@ -142,6 +357,22 @@ Retracer::Retracer(QObject *parent)
       m_profileMemory(false)
 {
     qRegisterMetaType<QList<ApiTraceError> >();
+    qRegisterMetaType<StateLookup *>();
+
+    m_stateServer = new StateServer;
+    m_serverThread = new QThread;
+    m_stateServer->moveToThread(m_serverThread);
+    m_serverThread->start();
+}
+
+Retracer::~Retracer()
+{
+    QMetaObject::invokeMethod(m_stateServer, "stop",
+                              Qt::BlockingQueuedConnection);
+    m_serverThread->quit();
+    m_serverThread->wait();
+    delete m_stateServer;
+    delete m_serverThread;
 }
 
 QString Retracer::fileName() const
@@ -154,6 +385,22 @@ void Retracer::setFileName(const QString &name)
     m_fileName = name;
 }
 
+QString Retracer::overlayFileName() const
+{
+    return m_overlayFileName;
+}
+
+void Retracer::setOverlayFileName(const QString &name)
+{
+    m_overlayFileName = name;
+}
+
+void Retracer::overlaySaved()
+{
+    // Queued after any lookup in progress, so the next one starts afresh
+    QMetaObject::invokeMethod(m_stateServer, "stop", Qt::QueuedConnection);
+}
+
 QString Retracer::remoteTarget() const
 {
     return m_remoteTarget;
@@ -306,7 +553,7 @@ QString Retracer::thumbnailCallSet() const
     return callSet;
 }
 
-QStringList Retracer::retraceArguments() const
+QStringList Retracer::retraceArguments(bool server) const
 {
     QStringList arguments;
 
@@ -319,8 +566,13 @@ QStringList Retracer::retraceArguments() const
     }
 
     if (m_captureState) {
-        arguments << QLatin1String("-D");
-        arguments << QString::number(m_captureCall);
+        if (server) {
+            // The call to dump comes with each request instead
+            arguments << QLatin1String("--server");
+        } else {
+            arguments << QLatin1String("-D");
+            arguments << QString::number(m_captureCall);
+        }
         arguments << QLatin1String("--dump-format");
         arguments << QLatin1String("ubjson");
     } else if (m_captureThumbnails) {
@@ -360,6 +612,33 @@ QStringList Retracer::retraceArguments() const
     return arguments;
 }
 
+/**
+ * Parse the warnings and errors a retrace process wrote to `device`.
+ */
+static void
+parseErrors(QIODevice &device, QList<ApiTraceError> &errors)
+{
+    QRegExp regexp("(^\\d+): +(\\b\\w+\\b): ([^\\r\\n]+)[\\r\\n]*$");
+    while (!device.atEnd()) {
+        QString line = device.readLine();
+        if (regexp.indexIn(line) != -1) {
+            ApiTraceError error;
+            error.callIndex = regexp.cap(1).toInt();
+            error.type = regexp.cap(2);
+            error.message = regexp.cap(3);
+            errors.append(error);
+        } else if (!errors.isEmpty()) {
+            // Probably a multiligne message
+            ApiTraceError &previous = errors.last();
+            if (line.endsWith("\n")) {
+                line.chop(1);
+            }
+            previous.message.append('\n');
+            previous.message.append(line);
+        }
+    }
+}
+
 /**
  * Starting point for the retracing thread.
  *
@@ -400,7 +679,20 @@ void Retracer::run()
         return;
     }
 
-    arguments << retraceArguments() << m_fileName;
+    bool server = m_captureState && !m_captureThumbnails;
+
+    arguments << retraceArguments(server);
+    if (!m_overlayFileName.isEmpty()) {
+        arguments << QLatin1String("--overlay") << m_overlayFileName;
+    }
+    if (isProfiling()) {
+        arguments << QLatin1String("--profile-format") << QLatin1String("binary");
+    }
+    if (m_captureState && m_remoteTarget.isEmpty()) {
+        // Remote targets would write the images where we can't read them
+        arguments << QLatin1String("--dump-images") << imageCacheDirectory();
+    }
+    arguments << m_fileName;
 
     /*
      * Support remote execution on a separate target.
@@ -412,6 +704,11 @@ void Retracer::run()
         prog = QLatin1String("ssh");
     }
 
+    if (server) {
+        runStateServer(prog, arguments);
+        return;
+    }
+
     /*
      * Start the process.
      */
@@ -427,6 +724,20 @@ void Retracer::run()
 
     QProcess process;
 
+    /*
+     * Profiles are written straight to a file, which is then mapped and
+     * decoded in one go.
+     */
+    QTemporaryFile profileFile(QDir::tempPath() + QLatin1String("/qapitrace-XXXXXX.profile"));
+    if (isProfiling()) {
+        if (!profileFile.open()) {
+            emit finished(QLatin1String("Could not create profile file"));
+            return;
+        }
+        profileFile.close();
+        process.setStandardOutputFile(profileFile.fileName());
+    }
+
     process.start(prog, arguments, QIODevice::ReadOnly);
     if (!process.waitForStarted(-1)) {
         emit finished(QLatin1String("Could not start process"));
@@ -438,15 +749,15 @@ void Retracer::run()
      */
 
     ImageHash thumbnails;
-    QVariantMap parsedJson;
+    UBJSONObject json;
     trace::Profile* profile = NULL;
 
     process.setReadChannel(QProcess::StandardOutput);
-    if (process.waitForReadyRead(-1)) {
+    if (!isProfiling() && process.waitForReadyRead(-1)) {
         BlockingIODevice io(&process);
 
         if (m_captureState) {
-            parsedJson = decodeUBJSONObject(&io).toMap();
+            json = UBJSONObject::read(&io);
             process.waitForFinished(-1);
         } else if (m_captureThumbnails) {
             /*
@@ -501,20 +812,6 @@ void Retracer::run()
             }
 
             Q_ASSERT(process.state() != QProcess::Running);
-        } else if (isProfiling()) {
-            profile = new trace::Profile();
-
-            while (!io.atEnd()) {
-                char line[256];
-                qint64 lineLength;
-
-                lineLength = io.readLine(line, 256);
-
-                if (lineLength == -1)
-                    break;
-
-                trace::Profiler::parseLine(line, profile);
-            }
         } else {
             QByteArray output;
             output = process.readAllStandardOutput();
@@ -536,38 +833,24 @@ void Retracer::run()
         msg = QLatin1String("Process exited with non zero exit code");
     }
 
+    if (isProfiling()) {
+        profile = Profiling::loadProfile(profileFile.fileName());
+    }
+
     /*
      * Parse errors.
      */
 
     QList<ApiTraceError> errors;
     process.setReadChannel(QProcess::StandardError);
-    QRegExp regexp("(^\\d+): +(\\b\\w+\\b): ([^\\r\\n]+)[\\r\\n]*$");
-    while (!process.atEnd()) {
-        QString line = process.readLine();
-        if (regexp.indexIn(line) != -1) {
-            ApiTraceError error;
-            error.callIndex = regexp.cap(1).toInt();
-            error.type = regexp.cap(2);
-            error.message = regexp.cap(3);
-            errors.append(error);
-        } else if (!errors.isEmpty()) {
-            // Probably a multiligne message
-            ApiTraceError &previous = errors.last();
-            if (line.endsWith("\n")) {
-                line.chop(1);
-            }
-            previous.message.append('\n');
-            previous.message.append(line);
-        }
-    }
+    parseErrors(process, errors);
 
     /*
      * Emit signals
      */
 
     if (m_captureState) {
-        ApiTraceState *state = new ApiTraceState(parsedJson);
+        ApiTraceState *state = new ApiTraceState(json);
         emit foundState(state);
     }
 
@@ -586,4 +869,34 @@ void Retracer::run()
     emit finished(msg);
 }
 
+/**
+ * Look up the state through the persistent `--server` retrace process.
+ */
+void Retracer::runStateServer(const QString &prog, const QStringList &arguments)
+{
+    StateLookup lookup;
+    lookup.prog = prog;
+    lookup.arguments = arguments;
+    lookup.call = m_captureCall;
+    QMetaObject::invokeMethod(m_stateServer, "lookup",
+                              Qt::BlockingQueuedConnection,
+                              Q_ARG(StateLookup *, &lookup));
+
+    QList<ApiTraceError> errors;
+    QBuffer errorBuffer(&lookup.errorOutput);
+    errorBuffer.open(QIODevice::ReadOnly);
+    parseErrors(errorBuffer, errors);
+
+    if (lookup.found) {
+        ApiTraceState *state = new ApiTraceState(lookup.json);
+        emit foundState(state);
+    }
+
+    if (!errors.isEmpty()) {
+        emit retraceErrors(errors);
+    }
+
+    emit finished(lookup.msg);
+}
+
 #include "retracer.moc"
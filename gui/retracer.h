@@ -8,6 +8,7 @@
 #include <QProcess>
 
 class ApiTraceState;
+class StateServer;
 
 namespace trace { struct Profile; }
 
@@ -16,10 +17,18 @@ class Retracer : public QThread
     Q_OBJECT
 public:
     Retracer(QObject *parent=0);
+    ~Retracer();
 
     QString fileName() const;
     void setFileName(const QString &name);
 
+    QString overlayFileName() const;
+    void setOverlayFileName(const QString &name);
+    /*
+     * The overlay was written to, so state lookups must replay it afresh.
+     */
+    void overlaySaved();
+
     QString remoteTarget() const;
     void setRemoteTarget(const QString &host);
 
@@ -57,7 +66,11 @@ public:
     void resetThumbnailsToCapture();
     QString thumbnailCallSet() const;
 
-    QStringList retraceArguments() const;
+    /*
+     * Command line options for a replay, or, with `server`, for a `--server`
+     * process doing state lookups.
+     */
+    QStringList retraceArguments(bool server = false) const;
 
 signals:
     void finished(const QString &output);
@@ -71,7 +84,10 @@ protected:
     virtual void run() override;
 
 private:
+    void runStateServer(const QString &prog, const QStringList &arguments);
+
     QString m_fileName;
+    QString m_overlayFileName;
     QString m_remoteTarget;
     trace::API m_api;
     bool m_benchmarking;
@@ -89,4 +105,7 @@ private:
     QProcessEnvironment m_processEnvironment;
 
     QList<qlonglong> m_thumbnailsToCapture;
+
+    StateServer *m_stateServer;
+    QThread *m_serverThread;
 };
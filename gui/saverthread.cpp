@@ -1,5 +1,7 @@
 #include "saverthread.h"
 
+#include "traceloader.h"
+
 #include "trace_writer.hpp"
 #include "trace_model.hpp"
 #include "trace_parser.hpp"
@@ -332,54 +334,133 @@ overwriteValue(trace::Call *call, const QVariant &val, int index)
 }
 
 SaverThread::SaverThread(QObject *parent)
-    : QThread(parent)
+    : QThread(parent),
+      m_loader(0),
+      m_baking(false)
 {
 }
 
-void SaverThread::saveFile(const QString &writeFileName,
+void SaverThread::saveFile(const QString &overlayFileName,
                            const QString &readFileName,
-                           const QSet<ApiTraceCall*> &editedCalls)
+                           const QSet<ApiTraceCall*> &editedCalls,
+                           const TraceLoader *loader)
 {
-    m_writeFileName = writeFileName;
+    m_overlayFileName = overlayFileName;
     m_readFileName = readFileName;
     m_editedCalls = editedCalls;
+    m_loader = loader;
+    m_baking = false;
+    start();
+}
+
+void SaverThread::bakeFile(const QString &writeFileName,
+                           const QString &readFileName,
+                           const QString &overlayFileName)
+{
+    m_writeFileName = writeFileName;
+    m_readFileName = readFileName;
+    m_overlayFileName = overlayFileName;
+    m_baking = true;
     start();
 }
 
 void SaverThread::run()
 {
-    qDebug() << "Saving  " << m_readFileName
-             << ", to " << m_writeFileName;
+    if (m_baking) {
+        bake();
+    } else {
+        saveOverlay();
+    }
+
+    emit traceSaved();
+}
+
+/*
+ * Write only the edited calls, keyed by call number, into the overlay.
+ *
+ * Rather than parsing the trace from the start, jump to the frame of the
+ * earliest edited call not written yet, unless already past its start, and
+ * parse until that call shows up.
+ */
+void SaverThread::saveOverlay()
+{
+    qDebug() << "Saving edits of " << m_readFileName
+             << ", to " << m_overlayFileName;
     QMap<int, ApiTraceCall*> callIndexMap;
 
     foreach(ApiTraceCall *call, m_editedCalls) {
         callIndexMap.insert(call->index(), call);
     }
 
-    trace::Writer writer;
-    writer.open(m_writeFileName.toLocal8Bit());
+    trace::OverlayWriter writer;
+    writer.open(m_overlayFileName.toLocal8Bit());
 
     trace::Parser parser;
     parser.open(m_readFileName.toLocal8Bit());
+    m_loader->copySignatures(parser);
+
+    while (!callIndexMap.isEmpty()) {
+        unsigned firstIndex = callIndexMap.begin().key();
+        ApiTraceFrame *frame = callIndexMap.begin().value()->parentFrame();
 
-    trace::Call *call;
-    while ((call = parser.parse_call())) {
-        if (callIndexMap.contains(call->no)) {
-            QVector<QVariant> values = callIndexMap[call->no]->editedValues();
-            for (int i = 0; i < values.count(); ++i) {
-                const QVariant &val = values[i];
-                overwriteValue(call, val, i);
+        trace::ParseBookmark current, frameStart;
+        parser.getBookmark(current);
+        if (m_loader->frameStart(frame->number, frameStart) &&
+            frameStart.next_call_no > current.next_call_no) {
+            parser.setBookmark(frameStart);
+        }
+
+        bool found = false;
+        trace::Call *call;
+        while (!found && (call = parser.parse_call())) {
+            found = call->no == firstIndex;
+            QMap<int, ApiTraceCall*>::iterator it = callIndexMap.find(call->no);
+            if (it != callIndexMap.end()) {
+                QVector<QVariant> values = it.value()->editedValues();
+                for (int i = 0; i < values.count(); ++i) {
+                    const QVariant &val = values[i];
+                    overwriteValue(call, val, i);
+                }
+                writer.writeCall(call);
+                callIndexMap.erase(it);
             }
-            writer.writeCall(call);
-        } else {
-            writer.writeCall(call);
+            delete call;
+        }
+        if (!found) {
+            qWarning() << "Edited call " << firstIndex << " not found";
+            break;
         }
-        delete call;
     }
 
     writer.close();
+}
 
-    emit traceSaved();
+/*
+ * Write a whole new trace, with the overlay applied.
+ */
+void SaverThread::bake()
+{
+    qDebug() << "Baking  " << m_readFileName
+             << " with " << m_overlayFileName
+             << ", to " << m_writeFileName;
+
+    trace::Writer writer;
+    writer.open(m_writeFileName.toLocal8Bit());
+
+    trace::AbstractParser *parser =
+        trace::overlayParser(new trace::Parser,
+                             m_overlayFileName.toLocal8Bit());
+    if (parser->open(m_readFileName.toLocal8Bit())) {
+        trace::Call *call;
+        while ((call = parser->parse_call())) {
+            writer.writeCall(call);
+            delete call;
+        }
+        parser->close();
+    }
+    delete parser;
+
+    writer.close();
 }
 
 #include "saverthread.moc"
@@ -7,6 +7,7 @@
 
 class ApiTraceCall;
 class ApiTraceFrame;
+class TraceLoader;
 
 class SaverThread : public QThread
 {
@@ -15,9 +16,13 @@ public:
     SaverThread(QObject *parent=0);
 
 public slots:
-    void saveFile(const QString &saveFileName,
+    void saveFile(const QString &overlayFileName,
                   const QString &readFileName,
-                  const QSet<ApiTraceCall*> &editedCalls);
+                  const QSet<ApiTraceCall*> &editedCalls,
+                  const TraceLoader *loader);
+    void bakeFile(const QString &writeFileName,
+                  const QString &readFileName,
+                  const QString &overlayFileName);
 
 signals:
     void traceSaved();
@@ -26,7 +31,13 @@ protected:
     virtual void run() override;
 
 private:
+    void saveOverlay();
+    void bake();
+
     QString m_readFileName;
     QString m_writeFileName;
+    QString m_overlayFileName;
     QSet<ApiTraceCall*> m_editedCalls;
+    const TraceLoader *m_loader;
+    bool m_baking;
 };
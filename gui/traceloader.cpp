@@ -1,11 +1,21 @@
 #include "traceloader.h"
 
 #include "apitrace.h"
+#include <QAtomicInt>
 #include <QDebug>
 #include <QFile>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+
+#include <limits.h>
 
 #define FRAMES_TO_CACHE 100
 
+// Minimum number of calls handed to a search worker at a time
+#define SEARCH_CHUNK_CALLS 8192
+
 static ApiTraceCall *
 apiCallFromTraceCall(const trace::Call *call,
                      const QHash<QString, QUrl> &helpHash,
@@ -42,15 +52,19 @@ void TraceLoader::loadTrace(const QString &filename)
         loadHelpFile();
     }
 
+    QMutexLocker locker(&m_mutex);
+
     if (!m_frameBookmarks.isEmpty()) {
         qDeleteAll(m_signatures);
         m_signatures.clear();
         m_frameBookmarks.clear();
         m_createdFrames.clear();
         m_parser.close();
+        m_scannedSignatures.close();
     }
 
-    if (!m_parser.open(filename.toLatin1())) {
+    m_filename = filename.toLatin1();
+    if (!m_parser.open(m_filename)) {
         qDebug() << "error: failed to open " << filename;
         return;
     }
@@ -68,10 +82,30 @@ void TraceLoader::loadTrace(const QString &filename)
 
     scanTrace();
 
+    m_scannedSignatures.copySignatures(m_parser);
+    locker.unlock();
+
     emit guessedApi(static_cast<int>(m_parser.api));
     emit finishedParsing();
 }
 
+void TraceLoader::copySignatures(trace::Parser &parser) const
+{
+    QMutexLocker locker(&m_mutex);
+    parser.copySignatures(m_scannedSignatures);
+}
+
+bool TraceLoader::frameStart(int frameIdx, trace::ParseBookmark &bookmark) const
+{
+    QMutexLocker locker(&m_mutex);
+    FrameBookmarks::const_iterator itr = m_frameBookmarks.find(frameIdx);
+    if (itr == m_frameBookmarks.end()) {
+        return false;
+    }
+    bookmark = itr->start;
+    return true;
+}
+
 void TraceLoader::loadFrame(ApiTraceFrame *currentFrame)
 {
     fetchFrameContents(currentFrame);
@@ -187,99 +221,199 @@ void TraceLoader::addSignature(unsigned id, ApiTraceCallSignature *signature)
     m_signatures[id] = signature;
 }
 
-void TraceLoader::searchNext(const ApiTrace::SearchRequest &request)
+/*
+ * Searches are split into chunks of consecutive frames, listed in search
+ * order.  Each worker owns a parser and claims chunks in that order, so the
+ * first chunk with a match holds the search result, and workers give up on
+ * any chunk past it.
+ *
+ * Worker parsers jump straight into the middle of the trace, so they borrow
+ * the signatures the loader's parser found while scanning it.
+ */
+class TraceLoader::SearchWorker : public QRunnable
 {
-    Q_ASSERT(m_parser.supportsOffsets());
-    int startFrame = m_createdFrames.indexOf(request.frame);
-    const FrameBookmark &frameBookmark = m_frameBookmarks[startFrame];
-    m_parser.setBookmark(frameBookmark.start);
-    trace::Call *call = 0;
-    while ((call = m_parser.parse_call())) {
-
-        if (callContains(call, request.text, request.cs)) {
-            unsigned frameIdx = callInFrame(call->no);
-            ApiTraceFrame *frame = m_createdFrames[frameIdx];
-            const QVector<ApiTraceCall*> calls =
-                    fetchFrameContents(frame);
-            for (int i = 0; i < calls.count(); ++i) {
-                if (calls[i]->index() == call->no) {
-                    emit searchResult(request, ApiTrace::SearchResult_Found,
-                                      calls[i]);
-                    break;
+public:
+    SearchWorker(const QByteArray &filename,
+                 const trace::Parser &signatures,
+                 const FrameBookmarks &frameBookmarks,
+                 const QVector<SearchChunk> &chunks,
+                 const ApiTrace::SearchRequest &request,
+                 QAtomicInt &nextChunk,
+                 QAtomicInt &foundChunk,
+                 QVector<int> &results)
+        : m_filename(filename),
+          m_signatures(signatures),
+          m_frameBookmarks(frameBookmarks),
+          m_chunks(chunks),
+          m_request(request),
+          m_nextChunk(nextChunk),
+          m_foundChunk(foundChunk),
+          m_results(results)
+    {
+        setAutoDelete(false);
+    }
+
+    void run() override
+    {
+        trace::Parser parser;
+        if (!parser.open(m_filename)) {
+            return;
+        }
+        parser.copySignatures(m_signatures);
+
+        int chunkIdx;
+        while ((chunkIdx = m_nextChunk.fetchAndAddOrdered(1)) < m_chunks.count() &&
+               chunkIdx < m_foundChunk.load()) {
+            int callIdx = searchChunk(parser, chunkIdx);
+            if (callIdx >= 0) {
+                m_results[chunkIdx] = callIdx;
+                int found = m_foundChunk.load();
+                while (chunkIdx < found &&
+                       !m_foundChunk.testAndSetOrdered(found, chunkIdx)) {
+                    found = m_foundChunk.load();
                 }
             }
+        }
+    }
+
+private:
+    int searchChunk(trace::Parser &parser, int chunkIdx)
+    {
+        const SearchChunk &chunk = m_chunks[chunkIdx];
+        bool backwards = m_request.direction == ApiTrace::SearchRequest::Prev;
+        int callIdx = -1;
+
+        parser.setBookmark(m_frameBookmarks[chunk.firstFrame].start);
+
+        trace::Call *call;
+        int numCallsToParse = chunk.numberOfCalls;
+        while (numCallsToParse-- && (call = parser.parse_call())) {
+            bool match = callContains(call, m_request.text, m_request.cs);
+            if (match) {
+                callIdx = call->no;
+            }
             delete call;
-            return;
+            if (match && !backwards) {
+                break;
+            }
+            if (m_foundChunk.load() < chunkIdx) {
+                return -1;
+            }
         }
+        return callIdx;
+    }
 
-        delete call;
+    const QByteArray &m_filename;
+    const trace::Parser &m_signatures;
+    const FrameBookmarks &m_frameBookmarks;
+    const QVector<SearchChunk> &m_chunks;
+    const ApiTrace::SearchRequest &m_request;
+    QAtomicInt &m_nextChunk;
+    QAtomicInt &m_foundChunk;
+    QVector<int> &m_results;
+};
+
+void TraceLoader::searchNext(const ApiTrace::SearchRequest &request)
+{
+    Q_ASSERT(m_parser.supportsOffsets());
+    int startFrame = m_createdFrames.indexOf(request.frame);
+
+    QVector<SearchChunk> chunks;
+    SearchChunk chunk = {startFrame, 0};
+    for (int frameIdx = startFrame; frameIdx < numberOfFrames(); ++frameIdx) {
+        chunk.numberOfCalls += numberOfCallsInFrame(frameIdx);
+        if (chunk.numberOfCalls >= SEARCH_CHUNK_CALLS) {
+            chunks.append(chunk);
+            chunk.firstFrame = frameIdx + 1;
+            chunk.numberOfCalls = 0;
+        }
     }
-    emit searchResult(request, ApiTrace::SearchResult_NotFound, 0);
+    if (chunk.numberOfCalls) {
+        chunks.append(chunk);
+    }
+
+    emitSearchResult(request, searchChunks(chunks, request));
 }
 
 void TraceLoader::searchPrev(const ApiTrace::SearchRequest &request)
 {
     Q_ASSERT(m_parser.supportsOffsets());
     int startFrame = m_createdFrames.indexOf(request.frame);
-    trace::Call *call = 0;
-    QList<trace::Call*> frameCalls;
-    int frameIdx = startFrame;
-
-    const FrameBookmark &frameBookmark = m_frameBookmarks[frameIdx];
-    int numCallsToParse = frameBookmark.numberOfCalls;
-    m_parser.setBookmark(frameBookmark.start);
 
-    while ((call = m_parser.parse_call())) {
-
-        frameCalls.append(call);
-        --numCallsToParse;
+    QVector<SearchChunk> chunks;
+    SearchChunk chunk = {startFrame, 0};
+    for (int frameIdx = startFrame; frameIdx >= 0; --frameIdx) {
+        chunk.firstFrame = frameIdx;
+        chunk.numberOfCalls += numberOfCallsInFrame(frameIdx);
+        if (chunk.numberOfCalls >= SEARCH_CHUNK_CALLS) {
+            chunks.append(chunk);
+            chunk.numberOfCalls = 0;
+        }
+    }
+    if (chunk.numberOfCalls) {
+        chunks.append(chunk);
+    }
 
-        if (numCallsToParse == 0) {
-            bool foundCall = searchCallsBackwards(frameCalls,
-                                                  frameIdx,
-                                                  request);
+    emitSearchResult(request, searchChunks(chunks, request));
+}
 
-            qDeleteAll(frameCalls);
-            frameCalls.clear();
-            if (foundCall) {
-                return;
-            }
+/*
+ * Returns the index of the matching call from the earliest chunk with a
+ * match, or -1 if no chunk matched.
+ */
+int TraceLoader::searchChunks(const QVector<SearchChunk> &chunks,
+                              const ApiTrace::SearchRequest &request)
+{
+    if (chunks.isEmpty()) {
+        return -1;
+    }
 
-            --frameIdx;
+    QAtomicInt nextChunk(0);
+    QAtomicInt foundChunk(INT_MAX);
+    QVector<int> results(chunks.count(), -1);
+
+    int numWorkers = qBound(1, QThread::idealThreadCount(), chunks.count());
+    QThreadPool pool;
+    pool.setMaxThreadCount(numWorkers);
+    QList<SearchWorker *> workers;
+    for (int i = 0; i < numWorkers; ++i) {
+        SearchWorker *worker = new SearchWorker(m_filename, m_parser,
+                                                m_frameBookmarks,
+                                                chunks, request,
+                                                nextChunk, foundChunk,
+                                                results);
+        workers.append(worker);
+        pool.start(worker);
+    }
+    pool.waitForDone();
+    qDeleteAll(workers);
 
-            if (frameIdx >= 0) {
-                const FrameBookmark &frameBookmark =
-                        m_frameBookmarks[frameIdx];
-                m_parser.setBookmark(frameBookmark.start);
-                numCallsToParse = frameBookmark.numberOfCalls;
-            }
-        }
+    int found = foundChunk.load();
+    if (found == INT_MAX) {
+        return -1;
     }
-    emit searchResult(request, ApiTrace::SearchResult_NotFound, 0);
+    return results[found];
 }
 
-bool TraceLoader::searchCallsBackwards(const QList<trace::Call*> &calls,
-                                       int frameIdx,
-                                       const ApiTrace::SearchRequest &request)
-{
-    for (int i = calls.count() - 1; i >= 0; --i) {
-        trace::Call *call = calls[i];
-        if (callContains(call, request.text, request.cs)) {
-            ApiTraceFrame *frame = m_createdFrames[frameIdx];
-            const QVector<ApiTraceCall*> apiCalls =
-                    fetchFrameContents(frame);
-            for (int i = 0; i < apiCalls.count(); ++i) {
-                if (apiCalls[i]->index() == call->no) {
-                    emit searchResult(request,
-                                      ApiTrace::SearchResult_Found,
-                                      apiCalls[i]);
-                    break;
-                }
-            }
-            return true;
+void TraceLoader::emitSearchResult(const ApiTrace::SearchRequest &request,
+                                   int callIdx)
+{
+    if (callIdx < 0) {
+        emit searchResult(request, ApiTrace::SearchResult_NotFound, 0);
+        return;
+    }
+
+    int frameIdx = callInFrame(callIdx);
+    ApiTraceFrame *frame = m_createdFrames[frameIdx];
+    const QVector<ApiTraceCall*> calls = fetchFrameContents(frame);
+    for (int i = 0; i < calls.count(); ++i) {
+        if (calls[i]->index() == callIdx) {
+            emit searchResult(request, ApiTrace::SearchResult_Found,
+                              calls[i]);
+            return;
         }
     }
-    return false;
+    emit searchResult(request, ApiTrace::SearchResult_NotFound, 0);
 }
 
 int TraceLoader::callInFrame(int callIdx) const
@@ -299,18 +433,11 @@ int TraceLoader::callInFrame(int callIdx) const
     return 0;
 }
 
-bool TraceLoader::callContains(trace::Call *call,
+bool TraceLoader::callContains(const trace::Call *call,
                                const QString &str,
                                Qt::CaseSensitivity sensitivity)
 {
-    /*
-     * FIXME: do string comparison directly on trace::Call
-     */
-    ApiTraceCall *apiCall = apiCallFromTraceCall(call, m_helpHash,
-                                                 0, 0, this);
-    bool result = apiCall->contains(str, sensitivity);
-    delete apiCall;
-    return result;
+    return apiCallSearchText(call).contains(str, sensitivity);
 }
 
 QVector<ApiTraceCall*>
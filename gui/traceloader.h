@@ -8,6 +8,7 @@
 #include <QObject>
 #include <QList>
 #include <QMap>
+#include <QMutex>
 #include <QStack>
 
 class TraceLoader : public QObject
@@ -23,6 +24,14 @@ public:
 
     trace::EnumSig *enumSignature(unsigned id);
 
+    /*
+     * Let parsers of the loaded trace, on any thread, start at a frame:
+     * seed them with the signatures found while scanning, then seek them to
+     * the frame's bookmark.
+     */
+    void copySignatures(trace::Parser &parser) const;
+    bool frameStart(int frameIdx, trace::ParseBookmark &bookmark) const;
+
 private:
     class FrameContents
     {
@@ -94,20 +103,33 @@ private:
     void guessApi(const trace::Call *call);
     void scanTrace();
 
+    struct SearchChunk {
+        int firstFrame;
+        int numberOfCalls;
+    };
+    class SearchWorker;
+
     void searchNext(const ApiTrace::SearchRequest &request);
     void searchPrev(const ApiTrace::SearchRequest &request);
+    int searchChunks(const QVector<SearchChunk> &chunks,
+                     const ApiTrace::SearchRequest &request);
+    void emitSearchResult(const ApiTrace::SearchRequest &request,
+                          int callIdx);
 
     int callInFrame(int callIdx) const;
-    bool callContains(trace::Call *call,
-                      const QString &str,
-                      Qt::CaseSensitivity sensitivity);
+    static bool callContains(const trace::Call *call,
+                             const QString &str,
+                             Qt::CaseSensitivity sensitivity);
      QVector<ApiTraceCall*> fetchFrameContents(ApiTraceFrame *frame);
-     bool searchCallsBackwards(const QList<trace::Call*> &calls,
-                               int frameIdx,
-                               const ApiTrace::SearchRequest &request);
 
 private:
     trace::Parser m_parser;
+    QByteArray m_filename;
+
+    // Guards what other threads read: the bookmarks, and the signatures
+    // copied from m_parser once scanned.
+    mutable QMutex m_mutex;
+    trace::Parser m_scannedSignatures;
 
     typedef QMap<int, FrameBookmark> FrameBookmarks;
     FrameBookmarks m_frameBookmarks;
@@ -370,6 +370,9 @@ Features::load(const Profile & profile, const Extensions & ext)
 
         primitive_restart = profile.versionGreaterOrEqual(3, 1) ||
                             ext.has("GL_NV_primitive_restart");
+
+        sync = profile.versionGreaterOrEqual(3, 2) ||
+               ext.has("GL_ARB_sync");
     } else {
         texture_3d = 1;
 
@@ -391,6 +394,9 @@ Features::load(const Profile & profile, const Extensions & ext)
         query_buffer_object = 0;
 
         primitive_restart = 0;
+
+        // GL_APPLE_sync requires different entry points
+        sync = profile.versionGreaterOrEqual(3, 0);
     }
 }
 
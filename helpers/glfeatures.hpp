@@ -162,6 +162,7 @@ struct Features
     unsigned read_framebuffer_object:1;
     unsigned query_buffer_object:1;
     unsigned primitive_restart:1;
+    unsigned sync:1;
 
     Features(void);
 
@@ -0,0 +1,252 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Scanning of element arrays, to find out which vertices a glDrawElements
+ * call references.
+ */
+
+#pragma once
+
+
+#include <stddef.h>
+
+#include <algorithm>
+
+#include "glimports.hpp"
+
+
+#if \
+    (defined(__i386__) && defined(__SSE2__)) /* gcc */ || \
+    defined(_M_IX86) /* msvc */ || \
+    defined(__x86_64__) /* gcc */ || \
+    defined(_M_X64) /* msvc */ || \
+    defined(_M_AMD64) /* msvc */
+#  define HAVE_SSE2
+#  include <emmintrin.h>
+#endif
+
+
+template< class T >
+static inline void
+_gl_index_range_scalar(const T *indices, size_t count,
+                       bool restart, GLuint restart_index,
+                       GLuint &min, GLuint &max)
+{
+    for (size_t i = 0; i < count; ++i) {
+        GLuint index = indices[i];
+        if (restart && index == restart_index) {
+            continue;
+        }
+        min = std::min(min, index);
+        max = std::max(max, index);
+    }
+}
+
+
+#ifdef HAVE_SSE2
+
+/*
+ * SSE2 only has unsigned min/max for bytes, so shorts and ints are biased into
+ * the signed range.  Restart indices are replaced by the identity of each
+ * reduction (all ones for min, zero for max) rather than skipped.
+ */
+
+static inline void
+_gl_index_range_sse2(const GLubyte *indices, size_t count,
+                     bool restart, GLuint restart_index,
+                     GLuint &min, GLuint &max)
+{
+    size_t n = count & ~size_t(15);
+    if (n) {
+        __m128i vmin = _mm_set1_epi8(-1);
+        __m128i vmax = _mm_setzero_si128();
+        if (restart && restart_index <= 0xff) {
+            __m128i vrestart = _mm_set1_epi8((char)restart_index);
+            for (size_t i = 0; i < n; i += 16) {
+                __m128i v = _mm_loadu_si128((const __m128i *)(indices + i));
+                __m128i eq = _mm_cmpeq_epi8(v, vrestart);
+                vmin = _mm_min_epu8(vmin, _mm_or_si128(v, eq));
+                vmax = _mm_max_epu8(vmax, _mm_andnot_si128(eq, v));
+            }
+        } else {
+            for (size_t i = 0; i < n; i += 16) {
+                __m128i v = _mm_loadu_si128((const __m128i *)(indices + i));
+                vmin = _mm_min_epu8(vmin, v);
+                vmax = _mm_max_epu8(vmax, v);
+            }
+        }
+
+        GLubyte lanes_min[16], lanes_max[16];
+        _mm_storeu_si128((__m128i *)lanes_min, vmin);
+        _mm_storeu_si128((__m128i *)lanes_max, vmax);
+        for (unsigned i = 0; i < 16; ++i) {
+            min = std::min(min, (GLuint)lanes_min[i]);
+            max = std::max(max, (GLuint)lanes_max[i]);
+        }
+    }
+
+    _gl_index_range_scalar(indices + n, count - n, restart, restart_index, min, max);
+}
+
+
+static inline void
+_gl_index_range_sse2(const GLushort *indices, size_t count,
+                     bool restart, GLuint restart_index,
+                     GLuint &min, GLuint &max)
+{
+    size_t n = count & ~size_t(7);
+    if (n) {
+        const __m128i bias = _mm_set1_epi16(-0x8000);
+        __m128i vmin = _mm_set1_epi16(0x7fff);
+        __m128i vmax = _mm_set1_epi16(-0x8000);
+        if (restart && restart_index <= 0xffff) {
+            __m128i vrestart = _mm_set1_epi16((short)restart_index);
+            for (size_t i = 0; i < n; i += 8) {
+                __m128i v = _mm_loadu_si128((const __m128i *)(indices + i));
+                __m128i eq = _mm_cmpeq_epi16(v, vrestart);
+                vmin = _mm_min_epi16(vmin, _mm_xor_si128(_mm_or_si128(v, eq), bias));
+                vmax = _mm_max_epi16(vmax, _mm_xor_si128(_mm_andnot_si128(eq, v), bias));
+            }
+        } else {
+            for (size_t i = 0; i < n; i += 8) {
+                __m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(indices + i)), bias);
+                vmin = _mm_min_epi16(vmin, v);
+                vmax = _mm_max_epi16(vmax, v);
+            }
+        }
+
+        GLushort lanes_min[8], lanes_max[8];
+        _mm_storeu_si128((__m128i *)lanes_min, _mm_xor_si128(vmin, bias));
+        _mm_storeu_si128((__m128i *)lanes_max, _mm_xor_si128(vmax, bias));
+        for (unsigned i = 0; i < 8; ++i) {
+            min = std::min(min, (GLuint)lanes_min[i]);
+            max = std::max(max, (GLuint)lanes_max[i]);
+        }
+    }
+
+    _gl_index_range_scalar(indices + n, count - n, restart, restart_index, min, max);
+}
+
+
+static inline __m128i
+_mm_min_epi32_sse2(__m128i a, __m128i b)
+{
+    __m128i gt = _mm_cmpgt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(gt, b), _mm_andnot_si128(gt, a));
+}
+
+
+static inline __m128i
+_mm_max_epi32_sse2(__m128i a, __m128i b)
+{
+    __m128i gt = _mm_cmpgt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(gt, a), _mm_andnot_si128(gt, b));
+}
+
+
+static inline void
+_gl_index_range_sse2(const GLuint *indices, size_t count,
+                     bool restart, GLuint restart_index,
+                     GLuint &min, GLuint &max)
+{
+    size_t n = count & ~size_t(3);
+    if (n) {
+        const __m128i bias = _mm_set1_epi32(0x80000000);
+        __m128i vmin = _mm_set1_epi32(0x7fffffff);
+        __m128i vmax = _mm_set1_epi32(0x80000000);
+        if (restart) {
+            __m128i vrestart = _mm_set1_epi32(restart_index);
+            for (size_t i = 0; i < n; i += 4) {
+                __m128i v = _mm_loadu_si128((const __m128i *)(indices + i));
+                __m128i eq = _mm_cmpeq_epi32(v, vrestart);
+                vmin = _mm_min_epi32_sse2(vmin, _mm_xor_si128(_mm_or_si128(v, eq), bias));
+                vmax = _mm_max_epi32_sse2(vmax, _mm_xor_si128(_mm_andnot_si128(eq, v), bias));
+            }
+        } else {
+            for (size_t i = 0; i < n; i += 4) {
+                __m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(indices + i)), bias);
+                vmin = _mm_min_epi32_sse2(vmin, v);
+                vmax = _mm_max_epi32_sse2(vmax, v);
+            }
+        }
+
+        GLuint lanes_min[4], lanes_max[4];
+        _mm_storeu_si128((__m128i *)lanes_min, _mm_xor_si128(vmin, bias));
+        _mm_storeu_si128((__m128i *)lanes_max, _mm_xor_si128(vmax, bias));
+        for (unsigned i = 0; i < 4; ++i) {
+            min = std::min(min, lanes_min[i]);
+            max = std::max(max, lanes_max[i]);
+        }
+    }
+
+    _gl_index_range_scalar(indices + n, count - n, restart, restart_index, min, max);
+}
+
+#endif /* HAVE_SSE2 */
+
+
+/**
+ * Find the smallest and largest of `count` indices of the given type,
+ * ignoring the restart index when primitive restart is enabled.
+ *
+ * Returns false (and min > max) if there were no indices to consider.
+ */
+static inline bool
+_gl_index_range(GLenum type, const void *indices, size_t count,
+                bool restart, GLuint restart_index,
+                GLuint &min, GLuint &max)
+{
+    min = ~0U;
+    max = 0;
+
+    switch (type) {
+#ifdef HAVE_SSE2
+    case GL_UNSIGNED_BYTE:
+        _gl_index_range_sse2((const GLubyte *)indices, count, restart, restart_index, min, max);
+        break;
+    case GL_UNSIGNED_SHORT:
+        _gl_index_range_sse2((const GLushort *)indices, count, restart, restart_index, min, max);
+        break;
+    case GL_UNSIGNED_INT:
+        _gl_index_range_sse2((const GLuint *)indices, count, restart, restart_index, min, max);
+        break;
+#else
+    case GL_UNSIGNED_BYTE:
+        _gl_index_range_scalar((const GLubyte *)indices, count, restart, restart_index, min, max);
+        break;
+    case GL_UNSIGNED_SHORT:
+        _gl_index_range_scalar((const GLushort *)indices, count, restart, restart_index, min, max);
+        break;
+    case GL_UNSIGNED_INT:
+        _gl_index_range_scalar((const GLuint *)indices, count, restart, restart_index, min, max);
+        break;
+#endif
+    default:
+        return false;
+    }
+
+    return min <= max;
+}
@@ -0,0 +1,174 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+#include <stdlib.h>
+
+#include <iostream>
+#include <vector>
+
+// Before X11 headers, pulled in by glimports.hpp
+#include "gtest/gtest.h"
+
+#include "os_time.hpp"
+#include "glindices.hpp"
+
+
+template< class T >
+static std::vector<T>
+makeIndices(size_t count, GLuint modulo)
+{
+    std::vector<T> indices(count);
+    unsigned seed = 1;
+    for (size_t i = 0; i < count; ++i) {
+        seed = seed * 1103515245 + 12345;
+        indices[i] = (T)((seed >> 8) % modulo);
+    }
+    return indices;
+}
+
+
+template< class T >
+static void
+checkRange(const std::vector<T> &indices, GLenum type, bool restart, GLuint restart_index)
+{
+    // Test every length and misalignment up to a few vectors
+    for (size_t offset = 0; offset < 4; ++offset) {
+        for (size_t count = 0; offset + count <= indices.size(); count += count < 80 ? 1 : 37) {
+            GLuint expected_min = ~0U, expected_max = 0;
+            _gl_index_range_scalar(&indices[offset], count, restart, restart_index, expected_min, expected_max);
+
+            GLuint min, max;
+            bool found = _gl_index_range(type, &indices[offset], count, restart, restart_index, min, max);
+            EXPECT_EQ(expected_min <= expected_max, found);
+            if (found) {
+                EXPECT_EQ(expected_min, min);
+                EXPECT_EQ(expected_max, max);
+            }
+        }
+    }
+}
+
+
+TEST(glindices, UnsignedByte)
+{
+    std::vector<GLubyte> indices = makeIndices<GLubyte>(1000, 256);
+    checkRange(indices, GL_UNSIGNED_BYTE, false, 0);
+    checkRange(indices, GL_UNSIGNED_BYTE, true, 0xff);
+    checkRange(indices, GL_UNSIGNED_BYTE, true, 0);
+    checkRange(indices, GL_UNSIGNED_BYTE, true, 0xffffffff);
+}
+
+
+TEST(glindices, UnsignedShort)
+{
+    std::vector<GLushort> indices = makeIndices<GLushort>(1000, 65536);
+    checkRange(indices, GL_UNSIGNED_SHORT, false, 0);
+    checkRange(indices, GL_UNSIGNED_SHORT, true, 0xffff);
+    checkRange(indices, GL_UNSIGNED_SHORT, true, indices[500]);
+
+    // Mostly restart indices
+    std::vector<GLushort> restarts = makeIndices<GLushort>(1000, 2);
+    for (size_t i = 0; i < restarts.size(); ++i) {
+        restarts[i] = restarts[i] ? 0xffff : 0x8000 + i;
+    }
+    checkRange(restarts, GL_UNSIGNED_SHORT, true, 0xffff);
+}
+
+
+TEST(glindices, UnsignedInt)
+{
+    std::vector<GLuint> indices = makeIndices<GLuint>(1000, 1 << 24);
+    indices[100] = 0x80000001;
+    checkRange(indices, GL_UNSIGNED_INT, false, 0);
+    checkRange(indices, GL_UNSIGNED_INT, true, 0xffffffff);
+    checkRange(indices, GL_UNSIGNED_INT, true, 0x80000001);
+
+    std::vector<GLuint> restarts(100, 0xffffffff);
+    checkRange(restarts, GL_UNSIGNED_INT, true, 0xffffffff);
+    checkRange(restarts, GL_UNSIGNED_INT, false, 0);
+}
+
+
+TEST(glindices, UnknownType)
+{
+    GLuint indices[4] = {0, 1, 2, 3};
+    GLuint min, max;
+    EXPECT_FALSE(_gl_index_range(GL_FLOAT, indices, 4, false, 0, min, max));
+}
+
+
+/*
+ * Not really a test, but a microbenchmark of the scan against the plain loop,
+ * on index arrays large enough to not fit in cache.
+ */
+template< class T >
+static void
+benchmark(const char *name, GLenum type)
+{
+    std::vector<T> indices = makeIndices<T>(4 << 20, GLuint(1) << (8 * sizeof(T) - 1));
+    const unsigned iterations = 4;
+
+    GLuint scalar_max = 0;
+    long long start = os::getTime();
+    for (unsigned i = 0; i < iterations; ++i) {
+        GLuint min = ~0U, max = 0;
+        _gl_index_range_scalar(&indices[0], indices.size(), true, 0xffffffff, min, max);
+        scalar_max += max;
+    }
+    long long scalar_time = os::getTime() - start;
+
+    GLuint vector_max = 0;
+    start = os::getTime();
+    for (unsigned i = 0; i < iterations; ++i) {
+        GLuint min, max;
+        _gl_index_range(type, &indices[0], indices.size(), true, 0xffffffff, min, max);
+        vector_max += max;
+    }
+    long long vector_time = os::getTime() - start;
+
+    EXPECT_EQ(scalar_max, vector_max);
+
+    double bytes = double(iterations) * indices.size() * sizeof(T);
+    std::cout << name << ": "
+              << bytes / (scalar_time * 1.0e9 / os::timeFrequency) << " GB/s scalar, "
+              << bytes / (vector_time * 1.0e9 / os::timeFrequency) << " GB/s\n";
+}
+
+
+TEST(glindices, Benchmark)
+{
+    benchmark<GLubyte>("GL_UNSIGNED_BYTE", GL_UNSIGNED_BYTE);
+    benchmark<GLushort>("GL_UNSIGNED_SHORT", GL_UNSIGNED_SHORT);
+    benchmark<GLuint>("GL_UNSIGNED_INT", GL_UNSIGNED_INT);
+}
+
+
+int
+main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
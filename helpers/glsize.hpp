@@ -382,6 +382,61 @@ _element_array_buffer_binding(void) {
     return _glGetInteger(GL_ELEMENT_ARRAY_BUFFER_BINDING);
 }
 
+/**
+ * Name of the buffer object bound to the given target, or zero if unknown.
+ */
+static inline GLuint
+_gl_buffer_binding(GLenum target) {
+    GLenum binding;
+    switch (target) {
+    case GL_ARRAY_BUFFER:
+        binding = GL_ARRAY_BUFFER_BINDING;
+        break;
+    case GL_ATOMIC_COUNTER_BUFFER:
+        binding = GL_ATOMIC_COUNTER_BUFFER_BINDING;
+        break;
+    case GL_COPY_READ_BUFFER:
+        binding = GL_COPY_READ_BUFFER_BINDING;
+        break;
+    case GL_COPY_WRITE_BUFFER:
+        binding = GL_COPY_WRITE_BUFFER_BINDING;
+        break;
+    case GL_DRAW_INDIRECT_BUFFER:
+        binding = GL_DRAW_INDIRECT_BUFFER_BINDING;
+        break;
+    case GL_DISPATCH_INDIRECT_BUFFER:
+        binding = GL_DISPATCH_INDIRECT_BUFFER_BINDING;
+        break;
+    case GL_ELEMENT_ARRAY_BUFFER:
+        binding = GL_ELEMENT_ARRAY_BUFFER_BINDING;
+        break;
+    case GL_PIXEL_PACK_BUFFER:
+        binding = GL_PIXEL_PACK_BUFFER_BINDING;
+        break;
+    case GL_PIXEL_UNPACK_BUFFER:
+        binding = GL_PIXEL_UNPACK_BUFFER_BINDING;
+        break;
+    case GL_QUERY_BUFFER:
+        binding = GL_QUERY_BUFFER_BINDING;
+        break;
+    case GL_SHADER_STORAGE_BUFFER:
+        binding = GL_SHADER_STORAGE_BUFFER_BINDING;
+        break;
+    case GL_TEXTURE_BUFFER:
+        binding = GL_TEXTURE_BUFFER;
+        break;
+    case GL_TRANSFORM_FEEDBACK_BUFFER:
+        binding = GL_TRANSFORM_FEEDBACK_BUFFER_BINDING;
+        break;
+    case GL_UNIFORM_BUFFER:
+        binding = GL_UNIFORM_BUFFER_BINDING;
+        break;
+    default:
+        return 0;
+    }
+    return _glGetInteger(binding);
+}
+
 /**
  * Same as glGetVertexAttribiv, but passing the result in the return value.
  */
@@ -79,6 +79,7 @@ class PlainAttribute : public Attribute {
 public:
     PlainAttribute(void) {}
     virtual void apply(std::ostream &) const override {}
+    virtual const char *text(void) const override { return ""; }
 };
 
 static const PlainAttribute plainAttribute;
@@ -107,18 +108,22 @@ public:
     {}
 
     void apply(std::ostream& os) const override {
-        os << "\33[" << escape;
+        os << escape;
+    }
+
+    const char *text(void) const override {
+        return escape;
     }
 };
 
-static const AnsiAttribute ansiNormal("0m");
-static const AnsiAttribute ansiBold("1m");
-static const AnsiAttribute ansiItalic("3m");
-static const AnsiAttribute ansiStrike("9m");
-static const AnsiAttribute ansiRed("31m");
-static const AnsiAttribute ansiGreen("32m");
-static const AnsiAttribute ansiBlue("34m");
-static const AnsiAttribute ansiGray("37m");
+static const AnsiAttribute ansiNormal("\33[0m");
+static const AnsiAttribute ansiBold("\33[1m");
+static const AnsiAttribute ansiItalic("\33[3m");
+static const AnsiAttribute ansiStrike("\33[9m");
+static const AnsiAttribute ansiRed("\33[31m");
+static const AnsiAttribute ansiGreen("\33[32m");
+static const AnsiAttribute ansiBlue("\33[34m");
+static const AnsiAttribute ansiGray("\33[37m");
 
 
 /**
@@ -43,6 +43,12 @@ namespace highlight {
 class Attribute {
 public:
     virtual void apply(std::ostream &) const = 0;
+
+    /*
+     * Text which apply() writes, or NULL if the attribute is not conveyed
+     * through the stream itself.
+     */
+    virtual const char *text(void) const { return NULL; }
 };
 
 
@@ -30,6 +30,8 @@
 #pragma once
 
 
+#include <stdint.h>
+
 #include <iostream>
 
 #include <string>
@@ -114,6 +116,19 @@ public:
     void
     writeMD5(std::ostream &os) const;
 
+    // Fast non-cryptographic hash of the dimensions, format, and pixels
+    uint64_t
+    hash64(void) const;
+
+    // Write hash64() in hexadecimal, after comment if given
+    void
+    writeHash(std::ostream &os, const char *comment = NULL) const;
+
+    // Hexadecimal MD5 of the dimensions, format, and pixels, suitable for
+    // naming files after their contents
+    std::string
+    contentHash(void) const;
+
     bool
     writePNG(std::ostream &os, bool strip_alpha = false) const;
 
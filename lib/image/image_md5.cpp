@@ -35,30 +35,63 @@ using namespace std;
 namespace image {
 
 
-void
-Image::writeMD5(std::ostream &os) const {
-    struct MD5Context md5c;
-    MD5Init(&md5c);
+static void
+updateMD5(struct MD5Context *md5c, const Image *image)
+{
     const unsigned char *row;
-    unsigned len = width*bytesPerPixel;
-    for (row = start(); row != end(); row += stride()) {
-        MD5Update(&md5c, (unsigned char *)row, len);
+    unsigned len = image->width*image->bytesPerPixel;
+    for (row = image->start(); row != image->end(); row += image->stride()) {
+        MD5Update(md5c, (unsigned char *)row, len);
     }
-    unsigned char signature[16];
-    MD5Final(signature, &md5c);
+}
+
 
+static void
+formatSignature(const unsigned char signature[16], char csig[33])
+{
     const char hex[] = "0123456789ABCDEF";
-    char csig[33];
-    for(int i = 0; i < sizeof signature; i++){
+    for(int i = 0; i < 16; i++){
         csig[2*i    ] = hex[signature[i] >> 4];
         csig[2*i + 1] = hex[signature[i] & 0xf];
     }
     csig[32] = '\0';
+}
+
+
+void
+Image::writeMD5(std::ostream &os) const {
+    struct MD5Context md5c;
+    MD5Init(&md5c);
+    updateMD5(&md5c, this);
+    unsigned char signature[16];
+    MD5Final(signature, &md5c);
+
+    char csig[33];
+    formatSignature(signature, csig);
 
     os << csig;
     os << "\n";
 }
 
 
+std::string
+Image::contentHash(void) const {
+    struct MD5Context md5c;
+    MD5Init(&md5c);
+
+    // Tell apart images with the same bytes but a different layout
+    unsigned header[4] = {width, height, channels, (unsigned)channelType};
+    MD5Update(&md5c, (unsigned char *)header, sizeof header);
+
+    updateMD5(&md5c, this);
+    unsigned char signature[16];
+    MD5Final(signature, &md5c);
+
+    char csig[33];
+    formatSignature(signature, csig);
+    return csig;
+}
+
+
 } /* namespace image */
 
@@ -31,11 +31,17 @@
 #include <assert.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
+#include <algorithm>
 #include <fstream>
+#include <string>
+#include <vector>
 
 #include "image.hpp"
+#include "os_thread.hpp"
+#include "thread_pool.hpp"
 
 
 namespace image {
@@ -44,14 +50,6 @@ namespace image {
 static const int png_compression_level = Z_BEST_SPEED;
 
 
-static void
-pngWriteCallback(png_structp png_ptr, png_bytep data, png_size_t length)
-{
-    std::ostream *os = (std::ostream *) png_get_io_ptr(png_ptr);
-    os->write((const char *)data, length);
-}
-
-
 static inline uint8_t
 floatToUnorm8(float c)
 {
@@ -66,7 +64,7 @@ floatToUnorm8(float c)
 
 
 static inline uint8_t
-floatToSRGB(float c)
+floatToSRGBExact(float c)
 {
     if (c <= 0.0f) {
         return 0;
@@ -83,16 +81,389 @@ floatToSRGB(float c)
 }
 
 
+/*
+ * Table driven float to sRGB conversion, giving the same results as
+ * floatToSRGBExact without calling powf per channel.
+ *
+ * For floats in (0, 1), the top bits of the IEEE representation index a
+ * table holding the sRGB value of the smallest float of that bucket.  Buckets
+ * are narrow enough to span at most a couple of sRGB values, which are then
+ * resolved by comparing against the smallest float mapping to each value.
+ */
+class SRGBTable
+{
+public:
+    static const unsigned shift = 15;
+
+    uint8_t start[(0x3f800000 >> shift) + 1];
+    float threshold[257];
+
+    SRGBTable() {
+        threshold[0] = 0.0f;
+        for (unsigned v = 1; v < 256; ++v) {
+            // Smallest float converting to v or more, by bisecting the bits
+            uint32_t lo = 0, hi = 0x3f800000;
+            while (lo < hi) {
+                uint32_t mid = lo + (hi - lo) / 2;
+                if (floatToSRGBExact(fromBits(mid)) >= v) {
+                    hi = mid;
+                } else {
+                    lo = mid + 1;
+                }
+            }
+            threshold[v] = fromBits(lo);
+        }
+        threshold[256] = 2.0f;
+
+        for (uint32_t i = 0; i < sizeof start; ++i) {
+            start[i] = floatToSRGBExact(fromBits(i << shift));
+        }
+    }
+
+    inline uint8_t
+    convert(float c) const {
+        if (!(c > 0.0f)) {
+            return 0; // also NaN
+        }
+        if (c >= 1.0f) {
+            return 255;
+        }
+        uint32_t bits;
+        memcpy(&bits, &c, sizeof bits);
+        unsigned v = start[bits >> shift];
+        while (c >= threshold[v + 1]) {
+            ++v;
+        }
+        return v;
+    }
+
+private:
+    static inline float
+    fromBits(uint32_t bits) {
+        float f;
+        memcpy(&f, &bits, sizeof f);
+        return f;
+    }
+};
+
+
+static const SRGBTable &
+srgbTable(void)
+{
+    static const SRGBTable table;
+    return table;
+}
+
+
+/*
+ * PNG writing.
+ *
+ * We write PNGs ourselves instead of through libpng, so that large images can
+ * be compressed on several threads, as pigz does: the scanlines are split in
+ * stripes, each deflated independently and ended on a byte boundary with a
+ * sync flush, and the results are concatenated into a single zlib stream.
+ * The output is a standard PNG.
+ */
+
+
+static inline void
+writeBE32(unsigned char *p, uint32_t value)
+{
+    p[0] = value >> 24;
+    p[1] = value >> 16;
+    p[2] = value >> 8;
+    p[3] = value;
+}
+
+
+static void
+writePNGChunk(std::ostream &os, const char *type,
+              const void *data0, size_t size0,
+              const void *data1 = NULL, size_t size1 = 0)
+{
+    unsigned char length[4];
+    writeBE32(length, uint32_t(size0 + size1));
+    os.write((const char *)length, sizeof length);
+    os.write(type, 4);
+
+    uLong crc = crc32(0, (const Bytef *)type, 4);
+    if (size0) {
+        os.write((const char *)data0, size0);
+        crc = crc32(crc, (const Bytef *)data0, uInt(size0));
+    }
+    if (size1) {
+        os.write((const char *)data1, size1);
+        crc = crc32(crc, (const Bytef *)data1, uInt(size1));
+    }
+
+    unsigned char crcBytes[4];
+    writeBE32(crcBytes, uint32_t(crc));
+    os.write((const char *)crcBytes, sizeof crcBytes);
+}
+
+
+struct PNGStripe
+{
+    const Image *image;
+    unsigned outChannels;
+    unsigned y0;
+    unsigned y1;
+    bool last;
+
+    std::string output;
+    uLong adler;
+    size_t rawSize;
+};
+
+
+/* Convert row y (counting from the top) to 8 bits, with outChannels channels */
+static void
+convertRow(const Image *image, unsigned y, unsigned outChannels, unsigned char *dst)
+{
+    const unsigned char *row = image->start() + (ptrdiff_t)y * image->stride();
+    unsigned width = image->width;
+    unsigned channels = image->channels;
+
+    if (image->channelType == TYPE_UNORM8) {
+        if (outChannels == channels) {
+            memcpy(dst, row, width * channels);
+        } else {
+            for (unsigned x = 0; x < width; ++x) {
+                memcpy(dst, row, outChannels);
+                dst += outChannels;
+                row += channels;
+            }
+        }
+        return;
+    }
+
+    const SRGBTable &table = srgbTable();
+    const float *rowFloat = (const float *)row;
+    for (unsigned x = 0; x < width; ++x) {
+        for (unsigned channel = 0; channel < outChannels; ++channel) {
+            float c = rowFloat[channel];
+            bool srgb = channels >= 3 && channel < 3;
+            *dst++ = srgb ? table.convert(c) : floatToUnorm8(c);
+        }
+        rowFloat += channels;
+    }
+}
+
+
+static inline unsigned char
+paethPredictor(int a, int b, int c)
+{
+    int p = a + b - c;
+    int pa = abs(p - a);
+    int pb = abs(p - b);
+    int pc = abs(p - c);
+    if (pa <= pb && pa <= pc) {
+        return a;
+    }
+    if (pb <= pc) {
+        return b;
+    }
+    return c;
+}
+
+
+static inline unsigned
+absResidual(unsigned char v)
+{
+    return v < 128 ? v : 256 - v;
+}
+
+
+/*
+ * Filter a row with whichever of the five PNG filters yields the smallest sum
+ * of absolute differences, the same heuristic libpng uses for adaptive
+ * filtering.
+ */
+static void
+filterRow(const unsigned char *cur, const unsigned char *prev,
+          size_t rowSize, unsigned bpp,
+          unsigned char *dst)
+{
+    unsigned long noneSum = 0;
+    unsigned long subSum = 0;
+    unsigned long upSum = 0;
+    unsigned long avgSum = 0;
+    unsigned long paethSum = 0;
+
+    for (size_t i = 0; i < bpp; ++i) {
+        unsigned char x = cur[i];
+        unsigned char b = prev[i];
+        noneSum += absResidual(x);
+        subSum += absResidual(x);
+        upSum += absResidual(x - b);
+        avgSum += absResidual(x - (b >> 1));
+        paethSum += absResidual(x - b);
+    }
+    for (size_t i = bpp; i < rowSize; ++i) {
+        unsigned char x = cur[i];
+        unsigned char a = cur[i - bpp];
+        unsigned char b = prev[i];
+        unsigned char c = prev[i - bpp];
+        noneSum += absResidual(x);
+        subSum += absResidual(x - a);
+        upSum += absResidual(x - b);
+        avgSum += absResidual(x - ((a + b) >> 1));
+        paethSum += absResidual(x - paethPredictor(a, b, c));
+    }
+
+    unsigned long sums[5] = {noneSum, subSum, upSum, avgSum, paethSum};
+    unsigned filter = 0;
+    for (unsigned i = 1; i < 5; ++i) {
+        if (sums[i] < sums[filter]) {
+            filter = i;
+        }
+    }
+
+    dst[0] = (unsigned char)filter;
+    dst += 1;
+
+    switch (filter) {
+    case 0:
+        memcpy(dst, cur, rowSize);
+        break;
+    case 1:
+        memcpy(dst, cur, bpp);
+        for (size_t i = bpp; i < rowSize; ++i) {
+            dst[i] = cur[i] - cur[i - bpp];
+        }
+        break;
+    case 2:
+        for (size_t i = 0; i < rowSize; ++i) {
+            dst[i] = cur[i] - prev[i];
+        }
+        break;
+    case 3:
+        for (size_t i = 0; i < bpp; ++i) {
+            dst[i] = cur[i] - (prev[i] >> 1);
+        }
+        for (size_t i = bpp; i < rowSize; ++i) {
+            dst[i] = cur[i] - ((cur[i - bpp] + prev[i]) >> 1);
+        }
+        break;
+    default:
+        for (size_t i = 0; i < bpp; ++i) {
+            dst[i] = cur[i] - prev[i];
+        }
+        for (size_t i = bpp; i < rowSize; ++i) {
+            dst[i] = cur[i] - paethPredictor(cur[i - bpp], prev[i], prev[i - bpp]);
+        }
+        break;
+    }
+}
+
+
+static void
+compressPNGStripe(PNGStripe *stripe)
+{
+    const Image *image = stripe->image;
+    unsigned bpp = stripe->outChannels;
+    size_t rowSize = (size_t)image->width * bpp;
+    unsigned rows = stripe->y1 - stripe->y0;
+
+    // Filtered scanlines, plus the previous and current unfiltered rows
+    stripe->rawSize = rows * (rowSize + 1);
+    unsigned char *raw = new unsigned char[stripe->rawSize];
+    unsigned char *prev = new unsigned char[rowSize];
+    unsigned char *cur = new unsigned char[rowSize];
+
+    if (stripe->y0 > 0) {
+        convertRow(image, stripe->y0 - 1, bpp, prev);
+    } else {
+        memset(prev, 0, rowSize);
+    }
+
+    unsigned char *dst = raw;
+    for (unsigned y = stripe->y0; y < stripe->y1; ++y) {
+        convertRow(image, y, bpp, cur);
+        filterRow(cur, prev, rowSize, bpp, dst);
+        std::swap(cur, prev);
+        dst += rowSize + 1;
+    }
+
+    delete [] cur;
+    delete [] prev;
+
+    stripe->adler = adler32(0L, Z_NULL, 0);
+    stripe->adler = adler32(stripe->adler, raw, uInt(stripe->rawSize));
+
+    z_stream strm;
+    memset(&strm, 0, sizeof strm);
+    // Raw deflate, as the zlib header and checksum are written once for all stripes
+    deflateInit2(&strm, png_compression_level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+
+    stripe->output.resize(deflateBound(&strm, uLong(stripe->rawSize)) + 16);
+    strm.next_in = raw;
+    strm.avail_in = uInt(stripe->rawSize);
+    strm.next_out = (Bytef *)&stripe->output[0];
+    strm.avail_out = uInt(stripe->output.size());
+
+    int flush = stripe->last ? Z_FINISH : Z_SYNC_FLUSH;
+    while (deflate(&strm, flush) == Z_OK && strm.avail_out == 0) {
+        size_t used = stripe->output.size();
+        stripe->output.resize(used * 2);
+        strm.next_out = (Bytef *)&stripe->output[used];
+        strm.avail_out = uInt(used);
+    }
+
+    stripe->output.resize(strm.total_out);
+    deflateEnd(&strm);
+
+    delete [] raw;
+}
+
+
+/*
+ * Shared by all threads writing PNGs, so that concurrent snapshots don't
+ * each spawn their own threads.
+ */
+static ThreadPool &
+pngThreadPool(void)
+{
+    static unsigned threads = os::thread::hardware_concurrency();
+    static ThreadPool *pool = new ThreadPool(threads ? threads : 1);
+    return *pool;
+}
+
+
+struct PNGStripeBatch
+{
+    os::mutex mutex;
+    os::condition_variable done;
+    unsigned pending;
+};
+
+
+static void
+compressPNGStripeAsync(PNGStripe *stripe, PNGStripeBatch *batch)
+{
+    compressPNGStripe(stripe);
+
+    os::unique_lock<os::mutex> lock(batch->mutex);
+    if (--batch->pending == 0) {
+        batch->done.notify_all();
+    }
+}
+
+
 bool
 Image::writePNG(std::ostream &os, bool strip_alpha) const
 {
-    png_structp png_ptr;
-    png_infop info_ptr;
     int color_type;
+    unsigned outChannels = channels;
 
     switch (channels) {
     case 4:
-        color_type = strip_alpha ? PNG_COLOR_TYPE_RGB : PNG_COLOR_TYPE_RGB_ALPHA;
+        if (strip_alpha) {
+            color_type = PNG_COLOR_TYPE_RGB;
+            outChannels = 3;
+        } else {
+            color_type = PNG_COLOR_TYPE_RGB_ALPHA;
+        }
         break;
     case 3:
         color_type = PNG_COLOR_TYPE_RGB;
@@ -105,68 +476,79 @@ Image::writePNG(std::ostream &os, bool strip_alpha) const
         break;
     default:
         assert(0);
-        goto no_png;
-    }
-
-    png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-    if (!png_ptr)
-        goto no_png;
-
-    info_ptr = png_create_info_struct(png_ptr);
-    if (!info_ptr) {
-        png_destroy_write_struct(&png_ptr,  NULL);
-        goto no_png;
+        return false;
     }
 
-    if (setjmp(png_jmpbuf(png_ptr))) {
-        png_destroy_write_struct(&png_ptr, &info_ptr);
-        goto no_png;
+    static const unsigned char signature[8] = {137, 'P', 'N', 'G', '\r', '\n', 26, '\n'};
+    os.write((const char *)signature, sizeof signature);
+
+    unsigned char ihdr[13];
+    writeBE32(ihdr, width);
+    writeBE32(ihdr + 4, height);
+    ihdr[8] = 8; // bit depth
+    ihdr[9] = color_type;
+    ihdr[10] = 0; // compression
+    ihdr[11] = 0; // filter
+    ihdr[12] = 0; // interlace
+    writePNGChunk(os, "IHDR", ihdr, sizeof ihdr);
+
+    // Split in stripes of at least 256KB of pixels each
+    size_t rowSize = (size_t)width * outChannels + 1;
+    unsigned stripeRows = std::max<size_t>(1, (256 * 1024) / rowSize);
+    unsigned numStripes = std::max(1u, (height + stripeRows - 1) / stripeRows);
+
+    std::vector<PNGStripe> stripes(numStripes);
+    for (unsigned i = 0; i < numStripes; ++i) {
+        PNGStripe &stripe = stripes[i];
+        stripe.image = this;
+        stripe.outChannels = outChannels;
+        stripe.y0 = i * stripeRows;
+        stripe.y1 = std::min(height, stripe.y0 + stripeRows);
+        stripe.last = i + 1 == numStripes;
     }
 
-    png_set_write_fn(png_ptr, &os, pngWriteCallback, NULL);
+    if (numStripes == 1) {
+        compressPNGStripe(&stripes[0]);
+    } else {
+        PNGStripeBatch batch;
+        batch.pending = numStripes - 1;
 
-    png_set_IHDR(png_ptr, info_ptr, width, height, 8,
-                 color_type, PNG_INTERLACE_NONE,
-                 PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
+        ThreadPool &pool = pngThreadPool();
+        for (unsigned i = 1; i < numStripes; ++i) {
+            pool.enqueue(compressPNGStripeAsync, &stripes[i], &batch);
+        }
 
-    png_set_compression_level(png_ptr, png_compression_level);
+        // Lend a hand rather than just waiting
+        compressPNGStripe(&stripes[0]);
 
-    png_write_info(png_ptr, info_ptr);
+        os::unique_lock<os::mutex> lock(batch.mutex);
+        while (batch.pending) {
+            batch.done.wait(lock);
+        }
+    }
 
-    if (channels == 4 && strip_alpha) {
-        png_set_filler(png_ptr, 0, PNG_FILLER_AFTER);
+    uLong adler = stripes[0].adler;
+    for (unsigned i = 1; i < numStripes; ++i) {
+        adler = adler32_combine(adler, stripes[i].adler, stripes[i].rawSize);
     }
 
-    switch (channelType) {
-    case TYPE_UNORM8:
-        for (const unsigned char *row = start(); row != end(); row += stride()) {
-            png_write_rows(png_ptr, (png_bytepp) &row, 1);
-        }
-        break;
-    case TYPE_FLOAT:
-        png_bytep rowUnorm8 = new png_byte[width * channels];
-        for (const unsigned char *row = start(); row != end(); row += stride()) {
-            const float *rowFloat = (const float *)row;
-            for (unsigned x = 0, i = 0; x < width; ++x) {
-                for (unsigned channel = 0; channel < channels; ++channel, ++i) {
-                    float c = rowFloat[i];
-                    bool srgb = channels >= 3 && channel < 3;
-                    rowUnorm8[i] = srgb ? floatToSRGB(c) : floatToUnorm8(c);
-                }
-            }
-            png_write_rows(png_ptr, (png_bytepp) &rowUnorm8, 1);
+    static const unsigned char zlibHeader[2] = {0x78, 0x01};
+    unsigned char zlibTrailer[4];
+    writeBE32(zlibTrailer, uint32_t(adler));
+
+    for (unsigned i = 0; i < numStripes; ++i) {
+        const std::string &output = stripes[i].output;
+        if (i == 0) {
+            writePNGChunk(os, "IDAT", zlibHeader, sizeof zlibHeader, output.data(), output.size());
+        } else {
+            writePNGChunk(os, "IDAT", output.data(), output.size());
         }
-        delete [] rowUnorm8;
-        break;
     }
+    writePNGChunk(os, "IDAT", zlibTrailer, sizeof zlibTrailer);
 
-    png_write_end(png_ptr, info_ptr);
-    png_destroy_write_struct(&png_ptr, &info_ptr);
+    writePNGChunk(os, "IEND", NULL, 0);
 
-    return true;
-
-no_png:
-    return false;
+    return !os.fail();
 }
 
 
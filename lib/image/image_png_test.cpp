@@ -0,0 +1,167 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+#include <math.h>
+#include <string.h>
+
+#include <sstream>
+
+#include "image.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace image;
+
+
+static Image *
+makeImage(unsigned width, unsigned height, unsigned channels)
+{
+    Image *image = new Image(width, height, channels);
+    unsigned seed = 1;
+    for (unsigned i = 0; i < width * height * channels; ++i) {
+        // Smooth gradients with some noise, like rendered frames
+        seed = seed * 1103515245 + 12345;
+        image->pixels[i] = (i / channels) % width + ((seed >> 16) & 3);
+    }
+    return image;
+}
+
+
+static Image *
+roundTrip(const Image *image, bool strip_alpha = false)
+{
+    std::stringstream ss;
+    EXPECT_TRUE(image->writePNG(ss, strip_alpha));
+    return readPNG(ss);
+}
+
+
+static void
+expectSamePixels(const Image *expected, const Image *actual)
+{
+    ASSERT_TRUE(actual != NULL);
+    ASSERT_EQ(expected->width, actual->width);
+    ASSERT_EQ(expected->height, actual->height);
+    ASSERT_EQ(expected->channels, actual->channels);
+    EXPECT_EQ(0, memcmp(expected->pixels, actual->pixels,
+                        expected->width * expected->height * expected->channels));
+}
+
+
+TEST(image_png, small)
+{
+    for (unsigned channels = 1; channels <= 4; ++channels) {
+        Image *image = makeImage(17, 5, channels);
+        Image *decoded = roundTrip(image);
+        expectSamePixels(image, decoded);
+        delete decoded;
+        delete image;
+    }
+}
+
+
+TEST(image_png, stripes)
+{
+    // Large enough to be split in several independently deflated stripes
+    Image *image = makeImage(1920, 1080, 4);
+    Image *decoded = roundTrip(image);
+    expectSamePixels(image, decoded);
+    delete decoded;
+    delete image;
+}
+
+
+TEST(image_png, flipped_strip_alpha)
+{
+    Image *image = makeImage(640, 480, 4);
+    image->flipped = true;
+
+    Image *decoded = roundTrip(image, true);
+    ASSERT_TRUE(decoded != NULL);
+    ASSERT_EQ(3, decoded->channels);
+
+    for (unsigned y = 0; y < image->height; ++y) {
+        const unsigned char *src = image->start() + (int)y * image->stride();
+        const unsigned char *dst = decoded->pixels + y * image->width * 3;
+        for (unsigned x = 0; x < image->width; ++x) {
+            ASSERT_EQ(0, memcmp(src + x * 4, dst + x * 3, 3)) << x << ", " << y;
+        }
+    }
+
+    delete decoded;
+    delete image;
+}
+
+
+static unsigned char
+referenceSRGB(float c)
+{
+    if (c <= 0.0f) {
+        return 0;
+    }
+    if (c >= 1.0f) {
+        return 255;
+    }
+    if (c <= 0.0031308f) {
+        c *= 12.92f;
+    } else {
+        c = 1.055f * powf(c, 1.0f/2.4f) - 0.055f;
+    }
+    return c * 255.0f + 0.5f;
+}
+
+
+TEST(image_png, float_srgb)
+{
+    const unsigned width = 4096;
+    Image image(width, 1, 4, false, TYPE_FLOAT);
+    float *pixels = (float *)image.pixels;
+    for (unsigned i = 0; i < width * 4; ++i) {
+        pixels[i] = (float)i / (width * 4 - 1) * 1.1f - 0.05f;
+    }
+
+    Image *decoded = roundTrip(&image);
+    ASSERT_TRUE(decoded != NULL);
+    for (unsigned i = 0; i < width * 4; ++i) {
+        unsigned char expected;
+        if (i % 4 == 3) {
+            float c = pixels[i];
+            expected = c <= 0.0f ? 0 : c >= 1.0f ? 255 : (unsigned char)(c * 255.0f + 0.5f);
+        } else {
+            expected = referenceSRGB(pixels[i]);
+        }
+        ASSERT_EQ(expected, decoded->pixels[i]) << pixels[i];
+    }
+    delete decoded;
+}
+
+
+int
+main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,480 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Benchmark of the trace I/O stack, on synthetic traces.
+ *
+ * For every call mix, a trace is serialized into memory, and then, for every
+ * codec, compressed into a file, decompressed, scanned and fully parsed.
+ * Each stage is reported as one JSON object per line, with rates relative to
+ * the uncompressed trace size.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h> // for CHAR_MAX
+#include <getopt.h>
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <brotli/enc/encode.h>
+
+#include "os_time.hpp"
+#include "trace_file.hpp"
+#include "trace_gen.hpp"
+#include "trace_ostream.hpp"
+#include "trace_parser.hpp"
+#include "trace_writer.hpp"
+
+
+enum Codec {
+    CODEC_SNAPPY = 0,
+    CODEC_ZLIB,
+    CODEC_BROTLI,
+    CODEC_COUNT
+};
+
+static const char *codecNames[CODEC_COUNT] = {"snappy", "zlib", "brotli"};
+
+
+static void
+usage(void)
+{
+    std::cout
+        << "usage: trace_bench [OPTIONS]\n"
+        << "Measure the throughput of writing, compressing, decompressing, scanning\n"
+        "and parsing synthetic traces, for every codec.\n"
+        "\n"
+        "    -h, --help             show this help message and exit\n"
+        "    -n, --calls=N          number of calls per trace\n"
+        "    -S, --size=MB          approximate uncompressed size of each trace, when\n"
+        "                           the number of calls is not given [default: 16]\n"
+        "    -m, --mix=MIX          only benchmark the given mix (may be repeated)\n"
+        "    -c, --codec=CODEC      only benchmark snappy, zlib or brotli (may be repeated)\n"
+        "    -s, --seed=N           random seed [default: 0]\n"
+        "    -r, --repeat=N         report the best of up to N runs of every stage,\n"
+        "                           stopping after a second [default: 3]\n"
+        "    -o, --output=TRACE     scratch trace file [default: trace_bench.trace]\n"
+        "    --brotli-quality=N     Brotli quality [default: 9]\n"
+        "\n"
+        "Results are written to standard output as JSON lines, like\n"
+        "\n"
+        "  {\"mix\": \"blob\", \"codec\": \"zlib\", \"stage\": \"scan\", \"calls\": 200000,\n"
+        "   \"bytes\": 2621440, \"compressed_bytes\": 1048576, \"seconds\": 0.5,\n"
+        "   \"mb_per_s\": 5.24, \"calls_per_s\": 400000}\n"
+        "\n"
+        "where bytes is the uncompressed trace size, and MB are 10^6 bytes.  The\n"
+        "write stage generates calls and serializes them into memory, so its\n"
+        "codec is \"none\".\n"
+    ;
+}
+
+enum {
+    BROTLI_QUALITY_OPT = CHAR_MAX + 1,
+};
+
+const static char *
+shortOptions = "hn:S:m:c:s:r:o:";
+
+const static struct option
+longOptions[] = {
+    {"help", no_argument, 0, 'h'},
+    {"calls", required_argument, 0, 'n'},
+    {"size", required_argument, 0, 'S'},
+    {"mix", required_argument, 0, 'm'},
+    {"codec", required_argument, 0, 'c'},
+    {"seed", required_argument, 0, 's'},
+    {"repeat", required_argument, 0, 'r'},
+    {"output", required_argument, 0, 'o'},
+    {"brotli-quality", required_argument, 0, BROTLI_QUALITY_OPT},
+    {0, 0, 0, 0}
+};
+
+
+class MemoryOutStream : public trace::OutStream {
+public:
+    std::string &data;
+
+    MemoryOutStream(std::string &_data) : data(_data) {}
+
+    bool write(const void *buffer, size_t length) override {
+        data.append(static_cast<const char *>(buffer), length);
+        return true;
+    }
+
+    void flush(void) override {}
+};
+
+
+struct Bench
+{
+    trace::GenOptions options;
+    unsigned long long calls = 0;
+    size_t size = 16 * 1000 * 1000;
+    unsigned repeat = 3;
+    int brotliQuality = 9;
+    std::string filename = "trace_bench.trace";
+
+    // Uncompressed trace of the current mix
+    std::string data;
+
+    // Size of the scratch trace, as last compressed
+    unsigned long long compressedBytes = 0;
+
+    void
+    report(const char *codec, const char *stage, long long bestTime);
+
+    void calibrate(void);
+    void write(void);
+    bool compress(Codec codec);
+    bool decompress(Codec codec);
+    bool parse(Codec codec, bool scan);
+
+    bool run(Codec codec);
+};
+
+
+void
+Bench::report(const char *codec, const char *stage, long long bestTime)
+{
+    double seconds = (double)bestTime / os::timeFrequency;
+    if (seconds <= 0) {
+        seconds = 1.0 / os::timeFrequency;
+    }
+
+    printf("{\"mix\": \"%s\", \"codec\": \"%s\", \"stage\": \"%s\", "
+           "\"calls\": %llu, \"bytes\": %llu, \"compressed_bytes\": %llu, "
+           "\"seconds\": %.6f, \"mb_per_s\": %.2f, \"calls_per_s\": %.0f}\n",
+           trace::getGenMixName(options.mix), codec, stage,
+           options.calls, (unsigned long long)data.size(), compressedBytes,
+           seconds, data.size() / seconds / 1e6, options.calls / seconds);
+    fflush(stdout);
+}
+
+
+/*
+ * Time the given function, returning the best time of all runs, or -1 if
+ * any run failed.  Slow stages, like Brotli compression, are not repeated
+ * once they took a second overall.
+ */
+template< class Function >
+static long long
+timeBest(unsigned repeat, Function function)
+{
+    long long best = -1;
+    long long total = 0;
+    for (unsigned i = 0; i < repeat && total < os::timeFrequency; ++i) {
+        long long start = os::getTime();
+        if (!function()) {
+            return -1;
+        }
+        long long elapsed = os::getTime() - start;
+        if (best < 0 || elapsed < best) {
+            best = elapsed;
+        }
+        total += elapsed;
+    }
+    return best;
+}
+
+
+static unsigned long long
+getFileSize(const char *filename)
+{
+    FILE *file = fopen(filename, "rb");
+    if (!file) {
+        return 0;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fclose(file);
+    return size < 0 ? 0 : size;
+}
+
+
+/*
+ * Pick the number of calls of the current mix, as the size of calls varies
+ * by orders of magnitude between mixes.
+ */
+void
+Bench::calibrate(void)
+{
+    if (calls) {
+        options.calls = calls;
+        return;
+    }
+
+    const unsigned long long sampleCalls = 1000;
+    options.calls = sampleCalls;
+
+    std::string sample;
+    trace::Writer writer;
+    writer.open(new MemoryOutStream(sample));
+    trace::generateTrace(writer, options);
+    writer.close();
+
+    options.calls = std::max(100ULL, (unsigned long long)(size * sampleCalls / sample.size()));
+}
+
+
+void
+Bench::write(void)
+{
+    long long best = timeBest(repeat, [&] {
+        data.clear();
+        trace::Writer writer;
+        writer.open(new MemoryOutStream(data));
+        trace::generateTrace(writer, options);
+        writer.close();
+        return true;
+    });
+
+    compressedBytes = data.size();
+    report("none", "write", best);
+}
+
+
+bool
+Bench::compress(Codec codec)
+{
+    long long best = timeBest(repeat, [&] {
+        if (codec == CODEC_BROTLI) {
+            // Same parameters as `apitrace repack --brotli`
+            brotli::BrotliParams params;
+            params.quality = brotliQuality;
+            params.lgwin = 24;
+
+            FILE *file = fopen(filename.c_str(), "wb");
+            if (!file) {
+                std::cerr << "error: failed to open " << filename << "\n";
+                return false;
+            }
+            brotli::BrotliMemIn in(data.data(), data.size());
+            brotli::BrotliFileOut out(file);
+            bool ok = brotli::BrotliCompress(params, &in, &out);
+            fclose(file);
+            if (!ok) {
+                std::cerr << "error: brotli compression failed\n";
+            }
+            return ok;
+        }
+
+        std::unique_ptr<trace::OutStream> stream(
+            codec == CODEC_ZLIB ? trace::createZLibStream(filename.c_str())
+                                : trace::createSnappyStream(filename.c_str()));
+        if (!stream) {
+            return false;
+        }
+
+        // Same granularity as the writer's own buffering would give
+        const size_t chunkSize = 64 * 1024;
+        for (size_t offset = 0; offset < data.size(); offset += chunkSize) {
+            stream->write(data.data() + offset, std::min(chunkSize, data.size() - offset));
+        }
+        return true;
+    });
+
+    if (best < 0) {
+        return false;
+    }
+
+    compressedBytes = getFileSize(filename.c_str());
+    report(codecNames[codec], "compress", best);
+    return true;
+}
+
+
+bool
+Bench::decompress(Codec codec)
+{
+    std::vector<char> buffer(64 * 1024);
+
+    long long best = timeBest(repeat, [&] {
+        std::unique_ptr<trace::File> file(trace::File::createForRead(filename.c_str()));
+        if (!file) {
+            return false;
+        }
+        size_t total = 0;
+        size_t read;
+        while ((read = file->read(buffer.data(), buffer.size())) != 0) {
+            total += read;
+        }
+        if (total != data.size()) {
+            std::cerr << "error: decompressed " << total << " bytes instead of " << data.size() << "\n";
+            return false;
+        }
+        return true;
+    });
+
+    if (best < 0) {
+        return false;
+    }
+
+    report(codecNames[codec], "decompress", best);
+    return true;
+}
+
+
+bool
+Bench::parse(Codec codec, bool scan)
+{
+    long long best = timeBest(repeat, [&] {
+        trace::Parser parser;
+        if (!parser.open(filename.c_str())) {
+            return false;
+        }
+        unsigned long long calls = 0;
+        trace::Call *call;
+        while ((call = scan ? parser.scan_call() : parser.parse_call()) != NULL) {
+            ++calls;
+            delete call;
+        }
+        if (calls != options.calls) {
+            std::cerr << "error: parsed " << calls << " calls instead of " << options.calls << "\n";
+            return false;
+        }
+        return true;
+    });
+
+    if (best < 0) {
+        return false;
+    }
+
+    report(codecNames[codec], scan ? "scan" : "parse", best);
+    return true;
+}
+
+
+bool
+Bench::run(Codec codec)
+{
+    return compress(codec) &&
+           decompress(codec) &&
+           parse(codec, true) &&
+           parse(codec, false);
+}
+
+
+int
+main(int argc, char **argv)
+{
+    Bench bench;
+
+    std::vector<trace::GenMix> mixes;
+    std::vector<Codec> codecs;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, shortOptions, longOptions, NULL)) != -1) {
+        switch (opt) {
+        case 'h':
+            usage();
+            return 0;
+        case 'n':
+            bench.calls = strtoull(optarg, NULL, 0);
+            break;
+        case 'S':
+            bench.size = (size_t)(atof(optarg) * 1000 * 1000);
+            break;
+        case 'm':
+            {
+                trace::GenMix mix;
+                if (!trace::lookupGenMix(optarg, mix)) {
+                    std::cerr << "error: unknown mix `" << optarg << "`\n";
+                    return 1;
+                }
+                mixes.push_back(mix);
+            }
+            break;
+        case 'c':
+            {
+                unsigned codec = 0;
+                while (codec < CODEC_COUNT && strcmp(optarg, codecNames[codec]) != 0) {
+                    ++codec;
+                }
+                if (codec == CODEC_COUNT) {
+                    std::cerr << "error: unknown codec `" << optarg << "`\n";
+                    return 1;
+                }
+                codecs.push_back(static_cast<Codec>(codec));
+            }
+            break;
+        case 's':
+            bench.options.seed = strtoull(optarg, NULL, 0);
+            break;
+        case 'r':
+            bench.repeat = std::max(atoi(optarg), 1);
+            break;
+        case 'o':
+            bench.filename = optarg;
+            break;
+        case BROTLI_QUALITY_OPT:
+            bench.brotliQuality = atoi(optarg);
+            break;
+        default:
+            std::cerr << "error: unexpected option `" << (char)opt << "`\n";
+            usage();
+            return 1;
+        }
+    }
+
+    if (argc != optind) {
+        std::cerr << "error: unexpected arguments\n";
+        usage();
+        return 1;
+    }
+
+    if (mixes.empty()) {
+        for (unsigned mix = 0; mix < trace::GEN_MIX_COUNT; ++mix) {
+            mixes.push_back(static_cast<trace::GenMix>(mix));
+        }
+    }
+    if (codecs.empty()) {
+        for (unsigned codec = 0; codec < CODEC_COUNT; ++codec) {
+            codecs.push_back(static_cast<Codec>(codec));
+        }
+    }
+
+    int ret = 0;
+    for (trace::GenMix mix : mixes) {
+        bench.options.mix = mix;
+        bench.calibrate();
+        bench.write();
+        for (Codec codec : codecs) {
+            if (!bench.run(codec)) {
+                ret = 1;
+            }
+        }
+    }
+
+    remove(bench.filename.c_str());
+
+    return ret;
+}
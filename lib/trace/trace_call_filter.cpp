@@ -0,0 +1,101 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+#include <limits>
+#include <iostream>
+
+#include "trace_call_filter.hpp"
+
+
+namespace trace {
+
+
+CallFilter::CallFilter() :
+    haveCalls(false),
+    firstCall(0),
+    lastCall(std::numeric_limits<CallNo>::max()),
+    haveFrames(false),
+    haveFunctionRegex(false)
+{
+}
+
+
+void
+CallFilter::setCalls(const CallSet &_calls) {
+    calls = _calls;
+    haveCalls = true;
+}
+
+
+void
+CallFilter::setFrames(const CallSet &_frames) {
+    frames = _frames;
+    haveFrames = true;
+}
+
+
+void
+CallFilter::addFunction(const char *name) {
+    functionNames.insert(name);
+}
+
+
+void
+CallFilter::keepFunction(const char *name) {
+    keptFunctionNames.insert(name);
+}
+
+
+// std::regex reports malformed patterns by throwing, so exceptions are
+// enabled for this file alone.
+bool
+CallFilter::setFunctionRegex(const char *pattern) {
+    try {
+        functionRegex = std::regex(pattern, std::regex::ECMAScript | std::regex::optimize);
+    } catch (const std::regex_error &e) {
+        std::cerr << "error: invalid regular expression `" << pattern << "`: " << e.what() << "\n";
+        return false;
+    }
+    haveFunctionRegex = true;
+    return true;
+}
+
+
+bool
+CallFilter::acceptsFunction(const char *name) const {
+    if (!functionNames.empty() &&
+        functionNames.find(name) == functionNames.end()) {
+        return false;
+    }
+    if (haveFunctionRegex &&
+        !std::regex_match(name, functionRegex)) {
+        return false;
+    }
+    return true;
+}
+
+
+} /* namespace trace */
@@ -0,0 +1,139 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Call predicate which the parser evaluates as soon as a call's signature has
+ * been read, so that calls which are not wanted are skipped over without
+ * building their argument values.
+ *
+ * All criteria which were set must be met for a call to be accepted, except
+ * for calls to kept functions, which are always accepted.
+ */
+
+#pragma once
+
+
+#include <regex>
+#include <set>
+#include <string>
+
+#include "trace_model.hpp"
+#include "trace_callset.hpp"
+
+
+namespace trace {
+
+
+class CallFilter
+{
+protected:
+    bool haveCalls;
+    CallSet calls;
+
+    CallNo firstCall;
+    CallNo lastCall;
+
+    bool haveFrames;
+    CallSet frames;
+
+    std::set<std::string> functionNames;
+
+    bool haveFunctionRegex;
+    std::regex functionRegex;
+
+    std::set<std::string> keptFunctionNames;
+
+public:
+    /* A default constructed filter accepts every call. */
+    CallFilter();
+
+    /* Only accept calls in the given set. */
+    void
+    setCalls(const CallSet &calls);
+
+    /* Only accept calls numbered from first to last, inclusive. */
+    void
+    setCallRange(CallNo first, CallNo last) {
+        firstCall = first;
+        lastCall = last;
+    }
+
+    CallNo
+    getFirstCall(void) const {
+        return firstCall;
+    }
+
+    /* Only accept calls in the given frames, frames being numbered from zero
+     * and ended by calls flagged CALL_FLAG_END_FRAME. */
+    void
+    setFrames(const CallSet &frames);
+
+    /* Only accept calls to the given function.  May be called several times. */
+    void
+    addFunction(const char *name);
+
+    /* Only accept calls to functions whose whole name matches the given
+     * ECMAScript regular expression.  Returns false, leaving the filter
+     * unchanged, if the pattern is malformed. */
+    bool
+    setFunctionRegex(const char *pattern);
+
+    /* Accept every call to the given function, whatever the other criteria.
+     * May be called several times. */
+    void
+    keepFunction(const char *name);
+
+    /* Whether calls to the given function may be accepted.  The parser
+     * evaluates this once per signature. */
+    bool
+    acceptsFunction(const char *name) const;
+
+    /* Whether every call to the given function is accepted.  The parser
+     * evaluates this once per signature. */
+    bool
+    keepsFunction(const char *name) const {
+        return keptFunctionNames.find(name) != keptFunctionNames.end();
+    }
+
+    /* Whether the call is accepted, given its function is. */
+    bool
+    accepts(CallNo callNo, CallFlags flags, unsigned frameNo) const {
+        return callNo >= firstCall &&
+               callNo <= lastCall &&
+               (!haveCalls || calls.contains(callNo, flags)) &&
+               (!haveFrames || frames.contains(frameNo, flags));
+    }
+
+    /* Whether no call at or after the given call/frame can be accepted. */
+    bool
+    isPast(CallNo callNo, unsigned frameNo) const {
+        return callNo > lastCall ||
+               (haveCalls && callNo > calls.getLast()) ||
+               (haveFrames && frameNo > frames.getLast());
+    }
+};
+
+
+} /* namespace trace */
@@ -0,0 +1,263 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "trace_parser.hpp"
+#include "trace_writer.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace trace;
+
+
+static const char *foo_arg_names[] = {"x", "mode"};
+static const FunctionSig foo_sig = {0, "glFoo", 2, foo_arg_names};
+static const FunctionSig swap_sig = {1, "glXSwapBuffers", 0, NULL};
+
+static const EnumValue mode_values[] = {{"GL_POINTS", 0}, {"GL_LINES", 1}};
+static const EnumSig mode_sig = {0, 2, mode_values};
+
+static const char *traceFilename = "trace_call_filter_test.trace";
+
+
+/*
+ * Write 3 frames of 3 calls each:
+ *
+ *   glFoo(x = N, mode = GL_LINES) = N
+ *   glFoo(x = N, mode = GL_LINES) = N
+ *   glXSwapBuffers()
+ */
+static void
+writeTrace(void)
+{
+    Writer writer;
+    ASSERT_TRUE(writer.open(traceFilename));
+    for (unsigned frame = 0; frame < 3; ++frame) {
+        for (unsigned i = 0; i < 2; ++i) {
+            unsigned call_no = writer.beginEnter(&foo_sig, 0);
+            writer.beginArg(0);
+            writer.writeUInt(call_no);
+            writer.endArg();
+            writer.beginArg(1);
+            writer.writeEnum(&mode_sig, 1);
+            writer.endArg();
+            writer.endEnter();
+            writer.beginLeave(call_no);
+            writer.beginReturn();
+            writer.writeUInt(call_no);
+            writer.endReturn();
+            writer.endLeave();
+        }
+        unsigned call_no = writer.beginEnter(&swap_sig, 0);
+        writer.endEnter();
+        writer.beginLeave(call_no);
+        writer.endLeave();
+    }
+    writer.close();
+}
+
+
+static CallSet
+callSet(const char *str)
+{
+    CallSet set(FREQUENCY_NONE);
+    set.merge(str);
+    return set;
+}
+
+
+static std::vector<CallNo>
+parseCallNos(const CallFilter &filter)
+{
+    std::vector<CallNo> callNos;
+
+    Parser parser;
+    parser.setFilter(&filter);
+    EXPECT_TRUE(parser.open(traceFilename));
+    Call *call;
+    while ((call = parser.parse_call())) {
+        callNos.push_back(call->no);
+        if (strcmp(call->name(), "glFoo") == 0) {
+            // Values must be intact even though signatures were defined
+            // by skipped calls.
+            EXPECT_EQ(call->no, call->arg(0).toUInt());
+            EXPECT_EQ(1, call->arg(1).toSInt());
+            EXPECT_EQ(call->no, call->ret->toUInt());
+        }
+        delete call;
+    }
+
+    return callNos;
+}
+
+
+TEST(trace_call_filter, calls)
+{
+    writeTrace();
+
+    CallFilter filter;
+    filter.setCalls(callSet("4-5"));
+    std::vector<CallNo> expected = {4, 5};
+    EXPECT_EQ(expected, parseCallNos(filter));
+
+    filter.setCalls(callSet("*/frame"));
+    expected = {2, 5, 8};
+    EXPECT_EQ(expected, parseCallNos(filter));
+
+    remove(traceFilename);
+}
+
+
+TEST(trace_call_filter, frames)
+{
+    writeTrace();
+
+    CallFilter filter;
+    filter.setFrames(callSet("1"));
+    std::vector<CallNo> expected = {3, 4, 5};
+    EXPECT_EQ(expected, parseCallNos(filter));
+
+    filter.setCalls(callSet("0-4"));
+    expected = {3, 4};
+    EXPECT_EQ(expected, parseCallNos(filter));
+
+    remove(traceFilename);
+}
+
+
+TEST(trace_call_filter, functions)
+{
+    writeTrace();
+
+    CallFilter filter;
+    filter.addFunction("glXSwapBuffers");
+    std::vector<CallNo> expected = {2, 5, 8};
+    EXPECT_EQ(expected, parseCallNos(filter));
+
+    CallFilter regexFilter;
+    regexFilter.setFunctionRegex("gl[^X].*");
+    expected = {0, 1, 3, 4, 6, 7};
+    EXPECT_EQ(expected, parseCallNos(regexFilter));
+
+    regexFilter.setFunctionRegex("Foo");
+    expected = {};
+    EXPECT_EQ(expected, parseCallNos(regexFilter));
+
+    // Malformed patterns are rejected, leaving the filter as it was
+    EXPECT_FALSE(regexFilter.setFunctionRegex("("));
+    EXPECT_EQ(expected, parseCallNos(regexFilter));
+
+    remove(traceFilename);
+}
+
+
+TEST(trace_call_filter, frame_no)
+{
+    writeTrace();
+
+    // Frame numbers must count skipped calls too
+    CallFilter filter;
+    filter.setFunctionRegex("glFoo");
+    filter.setCalls(callSet("4-7"));
+
+    Parser parser;
+    parser.setFilter(&filter);
+    ASSERT_TRUE(parser.open(traceFilename));
+    std::vector<unsigned> frameNos;
+    Call *call;
+    while ((call = parser.parse_call())) {
+        frameNos.push_back(call->frame_no);
+        delete call;
+    }
+    std::vector<unsigned> expected = {1, 2, 2};
+    EXPECT_EQ(expected, frameNos);
+    parser.close();
+
+    remove(traceFilename);
+}
+
+
+TEST(trace_call_filter, interleaved)
+{
+    Writer writer;
+    ASSERT_TRUE(writer.open(traceFilename));
+    unsigned outer = writer.beginEnter(&foo_sig, 0);
+    writer.endEnter();
+    unsigned inner = writer.beginEnter(&foo_sig, 1);
+    writer.endEnter();
+    writer.beginLeave(outer);
+    writer.beginReturn();
+    writer.writeUInt(outer);
+    writer.endReturn();
+    writer.endLeave();
+    writer.beginLeave(inner);
+    writer.beginReturn();
+    writer.writeUInt(inner);
+    writer.endReturn();
+    writer.endLeave();
+    writer.close();
+
+    // The rejected call's leave event must be skipped
+    Parser parser;
+    CallFilter filter;
+    filter.setCalls(callSet("1"));
+    parser.setFilter(&filter);
+    ASSERT_TRUE(parser.open(traceFilename));
+    Call *call = parser.parse_call();
+    ASSERT_TRUE(call != NULL);
+    EXPECT_EQ(1U, call->no);
+    EXPECT_EQ(1U, call->thread_id);
+    ASSERT_TRUE(call->ret != NULL);
+    EXPECT_EQ(1ULL, call->ret->toUInt());
+    delete call;
+    EXPECT_TRUE(parser.parse_call() == NULL);
+    parser.close();
+
+    // An accepted call must be returned complete even when the filter is
+    // already past it
+    filter.setCalls(callSet("0"));
+    parser.setFilter(&filter);
+    ASSERT_TRUE(parser.open(traceFilename));
+    call = parser.parse_call();
+    ASSERT_TRUE(call != NULL);
+    EXPECT_EQ(0U, call->no);
+    EXPECT_FALSE(call->flags & CALL_FLAG_INCOMPLETE);
+    ASSERT_TRUE(call->ret != NULL);
+    delete call;
+    EXPECT_TRUE(parser.parse_call() == NULL);
+
+    remove(traceFilename);
+}
+
+
+int
+main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
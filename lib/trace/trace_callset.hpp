@@ -177,11 +177,11 @@ namespace trace {
             return contains(call.no, call.flags);
         }
 
-        CallNo getFirst() {
+        CallNo getFirst() const {
             return limits.start;
         }
 
-        CallNo getLast() {
+        CallNo getLast() const {
             return limits.stop;
         }
     };
@@ -0,0 +1,465 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+#include <assert.h>
+#include <string.h>
+#include <wchar.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+#include "cxx_compat.hpp" // for std::to_string
+#include "os_string.hpp"
+
+#include "crc32c.hpp"
+
+#include "trace_columnar.hpp"
+
+
+namespace trace {
+
+
+// Columns are written out in chunks of this size
+static const size_t columnBufferSize = 64 * 1024;
+
+
+ColumnarFile::~ColumnarFile() {
+    close();
+}
+
+
+bool
+ColumnarFile::open(const std::string &filename) {
+    assert(!file);
+    file = fopen(filename.c_str(), "wb");
+    if (!file) {
+        std::cerr << "error: failed to create " << filename << "\n";
+        return false;
+    }
+    buffer.reserve(columnBufferSize);
+    return true;
+}
+
+
+bool
+ColumnarFile::close(void) {
+    if (!file) {
+        return true;
+    }
+    bool success = fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+    success = !failed && !ferror(file) && success;
+    success = fclose(file) == 0 && success;
+    file = nullptr;
+    failed = false;
+    buffer.clear();
+    return success;
+}
+
+
+void
+ColumnarFile::write(const void *data, size_t size) {
+    if (buffer.size() + size > columnBufferSize) {
+        if (fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size()) {
+            failed = true;
+        }
+        buffer.clear();
+    }
+    const char *bytes = static_cast<const char *>(data);
+    buffer.insert(buffer.end(), bytes, bytes + size);
+}
+
+
+/*
+ * Reduce a value to a type and a 64 bits scalar.
+ */
+class ScalarVisitor : public Visitor
+{
+public:
+    ColumnarType type = COLUMNAR_OTHER;
+    uint64_t value = 0;
+
+    void visit(Null *) override {
+        type = COLUMNAR_NULL;
+    }
+
+    void visit(Bool *node) override {
+        type = COLUMNAR_BOOL;
+        value = node->value;
+    }
+
+    void visit(SInt *node) override {
+        type = COLUMNAR_SINT;
+        value = node->value;
+    }
+
+    void visit(UInt *node) override {
+        type = COLUMNAR_UINT;
+        value = node->value;
+    }
+
+    void visit(Float *node) override {
+        type = COLUMNAR_FLOAT;
+        double d = node->value;
+        memcpy(&value, &d, sizeof value);
+    }
+
+    void visit(Double *node) override {
+        type = COLUMNAR_FLOAT;
+        memcpy(&value, &node->value, sizeof value);
+    }
+
+    void visit(String *node) override {
+        type = COLUMNAR_STRING;
+        value = strlen(node->value);
+    }
+
+    void visit(WString *node) override {
+        type = COLUMNAR_STRING;
+        value = wcslen(node->value);
+    }
+
+    void visit(Enum *node) override {
+        type = COLUMNAR_ENUM;
+        value = node->value;
+    }
+
+    void visit(Bitmask *node) override {
+        type = COLUMNAR_BITMASK;
+        value = node->value;
+    }
+
+    void visit(Struct *) override {}
+
+    void visit(Array *) override {}
+
+    void visit(Blob *) override {
+        type = COLUMNAR_BLOB;
+    }
+
+    void visit(Pointer *node) override {
+        type = COLUMNAR_POINTER;
+        value = node->value;
+    }
+
+    void visit(Repr *node) override {
+        _visit(node->machineValue);
+    }
+};
+
+
+bool
+ColumnarWriter::openArgColumns(ArgColumns &columns, const std::string &name) {
+    return columns.types.open(dirname + name + ".type.u8") &&
+           columns.values.open(dirname + name + ".value.u64");
+}
+
+
+bool
+ColumnarWriter::open(const char *_dirname) {
+    os::String path(_dirname);
+    if (!path.exists() && !os::createDirectory(path)) {
+        std::cerr << "error: failed to create " << _dirname << " directory\n";
+        return false;
+    }
+    path.join("");
+    dirname = path.str();
+
+    return callNos.open(dirname + "call_no.u32") &&
+           threads.open(dirname + "thread.u32") &&
+           functions.open(dirname + "function.u32") &&
+           frames.open(dirname + "frame.u32") &&
+           flags.open(dirname + "flags.u32") &&
+           openArgColumns(ret, "ret") &&
+           blobCalls.open(dirname + "blob_call.u32") &&
+           blobArgs.open(dirname + "blob_arg.u32") &&
+           blobSizes.open(dirname + "blob_size.u64") &&
+           blobCrcs.open(dirname + "blob_crc.u32");
+}
+
+
+void
+ColumnarWriter::writeValue(ArgColumns &columns, unsigned arg, Value *value) {
+    uint8_t type = COLUMNAR_NONE;
+    uint64_t scalar = 0;
+    if (value) {
+        ScalarVisitor visitor;
+        value->visit(visitor);
+        type = visitor.type;
+        scalar = type == COLUMNAR_BLOB ? numBlobs : visitor.value;
+    }
+    columns.types.write(type);
+    columns.values.write(scalar);
+
+    if (value) {
+        writeBlobs(arg, value);
+    }
+}
+
+
+void
+ColumnarWriter::writeBlobs(unsigned arg, Value *value) {
+    if (!value) {
+        return;
+    }
+
+    Blob *blob = value->toBlob();
+    if (blob) {
+        blobCalls.write<uint32_t>(numCalls);
+        blobArgs.write<uint32_t>(arg);
+        blobSizes.write<uint64_t>(blob->size);
+        blobCrcs.write<uint32_t>(crc32c_8bytes(blob->buf, blob->size));
+        ++numBlobs;
+        return;
+    }
+
+    Array *array = value->toArray();
+    if (array) {
+        for (Value *element : array->values) {
+            writeBlobs(arg, element);
+        }
+        return;
+    }
+
+    Struct *st = value->toStruct();
+    if (st) {
+        for (Value *member : st->members) {
+            writeBlobs(arg, member);
+        }
+    }
+}
+
+
+void
+ColumnarWriter::writeCall(const Call *call, unsigned frameNo) {
+    callNos.write<uint32_t>(call->no);
+    threads.write<uint32_t>(call->thread_id);
+    functions.write<uint32_t>(call->sig->id);
+    frames.write<uint32_t>(frameNo);
+    flags.write<uint32_t>(call->flags);
+
+    if (call->sig->id >= functionNames.size()) {
+        functionNames.resize(call->sig->id + 1);
+    }
+    if (functionNames[call->sig->id].empty()) {
+        functionNames[call->sig->id] = call->sig->name;
+    }
+
+    // Earlier calls had none of the new arguments
+    while (args.size() < call->args.size()) {
+        std::unique_ptr<ArgColumns> columns(new ArgColumns);
+        if (!openArgColumns(*columns, "arg" + std::to_string(args.size()))) {
+            exit(1);
+        }
+        for (size_t i = 0; i < numCalls; ++i) {
+            columns->types.write<uint8_t>(COLUMNAR_NONE);
+            columns->values.write<uint64_t>(0);
+        }
+        args.push_back(std::move(columns));
+    }
+
+    for (unsigned i = 0; i < args.size(); ++i) {
+        writeValue(*args[i], i, i < call->args.size() ? call->args[i].value : nullptr);
+    }
+    writeValue(ret, COLUMNAR_RET, call->ret);
+
+    ++numCalls;
+}
+
+
+bool
+ColumnarWriter::close(void) {
+    // Close every column, even after a failure
+    bool success = callNos.close();
+    success = threads.close() && success;
+    success = functions.close() && success;
+    success = frames.close() && success;
+    success = flags.close() && success;
+    success = ret.types.close() && success;
+    success = ret.values.close() && success;
+    success = blobCalls.close() && success;
+    success = blobArgs.close() && success;
+    success = blobSizes.close() && success;
+    success = blobCrcs.close() && success;
+    for (auto &columns : args) {
+        success = columns->types.close() && success;
+        success = columns->values.close() && success;
+    }
+
+    std::ofstream names(dirname + "functions.txt");
+    for (const std::string &name : functionNames) {
+        names << name << "\n";
+    }
+    names.close();
+    success = !names.fail() && success;
+
+    // Written last, and only on success, so that incomplete exports are
+    // recognizable
+    if (!success) {
+        std::cerr << "error: failed to write " << dirname << "\n";
+        return false;
+    }
+    std::ofstream manifest(dirname + "manifest.txt");
+    manifest << "apitrace-columnar " << COLUMNAR_VERSION << "\n"
+             << "calls " << numCalls << "\n"
+             << "args " << args.size() << "\n"
+             << "blobs " << numBlobs << "\n";
+    manifest.close();
+    success = !manifest.fail() && success;
+
+    if (!success) {
+        std::cerr << "error: failed to write " << dirname << "\n";
+    }
+    return success;
+}
+
+
+bool
+ColumnarReader::open(const char *_dirname) {
+    os::String path(_dirname);
+    path.join("");
+    dirname = path.str();
+
+    std::ifstream manifest(dirname + "manifest.txt");
+    if (!manifest) {
+        std::cerr << "error: failed to open " << dirname << "manifest.txt\n";
+        return false;
+    }
+    std::string magic, calls, args, blobs;
+    unsigned version = 0;
+    manifest >> magic >> version >> calls >> numCalls >> args >> numArgs >> blobs >> numBlobs;
+    if (manifest.fail() ||
+        magic != "apitrace-columnar" ||
+        calls != "calls" || args != "args" || blobs != "blobs") {
+        std::cerr << "error: " << dirname << " is not a columnar trace export\n";
+        return false;
+    }
+    if (version > COLUMNAR_VERSION) {
+        std::cerr << "error: unsupported columnar export version " << version << "\n";
+        return false;
+    }
+
+    std::ifstream names(dirname + "functions.txt");
+    if (!names) {
+        std::cerr << "error: failed to open " << dirname << "functions.txt\n";
+        return false;
+    }
+    functionNames.clear();
+    std::string name;
+    while (std::getline(names, name)) {
+        functionNames.push_back(name);
+    }
+
+    return true;
+}
+
+
+size_t
+ColumnarReader::readColumn(const char *name, size_t elementSize,
+                           size_t numRows, size_t first, size_t count, void *values) const {
+    if (first >= numRows) {
+        return 0;
+    }
+    count = std::min(count, numRows - first);
+
+    std::string filename = dirname + name;
+    FILE *file = fopen(filename.c_str(), "rb");
+    if (!file) {
+        std::cerr << "error: failed to open " << filename << "\n";
+        return 0;
+    }
+    size_t read = 0;
+    if (fseek(file, long(first * elementSize), SEEK_SET) == 0) {
+        read = fread(values, elementSize, count, file);
+    }
+    fclose(file);
+    return read;
+}
+
+
+size_t
+ColumnarReader::read(Column column, size_t first, size_t count, uint32_t *values) const {
+    static const char *names[] = {
+        "call_no.u32",
+        "thread.u32",
+        "function.u32",
+        "frame.u32",
+        "flags.u32",
+    };
+    assert(unsigned(column) < sizeof names / sizeof names[0]);
+    return readColumn(names[column], sizeof *values, numCalls, first, count, values);
+}
+
+
+size_t
+ColumnarReader::readArg(unsigned arg, size_t first, size_t count,
+                        uint8_t *types, uint64_t *values) const {
+    std::string name;
+    if (arg == COLUMNAR_RET) {
+        name = "ret";
+    } else if (arg < numArgs) {
+        name = "arg" + std::to_string(arg);
+    } else {
+        return 0;
+    }
+
+    size_t read = count;
+    if (types) {
+        read = readColumn((name + ".type.u8").c_str(), sizeof *types, numCalls, first, count, types);
+    }
+    if (values) {
+        read = std::min(read, readColumn((name + ".value.u64").c_str(), sizeof *values, numCalls, first, count, values));
+    }
+    return read;
+}
+
+
+size_t
+ColumnarReader::readBlobs(size_t first, size_t count, ColumnarBlob *blobs) const {
+    std::vector<uint32_t> u32s(count);
+    std::vector<uint64_t> u64s(count);
+
+    size_t read = readColumn("blob_call.u32", sizeof u32s[0], numBlobs, first, count, u32s.data());
+    for (size_t i = 0; i < read; ++i) {
+        blobs[i].call = u32s[i];
+    }
+    read = std::min(read, readColumn("blob_arg.u32", sizeof u32s[0], numBlobs, first, count, u32s.data()));
+    for (size_t i = 0; i < read; ++i) {
+        blobs[i].arg = u32s[i];
+    }
+    read = std::min(read, readColumn("blob_size.u64", sizeof u64s[0], numBlobs, first, count, u64s.data()));
+    for (size_t i = 0; i < read; ++i) {
+        blobs[i].size = u64s[i];
+    }
+    read = std::min(read, readColumn("blob_crc.u32", sizeof u32s[0], numBlobs, first, count, u32s.data()));
+    for (size_t i = 0; i < read; ++i) {
+        blobs[i].crc = u32s[i];
+    }
+    return read;
+}
+
+
+} /* namespace trace */
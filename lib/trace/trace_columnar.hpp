@@ -0,0 +1,258 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Column oriented export of a trace's calls, for loading into analytics
+ * tools.
+ *
+ * An export is a directory with one file per column.  Each column file is a
+ * flat array of fixed size integers, in the byte order of the machine which
+ * wrote it, with one element per row, so that it can be memory mapped or
+ * loaded as is (e.g., with numpy.fromfile()).  Files are:
+ *
+ *   manifest.txt         "apitrace-columnar VERSION", then the number of
+ *                        "calls", "args" columns and "blobs", one per line
+ *   functions.txt        function names, one per line, line N naming
+ *                        signature ID N
+ *
+ * with one row per call:
+ *
+ *   call_no.u32          call number
+ *   thread.u32           thread ID
+ *   function.u32         function signature ID
+ *   frame.u32            frame number
+ *   flags.u32            trace::CallFlags
+ *   argN.type.u8         ColumnarType of argument N, for N < args
+ *   argN.value.u64       value of argument N, as described by its type
+ *   ret.type.u8          ColumnarType of the return value
+ *   ret.value.u64        return value
+ *
+ * and one row per blob, wherever it appears in arguments or return values:
+ *
+ *   blob_call.u32        row of the call the blob belongs to
+ *   blob_arg.u32         argument index, or COLUMNAR_RET for the return value
+ *   blob_size.u64        size in bytes
+ *   blob_crc.u32         CRC-32C of the contents
+ */
+
+#pragma once
+
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "trace_model.hpp"
+
+
+namespace trace {
+
+
+#define COLUMNAR_VERSION 1
+
+// Argument index standing for the return value
+#define COLUMNAR_RET (~0U)
+
+
+enum ColumnarType {
+    COLUMNAR_NONE = 0,  // no such argument or return value; value is 0
+    COLUMNAR_NULL,      // value is 0
+    COLUMNAR_BOOL,      // value is 0 or 1
+    COLUMNAR_SINT,      // two's complement value
+    COLUMNAR_UINT,
+    COLUMNAR_FLOAT,     // value holds the bits of an IEEE 754 double
+    COLUMNAR_ENUM,      // two's complement value
+    COLUMNAR_BITMASK,
+    COLUMNAR_POINTER,
+    COLUMNAR_STRING,    // value is the string length, in characters
+    COLUMNAR_BLOB,      // value is the blob's row in the blob columns
+    COLUMNAR_OTHER,     // arrays, structures, etc.; value is 0
+};
+
+
+struct ColumnarBlob {
+    uint32_t call;
+    uint32_t arg;
+    uint64_t size;
+    uint32_t crc;
+};
+
+
+/*
+ * Column writer buffering its output, so that memory usage does not depend on
+ * the number of rows.
+ */
+class ColumnarFile
+{
+    FILE *file = nullptr;
+    std::vector<char> buffer;
+    bool failed = false;
+
+public:
+    ~ColumnarFile();
+
+    bool
+    open(const std::string &filename);
+
+    /* Flush and close, returning false if any write failed. */
+    bool
+    close(void);
+
+    void
+    write(const void *data, size_t size);
+
+    template <class T>
+    void
+    write(T value) {
+        write(&value, sizeof value);
+    }
+};
+
+
+class ColumnarWriter
+{
+protected:
+    std::string dirname;
+
+    size_t numCalls = 0;
+    size_t numBlobs = 0;
+
+    ColumnarFile callNos;
+    ColumnarFile threads;
+    ColumnarFile functions;
+    ColumnarFile frames;
+    ColumnarFile flags;
+
+    struct ArgColumns {
+        ColumnarFile types;
+        ColumnarFile values;
+    };
+
+    // Created as calls with more arguments are seen
+    std::vector<std::unique_ptr<ArgColumns>> args;
+    ArgColumns ret;
+
+    ColumnarFile blobCalls;
+    ColumnarFile blobArgs;
+    ColumnarFile blobSizes;
+    ColumnarFile blobCrcs;
+
+    // Indexed by signature ID
+    std::vector<std::string> functionNames;
+
+    bool
+    openArgColumns(ArgColumns &columns, const std::string &name);
+
+    void
+    writeValue(ArgColumns &columns, unsigned arg, Value *value);
+
+    void
+    writeBlobs(unsigned arg, Value *value);
+
+public:
+    /* Create the directory, if needed, and the column files in it. */
+    bool
+    open(const char *dirname);
+
+    void
+    writeCall(const Call *call, unsigned frameNo);
+
+    /* Flush all columns and write the manifest and function names. */
+    bool
+    close(void);
+};
+
+
+class ColumnarReader
+{
+protected:
+    std::string dirname;
+
+    size_t numCalls = 0;
+    size_t numArgs = 0;
+    size_t numBlobs = 0;
+
+    std::vector<std::string> functionNames;
+
+    size_t
+    readColumn(const char *name, size_t elementSize,
+               size_t numRows, size_t first, size_t count, void *values) const;
+
+public:
+    enum Column {
+        CALL_NO,
+        THREAD,
+        FUNCTION,
+        FRAME,
+        FLAGS,
+    };
+
+    /* Read the manifest and function names of an export. */
+    bool
+    open(const char *dirname);
+
+    size_t
+    getNumCalls(void) const {
+        return numCalls;
+    }
+
+    /* Number of argument columns, i.e., of arguments of the calls with the
+     * most arguments. */
+    size_t
+    getNumArgs(void) const {
+        return numArgs;
+    }
+
+    size_t
+    getNumBlobs(void) const {
+        return numBlobs;
+    }
+
+    /* Function names, indexed by the FUNCTION column. */
+    const std::vector<std::string> &
+    getFunctionNames(void) const {
+        return functionNames;
+    }
+
+    /* Read up to count rows of a per-call column, starting from the given row,
+     * and return how many were read. */
+    size_t
+    read(Column column, size_t first, size_t count, uint32_t *values) const;
+
+    /* Same for an argument, or the return value if arg is COLUMNAR_RET.
+     * Either of types or values may be NULL. */
+    size_t
+    readArg(unsigned arg, size_t first, size_t count,
+            uint8_t *types, uint64_t *values) const;
+
+    size_t
+    readBlobs(size_t first, size_t count, ColumnarBlob *blobs) const;
+};
+
+
+} /* namespace trace */
@@ -0,0 +1,168 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "trace_columnar.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace trace;
+
+
+static const char *foo_arg_names[] = {"x", "data", "f"};
+static const FunctionSig foo_sig = {0, "glFoo", 3, foo_arg_names};
+static const FunctionSig swap_sig = {1, "glXSwapBuffers", 0, NULL};
+
+static const char *dirname = "trace_columnar_test.columns";
+
+
+static Blob *
+newBlob(const char *data)
+{
+    Blob *blob = new Blob(strlen(data));
+    memcpy(blob->buf, data, blob->size);
+    return blob;
+}
+
+
+static void
+removeExport(void)
+{
+    static const char *filenames[] = {
+        "manifest.txt", "functions.txt",
+        "call_no.u32", "thread.u32", "function.u32", "frame.u32", "flags.u32",
+        "arg0.type.u8", "arg0.value.u64", "arg1.type.u8", "arg1.value.u64",
+        "arg2.type.u8", "arg2.value.u64", "ret.type.u8", "ret.value.u64",
+        "blob_call.u32", "blob_arg.u32", "blob_size.u64", "blob_crc.u32",
+    };
+    for (const char *filename : filenames) {
+        std::string path = std::string(dirname) + "/" + filename;
+        remove(path.c_str());
+    }
+    remove(dirname);
+}
+
+
+TEST(trace_columnar, roundtrip)
+{
+    ColumnarWriter writer;
+    ASSERT_TRUE(writer.open(dirname));
+
+    // Argument columns are created after the first call
+    Call swap(&swap_sig, CALL_FLAG_END_FRAME, 0);
+    swap.no = 0;
+    writer.writeCall(&swap, 0);
+
+    Call foo(&foo_sig, 0, 1);
+    foo.no = 1;
+    foo.args[0].value = new SInt(-3);
+    Array *array = new Array(2);
+    array->values[0] = newBlob("abc");
+    array->values[1] = newBlob("defg");
+    foo.args[1].value = array;
+    foo.args[2].value = new Double(0.5);
+    foo.ret = newBlob("");
+    writer.writeCall(&foo, 1);
+
+    ASSERT_TRUE(writer.close());
+
+    ColumnarReader reader;
+    ASSERT_TRUE(reader.open(dirname));
+    EXPECT_EQ(2U, reader.getNumCalls());
+    EXPECT_EQ(3U, reader.getNumArgs());
+    EXPECT_EQ(3U, reader.getNumBlobs());
+
+    std::vector<std::string> names = {"glFoo", "glXSwapBuffers"};
+    EXPECT_EQ(names, reader.getFunctionNames());
+
+    uint32_t u32s[3] = {};
+    EXPECT_EQ(2U, reader.read(ColumnarReader::FUNCTION, 0, 3, u32s));
+    EXPECT_EQ(1U, u32s[0]);
+    EXPECT_EQ(0U, u32s[1]);
+    EXPECT_EQ(1U, reader.read(ColumnarReader::THREAD, 1, 3, u32s));
+    EXPECT_EQ(1U, u32s[0]);
+    EXPECT_EQ(2U, reader.read(ColumnarReader::FLAGS, 0, 2, u32s));
+    EXPECT_EQ(unsigned(CALL_FLAG_END_FRAME), u32s[0]);
+    EXPECT_EQ(2U, reader.read(ColumnarReader::FRAME, 0, 2, u32s));
+    EXPECT_EQ(1U, u32s[1]);
+
+    uint8_t types[2];
+    uint64_t values[2];
+    EXPECT_EQ(2U, reader.readArg(0, 0, 2, types, values));
+    EXPECT_EQ(COLUMNAR_NONE, types[0]);
+    EXPECT_EQ(COLUMNAR_SINT, types[1]);
+    EXPECT_EQ(-3LL, (long long)values[1]);
+    EXPECT_EQ(1U, reader.readArg(1, 1, 2, types, NULL));
+    EXPECT_EQ(COLUMNAR_OTHER, types[0]);
+    EXPECT_EQ(1U, reader.readArg(2, 1, 1, types, values));
+    EXPECT_EQ(COLUMNAR_FLOAT, types[0]);
+    double d;
+    memcpy(&d, &values[0], sizeof d);
+    EXPECT_EQ(0.5, d);
+    EXPECT_EQ(1U, reader.readArg(COLUMNAR_RET, 1, 1, types, values));
+    EXPECT_EQ(COLUMNAR_BLOB, types[0]);
+    EXPECT_EQ(2U, values[0]);
+    EXPECT_EQ(0U, reader.readArg(3, 0, 1, types, values));
+
+    ColumnarBlob blobs[4];
+    EXPECT_EQ(3U, reader.readBlobs(0, 4, blobs));
+    EXPECT_EQ(1U, blobs[0].call);
+    EXPECT_EQ(1U, blobs[0].arg);
+    EXPECT_EQ(3U, blobs[0].size);
+    EXPECT_EQ(0x364b3fb7U, blobs[0].crc); // CRC-32C of "abc"
+    EXPECT_EQ(4U, blobs[1].size);
+    EXPECT_EQ(COLUMNAR_RET, blobs[2].arg);
+    EXPECT_EQ(0U, blobs[2].size);
+    EXPECT_EQ(0U, blobs[2].crc);
+
+    removeExport();
+}
+
+
+#ifdef __linux__
+
+// Writes failing part way, as on a full disk, must be reported.
+TEST(trace_columnar, full)
+{
+    ColumnarFile file;
+    ASSERT_TRUE(file.open("/dev/full"));
+    for (unsigned i = 0; i < 64 * 1024; ++i) {
+        file.write(uint32_t(i));
+    }
+    EXPECT_FALSE(file.close());
+}
+
+#endif /* __linux__ */
+
+
+int
+main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -28,7 +28,10 @@
 
 #include <limits>
 
+#include <cmath>
+
 #include <assert.h>
+#include <stdio.h>
 #include <string.h>
 
 #include "highlight.hpp"
@@ -38,6 +41,10 @@
 namespace trace {
 
 
+// Buffered output size above which it is written out after a call
+static const size_t flushSize = 64 * 1024;
+
+
 Dumper::Dumper(std::ostream &_os, DumpFlags _flags) :
     os(_os),
     dumpFlags(_flags),
@@ -53,72 +60,198 @@ Dumper::Dumper(std::ostream &_os, DumpFlags _flags) :
 }
 
 Dumper::~Dumper() {
+    flush();
+}
+
+void Dumper::flush(void) {
+    if (!buffer.empty()) {
+        os.write(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+}
+
+void Dumper::write(const highlight::Attribute &attr) {
+    const char *text = attr.text();
+    if (text) {
+        buffer.append(text);
+    } else {
+        // e.g. Windows console attributes, which must be applied in order
+        flush();
+        os << attr;
+    }
+}
+
+void Dumper::writeUInt(unsigned long long value) {
+    char digits[20];
+    char *p = digits + sizeof digits;
+    do {
+        *--p = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    write(p, digits + sizeof digits - p);
+}
+
+void Dumper::writeSInt(signed long long value) {
+    if (value < 0) {
+        write('-');
+        writeUInt(0ULL - (unsigned long long)value);
+    } else {
+        writeUInt(value);
+    }
+}
+
+void Dumper::writeHex(unsigned long long value) {
+    static const char hexDigits[] = "0123456789abcdef";
+    char digits[16];
+    char *p = digits + sizeof digits;
+    do {
+        *--p = hexDigits[value & 0xf];
+        value >>= 4;
+    } while (value);
+    write(p, digits + sizeof digits - p);
+}
+
+void Dumper::writeFloat(double value, int precision) {
+    static const double powersOf10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8,
+        1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17
+    };
+    assert(precision > 0 && precision < (int)(sizeof powersOf10 / sizeof powersOf10[0]));
+
+    // Integers below 10^precision, which are very common, are formatted
+    // without exponent nor decimal point.
+    double magnitude = std::fabs(value);
+    if (magnitude < powersOf10[precision] &&
+        magnitude == std::floor(magnitude)) {
+        if (std::signbit(value)) {
+            write('-');
+        }
+        writeUInt((unsigned long long)magnitude);
+        return;
+    }
+
+    // Same conversion as std::num_put
+    char digits[32];
+    int length = snprintf(digits, sizeof digits, "%.*g", precision, value);
+    assert(length > 0 && length < (int)sizeof digits);
+    write(digits, length);
 }
 
 void Dumper::visit(Null *) {
-    os << literal << "NULL" << normal;
+    write(literal);
+    write("NULL");
+    write(normal);
 }
 
 void Dumper::visit(Bool *node) {
-    os << literal << (node->value ? "true" : "false") << normal;
+    write(literal);
+    write(node->value ? "true" : "false");
+    write(normal);
 }
 
 void Dumper::visit(SInt *node) {
-    os << literal << node->value << normal;
+    write(literal);
+    writeSInt(node->value);
+    write(normal);
 }
 
 void Dumper::visit(UInt *node) {
-    os << literal << node->value << normal;
+    write(literal);
+    writeUInt(node->value);
+    write(normal);
 }
 
 void Dumper::visit(Float *node) {
-    std::streamsize oldPrecision = os.precision(std::numeric_limits<float>::digits10 + 1);
-    os << literal << node->value << normal;
-    os.precision(oldPrecision);
+    write(literal);
+    writeFloat(node->value, std::numeric_limits<float>::digits10 + 1);
+    write(normal);
 }
 
 void Dumper::visit(Double *node) {
-    std::streamsize oldPrecision = os.precision(std::numeric_limits<double>::digits10 + 1);
-    os << literal << node->value << normal;
-    os.precision(oldPrecision);
+    write(literal);
+    writeFloat(node->value, std::numeric_limits<double>::digits10 + 1);
+    write(normal);
+}
+
+// ASCII characters which are written verbatim in string literals
+static const bool verbatimChars[128] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x00
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x10
+    1, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 0x20, except '"'
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 0x30
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 0x40
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 1, 1, 1, // 0x50, except '\\'
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 0x60
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, // 0x70, except DEL
+};
+
+template< typename C >
+static inline bool
+isVerbatim(C c) {
+    unsigned u = (unsigned) c;
+    return u < 128 && verbatimChars[u];
+}
+
+static inline void
+appendVerbatim(std::string &buffer, const char *begin, const char *end) {
+    buffer.append(begin, end);
+}
+
+static inline void
+appendVerbatim(std::string &buffer, const wchar_t *begin, const wchar_t *end) {
+    for (const wchar_t *it = begin; it != end; ++it) {
+        buffer.push_back((char)*it);
+    }
 }
 
 template< typename C >
 void Dumper::visitString(const C *value) {
-    os << literal << "\"";
-    for (const C *it = value; *it; ++it) {
-        unsigned c = (unsigned) *it;
+    write(literal);
+    write('"');
+    const C *it = value;
+    while (*it) {
+        if (isVerbatim(*it)) {
+            const C *begin = it;
+            do {
+                ++it;
+            } while (isVerbatim(*it));
+            appendVerbatim(buffer, begin, it);
+            continue;
+        }
+
+        unsigned c = (unsigned) *it++;
         if (c == '\"')
-            os << "\\\"";
+            write("\\\"");
         else if (c == '\\')
-            os << "\\\\";
-        else if (c >= 0x20 && c <= 0x7e)
-            os << (char)c;
+            write("\\\\");
         else if (c == '\t') {
-            os << "\t";
+            write('\t');
         } else if (c == '\r') {
             // Ignore carriage-return
         } else if (c == '\n') {
             if (dumpFlags & DUMP_FLAG_NO_MULTILINE) {
-                os << "\\n";
+                write("\\n");
             } else {
                 // Reset formatting so that it looks correct with 'less -R'
-                os << normal << '\n' << literal;
+                write(normal);
+                write('\n');
+                write(literal);
             }
         } else {
             // FIXME: handle wchar_t octals properly
             unsigned octal0 = c & 0x7;
             unsigned octal1 = (c >> 3) & 0x7;
             unsigned octal2 = (c >> 3) & 0x7;
-            os << "\\";
+            write('\\');
             if (octal2)
-                os << octal2;
+                write((char)('0' + octal2));
             if (octal1)
-                os << octal1;
-            os << octal0;
+                write((char)('0' + octal1));
+            write((char)('0' + octal0));
         }
     }
-    os << "\"" << normal;
+    write('"');
+    write(normal);
 }
 
 void Dumper::visit(String *node) {
@@ -126,17 +259,20 @@ void Dumper::visit(String *node) {
 }
 
 void Dumper::visit(WString *node) {
-    os << literal << "L";
+    write(literal);
+    write('L');
     visitString(node->value);
 }
 
 void Dumper::visit(Enum *node) {
     const EnumValue *it = node->lookup();
+    write(literal);
     if (it) {
-        os << literal << it->name << normal;
-        return;
+        write(it->name);
+    } else {
+        writeSInt(node->value);
     }
-    os << literal << node->value << normal;
+    write(normal);
 }
 
 void Dumper::visit(Bitmask *bitmask) {
@@ -148,9 +284,11 @@ void Dumper::visit(Bitmask *bitmask) {
         if ((it->value && (value & it->value) == it->value) ||
             (!it->value && value == 0)) {
             if (!first) {
-                os << " | ";
+                write(" | ");
             }
-            os << literal << it->name << normal;
+            write(literal);
+            write(it->name);
+            write(normal);
             value &= ~it->value;
             first = false;
         }
@@ -160,9 +298,12 @@ void Dumper::visit(Bitmask *bitmask) {
     }
     if (value || first) {
         if (!first) {
-            os << " | ";
+            write(" | ");
         }
-        os << literal << "0x" << std::hex << value << std::dec << normal;
+        write(literal);
+        write("0x");
+        writeHex(value);
+        write(normal);
     }
 }
 
@@ -182,7 +323,11 @@ Dumper::visitMembers(Struct *s, const char *sep) {
             }
         }
 
-        os << sep << italic << memberName << normal << " = ",
+        write(sep);
+        write(italic);
+        write(memberName);
+        write(normal);
+        write(" = ");
         _visit(memberValue);
         sep = ", ";
     }
@@ -205,38 +350,47 @@ void Dumper::visit(Struct *s) {
             guid.Data4[i] = data4->values[i]->toUInt();
         }
         const char *name = getGuidName(guid);
-        os << literal << name << normal;
+        write(literal);
+        write(name);
+        write(normal);
         return;
     }
 
-    os << "{";
+    write('{');
     visitMembers(s);
-    os << "}";
+    write('}');
 }
 
 void Dumper::visit(Array *array) {
     if (array->values.size() == 1) {
-        os << "&";
+        write('&');
         _visit(array->values[0]);
     }
     else {
         const char *sep = "";
-        os << "{";
+        write('{');
         for (auto & value : array->values) {
-            os << sep;
+            write(sep);
             _visit(value);
             sep = ", ";
         }
-        os << "}";
+        write('}');
     }
 }
 
 void Dumper::visit(Blob *blob) {
-    os << pointer << "blob(" << blob->size << ")" << normal;
+    write(pointer);
+    write("blob(");
+    writeUInt(blob->size);
+    write(')');
+    write(normal);
 }
 
 void Dumper::visit(Pointer *p) {
-    os << pointer << "0x" << std::hex << p->value << std::dec << normal;
+    write(pointer);
+    write("0x");
+    writeHex(p->value);
+    write(normal);
 }
 
 void Dumper::visit(Repr *r) {
@@ -244,13 +398,30 @@ void Dumper::visit(Repr *r) {
 }
 
 void Dumper::visit(StackFrame *frame) {
-    frame->dump(os);
+    // Same as RawStackFrame::dump
+    write(frame->module ? frame->module : "?");
+    if (frame->function != NULL) {
+        write(": ");
+        write(frame->function);
+    }
+    if (frame->offset >= 0) {
+        write("+0x");
+        writeHex(frame->offset);
+    }
+    if (frame->filename != NULL) {
+        write(": ");
+        write(frame->filename);
+        if (frame->linenumber >= 0) {
+            write(':');
+            writeSInt(frame->linenumber);
+        }
+    }
 }
 
 void Dumper::visit(Backtrace & backtrace) {
     for (auto & frame : backtrace) {
         visit(frame);
-        os << "\n";
+        write('\n');
     }
 }
 
@@ -258,57 +429,74 @@ void Dumper::visit(Call *call) {
     CallFlags callFlags = call->flags;
 
     if (!(dumpFlags & DUMP_FLAG_NO_CALL_NO)) {
-        os << call->no << " ";
+        writeUInt(call->no);
+        write(' ');
     }
     if (dumpFlags & DUMP_FLAG_THREAD_IDS) {
-        os << "@" << std::hex << call->thread_id << std::dec << " ";
+        write('@');
+        writeHex(call->thread_id);
+        write(' ');
     }
 
     if (callFlags & CALL_FLAG_NON_REPRODUCIBLE) {
-        os << strike;
+        write(strike);
     } else if (callFlags & (CALL_FLAG_FAKE | CALL_FLAG_NO_SIDE_EFFECTS)) {
-        os << normal;
+        write(normal);
     } else {
-        os << bold;
+        write(bold);
     }
-    os << call->sig->name << normal;
+    write(call->sig->name);
+    write(normal);
 
-    os << "(";
+    write('(');
     const char *sep = "";
     for (unsigned i = 0; i < call->args.size(); ++i) {
-        os << sep;
+        write(sep);
         if (!(dumpFlags & DUMP_FLAG_NO_ARG_NAMES)) {
-            os << italic << call->sig->arg_names[i] << normal << " = ";
+            write(italic);
+            write(call->sig->arg_names[i]);
+            write(normal);
+            write(" = ");
         }
         if (call->args[i].value) {
             _visit(call->args[i].value);
         } else {
-           os << "?";
+            write('?');
         }
         sep = ", ";
     }
-    os << ")";
+    write(')');
 
     if (call->ret) {
-        os << " = ";
+        write(" = ");
         _visit(call->ret);
     }
 
     if (callFlags & CALL_FLAG_INCOMPLETE) {
-        os << " // " << red << "incomplete" << normal;
+        write(" // ");
+        write(red);
+        write("incomplete");
+        write(normal);
     }
 
     if (!(dumpFlags & DUMP_FLAG_NO_MULTILINE)) {
-        os << "\n";
+        write('\n');
 
         if (call->backtrace != NULL) {
-            os << bold << red << "Backtrace:\n" << normal;
+            write(bold);
+            write(red);
+            write("Backtrace:\n");
+            write(normal);
             visit(*call->backtrace);
         }
         if (callFlags & CALL_FLAG_END_FRAME) {
-            os << "\n";
+            write('\n');
         }
     }
+
+    if (buffer.size() >= flushSize) {
+        flush();
+    }
 }
 
 
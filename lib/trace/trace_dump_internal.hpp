@@ -26,6 +26,8 @@
 
 #pragma once
 
+#include <string>
+
 #include "highlight.hpp"
 #include "trace_dump.hpp"
 
@@ -33,10 +35,17 @@
 namespace trace {
 
 
+/*
+ * Output is formatted into a private buffer, which is written to the stream
+ * in large chunks, after each call whenever it grew large, on flush(), and on
+ * destruction.  Subclasses must therefore write through the write*() methods
+ * rather than to the stream.
+ */
 class Dumper : public Visitor
 {
 protected:
     std::ostream &os;
+    std::string buffer;
     DumpFlags dumpFlags;
     const highlight::Highlighter & highlighter;
     const highlight::Attribute & normal;
@@ -47,10 +56,33 @@ protected:
     const highlight::Attribute & pointer;
     const highlight::Attribute & literal;
 
+    inline void write(const char *s, size_t length) {
+        buffer.append(s, length);
+    }
+
+    inline void write(const char *s) {
+        buffer.append(s);
+    }
+
+    inline void write(char c) {
+        buffer.push_back(c);
+    }
+
+    void write(const highlight::Attribute &attr);
+
+    void writeSInt(signed long long value);
+    void writeUInt(unsigned long long value);
+    void writeHex(unsigned long long value);
+
+    /* Same as std::ostream with the given precision and default float field. */
+    void writeFloat(double value, int precision);
+
 public:
     Dumper(std::ostream &_os, DumpFlags _flags);
     ~Dumper();
 
+    void flush(void);
+
     virtual void visit(Null *) override;
     virtual void visit(Bool *node) override;
     virtual void visit(SInt *node) override;
@@ -0,0 +1,276 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+#include <math.h>
+#include <string.h>
+
+#include <limits>
+#include <sstream>
+
+#include "trace_dump.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace trace;
+
+
+static char *
+newString(const char *s)
+{
+    char *copy = new char[strlen(s) + 1];
+    strcpy(copy, s);
+    return copy;
+}
+
+
+static wchar_t *
+newWString(const wchar_t *s)
+{
+    wchar_t *copy = new wchar_t[wcslen(s) + 1];
+    wcscpy(copy, s);
+    return copy;
+}
+
+
+static const char *arg_names[] = {
+    "null", "b", "i", "u", "f", "d", "s", "ws", "e", "m", "st", "a", "a1",
+    "blob", "p", "r", "guid", "fs", "ds",
+};
+
+static const FunctionSig sig = {0, "glFoo", sizeof arg_names / sizeof arg_names[0], arg_names};
+
+static const EnumValue enum_values[] = {{"GL_ZERO", 0}, {"GL_ONE", 1}};
+static const EnumSig enum_sig = {0, 2, enum_values};
+
+static const BitmaskFlag bitmask_flags[] = {{"GL_NONE", 0}, {"GL_A_BIT", 1}, {"GL_B_BIT", 2}, {"GL_CD_BITS", 12}};
+static const BitmaskSig bitmask_sig = {0, 4, bitmask_flags};
+
+static const char *struct_member_names[] = {"x", "", "y"};
+static StructSig struct_sig = {0, "S", 3, struct_member_names};
+static const char *inner_member_names[] = {"z"};
+static StructSig inner_sig = {1, "", 1, inner_member_names};
+
+static const char *guid_member_names[] = {"Data1", "Data2", "Data3", "Data4"};
+static StructSig guid_sig = {2, "GUID", 4, guid_member_names};
+
+
+static Array *
+newArray(std::initializer_list<Value *> values)
+{
+    Array *array = new Array(values.size());
+    size_t i = 0;
+    for (Value *value : values) {
+        array->values[i++] = value;
+    }
+    return array;
+}
+
+
+static Array *
+newFloats(std::initializer_list<float> values)
+{
+    Array *array = new Array(values.size());
+    size_t i = 0;
+    for (float value : values) {
+        array->values[i++] = new Float(value);
+    }
+    return array;
+}
+
+
+static Array *
+newDoubles(std::initializer_list<double> values)
+{
+    Array *array = new Array(values.size());
+    size_t i = 0;
+    for (double value : values) {
+        array->values[i++] = new Double(value);
+    }
+    return array;
+}
+
+
+static Call *
+newCall(CallFlags flags)
+{
+    Call *call = new Call(&sig, flags, 0x1f);
+    call->no = 1234;
+
+    unsigned i = 0;
+    call->args[i++].value = new Null;
+    call->args[i++].value = new Bool(true);
+    call->args[i++].value = new SInt(std::numeric_limits<signed long long>::min());
+    call->args[i++].value = new UInt(std::numeric_limits<unsigned long long>::max());
+    call->args[i++].value = new Float(0.1f);
+    call->args[i++].value = new Double(1.0/3.0);
+    call->args[i++].value = new String(newString("a\"b\\c\td\re\nf\x01\x7f\xe9g"));
+    call->args[i++].value = new WString(newWString(L"w\"\x263a\n"));
+    call->args[i++].value = newArray({new Enum(&enum_sig, 1), new Enum(&enum_sig, -7)});
+    call->args[i++].value = newArray({new Bitmask(&bitmask_sig, 0), new Bitmask(&bitmask_sig, 0x2d), new Bitmask(&bitmask_sig, 0x30)});
+
+    Struct *inner = new Struct(&inner_sig);
+    inner->members[0] = new UInt(2);
+    Struct *st = new Struct(&struct_sig);
+    st->members[0] = new SInt(-1);
+    st->members[1] = inner;
+    st->members[2] = new Double(-0.0);
+    call->args[i++].value = st;
+
+    call->args[i++].value = newArray({new UInt(0), new UInt(10), new UInt(100)});
+    call->args[i++].value = newArray({new SInt(42)});
+    call->args[i++].value = new Blob(123456);
+    call->args[i++].value = new Pointer(0xdeadbeefULL);
+    call->args[i++].value = new Repr(new String(newString("GL_SRC")), new UInt(3));
+
+    // IID_IUnknown
+    Struct *guid = new Struct(&guid_sig);
+    guid->members[0] = new UInt(0x00000000);
+    guid->members[1] = new UInt(0x0000);
+    guid->members[2] = new UInt(0x0000);
+    guid->members[3] = newArray({new UInt(0xc0), new UInt(0), new UInt(0), new UInt(0),
+                                 new UInt(0), new UInt(0), new UInt(0), new UInt(0x46)});
+    call->args[i++].value = guid;
+
+    call->args[i++].value = newFloats({0.0f, -0.0f, 1.0f, -3.0f, 1234567.0f, 12345678.0f, 1e-7f, 3.4e38f,
+                                       INFINITY, -INFINITY, NAN, 0.5f, 16777216.0f});
+    call->args[i++].value = newDoubles({0.0, 1.0, 1e15, 1e16, 123456789012345678.0, -2.5, 1e-300,
+                                        std::numeric_limits<double>::max(), std::numeric_limits<double>::denorm_min()});
+    assert(i == call->args.size());
+
+    call->ret = new Pointer(0);
+
+    return call;
+}
+
+
+static std::string
+dumpCall(Call *call, DumpFlags flags)
+{
+    std::ostringstream os;
+    dump(*call, os, flags);
+    return os.str();
+}
+
+
+// Reference output, as formatted by the original iostream based Dumper
+static const char *
+expectedPlain =
+    "1234 @1f glFoo(null = NULL, b = true, i = -9223372036854775808, "
+    "u = 18446744073709551615, f = 0.1, d = 0.3333333333333333, "
+    "s = \"a\\\"b\\\\c\tde\n"
+    "f\\1\\777\\551g\", ws = L\"w\\\"\\772\n"
+    "\", e = {GL_ONE, -7}, m = {GL_NONE, GL_A_BIT | GL_CD_BITS | 0x20, "
+    "0x30}, st = {x = -1, z = 2, y = -0}, a = {0, 10, 100}, a1 = &42, "
+    "blob = blob(123456), p = 0xdeadbeef, r = \"GL_SRC\", "
+    "guid = IID_IUnknown, fs = {0, -0, 1, -3, 1234567, 1.234568e+07, "
+    "1e-07, 3.4e+38, inf, -inf, nan, 0.5, 1.677722e+07}, ds = {0, 1, "
+    "1000000000000000, 1e+16, 1.234567890123457e+17, -2.5, 1e-300, "
+    "1.797693134862316e+308, 4.940656458412465e-324}) = 0x0\n"
+    "\n";
+
+
+static const char *
+expectedColor =
+    "1234 \033[1mglFoo\033[0m(\033[34mNULL\033[0m, "
+    "\033[34mtrue\033[0m, \033[34m-9223372036854775808\033[0m, "
+    "\033[34m18446744073709551615\033[0m, \033[34m0.1\033[0m, "
+    "\033[34m0.3333333333333333\033[0m, "
+    "\033[34m\"a\\\"b\\\\c\tde\\nf\\1\\777\\551g\"\033[0m, "
+    "\033[34mL\033[34m\"w\\\"\\772\\n\"\033[0m, "
+    "{\033[34mGL_ONE\033[0m, \033[34m-7\033[0m}, "
+    "{\033[34mGL_NONE\033[0m, "
+    "\033[34mGL_A_BIT\033[0m | \033[34mGL_CD_BITS\033[0m | \033[34m0x20\033[0m, "
+    "\033[34m0x30\033[0m}, {x\033[0m = \033[34m-1\033[0m, "
+    "z\033[0m = \033[34m2\033[0m, y\033[0m = \033[34m-0\033[0m}, "
+    "{\033[34m0\033[0m, \033[34m10\033[0m, \033[34m100\033[0m}, "
+    "&\033[34m42\033[0m, \033[32mblob(123456)\033[0m, "
+    "\033[32m0xdeadbeef\033[0m, \033[34m\"GL_SRC\"\033[0m, "
+    "\033[34mIID_IUnknown\033[0m, {\033[34m0\033[0m, "
+    "\033[34m-0\033[0m, \033[34m1\033[0m, \033[34m-3\033[0m, "
+    "\033[34m1234567\033[0m, \033[34m1.234568e+07\033[0m, "
+    "\033[34m1e-07\033[0m, \033[34m3.4e+38\033[0m, \033[34minf\033[0m, "
+    "\033[34m-inf\033[0m, \033[34mnan\033[0m, \033[34m0.5\033[0m, "
+    "\033[34m1.677722e+07\033[0m}, {\033[34m0\033[0m, "
+    "\033[34m1\033[0m, \033[34m1000000000000000\033[0m, "
+    "\033[34m1e+16\033[0m, \033[34m1.234567890123457e+17\033[0m, "
+    "\033[34m-2.5\033[0m, \033[34m1e-300\033[0m, "
+    "\033[34m1.797693134862316e+308\033[0m, "
+    "\033[34m4.940656458412465e-324\033[0m}) = \033[32m0x0\033[0m";
+
+
+TEST(trace_dump, golden)
+{
+    Call *call = newCall(CALL_FLAG_END_FRAME);
+    EXPECT_EQ(expectedPlain, dumpCall(call, DUMP_FLAG_NO_COLOR | DUMP_FLAG_THREAD_IDS));
+    EXPECT_EQ(expectedColor, dumpCall(call, DUMP_FLAG_NO_ARG_NAMES | DUMP_FLAG_NO_MULTILINE));
+    delete call;
+}
+
+
+TEST(trace_dump, incomplete)
+{
+    Call *call = newCall(CALL_FLAG_INCOMPLETE | CALL_FLAG_NO_SIDE_EFFECTS);
+
+    StackFrame *frames[2] = {new StackFrame, new StackFrame};
+    frames[0]->module = newString("libfoo.so");
+    frames[0]->function = newString("foo");
+    frames[0]->offset = 0x1a;
+    frames[0]->filename = newString("foo.c");
+    frames[0]->linenumber = 42;
+    call->backtrace = new Backtrace(frames, frames + 2);
+
+    std::string plain = dumpCall(call, DUMP_FLAG_NO_COLOR | DUMP_FLAG_NO_CALL_NO);
+    EXPECT_EQ(0, plain.compare(0, 6, "glFoo("));
+    const char *tail = ") = 0x0 // incomplete\nBacktrace:\nlibfoo.so: foo+0x1a: foo.c:42\n?\n";
+    EXPECT_EQ(tail, plain.substr(plain.size() - strlen(tail)));
+
+    call->backtrace->clear();
+    delete call->backtrace;
+    call->backtrace = NULL;
+    delete frames[0];
+    delete frames[1];
+    delete call;
+}
+
+
+TEST(trace_dump, values)
+{
+    std::ostringstream os;
+    SInt i(-5);
+    String s(newString("x\ny"));
+    dump(&i, os, DUMP_FLAG_NO_COLOR);
+    os << ",";
+    dump(&s, os, DUMP_FLAG_NO_COLOR | DUMP_FLAG_NO_MULTILINE);
+    EXPECT_EQ("-5,\"x\\ny\"", os.str());
+}
+
+
+int
+main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,75 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+#include <string.h>
+
+#include "trace_fake_memory.hpp"
+
+
+namespace trace {
+
+
+void
+FakeMemory::keepCalls(CallFilter &filter) {
+    filter.keepFunction("malloc");
+    filter.keepFunction("memcpy");
+}
+
+
+bool
+FakeMemory::keep(const Call &call) {
+    const char *name = call.name();
+
+    if (strcmp(name, "malloc") == 0) {
+        if (!call.ret || call.args.size() < 1 || !call.args[0].value) {
+            return false;
+        }
+        unsigned long long address = call.ret->toUIntPtr();
+        if (!address) {
+            return false;
+        }
+        regions[address] = call.args[0].value->toUInt();
+        return true;
+    }
+
+    if (strcmp(name, "memcpy") == 0) {
+        if (call.args.size() < 1 || !call.args[0].value) {
+            return false;
+        }
+        unsigned long long address = call.args[0].value->toUIntPtr();
+        auto it = regions.upper_bound(address);
+        if (it == regions.begin()) {
+            return false;
+        }
+        --it;
+        return address - it->first < it->second;
+    }
+
+    return false;
+}
+
+
+} /* namespace trace */
@@ -0,0 +1,70 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Memory which wrappers allocate and fill through fake calls.
+ *
+ * User arrays are written into the trace as a fake malloc of a made up
+ * address, followed by fake memcpys into it of whatever changed before each
+ * draw (see gltrace_arrays.cpp).  Draws merely reference the made up address,
+ * which retrace resolves through the regions those mallocs registered, so
+ * tools which drop calls must keep all of them for the draws they do keep to
+ * replay.
+ */
+
+#pragma once
+
+
+#include <map>
+
+#include "trace_model.hpp"
+#include "trace_call_filter.hpp"
+
+
+namespace trace {
+
+
+class FakeMemory
+{
+protected:
+    /* Start address -> size, for every fake malloc seen so far. */
+    std::map<unsigned long long, unsigned long long> regions;
+
+public:
+    /* Make the filter accept every call keep() may need to see. */
+    static void
+    keepCalls(CallFilter &filter);
+
+    /* Whether the call must be kept: fake mallocs, and fake memcpys into
+     * memory they allocated.  Must be given every call, in order.
+     *
+     * Other memcpys, into buffer mappings for instance, are not, as the
+     * mapping may well have been dropped. */
+    bool
+    keep(const Call &call);
+};
+
+
+} /* namespace trace */
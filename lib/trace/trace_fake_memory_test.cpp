@@ -0,0 +1,273 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include <map>
+#include <string>
+
+#include "trace_fake_memory.hpp"
+#include "trace_parser.hpp"
+#include "trace_writer.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace trace;
+
+
+static const char *malloc_arg_names[] = {"size"};
+static const FunctionSig malloc_sig = {0, "malloc", 1, malloc_arg_names};
+static const char *memcpy_arg_names[] = {"dest", "src", "n"};
+static const FunctionSig memcpy_sig = {1, "memcpy", 3, memcpy_arg_names};
+static const char *draw_arg_names[] = {"pointer"};
+static const FunctionSig draw_sig = {2, "glDraw", 1, draw_arg_names};
+static const FunctionSig swap_sig = {3, "glXSwapBuffers", 0, NULL};
+
+static const unsigned long long arrayAddress = 0xa000000000000000ULL;
+static const unsigned long long mappingAddress = 0x1000;
+
+static const char *traceFilename = "trace_fake_memory_test.trace";
+static const char *trimmedFilename = "trace_fake_memory_test-trim.trace";
+
+
+static void
+writeMalloc(Writer &writer, unsigned long long address, size_t size)
+{
+    unsigned call_no = writer.beginEnter(&malloc_sig, 0);
+    writer.beginArg(0);
+    writer.writeUInt(size);
+    writer.endArg();
+    writer.endEnter();
+    writer.beginLeave(call_no);
+    writer.beginReturn();
+    writer.writePointer(address);
+    writer.endReturn();
+    writer.endLeave();
+}
+
+
+static void
+writeMemcpy(Writer &writer, unsigned long long address, const char *data)
+{
+    size_t size = strlen(data);
+    unsigned call_no = writer.beginEnter(&memcpy_sig, 0);
+    writer.beginArg(0);
+    writer.writePointer(address);
+    writer.endArg();
+    writer.beginArg(1);
+    writer.writeBlob(data, size);
+    writer.endArg();
+    writer.beginArg(2);
+    writer.writeUInt(size);
+    writer.endArg();
+    writer.endEnter();
+    writer.beginLeave(call_no);
+    writer.endLeave();
+}
+
+
+static void
+writeCall(Writer &writer, const FunctionSig *sig, unsigned long long pointer = 0)
+{
+    unsigned call_no = writer.beginEnter(sig, 0);
+    if (sig->num_args) {
+        writer.beginArg(0);
+        writer.writePointer(pointer);
+        writer.endArg();
+    }
+    writer.endEnter();
+    writer.beginLeave(call_no);
+    writer.endLeave();
+}
+
+
+/*
+ * Write 2 frames, drawing from a user array as gltrace_arrays.cpp traces
+ * them: whole on the first draw, only what changed on the next.
+ *
+ *   0 malloc(size = 16) = 0xa000000000000000
+ *   1 memcpy(dest = 0xa000000000000000, src = "0123456789abcdef", n = 16)
+ *   2 memcpy(dest = 0x1000, src = "zzzz", n = 4)   // into a buffer mapping
+ *   3 glDraw(pointer = 0xa000000000000000)
+ *   4 glXSwapBuffers()
+ *   5 memcpy(dest = 0xa000000000000004, src = "WXYZ", n = 4)
+ *   6 glDraw(pointer = 0xa000000000000000)
+ *   7 glXSwapBuffers()
+ */
+static void
+writeTrace(void)
+{
+    Writer writer;
+    ASSERT_TRUE(writer.open(traceFilename));
+    writeMalloc(writer, arrayAddress, 16);
+    writeMemcpy(writer, arrayAddress, "0123456789abcdef");
+    writeMemcpy(writer, mappingAddress, "zzzz");
+    writeCall(writer, &draw_sig, arrayAddress);
+    writeCall(writer, &swap_sig);
+    writeMemcpy(writer, arrayAddress + 4, "WXYZ");
+    writeCall(writer, &draw_sig, arrayAddress);
+    writeCall(writer, &swap_sig);
+    writer.close();
+}
+
+
+/*
+ * Same as `apitrace trim`.
+ */
+static void
+trim(CallSet calls, CallSet frames)
+{
+    Parser parser;
+    CallFilter filter;
+    if (frames.empty()) {
+        filter.setCalls(calls);
+        FakeMemory::keepCalls(filter);
+        parser.setFilter(&filter);
+    }
+    ASSERT_TRUE(parser.open(traceFilename));
+
+    Writer writer;
+    ASSERT_TRUE(writer.open(trimmedFilename));
+
+    FakeMemory fakeMemory;
+    unsigned frame = 0;
+    Call *call;
+    while ((call = parser.parse_call())) {
+        if (fakeMemory.keep(*call) ||
+            calls.contains(*call) ||
+            frames.contains(frame, call->flags)) {
+            writer.writeCall(call);
+        }
+        if (call->flags & CALL_FLAG_END_FRAME) {
+            frame++;
+        }
+        delete call;
+    }
+    writer.close();
+}
+
+
+/*
+ * Replay the trimmed trace as retrace would: mallocs register regions,
+ * memcpys and draws resolve their addresses against them.  Returns the
+ * calls replayed, and the array contents seen by each draw.
+ */
+static void
+retrace(std::vector<std::string> &calls, std::vector<std::string> &draws)
+{
+    std::map<unsigned long long, std::string> regions;
+    auto lookup = [&](unsigned long long address, size_t &offset) -> std::string * {
+        auto it = regions.upper_bound(address);
+        if (it == regions.begin()) {
+            return NULL;
+        }
+        --it;
+        offset = address - it->first;
+        return offset < it->second.size() ? &it->second : NULL;
+    };
+
+    Parser parser;
+    ASSERT_TRUE(parser.open(trimmedFilename));
+    Call *call;
+    while ((call = parser.parse_call())) {
+        calls.push_back(call->name());
+        size_t offset = 0;
+        if (strcmp(call->name(), "malloc") == 0) {
+            regions[call->ret->toUIntPtr()] = std::string(call->arg(0).toUInt(), '\0');
+        } else if (strcmp(call->name(), "memcpy") == 0) {
+            std::string *region = lookup(call->arg(0).toUIntPtr(), offset);
+            // Without its region, the made up address would reach memcpy
+            EXPECT_TRUE(region != NULL) << "call " << call->no;
+            if (region) {
+                const Blob *blob = call->arg(1).toBlob();
+                region->replace(offset, blob->size, blob->buf, blob->size);
+            }
+        } else if (strcmp(call->name(), "glDraw") == 0) {
+            std::string *region = lookup(call->arg(0).toUIntPtr(), offset);
+            EXPECT_TRUE(region != NULL) << "call " << call->no;
+            draws.push_back(region ? region->substr(offset) : std::string());
+        }
+        delete call;
+    }
+}
+
+
+static CallSet
+callSet(const char *str)
+{
+    CallSet set(FREQUENCY_NONE);
+    set.merge(str);
+    return set;
+}
+
+
+TEST(trace_fake_memory, trim_calls)
+{
+    writeTrace();
+    trim(callSet("6-7"), CallSet(FREQUENCY_NONE));
+
+    std::vector<std::string> calls;
+    std::vector<std::string> draws;
+    retrace(calls, draws);
+
+    // Calls 0, 1, 5, 6 and 7, but not the memcpy into the mapping
+    std::vector<std::string> expectedCalls = {"malloc", "memcpy", "memcpy", "glDraw", "glXSwapBuffers"};
+    EXPECT_EQ(expectedCalls, calls);
+    std::vector<std::string> expectedDraws = {"0123WXYZ89abcdef"};
+    EXPECT_EQ(expectedDraws, draws);
+
+    remove(traceFilename);
+    remove(trimmedFilename);
+}
+
+
+TEST(trace_fake_memory, trim_frames)
+{
+    writeTrace();
+    trim(CallSet(FREQUENCY_NONE), callSet("1"));
+
+    std::vector<std::string> calls;
+    std::vector<std::string> draws;
+    retrace(calls, draws);
+
+    // Calls 0, 1, 5, 6 and 7, but not the memcpy into the mapping
+    std::vector<std::string> expectedCalls = {"malloc", "memcpy", "memcpy", "glDraw", "glXSwapBuffers"};
+    EXPECT_EQ(expectedCalls, calls);
+    std::vector<std::string> expectedDraws = {"0123WXYZ89abcdef"};
+    EXPECT_EQ(expectedDraws, draws);
+
+    remove(traceFilename);
+    remove(trimmedFilename);
+}
+
+
+int
+main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -30,6 +30,7 @@
 #include <assert.h>
 #include <string.h>
 
+#include <algorithm>
 #include <iostream>
 
 #include <brotli/dec/decode.h>
@@ -134,9 +135,17 @@ void BrotliFile::rawClose()
     m_stream.close();
 }
 
-bool BrotliFile::rawSkip(size_t)
+bool BrotliFile::rawSkip(size_t length)
 {
-    return false;
+    uint8_t buffer[4096];
+    while (length) {
+        size_t read = rawRead(buffer, std::min(length, sizeof buffer));
+        if (!read) {
+            return false;
+        }
+        length -= read;
+    }
+    return true;
 }
 
 int BrotliFile::rawPercentRead(void)
@@ -128,9 +128,10 @@ void ZLibFile::rawClose()
     }
 }
 
-bool ZLibFile::rawSkip(size_t)
+bool ZLibFile::rawSkip(size_t length)
 {
-    return false;
+    // Forward seeks decompress and discard the data
+    return gzseek(m_gzFile, length, SEEK_CUR) >= 0;
 }
 
 int ZLibFile::rawPercentRead(void)
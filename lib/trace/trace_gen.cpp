@@ -0,0 +1,500 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <random>
+#include <vector>
+
+#include "trace_gen.hpp"
+#include "trace_writer.hpp"
+
+
+namespace trace {
+
+
+namespace {
+
+
+// Primitive modes, then capabilities, then buffer targets
+const EnumValue enumValues[] = {
+    {"GL_POINTS", 0x0000},
+    {"GL_LINES", 0x0001},
+    {"GL_TRIANGLES", 0x0004},
+    {"GL_DEPTH_TEST", 0x0B71},
+    {"GL_BLEND", 0x0BE2},
+    {"GL_ARRAY_BUFFER", 0x8892},
+    {"GL_ELEMENT_ARRAY_BUFFER", 0x8893},
+};
+const EnumSig enumSig = {0, sizeof enumValues / sizeof enumValues[0], enumValues};
+
+const BitmaskFlag bitmaskFlags[] = {
+    {"GL_DEPTH_BUFFER_BIT", 0x0100},
+    {"GL_STENCIL_BUFFER_BIT", 0x0400},
+    {"GL_COLOR_BUFFER_BIT", 0x4000},
+};
+const BitmaskSig bitmaskSig = {0, sizeof bitmaskFlags / sizeof bitmaskFlags[0], bitmaskFlags};
+
+const char *nodeMembers[] = {"value", "weight", "child"};
+const StructSig nodeSig = {0, "Node", 3, nodeMembers};
+
+const char *makeCurrentArgs[] = {"dpy", "drawable", "ctx"};
+const char *swapBuffersArgs[] = {"dpy", "drawable"};
+const char *uniform4fArgs[] = {"location", "v0", "v1", "v2", "v3"};
+const char *uniformMatrix4fvArgs[] = {"location", "count", "transpose", "value"};
+const char *enableArgs[] = {"cap"};
+const char *clearArgs[] = {"mask"};
+const char *getUniformLocationArgs[] = {"program", "name"};
+const char *drawArraysArgs[] = {"mode", "first", "count"};
+const char *bufferSubDataArgs[] = {"target", "offset", "size", "data"};
+const char *updateTreeArgs[] = {"tree"};
+
+const FunctionSig swapBuffersSig = {0, "glXSwapBuffers", 2, swapBuffersArgs};
+const FunctionSig uniform4fSig = {1, "glUniform4f", 5, uniform4fArgs};
+const FunctionSig uniformMatrix4fvSig = {2, "glUniformMatrix4fv", 4, uniformMatrix4fvArgs};
+const FunctionSig enableSig = {3, "glEnable", 1, enableArgs};
+const FunctionSig clearSig = {4, "glClear", 1, clearArgs};
+const FunctionSig getUniformLocationSig = {5, "glGetUniformLocation", 2, getUniformLocationArgs};
+const FunctionSig drawArraysSig = {6, "glDrawArrays", 3, drawArraysArgs};
+const FunctionSig bufferSubDataSig = {7, "glBufferSubData", 4, bufferSubDataArgs};
+const FunctionSig updateTreeSig = {8, "tracegenUpdateTree", 1, updateTreeArgs};
+const FunctionSig finishSig = {9, "glFinish", 0, NULL};
+const FunctionSig makeCurrentSig = {10, "glXMakeCurrent", 3, makeCurrentArgs};
+
+const char *uniformNames[] = {"uModelView", "uProjection", "uColor", "uTexture0"};
+
+
+struct MixProfile
+{
+    const char *name;
+
+    // Relative frequency of each kind of call
+    unsigned scalarWeight;
+    unsigned blobWeight;
+    unsigned structWeight;
+
+    unsigned threads;
+    unsigned callsPerFrame;
+    size_t maxBlobSize;
+    unsigned structDepth;
+};
+
+const MixProfile profiles[GEN_MIX_COUNT] = {
+    {"mixed",   70,  20,  10,  2, 1000,  16 * 1024,  4},
+    {"scalar", 100,   0,   0,  1, 1000,  16 * 1024,  4},
+    {"blob",     0, 100,   0,  1, 1000,  64 * 1024,  4},
+    {"struct",   0,   0, 100,  1, 1000,  16 * 1024, 16},
+    {"threads", 70,  20,  10, 64, 1000,  16 * 1024,  4},
+    {"frames",  70,  20,  10,  2,    4,  16 * 1024,  4},
+};
+
+
+class Generator
+{
+    Writer &writer;
+
+    // std::mt19937_64 output is fully specified by the standard, unlike
+    // that of the standard distributions, so only raw output is used.
+    std::mt19937_64 rng;
+
+    MixProfile profile;
+
+    // Blob contents mimic vertex data, with ever increasing indices
+    // interleaved with noisy attributes, so that they never repeat, yet
+    // compress somewhat.
+    std::vector<unsigned char> blob;
+    uint32_t blobIndex = 0;
+
+    inline unsigned
+    random(unsigned n) {
+        return (unsigned)(rng() % n);
+    }
+
+    inline float
+    randomFloat(void) {
+        return (float)(rng() % 20001) / 1000.0f - 10.0f;
+    }
+
+    inline unsigned
+    randomEnum(unsigned first, unsigned count) {
+        return (unsigned)enumValues[first + random(count)].value;
+    }
+
+    void
+    writeScalarCall(unsigned thread);
+
+    void
+    writeBlobCall(unsigned thread);
+
+    void
+    writeNode(unsigned depth);
+
+    void
+    writeStructCall(unsigned thread);
+
+    void
+    writeMakeCurrent(unsigned thread);
+
+    void
+    writeSwapBuffers(unsigned thread);
+
+public:
+    Generator(Writer &writer, const GenOptions &options);
+
+    unsigned long long
+    run(unsigned long long calls);
+};
+
+
+Generator::Generator(Writer &_writer, const GenOptions &options) :
+    writer(_writer),
+    rng(options.seed),
+    profile(profiles[options.mix])
+{
+    if (options.threads) {
+        profile.threads = options.threads;
+    }
+    if (options.callsPerFrame) {
+        profile.callsPerFrame = options.callsPerFrame;
+    }
+    if (options.maxBlobSize) {
+        profile.maxBlobSize = options.maxBlobSize;
+    }
+    if (options.structDepth) {
+        profile.structDepth = options.structDepth;
+    }
+
+    // Rounded up to whole vertices
+    blob.resize((profile.maxBlobSize + 7) & ~size_t(7));
+}
+
+
+void
+Generator::writeScalarCall(unsigned thread)
+{
+    unsigned call;
+    switch (random(6)) {
+    case 0:
+        call = writer.beginEnter(&uniform4fSig, thread);
+        writer.beginArg(0);
+        writer.writeSInt(random(16));
+        writer.endArg();
+        for (unsigned i = 1; i < 5; ++i) {
+            writer.beginArg(i);
+            writer.writeFloat(randomFloat());
+            writer.endArg();
+        }
+        writer.endEnter();
+        writer.beginLeave(call);
+        writer.endLeave();
+        break;
+    case 1:
+        call = writer.beginEnter(&uniformMatrix4fvSig, thread);
+        writer.beginArg(0);
+        writer.writeSInt(random(16));
+        writer.endArg();
+        writer.beginArg(1);
+        writer.writeSInt(1);
+        writer.endArg();
+        writer.beginArg(2);
+        writer.writeBool(false);
+        writer.endArg();
+        writer.beginArg(3);
+        writer.beginArray(16);
+        for (unsigned i = 0; i < 16; ++i) {
+            writer.beginElement();
+            writer.writeFloat(randomFloat());
+            writer.endElement();
+        }
+        writer.endArray();
+        writer.endArg();
+        writer.endEnter();
+        writer.beginLeave(call);
+        writer.endLeave();
+        break;
+    case 2:
+        call = writer.beginEnter(&enableSig, thread);
+        writer.beginArg(0);
+        writer.writeEnum(&enumSig, randomEnum(3, 2));
+        writer.endArg();
+        writer.endEnter();
+        writer.beginLeave(call);
+        writer.endLeave();
+        break;
+    case 3:
+        call = writer.beginEnter(&clearSig, thread);
+        writer.beginArg(0);
+        writer.writeBitmask(&bitmaskSig, bitmaskFlags[random(bitmaskSig.num_flags)].value |
+                                         bitmaskFlags[random(bitmaskSig.num_flags)].value);
+        writer.endArg();
+        writer.endEnter();
+        writer.beginLeave(call);
+        writer.endLeave();
+        break;
+    case 4:
+        {
+            unsigned name = random(sizeof uniformNames / sizeof uniformNames[0]);
+            call = writer.beginEnter(&getUniformLocationSig, thread);
+            writer.beginArg(0);
+            writer.writeUInt(1 + random(8));
+            writer.endArg();
+            writer.beginArg(1);
+            writer.writeString(uniformNames[name]);
+            writer.endArg();
+            writer.endEnter();
+            writer.beginLeave(call);
+            writer.beginReturn();
+            writer.writeSInt(name);
+            writer.endReturn();
+            writer.endLeave();
+        }
+        break;
+    default:
+        call = writer.beginEnter(&drawArraysSig, thread);
+        writer.beginArg(0);
+        writer.writeEnum(&enumSig, randomEnum(0, 3));
+        writer.endArg();
+        writer.beginArg(1);
+        writer.writeSInt(random(1024));
+        writer.endArg();
+        writer.beginArg(2);
+        writer.writeSInt(3 * (1 + random(1024)));
+        writer.endArg();
+        writer.endEnter();
+        writer.beginLeave(call);
+        writer.endLeave();
+        break;
+    }
+}
+
+
+void
+Generator::writeBlobCall(unsigned thread)
+{
+    size_t size = 1 + rng() % profile.maxBlobSize;
+    size_t offset = rng() % (1024 * 1024);
+
+    // Too many bytes for the Mersenne twister, so use a cheap xorshift
+    // seeded from it.  Bytes are stored explicitly to be endian neutral.
+    uint32_t noise = (uint32_t)rng() | 1;
+    for (size_t i = 0; i < size; i += 8) {
+        unsigned char *vertex = &blob[i];
+        vertex[0] = (unsigned char)blobIndex;
+        vertex[1] = (unsigned char)(blobIndex >> 8);
+        vertex[2] = (unsigned char)(blobIndex >> 16);
+        vertex[3] = (unsigned char)(blobIndex >> 24);
+        noise ^= noise << 13;
+        noise ^= noise >> 17;
+        noise ^= noise << 5;
+        vertex[4] = (unsigned char)noise;
+        vertex[5] = (unsigned char)(noise >> 8);
+        vertex[6] = 0;
+        vertex[7] = 0;
+        ++blobIndex;
+    }
+
+    unsigned call = writer.beginEnter(&bufferSubDataSig, thread);
+    writer.beginArg(0);
+    writer.writeEnum(&enumSig, 0x8892); // GL_ARRAY_BUFFER
+    writer.endArg();
+    writer.beginArg(1);
+    writer.writeSInt(offset);
+    writer.endArg();
+    writer.beginArg(2);
+    writer.writeSInt(size);
+    writer.endArg();
+    writer.beginArg(3);
+    writer.writeBlob(blob.data(), size);
+    writer.endArg();
+    writer.endEnter();
+    writer.beginLeave(call);
+    writer.endLeave();
+}
+
+
+void
+Generator::writeNode(unsigned depth)
+{
+    writer.beginStruct(&nodeSig);
+    writer.writeUInt(rng() % 100000);
+    writer.writeFloat(randomFloat());
+    if (depth > 1) {
+        writeNode(depth - 1);
+    } else {
+        writer.writeNull();
+    }
+    writer.endStruct();
+}
+
+
+void
+Generator::writeStructCall(unsigned thread)
+{
+    unsigned call = writer.beginEnter(&updateTreeSig, thread);
+    writer.beginArg(0);
+    writeNode(profile.structDepth);
+    writer.endArg();
+    writer.endEnter();
+    writer.beginLeave(call);
+    writer.endLeave();
+}
+
+
+void
+Generator::writeMakeCurrent(unsigned thread)
+{
+    unsigned call = writer.beginEnter(&makeCurrentSig, thread);
+    writer.beginArg(0);
+    writer.writePointer(0x1000);
+    writer.endArg();
+    writer.beginArg(1);
+    writer.writeUInt(0x2000001);
+    writer.endArg();
+    writer.beginArg(2);
+    writer.writePointer(0x3000);
+    writer.endArg();
+    writer.endEnter();
+    writer.beginLeave(call);
+    writer.beginReturn();
+    writer.writeSInt(1);
+    writer.endReturn();
+    writer.endLeave();
+}
+
+
+void
+Generator::writeSwapBuffers(unsigned thread)
+{
+    unsigned call = writer.beginEnter(&swapBuffersSig, thread);
+    writer.beginArg(0);
+    writer.writePointer(0x1000);
+    writer.endArg();
+    writer.beginArg(1);
+    writer.writeUInt(0x2000001);
+    writer.endArg();
+    writer.endEnter();
+    writer.beginLeave(call);
+    writer.endLeave();
+}
+
+
+unsigned long long
+Generator::run(unsigned long long calls)
+{
+    unsigned totalWeight = profile.scalarWeight + profile.blobWeight + profile.structWeight;
+    assert(totalWeight);
+
+    unsigned long long frames = 0;
+
+    // With several threads, a thread now and then blocks in glFinish while
+    // another one makes the next call, so that calls overlap.
+    bool pending = false;
+    unsigned pendingCall = 0;
+    unsigned pendingThread = 0;
+
+    for (unsigned long long i = 0; i < calls; ++i) {
+        unsigned thread = 0;
+        if (profile.threads > 1) {
+            thread = random(profile.threads);
+            if (pending && thread == pendingThread) {
+                thread = (thread + 1) % profile.threads;
+            }
+        }
+
+        if (i == 0) {
+            // Like real traces, and so that the API is detected right away
+            writeMakeCurrent(thread);
+        } else if ((i + 1) % profile.callsPerFrame == 0) {
+            writeSwapBuffers(thread);
+            ++frames;
+        } else if (profile.threads > 1 && !pending && random(16) == 0) {
+            pendingCall = writer.beginEnter(&finishSig, thread);
+            writer.endEnter();
+            pendingThread = thread;
+            pending = true;
+            continue;
+        } else {
+            unsigned choice = random(totalWeight);
+            if (choice < profile.scalarWeight) {
+                writeScalarCall(thread);
+            } else if (choice < profile.scalarWeight + profile.blobWeight) {
+                writeBlobCall(thread);
+            } else {
+                writeStructCall(thread);
+            }
+        }
+
+        if (pending) {
+            writer.beginLeave(pendingCall);
+            writer.endLeave();
+            pending = false;
+        }
+    }
+
+    if (pending) {
+        writer.beginLeave(pendingCall);
+        writer.endLeave();
+    }
+
+    return frames;
+}
+
+
+} /* anonymous namespace */
+
+
+const char *
+getGenMixName(GenMix mix)
+{
+    assert(mix < GEN_MIX_COUNT);
+    return profiles[mix].name;
+}
+
+
+bool
+lookupGenMix(const char *name, GenMix &mix)
+{
+    for (unsigned i = 0; i < GEN_MIX_COUNT; ++i) {
+        if (strcmp(name, profiles[i].name) == 0) {
+            mix = static_cast<GenMix>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+unsigned long long
+generateTrace(Writer &writer, const GenOptions &options)
+{
+    Generator generator(writer, options);
+    return generator.run(options.calls);
+}
+
+
+} /* namespace trace */
@@ -0,0 +1,89 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Deterministic synthetic trace generation, for benchmarking and testing the
+ * trace I/O stack without capturing real applications.
+ *
+ * The same options and seed always produce byte-identical traces, on every
+ * platform.
+ */
+
+#pragma once
+
+
+#include <stddef.h>
+
+
+namespace trace {
+
+
+class Writer;
+
+
+enum GenMix {
+    GEN_MIX_MIXED = 0,
+    GEN_MIX_SCALAR,   // small calls with a few scalar arguments
+    GEN_MIX_BLOB,     // large buffer uploads
+    GEN_MIX_STRUCT,   // deeply nested structures
+    GEN_MIX_THREADS,  // calls spread over many threads
+    GEN_MIX_FRAMES,   // very short frames
+    GEN_MIX_COUNT
+};
+
+
+struct GenOptions
+{
+    GenMix mix = GEN_MIX_MIXED;
+
+    unsigned long long calls = 100000;
+    unsigned long long seed = 0;
+
+    // Zero picks the default of the mix
+    unsigned threads = 0;
+    unsigned callsPerFrame = 0;
+    size_t maxBlobSize = 0;
+    unsigned structDepth = 0;
+};
+
+
+const char *
+getGenMixName(GenMix mix);
+
+/* Returns false if there is no mix with the given name. */
+bool
+lookupGenMix(const char *name, GenMix &mix);
+
+
+/*
+ * Write the given number of calls with the writer, starting with a
+ * glXMakeCurrent call and ending every frame with a glXSwapBuffers call.
+ * Returns the number of frames written.
+ */
+unsigned long long
+generateTrace(Writer &writer, const GenOptions &options);
+
+
+} /* namespace trace */
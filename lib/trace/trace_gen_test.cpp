@@ -0,0 +1,149 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+#include <stdio.h>
+
+#include <set>
+#include <string>
+
+#include "trace_gen.hpp"
+#include "trace_ostream.hpp"
+#include "trace_parser.hpp"
+#include "trace_writer.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace trace;
+
+
+class StringOutStream : public OutStream {
+public:
+    std::string &data;
+
+    StringOutStream(std::string &_data) : data(_data) {}
+
+    bool write(const void *buffer, size_t length) override {
+        data.append(static_cast<const char *>(buffer), length);
+        return true;
+    }
+
+    void flush(void) override {}
+};
+
+
+static std::string
+generate(const GenOptions &options)
+{
+    std::string data;
+    Writer writer;
+    writer.open(new StringOutStream(data));
+    generateTrace(writer, options);
+    writer.close();
+    return data;
+}
+
+
+TEST(trace_gen, deterministic)
+{
+    GenOptions options;
+    options.calls = 5000;
+    options.seed = 1;
+
+    std::string data = generate(options);
+    EXPECT_TRUE(data == generate(options));
+
+    options.seed = 2;
+    EXPECT_FALSE(data == generate(options));
+}
+
+
+TEST(trace_gen, mixes)
+{
+    const char *filename = "trace_gen_test.trace";
+
+    for (unsigned mix = 0; mix < GEN_MIX_COUNT; ++mix) {
+        GenMix lookedUp;
+        ASSERT_TRUE(lookupGenMix(getGenMixName(GenMix(mix)), lookedUp));
+        EXPECT_EQ(GenMix(mix), lookedUp);
+
+        GenOptions options;
+        options.mix = GenMix(mix);
+        options.calls = 2000;
+        options.maxBlobSize = 4096;
+
+        // Scanning must skip exactly what parsing reads, for every codec
+        for (int zlib = 0; zlib < 2; ++zlib) {
+            SCOPED_TRACE(std::string(getGenMixName(options.mix)) + (zlib ? " zlib" : " snappy"));
+
+            Writer writer;
+            ASSERT_TRUE(writer.open(zlib ? createZLibStream(filename) : createSnappyStream(filename)));
+            unsigned long long frames = generateTrace(writer, options);
+            writer.close();
+
+            for (int scan = 0; scan < 2; ++scan) {
+                Parser parser;
+                ASSERT_TRUE(parser.open(filename));
+
+                unsigned long long calls = 0;
+                unsigned long long frameEnds = 0;
+                std::set<unsigned> numbers;
+                std::set<unsigned> threads;
+                Call *call;
+                while ((call = scan ? parser.scan_call() : parser.parse_call()) != NULL) {
+                    // Calls are returned as they end, so overlapping calls
+                    // may come out of order
+                    numbers.insert(call->no);
+                    EXPECT_FALSE(call->flags & CALL_FLAG_INCOMPLETE);
+                    if (call->flags & CALL_FLAG_END_FRAME) {
+                        ++frameEnds;
+                    }
+                    threads.insert(call->thread_id);
+                    ++calls;
+                    delete call;
+                }
+
+                EXPECT_EQ(API_GL, parser.api);
+                EXPECT_EQ(options.calls, calls);
+                EXPECT_EQ(options.calls, numbers.size());
+                EXPECT_EQ(options.calls - 1, *numbers.rbegin());
+                EXPECT_EQ(frames, frameEnds);
+                if (options.mix == GEN_MIX_THREADS) {
+                    EXPECT_GT(threads.size(), 32U);
+                }
+            }
+        }
+    }
+
+    remove(filename);
+}
+
+
+int
+main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
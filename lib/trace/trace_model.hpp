@@ -292,7 +292,7 @@ public:
 class Struct : public Value
 {
 public:
-    Struct(StructSig *_sig) : sig(_sig), members(_sig->num_members) { }
+    Struct(const StructSig *_sig) : sig(_sig), members(_sig->num_members) { }
     ~Struct();
 
     bool toBool(void) const override;
@@ -555,6 +555,7 @@ class Call
 public:
     unsigned thread_id;
     unsigned no;
+    unsigned frame_no; // frame the call was entered in
     const FunctionSig *sig;
     std::vector<Arg> args;
     Value *ret;
@@ -564,6 +565,7 @@ public:
 
     Call(const FunctionSig *_sig, const CallFlags &_flags, unsigned _thread_id) :
         thread_id(_thread_id), 
+        frame_no(0),
         sig(_sig), 
         args(_sig->num_args), 
         ret(0),
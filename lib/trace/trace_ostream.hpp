@@ -48,5 +48,9 @@ createSnappyStream(const char *filename);
 OutStream *
 createZLibStream(const char *filename);
 
+/* Attach to the ring buffer of a running trace sink; see trace_shm.hpp. */
+OutStream *
+createShmStream(const char *name);
+
 
 } /* namespace trace */
@@ -43,6 +43,9 @@ namespace trace {
 Parser::Parser() {
     file = NULL;
     next_call_no = 0;
+    next_frame_no = 0;
+    filter = NULL;
+    scanning_call = NULL;
     version = 0;
     api = API_UNKNOWN;
 
@@ -101,77 +104,72 @@ void Parser::close(void) {
 
     deleteAll(calls);
 
-    // Delete all signature data.  Signatures are mere structures which don't
-    // own their own memory, so we need to destroy all data we created here.
-
-    for (auto sig : functions) {
-        if (sig) {
-            delete [] sig->name;
-            for (unsigned arg = 0; arg < sig->num_args; ++arg) {
-                delete [] sig->arg_names[arg];
-            }
-            delete [] sig->arg_names;
-            delete sig;
-        }
-    }
+    // Signatures are interned, and outlive the parser.
     functions.clear();
-
-    for (auto sig : structs) {
-        if (sig) {
-            delete [] sig->name;
-            for (unsigned member = 0; member < sig->num_members; ++member) {
-                delete [] sig->member_names[member];
-            }
-            delete [] sig->member_names;
-            delete sig;
-        }
-    }
     structs.clear();
-
-    for (auto sig : enums) {
-        if (sig) {
-            for (unsigned value = 0; value < sig->num_values; ++value) {
-                delete [] sig->values[value].name;
-            }
-            delete [] sig->values;
-            delete sig;
-        }
-    }
     enums.clear();
-    
-    for (auto sig : bitmasks) {
-        if (sig) {
-            for (unsigned flag = 0; flag < sig->num_flags; ++flag) {
-                delete [] sig->flags[flag].name;
-            }
-            delete [] sig->flags;
-            delete sig;
-        }
-    }
     bitmasks.clear();
+    glGetErrorSig = NULL;
+
+    filteredFunctions.clear();
 
     next_call_no = 0;
+    next_frame_no = 0;
 }
 
 
 void Parser::getBookmark(ParseBookmark &bookmark) {
     bookmark.offset = file->currentOffset();
     bookmark.next_call_no = next_call_no;
+    bookmark.next_frame_no = next_frame_no;
 }
 
 
 void Parser::setBookmark(const ParseBookmark &bookmark) {
     file->setCurrentOffset(bookmark.offset);
     next_call_no = bookmark.next_call_no;
+    next_frame_no = bookmark.next_frame_no;
     
     // Simply ignore all pending calls
     deleteAll(calls);
 }
 
 
+void Parser::copySignatures(const Parser &other) {
+    assert(functions.empty() && structs.empty() && enums.empty() && bitmasks.empty());
+
+    // Signatures are interned, and stack frames are never freed, so they can
+    // all be shared.
+    functions = other.functions;
+    structs = other.structs;
+    enums = other.enums;
+    bitmasks = other.bitmasks;
+    frames = other.frames;
+
+    glGetErrorSig = other.glGetErrorSig;
+
+    api = other.api;
+}
+
+
+void Parser::setFilter(const CallFilter *_filter) {
+    filter = _filter;
+    filteredFunctions.clear();
+}
+
+
 Call *Parser::parse_call(Mode mode) {
     do {
         Call *call;
+
+        // Stop once no call can be accepted anymore and all accepted calls
+        // have been returned.
+        if (filter &&
+            calls.empty() &&
+            filter->isPast(next_call_no, next_frame_no)) {
+            return NULL;
+        }
+
         int c = read_byte();
         switch (c) {
         case trace::EVENT_ENTER:
@@ -220,27 +218,36 @@ T *lookup(std::vector<T *> &map, size_t index) {
     }
 }
 
+template<class T>
+T &lookupState(std::vector<T> &map, size_t index) {
+    if (index >= map.size()) {
+        map.resize(index + 1);
+    }
+    return map[index];
+}
 
-Parser::FunctionSigFlags *
+
+const FunctionSigFlags *
 Parser::parse_function_sig(void) {
     size_t id = read_uint();
 
-    FunctionSigState *sig = lookup(functions, id);
+    SigState<FunctionSigFlags> &state = lookupState(functions, id);
 
-    if (!sig) {
+    if (!state.sig) {
         /* parse the signature */
-        sig = new FunctionSigState;
-        sig->id = id;
-        sig->name = read_string();
-        sig->num_args = read_uint();
-        const char **arg_names = new const char *[sig->num_args];
-        for (unsigned i = 0; i < sig->num_args; ++i) {
-            arg_names[i] = read_string();
+        FunctionSig def;
+        def.id = id;
+        def.name = read_interned_string();
+        def.num_args = read_uint();
+        std::vector<const char *> arg_names(def.num_args);
+        for (unsigned i = 0; i < def.num_args; ++i) {
+            arg_names[i] = read_interned_string();
         }
-        sig->arg_names = arg_names;
-        sig->flags = lookupCallFlags(sig->name);
-        sig->fileOffset = file->currentOffset();
-        functions[id] = sig;
+        def.arg_names = arg_names.data();
+
+        const FunctionSigFlags *sig = internSig(def);
+        state.sig = sig;
+        state.fileOffset = file->currentOffset();
 
         /**
          * Try to autodetect the API.
@@ -277,7 +284,7 @@ Parser::parse_function_sig(void) {
             glGetErrorSig = sig;
         }
 
-    } else if (file->currentOffset() < sig->fileOffset) {
+    } else if (file->currentOffset() < state.fileOffset) {
         /* skip over the signature */
         skip_string(); /* name */
         unsigned num_args = read_uint();
@@ -286,30 +293,30 @@ Parser::parse_function_sig(void) {
         }
     }
 
-    assert(sig);
-    return sig;
+    assert(state.sig);
+    return state.sig;
 }
 
 
-StructSig *Parser::parse_struct_sig() {
+const StructSig *Parser::parse_struct_sig() {
     size_t id = read_uint();
 
-    StructSigState *sig = lookup(structs, id);
+    SigState<StructSig> &state = lookupState(structs, id);
 
-    if (!sig) {
+    if (!state.sig) {
         /* parse the signature */
-        sig = new StructSigState;
-        sig->id = id;
-        sig->name = read_string();
-        sig->num_members = read_uint();
-        const char **member_names = new const char *[sig->num_members];
-        for (unsigned i = 0; i < sig->num_members; ++i) {
-            member_names[i] = read_string();
+        StructSig def;
+        def.id = id;
+        def.name = read_interned_string();
+        def.num_members = read_uint();
+        std::vector<const char *> member_names(def.num_members);
+        for (unsigned i = 0; i < def.num_members; ++i) {
+            member_names[i] = read_interned_string();
         }
-        sig->member_names = member_names;
-        sig->fileOffset = file->currentOffset();
-        structs[id] = sig;
-    } else if (file->currentOffset() < sig->fileOffset) {
+        def.member_names = member_names.data();
+        state.sig = internSig(def);
+        state.fileOffset = file->currentOffset();
+    } else if (file->currentOffset() < state.fileOffset) {
         /* skip over the signature */
         skip_string(); /* name */
         unsigned num_members = read_uint();
@@ -318,8 +325,8 @@ StructSig *Parser::parse_struct_sig() {
         }
     }
 
-    assert(sig);
-    return sig;
+    assert(state.sig);
+    return state.sig;
 }
 
 
@@ -329,52 +336,52 @@ StructSig *Parser::parse_struct_sig() {
  *   enum_sig = id name value
  *            | id
  */
-EnumSig *Parser::parse_old_enum_sig() {
+const EnumSig *Parser::parse_old_enum_sig() {
     size_t id = read_uint();
 
-    EnumSigState *sig = lookup(enums, id);
+    SigState<EnumSig> &state = lookupState(enums, id);
 
-    if (!sig) {
+    if (!state.sig) {
         /* parse the signature */
-        sig = new EnumSigState;
-        sig->id = id;
-        sig->num_values = 1;
-        EnumValue *values = new EnumValue[sig->num_values];
-        values->name = read_string();
-        values->value = read_sint();
-        sig->values = values;
-        sig->fileOffset = file->currentOffset();
-        enums[id] = sig;
-    } else if (file->currentOffset() < sig->fileOffset) {
+        EnumValue value;
+        value.name = read_interned_string();
+        value.value = read_sint();
+        EnumSig def;
+        def.id = id;
+        def.num_values = 1;
+        def.values = &value;
+        state.sig = internSig(def);
+        state.fileOffset = file->currentOffset();
+    } else if (file->currentOffset() < state.fileOffset) {
         /* skip over the signature */
         skip_string(); /*name*/
         scan_value();
     }
 
-    assert(sig);
-    return sig;
+    assert(state.sig);
+    return state.sig;
 }
 
 
-EnumSig *Parser::parse_enum_sig() {
+const EnumSig *Parser::parse_enum_sig() {
     size_t id = read_uint();
 
-    EnumSigState *sig = lookup(enums, id);
+    SigState<EnumSig> &state = lookupState(enums, id);
 
-    if (!sig) {
+    if (!state.sig) {
         /* parse the signature */
-        sig = new EnumSigState;
-        sig->id = id;
-        sig->num_values = read_uint();
-        EnumValue *values = new EnumValue[sig->num_values];
-        for (EnumValue *it = values; it != values + sig->num_values; ++it) {
-            it->name = read_string();
-            it->value = read_sint();
+        EnumSig def;
+        def.id = id;
+        def.num_values = read_uint();
+        std::vector<EnumValue> values(def.num_values);
+        for (EnumValue &value : values) {
+            value.name = read_interned_string();
+            value.value = read_sint();
         }
-        sig->values = values;
-        sig->fileOffset = file->currentOffset();
-        enums[id] = sig;
-    } else if (file->currentOffset() < sig->fileOffset) {
+        def.values = values.data();
+        state.sig = internSig(def);
+        state.fileOffset = file->currentOffset();
+    } else if (file->currentOffset() < state.fileOffset) {
         /* skip over the signature */
         int num_values = read_uint();
         for (int i = 0; i < num_values; ++i) {
@@ -383,33 +390,33 @@ EnumSig *Parser::parse_enum_sig() {
         }
     }
 
-    assert(sig);
-    return sig;
+    assert(state.sig);
+    return state.sig;
 }
 
 
-BitmaskSig *Parser::parse_bitmask_sig() {
+const BitmaskSig *Parser::parse_bitmask_sig() {
     size_t id = read_uint();
 
-    BitmaskSigState *sig = lookup(bitmasks, id);
+    SigState<BitmaskSig> &state = lookupState(bitmasks, id);
 
-    if (!sig) {
+    if (!state.sig) {
         /* parse the signature */
-        sig = new BitmaskSigState;
-        sig->id = id;
-        sig->num_flags = read_uint();
-        BitmaskFlag *flags = new BitmaskFlag[sig->num_flags];
-        for (BitmaskFlag *it = flags; it != flags + sig->num_flags; ++it) {
-            it->name = read_string();
-            it->value = read_uint();
-            if (it->value == 0 && it != flags) {
-                std::cerr << "warning: bitmask " << it->name << " is zero but is not first flag\n";
+        BitmaskSig def;
+        def.id = id;
+        def.num_flags = read_uint();
+        std::vector<BitmaskFlag> flags(def.num_flags);
+        for (BitmaskFlag &flag : flags) {
+            flag.name = read_interned_string();
+            flag.value = read_uint();
+            if (flag.value == 0 && &flag != &flags[0]) {
+                std::cerr << "warning: bitmask " << flag.name << " is zero but is not first flag\n";
             }
         }
-        sig->flags = flags;
-        sig->fileOffset = file->currentOffset();
-        bitmasks[id] = sig;
-    } else if (file->currentOffset() < sig->fileOffset) {
+        def.flags = flags.data();
+        state.sig = internSig(def);
+        state.fileOffset = file->currentOffset();
+    } else if (file->currentOffset() < state.fileOffset) {
         /* skip over the signature */
         int num_flags = read_uint();
         for (int i = 0; i < num_flags; ++i) {
@@ -418,8 +425,8 @@ BitmaskSig *Parser::parse_bitmask_sig() {
         }
     }
 
-    assert(sig);
-    return sig;
+    assert(state.sig);
+    return state.sig;
 }
 
 
@@ -432,11 +439,25 @@ void Parser::parse_enter(Mode mode) {
         thread_id = 0;
     }
 
-    FunctionSigFlags *sig = parse_function_sig();
+    const FunctionSigFlags *sig = parse_function_sig();
+
+    CallNo call_no = next_call_no++;
+    unsigned frame_no = next_frame_no;
+    if (sig->flags & CALL_FLAG_END_FRAME) {
+        ++next_frame_no;
+    }
+
+    if (filter && !filter_call(sig, call_no, sig->flags, frame_no)) {
+        // The matching leave event won't find this call, and will be skipped
+        // too.
+        skip_call_details();
+        return;
+    }
 
     Call *call = new Call(sig, sig->flags, thread_id);
 
-    call->no = next_call_no++;
+    call->no = call_no;
+    call->frame_no = frame_no;
 
     if (parse_call_details(call, mode)) {
         calls.push_back(call);
@@ -458,13 +479,10 @@ Call *Parser::parse_leave(Mode mode) {
     }
     if (!call) {
         /* This might happen on random access, when an asynchronous call is stranded
-         * between two frames.  We won't return this call, but we still need to skip 
-         * over its data.
+         * between two frames, or when the call was rejected by the filter.  We
+         * won't return this call, but we still need to skip over its data.
          */
-        const FunctionSig sig = {0, NULL, 0, NULL};
-        call = new Call(&sig, 0, 0);
-        parse_call_details(call, SCAN);
-        delete call;
+        skip_call_details();
         return NULL;
     }
 
@@ -478,6 +496,7 @@ Call *Parser::parse_leave(Mode mode) {
 
 
 bool Parser::parse_call_details(Call *call, Mode mode) {
+    scanning_call = mode == SCAN ? call : NULL;
     do {
         int c = read_byte();
         switch (c) {
@@ -485,6 +504,7 @@ bool Parser::parse_call_details(Call *call, Mode mode) {
 #if TRACE_VERBOSE
             std::cerr << "\tCALL_END\n";
 #endif
+            scanning_call = NULL;
             return true;
         case trace::CALL_ARG:
 #if TRACE_VERBOSE
@@ -509,11 +529,64 @@ bool Parser::parse_call_details(Call *call, Mode mode) {
                       << c << "\n";
             exit(1);
         case -1:
+            scanning_call = NULL;
             return false;
         }
     } while(true);
 }
 
+/**
+ * Skip over the details of a call which won't be returned.  Signatures and
+ * backtrace frames defined here must still be registered, as later calls may
+ * refer to them.
+ */
+void Parser::skip_call_details(void) {
+    do {
+        int c = read_byte();
+        switch (c) {
+        case trace::CALL_END:
+        case -1:
+            return;
+        case trace::CALL_ARG:
+            skip_uint();
+            scan_value();
+            break;
+        case trace::CALL_RET:
+            scan_value();
+            break;
+        case trace::CALL_BACKTRACE:
+            {
+                unsigned num_frames = read_uint();
+                for (unsigned i = 0; i < num_frames; ++i) {
+                    parse_backtrace_frame(SKIP);
+                }
+            }
+            break;
+        default:
+            std::cerr << "error: unknown call detail " << c << "\n";
+            exit(1);
+        }
+    } while(true);
+}
+
+
+bool Parser::filter_call(const FunctionSig *sig, CallNo call_no, CallFlags flags, unsigned frame_no) {
+    if (filteredFunctions.size() <= sig->id) {
+        filteredFunctions.resize(sig->id + 1);
+    }
+    signed char &accepted = filteredFunctions[sig->id];
+    if (accepted == 0) {
+        if (filter->keepsFunction(sig->name)) {
+            accepted = 2;
+        } else {
+            accepted = filter->acceptsFunction(sig->name) ? 1 : -1;
+        }
+    }
+    return accepted == 2 ||
+           (accepted > 0 && filter->accepts(call_no, flags, frame_no));
+}
+
+
 bool Parser::parse_call_backtrace(Call *call, Mode mode) {
     unsigned num_frames = read_uint();
     Backtrace* backtrace = new Backtrace(num_frames);
@@ -536,13 +609,13 @@ StackFrame * Parser::parse_backtrace_frame(Mode mode) {
                c != -1) {
             switch (c) {
             case trace::BACKTRACE_MODULE:
-                frame->module = read_string();
+                frame->module = read_interned_string();
                 break;
             case trace::BACKTRACE_FUNCTION:
-                frame->function = read_string();
+                frame->function = read_interned_string();
                 break;
             case trace::BACKTRACE_FILENAME:
-                frame->filename = read_string();
+                frame->filename = read_interned_string();
                 break;
             case trace::BACKTRACE_LINENUMBER:
                 frame->linenumber = read_uint();
@@ -800,7 +873,7 @@ void Parser::scan_string() {
 
 
 Value *Parser::parse_enum() {
-    EnumSig *sig;
+    const EnumSig *sig;
     signed long long value;
     if (version >= 3) {
         sig = parse_enum_sig();
@@ -825,7 +898,7 @@ void Parser::scan_enum() {
 
 
 Value *Parser::parse_bitmask() {
-    BitmaskSig *sig = parse_bitmask_sig();
+    const BitmaskSig *sig = parse_bitmask_sig();
 
     unsigned long long value = read_uint();
 
@@ -869,6 +942,9 @@ Value *Parser::parse_blob(void) {
 
 void Parser::scan_blob(void) {
     size_t size = read_uint();
+    if (scanning_call) {
+        scanned_blob(scanning_call, size);
+    }
     if (size) {
         file->skip(size);
     }
@@ -876,7 +952,7 @@ void Parser::scan_blob(void) {
 
 
 Value *Parser::parse_struct() {
-    StructSig *sig = parse_struct_sig();
+    const StructSig *sig = parse_struct_sig();
     Struct *value = new Struct(sig);
 
     for (size_t i = 0; i < sig->num_members; ++i) {
@@ -888,7 +964,7 @@ Value *Parser::parse_struct() {
 
 
 void Parser::scan_struct() {
-    StructSig *sig = parse_struct_sig();
+    const StructSig *sig = parse_struct_sig();
     for (size_t i = 0; i < sig->num_members; ++i) {
         scan_value();
     }
@@ -956,6 +1032,23 @@ const char * Parser::read_string(void) {
 }
 
 
+/*
+ * Read a string and intern it, for signatures and other strings which are
+ * never freed.
+ */
+const char * Parser::read_interned_string(void) {
+    size_t len = read_uint();
+    internBuffer.resize(len);
+    if (len) {
+        file->read(&internBuffer[0], len);
+    }
+#if TRACE_VERBOSE
+    std::cerr << "\tSTRING \"" << internBuffer << "\"\n";
+#endif
+    return internString(internBuffer);
+}
+
+
 void Parser::skip_string(void) {
     size_t len = read_uint();
     file->skip(len);
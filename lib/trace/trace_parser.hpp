@@ -28,11 +28,14 @@
 
 #include <iostream>
 #include <list>
+#include <string>
 
 #include "trace_file.hpp"
 #include "trace_format.hpp"
 #include "trace_model.hpp"
 #include "trace_api.hpp"
+#include "trace_call_filter.hpp"
+#include "trace_sig_registry.hpp"
 
 
 namespace trace {
@@ -42,6 +45,7 @@ struct ParseBookmark
 {
     File::Offset offset;
     unsigned next_call_no;
+    unsigned next_frame_no;
 };
 
 
@@ -73,30 +77,28 @@ protected:
     typedef std::list<Call *> CallList;
     CallList calls;
 
-    struct FunctionSigFlags : public FunctionSig {
-        CallFlags flags;
-    };
-
-    // Helper template that extends a base signature structure, with additional
-    // parsing information.
+    // Signatures are interned in the process-wide registry, and merely
+    // referred to here, along with additional parsing information.
     template< class T >
-    struct SigState : public T {
+    struct SigState {
+        const T *sig = nullptr;
+
         // Offset in the file of where signature was defined.  It is used when
         // reparsing to determine whether the signature definition is to be
         // expected next or not.
         File::Offset fileOffset;
     };
 
-    typedef SigState<FunctionSigFlags> FunctionSigState;
-    typedef SigState<StructSig> StructSigState;
-    typedef SigState<EnumSig> EnumSigState;
-    typedef SigState<BitmaskSig> BitmaskSigState;
-    typedef SigState<StackFrame> StackFrameState;
+    // Stack frames are specific to each trace, so they are owned by the
+    // parser instead.
+    struct StackFrameState : public StackFrame {
+        File::Offset fileOffset;
+    };
 
-    typedef std::vector<FunctionSigState *> FunctionMap;
-    typedef std::vector<StructSigState *> StructMap;
-    typedef std::vector<EnumSigState *> EnumMap;
-    typedef std::vector<BitmaskSigState *> BitmaskMap;
+    typedef std::vector<SigState<FunctionSigFlags>> FunctionMap;
+    typedef std::vector<SigState<StructSig>> StructMap;
+    typedef std::vector<SigState<EnumSig>> EnumMap;
+    typedef std::vector<SigState<BitmaskSig>> BitmaskMap;
     typedef std::vector<StackFrameState *> StackFrameMap;
 
     FunctionMap functions;
@@ -105,11 +107,24 @@ protected:
     BitmaskMap bitmasks;
     StackFrameMap frames;
 
-    FunctionSig *glGetErrorSig;
+    const FunctionSig *glGetErrorSig;
 
     unsigned next_call_no;
+    unsigned next_frame_no;
+
+    const CallFilter *filter;
+
+    // Per function signature ID: 0 if not yet evaluated against the filter,
+    // 2 if always accepted, 1 if accepted, -1 if rejected.
+    std::vector<signed char> filteredFunctions;
+
+    // Call whose details are being scanned, if any.
+    Call *scanning_call;
 
     unsigned long long version;
+
+    // Scratch buffer for strings about to be interned.
+    std::string internBuffer;
 public:
     API api;
 
@@ -134,10 +149,23 @@ public:
 
     void setBookmark(const ParseBookmark &bookmark) override;
 
+    /*
+     * Copy all signatures parsed so far by another parser opened on the same
+     * trace, so that this parser may start from any bookmark taken from it.
+     */
+    void copySignatures(const Parser &other);
+
     unsigned long long getVersion(void) const override {
         return version;
     }
 
+    /*
+     * Only return calls accepted by the given filter, which must outlive the
+     * parser or be reset with NULL.  Other calls are skipped without decoding
+     * their values, and parsing ends once no further call can be accepted.
+     */
+    void setFilter(const CallFilter *filter);
+
     int percentRead()
     {
         return file->percentRead();
@@ -148,13 +176,20 @@ public:
     }
 
 protected:
+    /*
+     * Called with the size of every blob skipped while scanning the details
+     * of a call, be it an argument, a return value, or nested in either, so
+     * that subclasses can account for blobs without reading them.
+     */
+    virtual void scanned_blob(Call *call, size_t size) {}
+
     Call *parse_call(Mode mode);
 
-    FunctionSigFlags *parse_function_sig(void);
-    StructSig *parse_struct_sig();
-    EnumSig *parse_old_enum_sig();
-    EnumSig *parse_enum_sig();
-    BitmaskSig *parse_bitmask_sig();
+    const FunctionSigFlags *parse_function_sig(void);
+    const StructSig *parse_struct_sig();
+    const EnumSig *parse_old_enum_sig();
+    const EnumSig *parse_enum_sig();
+    const BitmaskSig *parse_bitmask_sig();
     
 public:
     static CallFlags
@@ -169,6 +204,10 @@ protected:
 
     bool parse_call_details(Call *call, Mode mode);
 
+    void skip_call_details(void);
+
+    bool filter_call(const FunctionSig *sig, CallNo call_no, CallFlags flags, unsigned frame_no);
+
     bool parse_call_backtrace(Call *call, Mode mode);
     StackFrame * parse_backtrace_frame(Mode mode);
 
@@ -227,6 +266,7 @@ protected:
     void scan_wstring();
 
     const char * read_string(void);
+    const char * read_interned_string(void);
     void skip_string(void);
 
     signed long long read_sint(void);
@@ -243,6 +283,13 @@ protected:
 AbstractParser *
 lastFrameLoopParser(AbstractParser *parser, int loopCount);
 
+/*
+ * Decorate a parser so that calls replaced in the given edit overlay (as
+ * written by OverlayWriter) are returned instead of the original ones.
+ */
+AbstractParser *
+overlayParser(AbstractParser *parser, const char *overlayFilename);
+
 
 } /* namespace trace */
 
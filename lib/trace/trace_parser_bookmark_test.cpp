@@ -0,0 +1,168 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+#include "trace_parser.hpp"
+#include "trace_writer.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace trace;
+
+
+static const char *draw_arg_names[] = {"label", "mode", "rect"};
+static const FunctionSig draw_sig = {0, "glDraw", 3, draw_arg_names};
+static const FunctionSig swap_sig = {1, "glXSwapBuffers", 0, NULL};
+
+static const EnumValue mode_values[] = {{"GL_POINTS", 0}, {"GL_LINES", 1}};
+static const EnumSig mode_sig = {0, 2, mode_values};
+
+static const char *rect_member_names[] = {"x", "y"};
+static const StructSig rect_sig = {0, "Rect", 2, rect_member_names};
+
+static const char *traceFilename = "trace_parser_bookmark_test.trace";
+
+static const unsigned numFrames = 8;
+static const unsigned callsPerFrame = 16;
+
+
+/*
+ * Write frames of glDraw calls, labelled "hay" except for a single "needle"
+ * in the last frame, so all signatures are defined long before it.
+ */
+static void
+writeTrace(void)
+{
+    Writer writer;
+    ASSERT_TRUE(writer.open(traceFilename));
+    for (unsigned frame = 0; frame < numFrames; ++frame) {
+        for (unsigned i = 0; i < callsPerFrame; ++i) {
+            bool needle = frame == numFrames - 1 && i == callsPerFrame / 2;
+            unsigned call_no = writer.beginEnter(&draw_sig, 0);
+            writer.beginArg(0);
+            writer.writeString(needle ? "needle" : "hay");
+            writer.endArg();
+            writer.beginArg(1);
+            writer.writeEnum(&mode_sig, 1);
+            writer.endArg();
+            writer.beginArg(2);
+            writer.beginStruct(&rect_sig);
+            writer.writeSInt(frame);
+            writer.writeSInt(i);
+            writer.endStruct();
+            writer.endArg();
+            writer.endEnter();
+            writer.beginLeave(call_no);
+            writer.endLeave();
+        }
+        unsigned call_no = writer.beginEnter(&swap_sig, 0);
+        writer.endEnter();
+        writer.beginLeave(call_no);
+        writer.endLeave();
+    }
+    writer.close();
+}
+
+
+/*
+ * Search the frames starting at `firstFrame` the way the GUI search workers
+ * do: with a fresh parser, seeded with the signatures of the parser which
+ * scanned the whole trace, and jumping straight to the frame's bookmark.
+ */
+static int
+searchFrom(const Parser &scanner, const std::vector<ParseBookmark> &frames,
+           unsigned firstFrame)
+{
+    Parser parser;
+    EXPECT_TRUE(parser.open(traceFilename));
+    parser.copySignatures(scanner);
+    parser.setBookmark(frames[firstFrame]);
+
+    int found = -1;
+    Call *call;
+    while (found < 0 && (call = parser.parse_call())) {
+        if (strcmp(call->name(), "glDraw") == 0) {
+            // Values must be intact even though their signatures were
+            // defined before the bookmark.
+            EXPECT_EQ(1, call->arg(1).toSInt());
+            const Struct *rect = call->arg(2).toStruct();
+            EXPECT_TRUE(rect != NULL);
+            if (rect) {
+                EXPECT_STREQ("Rect", rect->sig->name);
+                EXPECT_EQ(2u, rect->members.size());
+            }
+            if (strcmp(call->arg(0).toString(), "needle") == 0) {
+                found = call->no;
+            }
+        }
+        delete call;
+    }
+    return found;
+}
+
+
+TEST(trace_parser_bookmark, search)
+{
+    writeTrace();
+
+    // Scan the whole trace first, as the GUI does when loading it
+    Parser scanner;
+    ASSERT_TRUE(scanner.open(traceFilename));
+    std::vector<ParseBookmark> frames;
+    ParseBookmark bookmark;
+    scanner.getBookmark(bookmark);
+    frames.push_back(bookmark);
+    Call *call;
+    while ((call = scanner.scan_call())) {
+        if (call->flags & CALL_FLAG_END_FRAME) {
+            scanner.getBookmark(bookmark);
+            frames.push_back(bookmark);
+        }
+        delete call;
+    }
+    ASSERT_EQ(numFrames + 1, frames.size());
+
+    int needle = (numFrames - 1) * (callsPerFrame + 1) + callsPerFrame / 2;
+    EXPECT_EQ(needle, searchFrom(scanner, frames, 0));
+    EXPECT_EQ(needle, searchFrom(scanner, frames, numFrames / 2));
+    EXPECT_EQ(needle, searchFrom(scanner, frames, numFrames - 1));
+
+    scanner.close();
+
+    remove(traceFilename);
+}
+
+
+int
+main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
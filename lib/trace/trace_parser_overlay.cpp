@@ -0,0 +1,175 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+#include <map>
+#include <string>
+
+#include "trace_parser.hpp"
+
+
+namespace trace {
+
+
+// Parser for edit overlays, as written by OverlayWriter
+class OverlayReader : public Parser {
+public:
+    bool open(const char *filename) override;
+    void close(void) override;
+
+    // Return a new copy of the replacement for the given call, if any.
+    Call *lookup(unsigned call_no);
+
+private:
+    typedef std::map<unsigned, ParseBookmark> Index;
+    Index index;
+};
+
+
+bool
+OverlayReader::open(const char *filename)
+{
+    if (!Parser::open(filename)) {
+        return false;
+    }
+
+    if (!supportsOffsets()) {
+        std::cerr << "error: edit overlay " << filename << " does not support random access\n";
+        close();
+        return false;
+    }
+
+    // Index the replacement calls, without keeping their values around.
+    while (true) {
+        unsigned call_no = read_uint();
+        ParseBookmark bookmark;
+        getBookmark(bookmark);
+        Call *call = parse_call(SCAN);
+        if (!call) {
+            break;
+        }
+        index[call_no] = bookmark;
+        delete call;
+    }
+
+    return true;
+}
+
+
+void
+OverlayReader::close(void)
+{
+    index.clear();
+    Parser::close();
+}
+
+
+Call *
+OverlayReader::lookup(unsigned call_no)
+{
+    Index::const_iterator it = index.find(call_no);
+    if (it == index.end()) {
+        return NULL;
+    }
+
+    setBookmark(it->second);
+    Call *call = parse_call(FULL);
+    if (call) {
+        call->no = call_no;
+    }
+    return call;
+}
+
+
+// Decorator for parser which applies an edit overlay
+class OverlayParser : public AbstractParser  {
+public:
+    OverlayParser(AbstractParser *p, const char *f) :
+        parser(p),
+        overlayFilename(f)
+    {
+    }
+
+    ~OverlayParser() {
+        delete parser;
+    }
+
+    Call *parse_call(void) override;
+
+    // Delegate to Parser
+    void getBookmark(ParseBookmark &bookmark) override { parser->getBookmark(bookmark); }
+    void setBookmark(const ParseBookmark &bookmark) override { parser->setBookmark(bookmark); }
+    bool open(const char *filename) override;
+    void close(void) override { parser->close(); overlay.close(); }
+    unsigned long long getVersion(void) const override { return parser->getVersion(); }
+private:
+    AbstractParser *parser;
+    std::string overlayFilename;
+    OverlayReader overlay;
+};
+
+
+bool
+OverlayParser::open(const char *filename)
+{
+    if (!overlay.open(overlayFilename.c_str())) {
+        std::cerr << "error: failed to open edit overlay " << overlayFilename << "\n";
+        return false;
+    }
+
+    if (!parser->open(filename)) {
+        overlay.close();
+        return false;
+    }
+
+    return true;
+}
+
+
+Call *
+OverlayParser::parse_call(void)
+{
+    Call *call = parser->parse_call();
+    if (call) {
+        Call *replacement = overlay.lookup(call->no);
+        if (replacement) {
+            replacement->thread_id = call->thread_id;
+            replacement->flags |= call->flags & CALL_FLAG_INCOMPLETE;
+            delete call;
+            call = replacement;
+        }
+    }
+    return call;
+}
+
+
+AbstractParser *
+overlayParser(AbstractParser *parser, const char *overlayFilename)
+{
+    return new OverlayParser(parser, overlayFilename);
+}
+
+
+} /* namespace trace */
@@ -0,0 +1,113 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "trace_parser.hpp"
+#include "trace_writer.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace trace;
+
+
+static const char *arg_names[] = {"x"};
+static const FunctionSig sig = {0, "glFoo", 1, arg_names};
+
+
+static void
+writeCall(Writer &writer, unsigned thread_id, unsigned long long x)
+{
+    unsigned call_no = writer.beginEnter(&sig, thread_id);
+    writer.beginArg(0);
+    writer.writeUInt(x);
+    writer.endArg();
+    writer.endEnter();
+    writer.beginLeave(call_no);
+    writer.endLeave();
+}
+
+
+TEST(trace_parser_overlay, replace)
+{
+    const char *traceFilename = "trace_parser_overlay_test.trace";
+    const char *overlayFilename = "trace_parser_overlay_test.overlay";
+
+    Writer writer;
+    ASSERT_TRUE(writer.open(traceFilename));
+    for (unsigned i = 0; i < 4; ++i) {
+        writeCall(writer, 0, i);
+    }
+    writer.close();
+
+    // Replace the argument of call 2
+    OverlayWriter overlayWriter;
+    ASSERT_TRUE(overlayWriter.open(overlayFilename));
+    Call call(&sig, 0, 0);
+    call.no = 2;
+    call.args[0].value = new UInt(42);
+    overlayWriter.writeCall(&call);
+    overlayWriter.close();
+
+    AbstractParser *parser = overlayParser(new Parser, overlayFilename);
+    ASSERT_TRUE(parser->open(traceFilename));
+
+    static const unsigned long long expected[] = {0, 1, 42, 3};
+    for (unsigned i = 0; i < 4; ++i) {
+        Call *parsed = parser->parse_call();
+        ASSERT_TRUE(parsed != NULL);
+        EXPECT_EQ(i, parsed->no);
+        EXPECT_STREQ("glFoo", parsed->name());
+        EXPECT_EQ(expected[i], parsed->arg(0).toUInt());
+        delete parsed;
+    }
+    EXPECT_TRUE(parser->parse_call() == NULL);
+
+    // Replacements must be returned again after reopening
+    parser->close();
+    ASSERT_TRUE(parser->open(traceFilename));
+    Call *parsed;
+    while ((parsed = parser->parse_call()) && parsed->no != 2) {
+        delete parsed;
+    }
+    ASSERT_TRUE(parsed != NULL);
+    EXPECT_EQ(42ULL, parsed->arg(0).toUInt());
+    delete parsed;
+
+    delete parser;
+
+    remove(traceFilename);
+    remove(overlayFilename);
+}
+
+
+int
+main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
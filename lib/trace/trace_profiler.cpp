@@ -26,11 +26,44 @@
 
 #include "trace_profiler.hpp"
 #include "os_time.hpp"
+#include <algorithm>
 #include <iostream>
 #include <string.h>
 #include <sstream>
 
 namespace trace {
+
+static const char profileMagic[8] = {'A', 'P', 'I', 'P', 'R', 'O', 'F', 0};
+static const uint32_t profileVersion = 1;
+
+enum {
+    PROFILE_RECORD_NAME = 1,
+    PROFILE_RECORD_CALL,
+    PROFILE_RECORD_FRAME_END,
+};
+
+struct ProfileCallRecord {
+    int64_t gpuStart;
+    int64_t gpuDuration;
+    int64_t cpuStart;
+    int64_t cpuDuration;
+    int64_t vsizeStart;
+    int64_t vsizeDuration;
+    int64_t rssStart;
+    int64_t rssDuration;
+    int64_t pixels;
+    uint32_t no;
+    uint32_t program;
+    uint32_t name;
+    uint32_t reserved;
+};
+
+static inline void
+writeUInt32(uint32_t value)
+{
+    std::cout.write(reinterpret_cast<const char *>(&value), sizeof value);
+}
+
 Profiler::Profiler()
     : baseGpuTime(0),
       baseCpuTime(0),
@@ -40,7 +73,9 @@ Profiler::Profiler()
       cpuTimes(false),
       gpuTimes(true),
       pixelsDrawn(false),
-      memoryUsage(false)
+      memoryUsage(false),
+      binary(false),
+      numCalls(0)
 {
 }
 
@@ -48,12 +83,19 @@ Profiler::~Profiler()
 {
 }
 
-void Profiler::setup(bool cpuTimes_, bool gpuTimes_, bool pixelsDrawn_, bool memoryUsage_)
+void Profiler::setup(bool cpuTimes_, bool gpuTimes_, bool pixelsDrawn_, bool memoryUsage_, bool binary_)
 {
     cpuTimes = cpuTimes_;
     gpuTimes = gpuTimes_;
     pixelsDrawn = pixelsDrawn_;
     memoryUsage = memoryUsage_;
+    binary = binary_;
+
+    if (binary) {
+        std::cout.write(profileMagic, sizeof profileMagic);
+        writeUInt32(profileVersion);
+        return;
+    }
 
     std::cout << "# call no gpu_start gpu_dura cpu_start cpu_dura vsize_start vsize_dura rss_start rss_dura pixels program name" << std::endl;
 }
@@ -140,6 +182,43 @@ void Profiler::addCall(unsigned no,
         rssDuration = 0;
     }
 
+    if (binary) {
+        std::unordered_map<std::string, unsigned>::const_iterator it = nameIndices.find(name);
+        unsigned nameIndex;
+        if (it == nameIndices.end()) {
+            nameIndex = unsigned(nameIndices.size());
+            nameIndices[name] = nameIndex;
+
+            uint32_t length = uint32_t(strlen(name));
+            writeUInt32(PROFILE_RECORD_NAME);
+            writeUInt32(nameIndex);
+            writeUInt32(length);
+            std::cout.write(name, length);
+        } else {
+            nameIndex = it->second;
+        }
+
+        ProfileCallRecord record;
+        record.gpuStart = gpuStart;
+        record.gpuDuration = gpuDuration;
+        record.cpuStart = cpuStart;
+        record.cpuDuration = cpuDuration;
+        record.vsizeStart = vsizeStart;
+        record.vsizeDuration = vsizeDuration;
+        record.rssStart = rssStart;
+        record.rssDuration = rssDuration;
+        record.pixels = pixels;
+        record.no = no;
+        record.program = program;
+        record.name = nameIndex;
+        record.reserved = 0;
+
+        writeUInt32(PROFILE_RECORD_CALL);
+        std::cout.write(reinterpret_cast<const char *>(&record), sizeof record);
+        ++numCalls;
+        return;
+    }
+
     std::cout << "call"
               << " " << no
               << " " << gpuStart
@@ -158,46 +237,40 @@ void Profiler::addCall(unsigned no,
 
 void Profiler::addFrameEnd()
 {
+    if (binary) {
+        writeUInt32(PROFILE_RECORD_FRAME_END);
+        writeUInt32(numCalls);
+        /* Keep the stream live for consumers reading it while we replay */
+        std::cout.flush();
+        return;
+    }
+
     std::cout << "frame_end" << std::endl;
 }
 
-void Profiler::parseLine(const char* in, Profile* profile)
+/* Accumulates calls and frames into a profile, computing frame extents */
+class ProfileBuilder
 {
-    std::stringstream line(in, std::ios_base::in);
-    std::string type;
-    static int64_t lastGpuTime;
-    static int64_t lastCpuTime;
-    static int64_t lastVsizeUsage;
-    static int64_t lastRssUsage;
-
-    if (in[0] == '#' || strlen(in) < 4)
-        return;
+public:
+    int64_t lastGpuTime;
+    int64_t lastCpuTime;
+    int64_t lastVsizeUsage;
+    int64_t lastRssUsage;
+
+    ProfileBuilder() {
+        reset();
+    }
 
-    if (profile->programs.size() == 0 && profile->calls.size() == 0 && profile->frames.size() == 0) {
+    void
+    reset(void) {
         lastGpuTime = 0;
         lastCpuTime = 0;
         lastVsizeUsage = 0;
         lastRssUsage = 0;
     }
 
-    line >> type;
-
-    if (type.compare("call") == 0) {
-        Profile::Call call;
-
-        line >> call.no
-             >> call.gpuStart
-             >> call.gpuDuration
-             >> call.cpuStart
-             >> call.cpuDuration
-             >> call.vsizeStart
-             >> call.vsizeDuration
-             >> call.rssStart
-             >> call.rssDuration
-             >> call.pixels
-             >> call.program
-             >> call.name;
-
+    void
+    addCall(Profile *profile, const Profile::Call &call) {
         if (lastGpuTime < call.gpuStart + call.gpuDuration) {
             lastGpuTime = call.gpuStart + call.gpuDuration;
         }
@@ -229,7 +302,10 @@ void Profiler::parseLine(const char* in, Profile* profile)
             program.rssTotal += call.rssDuration;
             program.calls.push_back((unsigned int)(profile->calls.size() - 1));
         }
-    } else if (type.compare("frame_end") == 0) {
+    }
+
+    void
+    addFrameEnd(Profile *profile) {
         Profile::Frame frame;
         frame.no = unsigned(profile->frames.size());
 
@@ -255,5 +331,350 @@ void Profiler::parseLine(const char* in, Profile* profile)
 
         profile->frames.push_back(frame);
     }
+};
+
+void Profiler::parseLine(const char* in, Profile* profile)
+{
+    std::stringstream line(in, std::ios_base::in);
+    std::string type;
+    static ProfileBuilder builder;
+
+    if (in[0] == '#' || strlen(in) < 4)
+        return;
+
+    if (profile->programs.size() == 0 && profile->calls.size() == 0 && profile->frames.size() == 0) {
+        builder.reset();
+    }
+
+    line >> type;
+
+    if (type.compare("call") == 0) {
+        Profile::Call call;
+        std::string name;
+
+        line >> call.no
+             >> call.gpuStart
+             >> call.gpuDuration
+             >> call.cpuStart
+             >> call.cpuDuration
+             >> call.vsizeStart
+             >> call.vsizeDuration
+             >> call.rssStart
+             >> call.rssDuration
+             >> call.pixels
+             >> call.program
+             >> name;
+
+        call.name = profile->addName(name);
+
+        builder.addCall(profile, call);
+    } else if (type.compare("frame_end") == 0) {
+        builder.addFrameEnd(profile);
+    }
+}
+
+bool Profiler::parseBinary(const void *data, size_t size, Profile* profile)
+{
+    const char *p = static_cast<const char *>(data);
+    const char *end = p + size;
+    uint32_t version;
+    ProfileBuilder builder;
+
+    /* Map stream name indices to profile name indices */
+    std::vector<unsigned> nameMap;
+
+    if (size < sizeof profileMagic + sizeof version ||
+        memcmp(p, profileMagic, sizeof profileMagic) != 0) {
+        std::cerr << "error: not a binary profile\n";
+        return false;
+    }
+    p += sizeof profileMagic;
+
+    memcpy(&version, p, sizeof version);
+    p += sizeof version;
+    if (version != profileVersion) {
+        std::cerr << "error: unsupported binary profile version " << version << "\n";
+        return false;
+    }
+
+    while (p != end) {
+        uint32_t tag;
+        if (end - p < (ptrdiff_t)sizeof tag) {
+            goto truncated;
+        }
+        memcpy(&tag, p, sizeof tag);
+        p += sizeof tag;
+
+        switch (tag) {
+        case PROFILE_RECORD_NAME: {
+            uint32_t header[2];
+            if (end - p < (ptrdiff_t)sizeof header) {
+                goto truncated;
+            }
+            memcpy(header, p, sizeof header);
+            p += sizeof header;
+            uint32_t index = header[0];
+            uint32_t length = header[1];
+            if ((size_t)(end - p) < length) {
+                goto truncated;
+            }
+            if (nameMap.size() <= index) {
+                nameMap.resize(index + 1);
+            }
+            nameMap[index] = profile->addName(std::string(p, length));
+            p += length;
+            break;
+        }
+        case PROFILE_RECORD_CALL: {
+            ProfileCallRecord record;
+            if (end - p < (ptrdiff_t)sizeof record) {
+                goto truncated;
+            }
+            memcpy(&record, p, sizeof record);
+            p += sizeof record;
+            if (record.name >= nameMap.size()) {
+                std::cerr << "error: undefined name in binary profile\n";
+                return false;
+            }
+
+            Profile::Call call;
+            call.no = record.no;
+            call.program = record.program;
+            call.gpuStart = record.gpuStart;
+            call.gpuDuration = record.gpuDuration;
+            call.cpuStart = record.cpuStart;
+            call.cpuDuration = record.cpuDuration;
+            call.vsizeStart = record.vsizeStart;
+            call.vsizeDuration = record.vsizeDuration;
+            call.rssStart = record.rssStart;
+            call.rssDuration = record.rssDuration;
+            call.pixels = record.pixels;
+            call.name = nameMap[record.name];
+
+            builder.addCall(profile, call);
+            break;
+        }
+        case PROFILE_RECORD_FRAME_END: {
+            uint32_t numCalls;
+            if (end - p < (ptrdiff_t)sizeof numCalls) {
+                goto truncated;
+            }
+            memcpy(&numCalls, p, sizeof numCalls);
+            p += sizeof numCalls;
+            if (numCalls != profile->calls.size()) {
+                std::cerr << "error: inconsistent frame in binary profile\n";
+                return false;
+            }
+            builder.addFrameEnd(profile);
+            break;
+        }
+        default:
+            std::cerr << "error: unexpected record " << tag << " in binary profile\n";
+            return false;
+        }
+    }
+
+    return true;
+
+truncated:
+    /* The retrace might have been interrupted; keep what was read */
+    std::cerr << "warning: truncated binary profile\n";
+    return true;
+}
+
+static inline int64_t
+callStart(const Profile::Call &call, bool gpu)
+{
+    return gpu ? call.gpuStart : call.cpuStart;
+}
+
+static inline int64_t
+callDuration(const Profile::Call &call, bool gpu)
+{
+    return gpu ? call.gpuDuration : call.cpuDuration;
+}
+
+static void
+buildTimeline(const Profile &profile, bool gpu, Profile::Timeline &timeline)
+{
+    timeline.busy.resize(timeline.calls.size() + 1);
+    timeline.busy[0] = 0;
+    for (size_t i = 0; i < timeline.calls.size(); ++i) {
+        const Profile::Call &call = profile.calls[timeline.calls[i]];
+        timeline.busy[i + 1] = timeline.busy[i] + callDuration(call, gpu);
+    }
+}
+
+static void
+buildDurationLevels(const Profile &profile, bool gpu,
+                    std::vector< std::vector<Profile::DurationSummary> > &levels)
+{
+    const unsigned fanout = Profile::durationFanout;
+
+    levels.clear();
+
+    size_t count = profile.calls.size() / fanout;
+    if (count == 0) {
+        return;
+    }
+
+    /* The first level summarizes the calls themselves */
+    levels.push_back(std::vector<Profile::DurationSummary>(count));
+    for (size_t i = 0; i < count; ++i) {
+        Profile::DurationSummary &bucket = levels.back()[i];
+        int64_t duration = callDuration(profile.calls[i * fanout], gpu);
+        bucket.min = bucket.max = bucket.sum = duration;
+        for (unsigned j = 1; j < fanout; ++j) {
+            duration = callDuration(profile.calls[i * fanout + j], gpu);
+            bucket.min = std::min(bucket.min, duration);
+            bucket.max = std::max(bucket.max, duration);
+            bucket.sum += duration;
+        }
+    }
+
+    /* Further levels summarize the level below */
+    while ((count = levels.back().size() / fanout) != 0) {
+        levels.push_back(std::vector<Profile::DurationSummary>(count));
+        const std::vector<Profile::DurationSummary> &below = levels[levels.size() - 2];
+        for (size_t i = 0; i < count; ++i) {
+            Profile::DurationSummary &bucket = levels.back()[i];
+            bucket = below[i * fanout];
+            for (unsigned j = 1; j < fanout; ++j) {
+                const Profile::DurationSummary &other = below[i * fanout + j];
+                bucket.min = std::min(bucket.min, other.min);
+                bucket.max = std::max(bucket.max, other.max);
+                bucket.sum += other.sum;
+            }
+        }
+    }
+}
+
+void Profile::summarize(void)
+{
+    buildDurationLevels(*this, false, cpuDurationLevels);
+    buildDurationLevels(*this, true, gpuDurationLevels);
+
+    cpuTimeline.calls.resize(calls.size());
+    gpuTimeline.calls.clear();
+    for (unsigned i = 0; i < calls.size(); ++i) {
+        cpuTimeline.calls[i] = i;
+        if (calls[i].pixels >= 0) {
+            gpuTimeline.calls.push_back(i);
+        }
+    }
+    buildTimeline(*this, false, cpuTimeline);
+    buildTimeline(*this, true, gpuTimeline);
+
+    programCpuTimelines.resize(programs.size());
+    programGpuTimelines.resize(programs.size());
+    for (size_t i = 0; i < programs.size(); ++i) {
+        programCpuTimelines[i].calls = programs[i].calls;
+        programGpuTimelines[i].calls = programs[i].calls;
+        buildTimeline(*this, false, programCpuTimelines[i]);
+        buildTimeline(*this, true, programGpuTimelines[i]);
+    }
+}
+
+Profile::DurationSummary
+Profile::durations(bool gpu, size_t begin, size_t end) const
+{
+    const std::vector< std::vector<DurationSummary> > &levels = gpu ? gpuDurationLevels : cpuDurationLevels;
+
+    DurationSummary result;
+    result.min = INT64_MAX;
+    result.max = INT64_MIN;
+    result.sum = 0;
+
+    end = std::min(end, calls.size());
+    if (begin >= end) {
+        result.min = result.max = 0;
+        return result;
+    }
+
+    /*
+     * Consume unaligned items at both ends of the range, then move up a
+     * level, until the range fits within the coarsest level.
+     */
+    for (size_t level = 0; begin < end; ++level) {
+        bool top = level >= levels.size() ||
+                   end - begin < 2 * durationFanout;
+
+        while (begin < end && (top || begin % durationFanout)) {
+            DurationSummary item;
+            if (level == 0) {
+                item.min = item.max = item.sum = callDuration(calls[begin], gpu);
+            } else {
+                item = levels[level - 1][begin];
+            }
+            result.min = std::min(result.min, item.min);
+            result.max = std::max(result.max, item.max);
+            result.sum += item.sum;
+            ++begin;
+        }
+
+        while (begin < end && end % durationFanout) {
+            --end;
+            DurationSummary item;
+            if (level == 0) {
+                item.min = item.max = item.sum = callDuration(calls[end], gpu);
+            } else {
+                item = levels[level - 1][end];
+            }
+            result.min = std::min(result.min, item.min);
+            result.max = std::max(result.max, item.max);
+            result.sum += item.sum;
+        }
+
+        begin /= durationFanout;
+        end /= durationFanout;
+    }
+
+    return result;
+}
+
+size_t
+Profile::findTimelineCall(const Timeline &timeline, bool gpu, int64_t time) const
+{
+    /* Calls of a timeline don't overlap, so their end times are ordered too */
+    std::vector<unsigned>::const_iterator it =
+        std::upper_bound(timeline.calls.begin(), timeline.calls.end(), time,
+                         [this, gpu] (int64_t t, unsigned index) {
+                             const Call &call = calls[index];
+                             return t < callStart(call, gpu) + callDuration(call, gpu);
+                         });
+    return it - timeline.calls.begin();
+}
+
+int64_t
+Profile::busyTime(const Timeline &timeline, bool gpu, int64_t start, int64_t end) const
+{
+    if (start >= end || timeline.calls.empty()) {
+        return 0;
+    }
+
+    /* Busy time in [-inf, time) */
+    struct Cumulative {
+        const Profile &profile;
+        const Timeline &timeline;
+        bool gpu;
+
+        int64_t operator () (int64_t time) const {
+            /* Number of calls starting before time */
+            std::vector<unsigned>::const_iterator it =
+                std::lower_bound(timeline.calls.begin(), timeline.calls.end(), time,
+                                 [this] (unsigned index, int64_t t) {
+                                     return callStart(profile.calls[index], gpu) < t;
+                                 });
+            size_t count = it - timeline.calls.begin();
+            if (count == 0) {
+                return 0;
+            }
+            const Call &last = profile.calls[timeline.calls[count - 1]];
+            int64_t partial = std::min(callDuration(last, gpu), time - callStart(last, gpu));
+            return timeline.busy[count - 1] + std::max<int64_t>(partial, 0);
+        }
+    } cumulative = {*this, timeline, gpu};
+
+    return cumulative(end) - cumulative(start);
 }
 }
@@ -26,7 +26,9 @@
 
 #pragma once
 
+#include <map>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <stdint.h>
 
@@ -52,7 +54,8 @@ struct Profile {
 
         int64_t pixels;
 
-        std::string name;
+        /* Index to profile->names array */
+        unsigned name;
     };
 
     struct Frame {
@@ -92,6 +95,71 @@ struct Profile {
     std::vector<Call> calls;
     std::vector<Frame> frames;
     std::vector<Program> programs;
+
+    /* Call names, shared by all calls with the same name */
+    std::vector<std::string> names;
+    std::map<std::string, unsigned> nameIndices;
+
+    unsigned
+    addName(const std::string &name) {
+        std::map<std::string, unsigned>::const_iterator it = nameIndices.find(name);
+        if (it != nameIndices.end()) {
+            return it->second;
+        }
+        unsigned index = unsigned(names.size());
+        names.push_back(name);
+        nameIndices[name] = index;
+        return index;
+    }
+
+    const std::string &
+    getName(const Call &call) const {
+        return names[call.name];
+    }
+
+    /*
+     * Summaries used to draw zoomed out views without visiting every call,
+     * built by summarize() once all calls were added.
+     */
+
+    struct DurationSummary {
+        int64_t min;
+        int64_t max;
+        int64_t sum;
+    };
+
+    /* Calls of one timeline in time order, with their running busy time */
+    struct Timeline {
+        std::vector<unsigned> calls;
+
+        /* busy[i] is the total duration of calls[0, i) */
+        std::vector<int64_t> busy;
+    };
+
+    /* Each level of durations covers durationFanout times more calls */
+    static const unsigned durationFanout = 16;
+    std::vector< std::vector<DurationSummary> > cpuDurationLevels;
+    std::vector< std::vector<DurationSummary> > gpuDurationLevels;
+
+    Timeline cpuTimeline;
+    Timeline gpuTimeline;
+    std::vector<Timeline> programCpuTimelines;
+    std::vector<Timeline> programGpuTimelines;
+
+    void
+    summarize(void);
+
+    /* Min, max, and sum of the CPU or GPU durations of calls [begin, end) */
+    DurationSummary
+    durations(bool gpu, size_t begin, size_t end) const;
+
+    /* Position in timeline of the first call ending after time */
+    size_t
+    findTimelineCall(const Timeline &timeline, bool gpu, int64_t time) const;
+
+    /* Time spent in the timeline calls within [start, end) */
+    int64_t
+    busyTime(const Timeline &timeline, bool gpu, int64_t start, int64_t end) const;
 };
 
 class Profiler
@@ -100,7 +168,7 @@ public:
     Profiler();
     ~Profiler();
 
-    void setup(bool cpuTimes_, bool gpuTimes_, bool pixelsDrawn_, bool memoryUsage_);
+    void setup(bool cpuTimes_, bool gpuTimes_, bool pixelsDrawn_, bool memoryUsage_, bool binary_ = false);
 
     void addCall(unsigned no,
                  const char* name,
@@ -127,6 +195,22 @@ public:
 
     static void parseLine(const char* line, Profile* profile);
 
+    /**
+     * Parse a whole binary profile, as written when setup() is called with
+     * binary_ set.
+     *
+     * The binary format starts with the 8 byte magic "APIPROF\0" and a uint32
+     * version, followed by records, each introduced by a uint32 tag:
+     * - name: uint32 index, uint32 length, and the name characters; emitted
+     *   the first time a call name is seen;
+     * - call: a fixed-size record with the same fields as Profile::Call, the
+     *   name being an index into the previously emitted names;
+     * - frame end: uint32 number of call records written so far.
+     *
+     * All integers are in host byte order.
+     */
+    static bool parseBinary(const void *data, size_t size, Profile* profile);
+
 private:
     int64_t baseGpuTime;
     int64_t baseCpuTime;
@@ -138,6 +222,10 @@ private:
     bool gpuTimes;
     bool pixelsDrawn;
     bool memoryUsage;
+    bool binary;
+
+    unsigned numCalls;
+    std::unordered_map<std::string, unsigned> nameIndices;
 };
 }
 
@@ -0,0 +1,218 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+#include <string.h>
+
+#include <algorithm>
+#include <sstream>
+#include <iostream>
+
+#include "trace_profiler.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace trace;
+
+
+/* Run the profiler with std::cout redirected, and return what it wrote */
+static std::string
+writeProfile(bool binary)
+{
+    std::ostringstream output;
+    std::streambuf *saved = std::cout.rdbuf(output.rdbuf());
+
+    Profiler profiler;
+    profiler.setup(true, true, false, false, binary);
+    profiler.addCall(1, "glDrawArrays", 3, 0, 100, 10, 2000, 5000, 0, 0, 0, 0);
+    profiler.addCall(2, "glDrawElements", 3, 0, 110, 20, 8000, 3000, 0, 0, 0, 0);
+    profiler.addFrameEnd();
+    profiler.addCall(4, "glDrawArrays", 1, 0, 200, 30, 12000, 4000, 0, 0, 0, 0);
+    profiler.addFrameEnd();
+
+    std::cout.rdbuf(saved);
+    return output.str();
+}
+
+
+static void
+checkProfile(const Profile &profile)
+{
+    ASSERT_EQ(3, profile.calls.size());
+    EXPECT_EQ(2, profile.names.size());
+
+    EXPECT_EQ(1, profile.calls[0].no);
+    EXPECT_EQ(100, profile.calls[0].gpuStart);
+    EXPECT_EQ(5000, profile.calls[0].cpuDuration);
+    EXPECT_EQ("glDrawArrays", profile.getName(profile.calls[0]));
+    EXPECT_EQ("glDrawElements", profile.getName(profile.calls[1]));
+    EXPECT_EQ(profile.calls[0].name, profile.calls[2].name);
+
+    ASSERT_EQ(2, profile.frames.size());
+    EXPECT_EQ(0, profile.frames[0].calls.begin);
+    EXPECT_EQ(1, profile.frames[0].calls.end);
+    EXPECT_EQ(2, profile.frames[1].calls.begin);
+    EXPECT_EQ(2, profile.frames[1].calls.end);
+    EXPECT_EQ(130, profile.frames[0].gpuDuration);
+
+    ASSERT_EQ(4, profile.programs.size());
+    EXPECT_EQ(2, profile.programs[3].calls.size());
+    EXPECT_EQ(30, profile.programs[3].gpuTotal);
+}
+
+
+TEST(trace_profiler, text)
+{
+    std::istringstream lines(writeProfile(false));
+    Profile profile;
+    std::string line;
+    while (std::getline(lines, line)) {
+        Profiler::parseLine(line.c_str(), &profile);
+    }
+    checkProfile(profile);
+}
+
+
+TEST(trace_profiler, binary)
+{
+    std::string data = writeProfile(true);
+    Profile profile;
+    ASSERT_TRUE(Profiler::parseBinary(data.data(), data.size(), &profile));
+    checkProfile(profile);
+}
+
+
+TEST(trace_profiler, binary_truncated)
+{
+    std::string data = writeProfile(true);
+    Profile profile;
+    ASSERT_TRUE(Profiler::parseBinary(data.data(), data.size() - 6, &profile));
+    EXPECT_EQ(3, profile.calls.size());
+    EXPECT_EQ(1, profile.frames.size());
+
+    Profile invalid;
+    EXPECT_FALSE(Profiler::parseBinary("garbage", 7, &invalid));
+}
+
+
+/* Back to back calls with varying gaps and durations */
+static void
+fillProfile(Profile &profile, unsigned count)
+{
+    int64_t time = 0;
+    profile.programs.resize(3);
+    for (unsigned i = 0; i < count; ++i) {
+        Profile::Call call;
+        memset(&call, 0, sizeof call);
+        call.no = i;
+        call.program = i % 3;
+        call.cpuStart = time + (i * 7) % 5;
+        call.cpuDuration = 1 + (i * 13) % 29;
+        call.gpuStart = call.cpuStart;
+        call.gpuDuration = (i * 17) % 11;
+        call.pixels = i % 4 == 0 ? -1 : 0;
+        time = call.cpuStart + call.cpuDuration;
+        profile.calls.push_back(call);
+        if (call.pixels >= 0) {
+            profile.programs[call.program].calls.push_back(i);
+        }
+    }
+    profile.summarize();
+}
+
+
+TEST(trace_profiler, durations)
+{
+    Profile profile;
+    fillProfile(profile, 5000);
+
+    static const size_t ranges[][2] = {
+        {0, 5000}, {0, 1}, {3, 17}, {15, 33}, {16, 256}, {1, 4999}, {255, 4097}, {100, 100},
+    };
+
+    for (unsigned i = 0; i < sizeof ranges / sizeof ranges[0]; ++i) {
+        size_t begin = ranges[i][0];
+        size_t end = ranges[i][1];
+        for (int gpu = 0; gpu < 2; ++gpu) {
+            int64_t min = 0, max = 0, sum = 0;
+            for (size_t j = begin; j < end; ++j) {
+                int64_t duration = gpu ? profile.calls[j].gpuDuration : profile.calls[j].cpuDuration;
+                min = j == begin ? duration : std::min(min, duration);
+                max = j == begin ? duration : std::max(max, duration);
+                sum += duration;
+            }
+            Profile::DurationSummary summary = profile.durations(gpu, begin, end);
+            EXPECT_EQ(min, summary.min) << begin << ", " << end;
+            EXPECT_EQ(max, summary.max) << begin << ", " << end;
+            EXPECT_EQ(sum, summary.sum) << begin << ", " << end;
+        }
+    }
+}
+
+
+TEST(trace_profiler, busy_time)
+{
+    Profile profile;
+    fillProfile(profile, 1000);
+
+    static const int64_t ranges[][2] = {
+        {-10, 0}, {0, 1}, {3, 40}, {0, 100000}, {1234, 5678}, {999, 1000},
+    };
+
+    for (unsigned i = 0; i < sizeof ranges / sizeof ranges[0]; ++i) {
+        int64_t start = ranges[i][0];
+        int64_t end = ranges[i][1];
+
+        int64_t cpuBusy = 0, programBusy = 0;
+        for (size_t j = 0; j < profile.calls.size(); ++j) {
+            const Profile::Call &call = profile.calls[j];
+            int64_t overlap = std::min(end, call.cpuStart + call.cpuDuration) - std::max(start, call.cpuStart);
+            if (overlap > 0) {
+                cpuBusy += overlap;
+                if (call.pixels >= 0 && call.program == 1) {
+                    programBusy += overlap;
+                }
+            }
+        }
+
+        EXPECT_EQ(cpuBusy, profile.busyTime(profile.cpuTimeline, false, start, end)) << start << ", " << end;
+        EXPECT_EQ(programBusy, profile.busyTime(profile.programCpuTimelines[1], false, start, end)) << start << ", " << end;
+    }
+
+    size_t pos = profile.findTimelineCall(profile.cpuTimeline, false, 100);
+    ASSERT_LT(pos, profile.calls.size());
+    EXPECT_GT(profile.calls[pos].cpuStart + profile.calls[pos].cpuDuration, 100);
+    if (pos > 0) {
+        EXPECT_LE(profile.calls[pos - 1].cpuStart + profile.calls[pos - 1].cpuDuration, 100);
+    }
+}
+
+
+int
+main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,461 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <iostream>
+#include <new>
+
+#if !defined(_WIN32) && !defined(__ANDROID__)
+#define HAVE_SHM 1
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "os.hpp"
+#include "os_process.hpp"
+#include "os_time.hpp"
+#include "trace_shm.hpp"
+
+
+#define SHM_MAGIC 0x6b6e6973 // "sink"
+#define SHM_VERSION 1
+
+// Smallest and largest ring sizes
+#define SHM_MIN_SIZE (64 * 1024)
+#define SHM_MAX_SIZE (1U << 30)
+
+// How often the producer publishes its write position
+#define SHM_PUBLISH_SIZE (16 * 1024)
+
+// How long the sink sleeps when the ring is empty, in microseconds
+#define SHM_POLL_INTERVAL 1000
+
+
+namespace trace {
+
+
+/*
+ * Ring positions are free running 32 bit counters, which wrap around
+ * harmlessly as the ring size is a power of two no larger than 2^30.
+ */
+struct ShmHeader
+{
+    std::atomic<uint32_t> magic;
+    uint32_t version;
+    uint32_t size;
+    int32_t sinkPid;
+    std::atomic<int32_t> producerPid;
+    std::atomic<uint32_t> closed;
+
+    // Keep the positions on their own cache lines
+    alignas(64) std::atomic<uint32_t> head; // written by the producer
+    alignas(64) std::atomic<uint32_t> tail; // written by the sink
+
+    unsigned char *
+    data(void) {
+        return reinterpret_cast<unsigned char *>(this + 1);
+    }
+};
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "atomics must be lock free to be shared between processes");
+static_assert(sizeof(ShmHeader) % 64 == 0, "ring data must be aligned");
+
+
+#ifdef HAVE_SHM
+
+static std::string
+segmentName(const char *name)
+{
+    std::string s;
+    if (name[0] != '/') {
+        s = "/";
+    }
+    return s + name;
+}
+
+
+static bool
+isProcessAlive(pid_t pid)
+{
+    return kill(pid, 0) == 0 || errno != ESRCH;
+}
+
+
+class ShmOutStream : public OutStream {
+public:
+    ShmOutStream(ShmHeader *header, size_t mappingSize);
+    ~ShmOutStream();
+
+    bool write(const void *buffer, size_t length) override;
+    void flush(void) override;
+
+private:
+    ShmHeader *m_header;
+    size_t m_mappingSize;
+    unsigned char *m_data;
+    uint32_t m_size;
+
+    uint32_t m_head;
+    uint32_t m_published;
+    uint32_t m_tail; // last read position seen
+    bool m_broken;
+
+    // Process which attached to the sink.  Forked children inherit the
+    // stream, and destroying or flushing it there must not publish their
+    // stale position, nor close the sink under the parent's feet.
+    int32_t m_pid;
+
+    inline bool isOwner(void) const {
+        return os::getCurrentProcessId() == m_pid;
+    }
+
+    inline void publish(void) {
+        m_header->head.store(m_head, std::memory_order_release);
+        m_published = m_head;
+    }
+
+    bool waitForSpace(void);
+};
+
+
+ShmOutStream::ShmOutStream(ShmHeader *header, size_t mappingSize)
+    : m_header(header),
+      m_mappingSize(mappingSize),
+      m_data(header->data()),
+      m_size(header->size),
+      m_head(header->head.load(std::memory_order_relaxed)),
+      m_published(m_head),
+      m_tail(header->tail.load(std::memory_order_acquire)),
+      m_broken(false),
+      m_pid(header->producerPid.load(std::memory_order_relaxed))
+{
+}
+
+
+ShmOutStream::~ShmOutStream()
+{
+    if (isOwner()) {
+        publish();
+        m_header->closed.store(1, std::memory_order_release);
+    }
+    munmap(m_header, m_mappingSize);
+}
+
+
+bool ShmOutStream::waitForSpace(void)
+{
+    if (!isOwner()) {
+        m_broken = true;
+        return false;
+    }
+
+    publish();
+
+    unsigned retries = 0;
+    for (;;) {
+        m_tail = m_header->tail.load(std::memory_order_acquire);
+        if (m_head - m_tail < m_size) {
+            return true;
+        }
+
+        os::sleep(SHM_POLL_INTERVAL / 10);
+
+        if (++retries % 1000 == 0 &&
+            !isProcessAlive(m_header->sinkPid)) {
+            os::log("apitrace: error: trace sink went away\n");
+            m_broken = true;
+            return false;
+        }
+    }
+}
+
+
+bool ShmOutStream::write(const void *buffer, size_t length)
+{
+    const unsigned char *src = static_cast<const unsigned char *>(buffer);
+
+    while (length) {
+        if (m_broken) {
+            return false;
+        }
+
+        uint32_t available = m_size - (m_head - m_tail);
+        if (!available) {
+            if (!waitForSpace()) {
+                return false;
+            }
+            continue;
+        }
+
+        uint32_t offset = m_head & (m_size - 1);
+        size_t count = length;
+        if (count > available) {
+            count = available;
+        }
+        if (count > m_size - offset) {
+            count = m_size - offset;
+        }
+
+        memcpy(m_data + offset, src, count);
+        m_head += count;
+        src += count;
+        length -= count;
+    }
+
+    if (m_head - m_published >= SHM_PUBLISH_SIZE) {
+        if (!isOwner()) {
+            m_broken = true;
+            return false;
+        }
+        publish();
+    }
+
+    return true;
+}
+
+
+void ShmOutStream::flush(void)
+{
+    if (isOwner()) {
+        publish();
+    }
+}
+
+
+OutStream *
+createShmStream(const char *name)
+{
+    std::string path = segmentName(name);
+
+    int fd = shm_open(path.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        os::log("apitrace: error: could not open trace sink %s: %s\n", name, strerror(errno));
+        return nullptr;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 ||
+        (size_t)st.st_size < sizeof(ShmHeader) + SHM_MIN_SIZE) {
+        os::log("apitrace: error: %s is not a trace sink\n", name);
+        close(fd);
+        return nullptr;
+    }
+
+    size_t mappingSize = st.st_size;
+    void *mapping = mmap(NULL, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        os::log("apitrace: error: could not map trace sink %s: %s\n", name, strerror(errno));
+        return nullptr;
+    }
+
+    ShmHeader *header = static_cast<ShmHeader *>(mapping);
+    if (header->magic.load(std::memory_order_acquire) != SHM_MAGIC ||
+        header->version != SHM_VERSION ||
+        sizeof(ShmHeader) + header->size != mappingSize) {
+        os::log("apitrace: error: %s is not a trace sink\n", name);
+        munmap(mapping, mappingSize);
+        return nullptr;
+    }
+
+    int32_t producerPid = 0;
+    if (!header->producerPid.compare_exchange_strong(producerPid, os::getCurrentProcessId())) {
+        os::log("apitrace: error: trace sink %s is already in use by process %d\n", name, producerPid);
+        munmap(mapping, mappingSize);
+        return nullptr;
+    }
+
+    return new ShmOutStream(header, mappingSize);
+}
+
+
+ShmSink::~ShmSink()
+{
+    unlink();
+    if (header) {
+        munmap(header, mappingSize);
+    }
+}
+
+
+void
+ShmSink::unlink(void)
+{
+    if (linked) {
+        shm_unlink(name.c_str());
+        linked = false;
+    }
+}
+
+
+bool
+ShmSink::create(const char *name, size_t size)
+{
+    assert(!header);
+
+    this->name = segmentName(name);
+
+    uint32_t ringSize = SHM_MIN_SIZE;
+    while (ringSize < size && ringSize < SHM_MAX_SIZE) {
+        ringSize <<= 1;
+    }
+
+    int fd = shm_open(this->name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        std::cerr << "error: failed to create " << this->name << ": " << strerror(errno) << "\n";
+        return false;
+    }
+    linked = true;
+
+    mappingSize = sizeof(ShmHeader) + ringSize;
+    void *mapping = MAP_FAILED;
+    if (ftruncate(fd, mappingSize) == 0) {
+        mapping = mmap(NULL, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    int error = errno;
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        std::cerr << "error: failed to map " << this->name << ": " << strerror(error) << "\n";
+        unlink();
+        return false;
+    }
+
+    // The segment is zero filled, so only non-zero fields need setting
+    header = new (mapping) ShmHeader;
+    header->version = SHM_VERSION;
+    header->size = ringSize;
+    header->sinkPid = os::getCurrentProcessId();
+    header->magic.store(SHM_MAGIC, std::memory_order_release);
+
+    return true;
+}
+
+
+bool
+ShmSink::run(OutStream *out, const std::atomic<bool> &stop)
+{
+    assert(header);
+
+    unsigned char *data = header->data();
+    uint32_t size = header->size;
+    uint32_t tail = header->tail.load(std::memory_order_relaxed);
+    bool attached = false;
+
+    for (;;) {
+        uint32_t head = header->head.load(std::memory_order_acquire);
+        if (head != tail) {
+            uint32_t used = head - tail;
+            uint32_t offset = tail & (size - 1);
+            uint32_t count = std::min(used, size - offset);
+            out->write(data + offset, count);
+            if (used > count) {
+                out->write(data, used - count);
+            }
+            tail = head;
+            header->tail.store(tail, std::memory_order_release);
+            bytes += used;
+            continue;
+        }
+
+        int32_t producerPid = header->producerPid.load(std::memory_order_acquire);
+        if (producerPid && !attached) {
+            // Nobody else can attach now, so there is no need for the name
+            attached = true;
+            unlink();
+        }
+
+        bool done;
+        if (attached) {
+            done = header->closed.load(std::memory_order_acquire) ||
+                   !isProcessAlive(producerPid);
+        } else {
+            done = stop.load();
+        }
+
+        if (done) {
+            // Pick up whatever was published before the producer went away
+            if (header->head.load(std::memory_order_acquire) == tail) {
+                break;
+            }
+            continue;
+        }
+
+        os::sleep(SHM_POLL_INTERVAL);
+    }
+
+    return attached;
+}
+
+
+#else /* !HAVE_SHM */
+
+
+OutStream *
+createShmStream(const char *name)
+{
+    os::log("apitrace: error: trace sinks are not supported on this platform\n");
+    return nullptr;
+}
+
+
+ShmSink::~ShmSink()
+{
+}
+
+
+void
+ShmSink::unlink(void)
+{
+}
+
+
+bool
+ShmSink::create(const char *name, size_t size)
+{
+    std::cerr << "error: trace sinks are not supported on this platform\n";
+    return false;
+}
+
+
+bool
+ShmSink::run(OutStream *out, const std::atomic<bool> &stop)
+{
+    return false;
+}
+
+
+#endif /* !HAVE_SHM */
+
+
+} /* namespace trace */
@@ -0,0 +1,101 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Out-of-process trace writing through a shared memory ring buffer.
+ *
+ * The sink (`apitrace sink`, or `apitrace trace --sink`) creates a named
+ * shared memory segment holding a single-producer single-consumer ring
+ * buffer.  The traced process, given the segment name in the TRACE_SINK
+ * environment variable, attaches to it with createShmStream() and copies the
+ * serialized calls into the ring, leaving compression and file I/O to the
+ * sink process.
+ *
+ * Only one process may attach to a segment.  Any other process, such as a
+ * forked child, falls back to writing a trace file of its own.
+ *
+ * The producer publishes what it wrote every few KB, and whenever the writer
+ * is flushed, which includes the exception handler.  The sink polls the ring,
+ * and finalizes the trace when the producer closes the stream or when the
+ * producer process is gone, so traces of crashing applications still end
+ * with every call that was published.
+ */
+
+#pragma once
+
+
+#include <stddef.h>
+
+#include <atomic>
+#include <string>
+
+#include "trace_ostream.hpp"
+
+
+namespace trace {
+
+
+#define TRACE_SINK_DEFAULT_SIZE (32 * 1024 * 1024)
+
+
+struct ShmHeader;
+
+
+class ShmSink
+{
+protected:
+    std::string name;
+    ShmHeader *header = nullptr;
+    size_t mappingSize = 0;
+    bool linked = false;
+    unsigned long long bytes = 0;
+
+    void unlink(void);
+
+public:
+    ~ShmSink();
+
+    /* Create the named segment, with a ring of at least the given size. */
+    bool
+    create(const char *name, size_t size = TRACE_SINK_DEFAULT_SIZE);
+
+    /*
+     * Copy everything the producer writes into the given stream, until the
+     * producer closes it or dies.  If stop is set, return as soon as no
+     * producer is attached or alive.  Returns false if no producer ever
+     * attached.
+     */
+    bool
+    run(OutStream *out, const std::atomic<bool> &stop);
+
+    /* Number of bytes received so far. */
+    unsigned long long
+    getBytes(void) const {
+        return bytes;
+    }
+};
+
+
+} /* namespace trace */
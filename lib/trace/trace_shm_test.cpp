@@ -0,0 +1,231 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <thread>
+
+#include "os_process.hpp"
+#include "os_string.hpp"
+#include "os_time.hpp"
+#include "trace_ostream.hpp"
+#include "trace_shm.hpp"
+
+#include "gtest/gtest.h"
+
+
+#if !defined(_WIN32) && !defined(__ANDROID__)
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+class StringOutStream : public trace::OutStream {
+public:
+    std::string data;
+
+    bool write(const void *buffer, size_t length) override {
+        data.append(static_cast<const char *>(buffer), length);
+        return true;
+    }
+
+    void flush(void) override {}
+};
+
+
+static os::String
+sinkName(const char *test)
+{
+    return os::String::format("apitrace-%s-%u", test, (unsigned)os::getCurrentProcessId());
+}
+
+
+static std::string
+pattern(size_t size)
+{
+    std::string s(size, 0);
+    for (size_t i = 0; i < size; ++i) {
+        s[i] = (char)(i * 2654435761U >> 13);
+    }
+    return s;
+}
+
+
+TEST(trace_shm, roundtrip)
+{
+    os::String name = sinkName("roundtrip");
+    trace::ShmSink sink;
+    ASSERT_TRUE(sink.create(name, 64 * 1024));
+
+    StringOutStream out;
+    std::atomic<bool> stop(false);
+    bool attached = false;
+    std::thread thread([&] { attached = sink.run(&out, stop); });
+
+    trace::OutStream *stream = trace::createShmStream(name);
+    ASSERT_TRUE(stream != nullptr);
+
+    // Only one producer may attach
+    EXPECT_EQ(nullptr, trace::createShmStream(name));
+
+    // Write several times the ring size, in chunks of varying size
+    std::string expected = pattern(1024 * 1024 + 17);
+    size_t offset = 0;
+    for (size_t length = 1; offset < expected.size(); length = length * 3 % 100003) {
+        length = std::min(length, expected.size() - offset);
+        EXPECT_TRUE(stream->write(expected.data() + offset, length));
+        offset += length;
+    }
+    delete stream;
+
+    thread.join();
+    EXPECT_TRUE(attached);
+    EXPECT_EQ(expected.size(), sink.getBytes());
+    EXPECT_TRUE(expected == out.data);
+}
+
+
+TEST(trace_shm, crash)
+{
+    os::String name = sinkName("crash");
+    trace::ShmSink sink;
+    ASSERT_TRUE(sink.create(name, 64 * 1024));
+
+    std::string expected = pattern(100 * 1024);
+
+    pid_t pid = fork();
+    ASSERT_NE(-1, pid);
+    if (pid == 0) {
+        // Die without closing the stream, as a crashing process would, after
+        // flushing like the exception handler does
+        trace::OutStream *stream = trace::createShmStream(name);
+        if (stream) {
+            stream->write(expected.data(), expected.size());
+            stream->flush();
+            stream->write("lost", 4);
+        }
+        _exit(stream ? 0 : 1);
+    }
+
+    // The sink can only tell a process is gone once it was reaped
+    int status = -1;
+    std::thread reaper([&] { waitpid(pid, &status, 0); });
+
+    StringOutStream out;
+    std::atomic<bool> stop(false);
+    EXPECT_TRUE(sink.run(&out, stop));
+
+    reaper.join();
+    EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    EXPECT_TRUE(expected == out.data);
+}
+
+
+TEST(trace_shm, fork)
+{
+    os::String name = sinkName("fork");
+    trace::ShmSink sink;
+    // Large enough to never block, should the sink wrongly finish early
+    ASSERT_TRUE(sink.create(name, 256 * 1024));
+
+    StringOutStream out;
+    std::atomic<bool> stop(false);
+    bool attached = false;
+    std::thread thread([&] { attached = sink.run(&out, stop); });
+
+    trace::OutStream *stream = trace::createShmStream(name);
+    ASSERT_TRUE(stream != nullptr);
+
+    std::string expected = pattern(150 * 1024);
+    size_t third = expected.size() / 3;
+    EXPECT_TRUE(stream->write(expected.data(), third));
+    stream->flush();
+
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+
+    pid_t pid = fork();
+    ASSERT_NE(-1, pid);
+    if (pid == 0) {
+        // Once the parent moved on, destroy the inherited stream, which must
+        // neither move the published position back nor close the sink
+        char c;
+        bool ok = read(fds[0], &c, 1) == 1;
+        stream->flush();
+        delete stream;
+        _exit(ok ? 0 : 1);
+    }
+
+    EXPECT_TRUE(stream->write(expected.data() + third, third));
+    stream->flush();
+    os::sleep(20000);
+
+    EXPECT_EQ(1, write(fds[1], "x", 1));
+    int status = -1;
+    waitpid(pid, &status, 0);
+    EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    close(fds[0]);
+    close(fds[1]);
+    os::sleep(20000);
+
+    EXPECT_TRUE(stream->write(expected.data() + 2 * third, expected.size() - 2 * third));
+    delete stream;
+
+    thread.join();
+    EXPECT_TRUE(attached);
+    EXPECT_TRUE(expected == out.data);
+}
+
+
+TEST(trace_shm, stop)
+{
+    os::String name = sinkName("stop");
+    trace::ShmSink sink;
+    ASSERT_TRUE(sink.create(name));
+
+    StringOutStream out;
+    std::atomic<bool> stop(true);
+    EXPECT_FALSE(sink.run(&out, stop));
+    EXPECT_EQ(0U, out.data.size());
+}
+
+
+TEST(trace_shm, missing)
+{
+    EXPECT_EQ(nullptr, trace::createShmStream(sinkName("missing")));
+}
+
+#endif
+
+
+int
+main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
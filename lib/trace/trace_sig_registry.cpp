@@ -0,0 +1,297 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "os_thread.hpp"
+#include "trace_parser.hpp"
+#include "trace_sig_registry.hpp"
+
+
+namespace trace {
+
+
+namespace {
+
+
+inline void
+hashCombine(size_t &seed, uint64_t value)
+{
+    seed ^= std::hash<uint64_t>()(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+
+/*
+ * Signature strings are interned before the signatures themselves, so they
+ * can be hashed and compared by address.
+ */
+inline void
+hashCombine(size_t &seed, const char *str)
+{
+    hashCombine(seed, (uint64_t)(uintptr_t)str);
+}
+
+
+size_t
+hashSig(const FunctionSig &sig)
+{
+    size_t seed = sig.id;
+    hashCombine(seed, sig.name);
+    for (unsigned i = 0; i < sig.num_args; ++i) {
+        hashCombine(seed, sig.arg_names[i]);
+    }
+    return seed;
+}
+
+
+size_t
+hashSig(const StructSig &sig)
+{
+    size_t seed = sig.id;
+    hashCombine(seed, sig.name);
+    for (unsigned i = 0; i < sig.num_members; ++i) {
+        hashCombine(seed, sig.member_names[i]);
+    }
+    return seed;
+}
+
+
+size_t
+hashSig(const EnumSig &sig)
+{
+    size_t seed = sig.id;
+    for (unsigned i = 0; i < sig.num_values; ++i) {
+        hashCombine(seed, sig.values[i].name);
+        hashCombine(seed, (uint64_t)sig.values[i].value);
+    }
+    return seed;
+}
+
+
+size_t
+hashSig(const BitmaskSig &sig)
+{
+    size_t seed = sig.id;
+    for (unsigned i = 0; i < sig.num_flags; ++i) {
+        hashCombine(seed, sig.flags[i].name);
+        hashCombine(seed, sig.flags[i].value);
+    }
+    return seed;
+}
+
+
+bool
+equalSig(const FunctionSig &a, const FunctionSig &b)
+{
+    return a.id == b.id &&
+           a.name == b.name &&
+           a.num_args == b.num_args &&
+           std::equal(a.arg_names, a.arg_names + a.num_args, b.arg_names);
+}
+
+
+bool
+equalSig(const StructSig &a, const StructSig &b)
+{
+    return a.id == b.id &&
+           a.name == b.name &&
+           a.num_members == b.num_members &&
+           std::equal(a.member_names, a.member_names + a.num_members, b.member_names);
+}
+
+
+bool
+equalSig(const EnumSig &a, const EnumSig &b)
+{
+    if (a.id != b.id || a.num_values != b.num_values) {
+        return false;
+    }
+    for (unsigned i = 0; i < a.num_values; ++i) {
+        if (a.values[i].name != b.values[i].name ||
+            a.values[i].value != b.values[i].value) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+bool
+equalSig(const BitmaskSig &a, const BitmaskSig &b)
+{
+    if (a.id != b.id || a.num_flags != b.num_flags) {
+        return false;
+    }
+    for (unsigned i = 0; i < a.num_flags; ++i) {
+        if (a.flags[i].name != b.flags[i].name ||
+            a.flags[i].value != b.flags[i].value) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+template< class T >
+T *
+copyArray(const T *array, unsigned count)
+{
+    T *copy = new T[count];
+    std::copy(array, array + count, copy);
+    return copy;
+}
+
+
+struct Registry
+{
+    os::mutex mutex;
+
+    // Node based, so the strings never move
+    std::unordered_set<std::string> strings;
+
+    std::unordered_multimap<size_t, const FunctionSigFlags *> functions;
+    std::unordered_multimap<size_t, const StructSig *> structs;
+    std::unordered_multimap<size_t, const EnumSig *> enums;
+    std::unordered_multimap<size_t, const BitmaskSig *> bitmasks;
+};
+
+
+Registry &
+registry(void)
+{
+    // Never destroyed, as signatures may still be referred to by calls or
+    // parsers destroyed at exit.
+    static Registry *registry = new Registry;
+    return *registry;
+}
+
+
+template< class Sig, class Interned >
+const Interned *
+findSig(const std::unordered_multimap<size_t, const Interned *> &map,
+        size_t hash, const Sig &sig)
+{
+    auto range = map.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (equalSig(*it->second, sig)) {
+            return it->second;
+        }
+    }
+    return nullptr;
+}
+
+
+} /* anonymous namespace */
+
+
+const char *
+internString(const std::string &str)
+{
+    Registry &r = registry();
+    os::unique_lock<os::mutex> lock(r.mutex);
+    return r.strings.insert(str).first->c_str();
+}
+
+
+const FunctionSigFlags *
+internSig(const FunctionSig &sig)
+{
+    size_t hash = hashSig(sig);
+    Registry &r = registry();
+    os::unique_lock<os::mutex> lock(r.mutex);
+
+    const FunctionSigFlags *interned = findSig(r.functions, hash, sig);
+    if (!interned) {
+        FunctionSigFlags *copy = new FunctionSigFlags;
+        static_cast<FunctionSig &>(*copy) = sig;
+        copy->arg_names = copyArray(sig.arg_names, sig.num_args);
+        copy->flags = Parser::lookupCallFlags(sig.name);
+        r.functions.emplace(hash, copy);
+        interned = copy;
+    }
+    return interned;
+}
+
+
+const StructSig *
+internSig(const StructSig &sig)
+{
+    size_t hash = hashSig(sig);
+    Registry &r = registry();
+    os::unique_lock<os::mutex> lock(r.mutex);
+
+    const StructSig *interned = findSig(r.structs, hash, sig);
+    if (!interned) {
+        StructSig *copy = new StructSig(sig);
+        copy->member_names = copyArray(sig.member_names, sig.num_members);
+        r.structs.emplace(hash, copy);
+        interned = copy;
+    }
+    return interned;
+}
+
+
+const EnumSig *
+internSig(const EnumSig &sig)
+{
+    size_t hash = hashSig(sig);
+    Registry &r = registry();
+    os::unique_lock<os::mutex> lock(r.mutex);
+
+    const EnumSig *interned = findSig(r.enums, hash, sig);
+    if (!interned) {
+        EnumSig *copy = new EnumSig(sig);
+        copy->values = copyArray(sig.values, sig.num_values);
+        r.enums.emplace(hash, copy);
+        interned = copy;
+    }
+    return interned;
+}
+
+
+const BitmaskSig *
+internSig(const BitmaskSig &sig)
+{
+    size_t hash = hashSig(sig);
+    Registry &r = registry();
+    os::unique_lock<os::mutex> lock(r.mutex);
+
+    const BitmaskSig *interned = findSig(r.bitmasks, hash, sig);
+    if (!interned) {
+        BitmaskSig *copy = new BitmaskSig(sig);
+        copy->flags = copyArray(sig.flags, sig.num_flags);
+        r.bitmasks.emplace(hash, copy);
+        interned = copy;
+    }
+    return interned;
+}
+
+
+} /* namespace trace */
@@ -0,0 +1,83 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Process-wide registry of interned trace signatures.
+ *
+ * Every parser reads the signature definitions embedded in its trace, and
+ * tools which open many traces, or many parsers on the same trace, would
+ * otherwise decode and store the very same definitions over and over again.
+ * Instead, parsers intern every string they read from a definition, and then
+ * the definition itself, getting back an immutable signature shared with all
+ * other parsers in the process which read an identical one.
+ *
+ * Interned strings and signatures are never freed, so they remain valid
+ * after the parser which read them is closed.  Their number is bounded by
+ * the APIs traced, rather than by the number or size of traces.
+ *
+ * All functions are thread safe.
+ */
+
+#pragma once
+
+
+#include <string>
+
+#include "trace_model.hpp"
+
+
+namespace trace {
+
+
+struct FunctionSigFlags : public FunctionSig {
+    CallFlags flags;
+};
+
+
+/*
+ * Return the interned copy of the given string.
+ */
+const char *
+internString(const std::string &str);
+
+/*
+ * Return the interned copy of the given signature, whose strings must all be
+ * interned already.  The signature and its arrays are copied, so they may be
+ * temporaries.
+ */
+const FunctionSigFlags *
+internSig(const FunctionSig &sig);
+
+const StructSig *
+internSig(const StructSig &sig);
+
+const EnumSig *
+internSig(const EnumSig &sig);
+
+const BitmaskSig *
+internSig(const BitmaskSig &sig);
+
+
+} /* namespace trace */
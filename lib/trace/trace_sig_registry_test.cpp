@@ -0,0 +1,153 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+#include <stdio.h>
+
+#include <string>
+
+#include "trace_parser.hpp"
+#include "trace_sig_registry.hpp"
+#include "trace_writer.hpp"
+
+#include "gtest/gtest.h"
+
+using namespace trace;
+
+
+TEST(trace_sig_registry, intern)
+{
+    std::string name = "glFlush";
+    const char *interned = internString(name);
+    EXPECT_STREQ("glFlush", interned);
+    EXPECT_EQ(interned, internString(std::string("glFlush")));
+    EXPECT_NE(interned, internString(std::string("glFinish")));
+
+    // Signatures are copied, so the definitions may be temporaries
+    const char *arg_names[] = {internString("mode")};
+    FunctionSig def = {7, interned, 1, arg_names};
+    const FunctionSigFlags *sig = internSig(def);
+    EXPECT_NE(&def, static_cast<const FunctionSig *>(sig));
+    EXPECT_NE(arg_names, sig->arg_names);
+    EXPECT_EQ(Parser::lookupCallFlags("glFlush"), sig->flags);
+
+    const char *other_arg_names[] = {internString("mode")};
+    FunctionSig same = {7, interned, 1, other_arg_names};
+    EXPECT_EQ(sig, internSig(same));
+
+    // Ids are part of the signature
+    FunctionSig moved = {8, interned, 1, arg_names};
+    EXPECT_NE(sig, internSig(moved));
+
+    EnumValue values[] = {{internString("GL_ZERO"), 0}, {internString("GL_ONE"), 1}};
+    EnumSig enumDef = {3, 2, values};
+    const EnumSig *enumSig = internSig(enumDef);
+    EXPECT_EQ(enumSig, internSig(enumDef));
+    values[1].value = 2;
+    EXPECT_NE(enumSig, internSig(enumDef));
+    EXPECT_EQ(1, enumSig->values[1].value);
+}
+
+
+static const char *arg_names[] = {"mode", "rect"};
+static const FunctionSig sig = {0, "glFoo", 2, arg_names};
+
+static const EnumValue enum_values[] = {{"GL_POINTS", 0}, {"GL_LINES", 1}};
+static const EnumSig enum_sig = {0, 2, enum_values};
+
+static const char *member_names[] = {"x", "y"};
+static const StructSig struct_sig = {0, "Rect", 2, member_names};
+
+
+static void
+writeCall(Writer &writer, unsigned x)
+{
+    unsigned call_no = writer.beginEnter(&sig, 0);
+    writer.beginArg(0);
+    writer.writeEnum(&enum_sig, 1);
+    writer.endArg();
+    writer.beginArg(1);
+    writer.beginStruct(&struct_sig);
+    writer.writeUInt(x);
+    writer.writeUInt(x + 1);
+    writer.endStruct();
+    writer.endArg();
+    writer.endEnter();
+    writer.beginLeave(call_no);
+    writer.endLeave();
+}
+
+
+TEST(trace_sig_registry, parsers)
+{
+    const char *traceFilename = "trace_sig_registry_test.trace";
+
+    Writer writer;
+    ASSERT_TRUE(writer.open(traceFilename));
+    writeCall(writer, 0);
+    writeCall(writer, 2);
+    writer.close();
+
+    Parser *first = new Parser;
+    ASSERT_TRUE(first->open(traceFilename));
+    Parser second;
+    ASSERT_TRUE(second.open(traceFilename));
+
+    Call *a = first->parse_call();
+    Call *b = second.parse_call();
+    ASSERT_TRUE(a != NULL);
+    ASSERT_TRUE(b != NULL);
+
+    // Both parsers share the same signatures
+    EXPECT_EQ(a->sig, b->sig);
+    EXPECT_EQ(static_cast<const Enum &>(a->arg(0)).sig, static_cast<const Enum &>(b->arg(0)).sig);
+    EXPECT_EQ(a->arg(1).toStruct()->sig, b->arg(1).toStruct()->sig);
+
+    // Signatures outlive the parser which read them
+    delete first;
+    EXPECT_STREQ("glFoo", a->name());
+    EXPECT_STREQ("mode", a->sig->arg_names[0]);
+    EXPECT_STREQ("GL_LINES", static_cast<const Enum &>(a->arg(0)).sig->values[1].name);
+    EXPECT_STREQ("y", a->arg(1).toStruct()->sig->member_names[1]);
+    delete a;
+
+    Call *c = second.parse_call();
+    ASSERT_TRUE(c != NULL);
+    EXPECT_EQ(b->sig, c->sig);
+    EXPECT_EQ(3ULL, c->arg(1).toStruct()->members[1]->toUInt());
+    delete b;
+    delete c;
+
+    second.close();
+    remove(traceFilename);
+}
+
+
+int
+main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -59,13 +59,20 @@ Writer::close(void) {
 
 bool
 Writer::open(const char *filename) {
-    close();
-
-    m_file = createSnappyStream(filename);
-    if (!m_file) {
+    OutStream *stream = createSnappyStream(filename);
+    if (!stream) {
         return false;
     }
 
+    return open(stream);
+}
+
+bool
+Writer::open(OutStream *stream) {
+    close();
+
+    m_file = stream;
+
     call_no = 0;
     functions.clear();
     structs.clear();
@@ -367,6 +374,11 @@ void Writer::writePointer(unsigned long long addr) {
     _writeUInt(addr);
 }
 
+void OverlayWriter::writeCall(Call *call) {
+    _writeUInt(call->no);
+    Writer::writeCall(call);
+}
+
 
 } /* namespace trace */
 
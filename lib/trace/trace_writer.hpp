@@ -55,6 +55,8 @@ namespace trace {
         ~Writer();
 
         bool open(const char *filename);
+        /* Start a trace on the given stream, taking ownership of it. */
+        bool open(OutStream *stream);
         void close(void);
 
         unsigned beginEnter(const FunctionSig *sig, unsigned thread_id);
@@ -112,5 +114,17 @@ namespace trace {
 
     };
 
+    /*
+     * Writer for edit overlays.
+     *
+     * An edit overlay is a sidecar file with replacement calls for a trace.
+     * It uses the regular trace encoding, except that every call is preceded
+     * by the number of the call it replaces.  See trace::overlayParser.
+     */
+    class OverlayWriter : public Writer {
+    public:
+        void writeCall(Call *call);
+    };
+
 } /* namespace trace */
 
@@ -88,6 +88,18 @@ LocalWriter::open(void) {
 
     const char *lpFileName;
 
+    const char *sinkName = getenv("TRACE_SINK");
+    if (sinkName) {
+        OutStream *stream = createShmStream(sinkName);
+        if (stream) {
+            os::log("apitrace: tracing to sink %s\n", sinkName);
+            Writer::open(stream);
+            pid = os::getCurrentProcessId();
+            return;
+        }
+        os::log("apitrace: warning: tracing to a file instead\n");
+    }
+
     lpFileName = getenv("TRACE_FILE");
     if (!lpFileName) {
         static unsigned dwCounter = 0;
@@ -163,9 +175,10 @@ void LocalWriter::checkProcessId(void) {
         // create a new file.  We can't call any method of the current
         // file, as it may cause it to flush and corrupt the parent's
         // trace, so we effectively leak the old file object.
-        close();
-        // Don't want to open the same file again
+        m_file = nullptr;
+        // Don't want to open the same file or sink again
         os::unsetEnvironment("TRACE_FILE");
+        os::unsetEnvironment("TRACE_SINK");
         open();
     }
 }
@@ -0,0 +1,158 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h> // for CHAR_MAX
+#include <getopt.h>
+
+#include <iostream>
+
+#include "trace_gen.hpp"
+#include "trace_ostream.hpp"
+#include "trace_writer.hpp"
+
+
+static void
+usage(void)
+{
+    std::cout
+        << "usage: tracegen [OPTIONS] TRACE\n"
+        << "Write a reproducible synthetic trace.\n"
+        "\n"
+        "    -h, --help             show this help message and exit\n"
+        "    -n, --calls=N          number of calls [default: 100000]\n"
+        "    -m, --mix=MIX          kind of calls: mixed, scalar, blob, struct,\n"
+        "                           threads or frames [default: mixed]\n"
+        "    -s, --seed=N           random seed [default: 0]\n"
+        "    -z, --zlib             use zlib compression instead of snappy\n"
+        "    --threads=N            number of threads\n"
+        "    --calls-per-frame=N    number of calls per frame\n"
+        "    --blob-size=BYTES      maximum blob size\n"
+        "    --struct-depth=N       nesting depth of structures\n"
+        "\n"
+        "The same options always produce the same trace.  Options without a\n"
+        "default take the value best suited to the mix.  Use `apitrace repack`\n"
+        "for Brotli compression.\n"
+    ;
+}
+
+enum {
+    THREADS_OPT = CHAR_MAX + 1,
+    CALLS_PER_FRAME_OPT,
+    BLOB_SIZE_OPT,
+    STRUCT_DEPTH_OPT,
+};
+
+const static char *
+shortOptions = "hn:m:s:z";
+
+const static struct option
+longOptions[] = {
+    {"help", no_argument, 0, 'h'},
+    {"calls", required_argument, 0, 'n'},
+    {"mix", required_argument, 0, 'm'},
+    {"seed", required_argument, 0, 's'},
+    {"zlib", no_argument, 0, 'z'},
+    {"threads", required_argument, 0, THREADS_OPT},
+    {"calls-per-frame", required_argument, 0, CALLS_PER_FRAME_OPT},
+    {"blob-size", required_argument, 0, BLOB_SIZE_OPT},
+    {"struct-depth", required_argument, 0, STRUCT_DEPTH_OPT},
+    {0, 0, 0, 0}
+};
+
+
+int
+main(int argc, char **argv)
+{
+    trace::GenOptions options;
+    bool zlib = false;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, shortOptions, longOptions, NULL)) != -1) {
+        switch (opt) {
+        case 'h':
+            usage();
+            return 0;
+        case 'n':
+            options.calls = strtoull(optarg, NULL, 0);
+            break;
+        case 'm':
+            if (!trace::lookupGenMix(optarg, options.mix)) {
+                std::cerr << "error: unknown mix `" << optarg << "`\n";
+                return 1;
+            }
+            break;
+        case 's':
+            options.seed = strtoull(optarg, NULL, 0);
+            break;
+        case 'z':
+            zlib = true;
+            break;
+        case THREADS_OPT:
+            options.threads = atoi(optarg);
+            break;
+        case CALLS_PER_FRAME_OPT:
+            options.callsPerFrame = atoi(optarg);
+            break;
+        case BLOB_SIZE_OPT:
+            options.maxBlobSize = strtoull(optarg, NULL, 0);
+            break;
+        case STRUCT_DEPTH_OPT:
+            options.structDepth = atoi(optarg);
+            break;
+        default:
+            std::cerr << "error: unexpected option `" << (char)opt << "`\n";
+            usage();
+            return 1;
+        }
+    }
+
+    if (argc != optind + 1) {
+        std::cerr << "error: one output trace must be specified\n";
+        usage();
+        return 1;
+    }
+
+    const char *filename = argv[optind];
+
+    trace::OutStream *stream = zlib ? trace::createZLibStream(filename)
+                                    : trace::createSnappyStream(filename);
+    if (!stream) {
+        return 1;
+    }
+
+    trace::Writer writer;
+    if (!writer.open(stream)) {
+        return 1;
+    }
+    unsigned long long frames = trace::generateTrace(writer, options);
+    writer.close();
+
+    std::cerr << "wrote " << options.calls << " calls in " << frames << " frames to " << filename << "\n";
+
+    return 0;
+}
@@ -0,0 +1,690 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "os_thread.hpp"
+#include "glproc.hpp"
+#include "glnull.hpp"
+
+
+namespace glnull {
+
+
+static const char *
+extensionNames[] = {
+    "GL_ARB_framebuffer_object",
+    "GL_ARB_map_buffer_range",
+    "GL_ARB_pixel_buffer_object",
+    "GL_ARB_sync",
+    "GL_ARB_vertex_array_object",
+};
+
+static const unsigned
+numExtensionNames = sizeof extensionNames / sizeof extensionNames[0];
+
+
+struct Buffer
+{
+    GLsizeiptr size = 0;
+    std::vector<char> storage;
+    GLvoid *mapPointer = nullptr;
+};
+
+
+/*
+ * Objects shared among contexts.
+ */
+struct ShareGroup
+{
+    unsigned refCount = 1;
+    std::map<GLuint, Buffer> buffers;
+};
+
+
+struct Context
+{
+    glfeatures::Profile profile;
+    ShareGroup *shareGroup;
+
+    std::map<GLenum, GLuint> bufferBindings;
+    GLuint currentProgram = 0;
+
+    std::string version;
+    std::string extensions;
+};
+
+
+static GLuint nextName = 1;
+
+static OS_THREAD_LOCAL Context *
+currentContext;
+
+
+GLuint
+genNames(GLsizei count)
+{
+    GLuint first = nextName;
+    nextName += count > 0 ? count : 1;
+    return first;
+}
+
+
+Context *
+createContext(const glfeatures::Profile &profile, Context *shareContext)
+{
+    Context *context = new Context;
+    context->profile = profile;
+
+    if (shareContext) {
+        context->shareGroup = shareContext->shareGroup;
+        ++context->shareGroup->refCount;
+    } else {
+        context->shareGroup = new ShareGroup;
+    }
+
+    char version[64];
+    if (profile.es()) {
+        snprintf(version, sizeof version, "OpenGL ES%s %u.%u apitrace null",
+                 profile.major == 1 ? "-CM" : "", profile.major, profile.minor);
+    } else {
+        snprintf(version, sizeof version, "%u.%u apitrace null",
+                 profile.major, profile.minor);
+    }
+    context->version = version;
+
+    for (unsigned i = 0; i < numExtensionNames; ++i) {
+        if (i) {
+            context->extensions += ' ';
+        }
+        context->extensions += extensionNames[i];
+    }
+
+    return context;
+}
+
+
+void
+destroyContext(Context *context)
+{
+    if (!context) {
+        return;
+    }
+
+    if (context == currentContext) {
+        currentContext = nullptr;
+    }
+
+    if (--context->shareGroup->refCount == 0) {
+        delete context->shareGroup;
+    }
+    delete context;
+}
+
+
+void
+makeCurrent(Context *context)
+{
+    currentContext = context;
+}
+
+
+static Buffer *
+getBuffer(GLuint buffer)
+{
+    if (!currentContext || !buffer) {
+        return nullptr;
+    }
+    return &currentContext->shareGroup->buffers[buffer];
+}
+
+
+static Buffer *
+getBoundBuffer(GLenum target)
+{
+    if (!currentContext) {
+        return nullptr;
+    }
+    std::map<GLenum, GLuint>::const_iterator it = currentContext->bufferBindings.find(target);
+    if (it == currentContext->bufferBindings.end()) {
+        return nullptr;
+    }
+    return getBuffer(it->second);
+}
+
+
+static GLuint
+getBufferBinding(GLenum target)
+{
+    if (!currentContext) {
+        return 0;
+    }
+    std::map<GLenum, GLuint>::const_iterator it = currentContext->bufferBindings.find(target);
+    return it != currentContext->bufferBindings.end() ? it->second : 0;
+}
+
+
+static void
+bufferData(Buffer *buffer, GLsizeiptr size)
+{
+    if (buffer) {
+        buffer->size = size;
+        buffer->storage.clear();
+        buffer->mapPointer = nullptr;
+    }
+}
+
+
+/*
+ * Map a buffer range onto (lazily allocated) client memory, so that glretrace
+ * can still replay the memcpy calls into it.
+ */
+static GLvoid *
+mapBuffer(Buffer *buffer, GLintptr offset, GLsizeiptr length)
+{
+    static char dummy;
+
+    if (!buffer) {
+        return &dummy;
+    }
+
+    if (length < 0) {
+        length = buffer->size - offset;
+    }
+    size_t end = size_t(offset + length);
+    if (buffer->storage.size() < end) {
+        buffer->storage.resize(end);
+    }
+
+    buffer->mapPointer = buffer->storage.empty() ? &dummy : buffer->storage.data() + offset;
+    return buffer->mapPointer;
+}
+
+
+static GLboolean
+unmapBuffer(Buffer *buffer)
+{
+    if (buffer) {
+        buffer->mapPointer = nullptr;
+    }
+    return GL_TRUE;
+}
+
+
+static void
+getBufferParameter(Buffer *buffer, GLenum pname, GLint *params)
+{
+    switch (pname) {
+    case GL_BUFFER_SIZE:
+        params[0] = buffer ? GLint(buffer->size) : 0;
+        break;
+    case GL_BUFFER_MAPPED:
+        params[0] = buffer && buffer->mapPointer ? GL_TRUE : GL_FALSE;
+        break;
+    default:
+        params[0] = 0;
+        break;
+    }
+}
+
+
+static void
+getBufferPointer(Buffer *buffer, GLenum pname, GLvoid **params)
+{
+    params[0] = buffer && pname == GL_BUFFER_MAP_POINTER ? buffer->mapPointer : nullptr;
+}
+
+
+/*
+ * Answer integer state queries, returning false for state we don't keep.
+ */
+static bool
+getInteger(GLenum pname, GLint64 *value)
+{
+    if (!currentContext) {
+        return false;
+    }
+
+    const glfeatures::Profile &profile = currentContext->profile;
+
+    switch (pname) {
+    case GL_MAJOR_VERSION:
+        *value = profile.major;
+        return true;
+    case GL_MINOR_VERSION:
+        *value = profile.minor;
+        return true;
+    case GL_CONTEXT_FLAGS:
+        *value = profile.forwardCompatible ? GL_CONTEXT_FLAG_FORWARD_COMPATIBLE_BIT : 0;
+        return true;
+    case GL_CONTEXT_PROFILE_MASK:
+        *value = profile.core ? GL_CONTEXT_CORE_PROFILE_BIT : GL_CONTEXT_COMPATIBILITY_PROFILE_BIT;
+        return true;
+    case GL_NUM_EXTENSIONS:
+        *value = numExtensionNames;
+        return true;
+    case GL_MAX_SAMPLES:
+    case GL_MAX_RASTER_SAMPLES_EXT:
+        *value = 16;
+        return true;
+    case GL_MAX_DEBUG_MESSAGE_LENGTH:
+        *value = 1024;
+        return true;
+    case GL_PROGRAM_ERROR_POSITION_ARB:
+        *value = -1;
+        return true;
+    case GL_CURRENT_PROGRAM:
+        *value = currentContext->currentProgram;
+        return true;
+    case GL_ARRAY_BUFFER_BINDING:
+        *value = getBufferBinding(GL_ARRAY_BUFFER);
+        return true;
+    case GL_ELEMENT_ARRAY_BUFFER_BINDING:
+        *value = getBufferBinding(GL_ELEMENT_ARRAY_BUFFER);
+        return true;
+    case GL_PIXEL_PACK_BUFFER_BINDING:
+        *value = getBufferBinding(GL_PIXEL_PACK_BUFFER);
+        return true;
+    case GL_PIXEL_UNPACK_BUFFER_BINDING:
+        *value = getBufferBinding(GL_PIXEL_UNPACK_BUFFER);
+        return true;
+    case GL_QUERY_BUFFER_BINDING:
+        *value = getBufferBinding(GL_QUERY_BUFFER);
+        return true;
+    default:
+        return false;
+    }
+}
+
+
+/*
+ * Only the first value is written, as multi-valued state is never read back
+ * by glretrace itself.
+ */
+template< class T >
+static inline void
+getValues(GLenum pname, T *params)
+{
+    GLint64 value = 0;
+    getInteger(pname, &value);
+    params[0] = static_cast<T>(value);
+}
+
+
+} /* namespace glnull */
+
+
+using namespace glnull;
+
+
+const GLubyte * APIENTRY
+_null_glGetString(GLenum name)
+{
+    const char *result = "";
+    switch (name) {
+    case GL_VENDOR:
+        result = "apitrace";
+        break;
+    case GL_RENDERER:
+        result = "null";
+        break;
+    case GL_VERSION:
+        if (currentContext) {
+            result = currentContext->version.c_str();
+        }
+        break;
+    case GL_SHADING_LANGUAGE_VERSION:
+        result = "1.10";
+        break;
+    case GL_EXTENSIONS:
+        if (currentContext) {
+            result = currentContext->extensions.c_str();
+        }
+        break;
+    }
+    return reinterpret_cast<const GLubyte *>(result);
+}
+
+const GLubyte * APIENTRY
+_null_glGetStringi(GLenum name, GLuint index)
+{
+    if (name == GL_EXTENSIONS && index < numExtensionNames) {
+        return reinterpret_cast<const GLubyte *>(extensionNames[index]);
+    }
+    return nullptr;
+}
+
+void APIENTRY
+_null_glGetBooleanv(GLenum pname, GLboolean * params)
+{
+    getValues(pname, params);
+}
+
+void APIENTRY
+_null_glGetIntegerv(GLenum pname, GLint * params)
+{
+    getValues(pname, params);
+}
+
+void APIENTRY
+_null_glGetInteger64v(GLenum pname, GLint64 * params)
+{
+    getValues(pname, params);
+}
+
+void APIENTRY
+_null_glGetFloatv(GLenum pname, GLfloat * params)
+{
+    getValues(pname, params);
+}
+
+void APIENTRY
+_null_glGetDoublev(GLenum pname, GLdouble * params)
+{
+    getValues(pname, params);
+}
+
+
+// Compilation and linking always succeed, without any log
+static void
+getObjectParameter(GLenum pname, GLint *params)
+{
+    switch (pname) {
+    case GL_COMPILE_STATUS:
+    case GL_LINK_STATUS:
+    case GL_VALIDATE_STATUS:
+        params[0] = GL_TRUE;
+        break;
+    default:
+        params[0] = 0;
+        break;
+    }
+}
+
+void APIENTRY
+_null_glGetShaderiv(GLuint shader, GLenum pname, GLint * params)
+{
+    getObjectParameter(pname, params);
+}
+
+void APIENTRY
+_null_glGetProgramiv(GLuint program, GLenum pname, GLint * params)
+{
+    getObjectParameter(pname, params);
+}
+
+void APIENTRY
+_null_glGetObjectParameterivARB(GLhandleARB obj, GLenum pname, GLint * params)
+{
+    getObjectParameter(pname, params);
+}
+
+GLhandleARB APIENTRY
+_null_glGetHandleARB(GLenum pname)
+{
+    if (pname == GL_PROGRAM_OBJECT_ARB && currentContext) {
+        return currentContext->currentProgram;
+    }
+    return 0;
+}
+
+void APIENTRY
+_null_glUseProgram(GLuint program)
+{
+    if (currentContext) {
+        currentContext->currentProgram = program;
+    }
+}
+
+void APIENTRY
+_null_glUseProgramObjectARB(GLhandleARB programObj)
+{
+    _null_glUseProgram(programObj);
+}
+
+
+void APIENTRY
+_null_glBindBuffer(GLenum target, GLuint buffer)
+{
+    if (currentContext) {
+        currentContext->bufferBindings[target] = buffer;
+    }
+}
+
+void APIENTRY
+_null_glBindBufferARB(GLenum target, GLuint buffer)
+{
+    _null_glBindBuffer(target, buffer);
+}
+
+void APIENTRY
+_null_glDeleteBuffers(GLsizei n, const GLuint * buffers)
+{
+    if (!currentContext) {
+        return;
+    }
+    for (GLsizei i = 0; i < n; ++i) {
+        currentContext->shareGroup->buffers.erase(buffers[i]);
+        std::map<GLenum, GLuint>::iterator it;
+        for (it = currentContext->bufferBindings.begin(); it != currentContext->bufferBindings.end(); ++it) {
+            if (it->second == buffers[i]) {
+                it->second = 0;
+            }
+        }
+    }
+}
+
+void APIENTRY
+_null_glDeleteBuffersARB(GLsizei n, const GLuint * buffers)
+{
+    _null_glDeleteBuffers(n, buffers);
+}
+
+void APIENTRY
+_null_glBufferData(GLenum target, GLsizeiptr size, const GLvoid * data, GLenum usage)
+{
+    bufferData(getBoundBuffer(target), size);
+}
+
+void APIENTRY
+_null_glBufferDataARB(GLenum target, GLsizeiptrARB size, const GLvoid * data, GLenum usage)
+{
+    bufferData(getBoundBuffer(target), size);
+}
+
+void APIENTRY
+_null_glBufferStorage(GLenum target, GLsizeiptr size, const GLvoid * data, GLbitfield flags)
+{
+    bufferData(getBoundBuffer(target), size);
+}
+
+void APIENTRY
+_null_glNamedBufferData(GLuint buffer, GLsizeiptr size, const void * data, GLenum usage)
+{
+    bufferData(getBuffer(buffer), size);
+}
+
+void APIENTRY
+_null_glNamedBufferDataEXT(GLuint buffer, GLsizeiptr size, const GLvoid * data, GLenum usage)
+{
+    bufferData(getBuffer(buffer), size);
+}
+
+void APIENTRY
+_null_glNamedBufferStorage(GLuint buffer, GLsizeiptr size, const void * data, GLbitfield flags)
+{
+    bufferData(getBuffer(buffer), size);
+}
+
+void APIENTRY
+_null_glNamedBufferStorageEXT(GLuint buffer, GLsizeiptr size, const GLvoid * data, GLbitfield flags)
+{
+    bufferData(getBuffer(buffer), size);
+}
+
+GLvoid * APIENTRY
+_null_glMapBuffer(GLenum target, GLenum access)
+{
+    return mapBuffer(getBoundBuffer(target), 0, -1);
+}
+
+GLvoid * APIENTRY
+_null_glMapBufferARB(GLenum target, GLenum access)
+{
+    return mapBuffer(getBoundBuffer(target), 0, -1);
+}
+
+GLvoid * APIENTRY
+_null_glMapBufferOES(GLenum target, GLenum access)
+{
+    return mapBuffer(getBoundBuffer(target), 0, -1);
+}
+
+GLvoid * APIENTRY
+_null_glMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+    return mapBuffer(getBoundBuffer(target), offset, length);
+}
+
+GLvoid * APIENTRY
+_null_glMapBufferRangeEXT(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+    return mapBuffer(getBoundBuffer(target), offset, length);
+}
+
+GLvoid * APIENTRY
+_null_glMapNamedBuffer(GLuint buffer, GLenum access)
+{
+    return mapBuffer(getBuffer(buffer), 0, -1);
+}
+
+GLvoid * APIENTRY
+_null_glMapNamedBufferEXT(GLuint buffer, GLenum access)
+{
+    return mapBuffer(getBuffer(buffer), 0, -1);
+}
+
+GLvoid * APIENTRY
+_null_glMapNamedBufferRange(GLuint buffer, GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+    return mapBuffer(getBuffer(buffer), offset, length);
+}
+
+GLvoid * APIENTRY
+_null_glMapNamedBufferRangeEXT(GLuint buffer, GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+    return mapBuffer(getBuffer(buffer), offset, length);
+}
+
+GLboolean APIENTRY
+_null_glUnmapBuffer(GLenum target)
+{
+    return unmapBuffer(getBoundBuffer(target));
+}
+
+GLboolean APIENTRY
+_null_glUnmapBufferARB(GLenum target)
+{
+    return unmapBuffer(getBoundBuffer(target));
+}
+
+GLboolean APIENTRY
+_null_glUnmapBufferOES(GLenum target)
+{
+    return unmapBuffer(getBoundBuffer(target));
+}
+
+GLboolean APIENTRY
+_null_glUnmapNamedBuffer(GLuint buffer)
+{
+    return unmapBuffer(getBuffer(buffer));
+}
+
+GLboolean APIENTRY
+_null_glUnmapNamedBufferEXT(GLuint buffer)
+{
+    return unmapBuffer(getBuffer(buffer));
+}
+
+void APIENTRY
+_null_glGetBufferParameteriv(GLenum target, GLenum pname, GLint * params)
+{
+    getBufferParameter(getBoundBuffer(target), pname, params);
+}
+
+void APIENTRY
+_null_glGetBufferParameterivARB(GLenum target, GLenum pname, GLint * params)
+{
+    getBufferParameter(getBoundBuffer(target), pname, params);
+}
+
+void APIENTRY
+_null_glGetNamedBufferParameteriv(GLuint buffer, GLenum pname, GLint * params)
+{
+    getBufferParameter(getBuffer(buffer), pname, params);
+}
+
+void APIENTRY
+_null_glGetNamedBufferParameterivEXT(GLuint buffer, GLenum pname, GLint * params)
+{
+    getBufferParameter(getBuffer(buffer), pname, params);
+}
+
+void APIENTRY
+_null_glGetBufferPointerv(GLenum target, GLenum pname, GLvoid * * params)
+{
+    getBufferPointer(getBoundBuffer(target), pname, params);
+}
+
+void APIENTRY
+_null_glGetBufferPointervARB(GLenum target, GLenum pname, GLvoid * * params)
+{
+    getBufferPointer(getBoundBuffer(target), pname, params);
+}
+
+void APIENTRY
+_null_glGetBufferPointervOES(GLenum target, GLenum pname, GLvoid * * params)
+{
+    getBufferPointer(getBoundBuffer(target), pname, params);
+}
+
+void APIENTRY
+_null_glGetNamedBufferPointerv(GLuint buffer, GLenum pname, GLvoid * * params)
+{
+    getBufferPointer(getBuffer(buffer), pname, params);
+}
+
+void APIENTRY
+_null_glGetNamedBufferPointervEXT(GLuint buffer, GLenum pname, GLvoid * * params)
+{
+    getBufferPointer(getBuffer(buffer), pname, params);
+}
@@ -0,0 +1,71 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Null GL implementation, used by `glretrace --driver=null` to measure the
+ * replay overhead without any driver work.
+ *
+ * All GL entry points are no-ops (see glnull.py), except that object names are
+ * handed out, and just enough state is kept (buffer sizes and mappings,
+ * bindings, the current program) to answer the queries glretrace itself
+ * relies upon.
+ */
+
+#pragma once
+
+
+#include "glimports.hpp"
+#include "glfeatures.hpp"
+
+
+namespace glnull {
+
+
+struct Context;
+
+
+/**
+ * Point all GL dispatch entries to the null implementation.
+ */
+void
+install(void);
+
+/**
+ * Reserve count consecutive object names, returning the first.
+ */
+GLuint
+genNames(GLsizei count);
+
+Context *
+createContext(const glfeatures::Profile &profile, Context *shareContext);
+
+void
+destroyContext(Context *context);
+
+void
+makeCurrent(Context *context);
+
+
+} /* namespace glnull */
@@ -0,0 +1,172 @@
+##########################################################################
+#
+# Copyright 2026 The apitrace authors
+# All Rights Reserved.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+#
+##########################################################################/
+
+
+"""Generate the null GL dispatch table, used by `glretrace --driver=null`.
+
+Every GL entry point becomes a no-op, except that object names are handed out
+so that swizzling still happens, and that a few queries glretrace relies upon
+are answered (see glnull.cpp).
+"""
+
+
+import retrace # to adjust sys.path
+
+import specs.stdapi as stdapi
+import specs.glapi as glapi
+
+
+# Entry points implemented by hand in glnull.cpp
+handwritten_functions = set([
+    'glGetString',
+    'glGetStringi',
+    'glGetBooleanv',
+    'glGetIntegerv',
+    'glGetInteger64v',
+    'glGetFloatv',
+    'glGetDoublev',
+    'glGetShaderiv',
+    'glGetProgramiv',
+    'glGetObjectParameterivARB',
+    'glGetHandleARB',
+    'glUseProgram',
+    'glUseProgramObjectARB',
+    'glBindBuffer',
+    'glBindBufferARB',
+    'glDeleteBuffers',
+    'glDeleteBuffersARB',
+    'glBufferData',
+    'glBufferDataARB',
+    'glBufferStorage',
+    'glNamedBufferData',
+    'glNamedBufferDataEXT',
+    'glNamedBufferStorage',
+    'glNamedBufferStorageEXT',
+    'glMapBuffer',
+    'glMapBufferARB',
+    'glMapBufferOES',
+    'glMapBufferRange',
+    'glMapBufferRangeEXT',
+    'glMapNamedBuffer',
+    'glMapNamedBufferEXT',
+    'glMapNamedBufferRange',
+    'glMapNamedBufferRangeEXT',
+    'glUnmapBuffer',
+    'glUnmapBufferARB',
+    'glUnmapBufferOES',
+    'glUnmapNamedBuffer',
+    'glUnmapNamedBufferEXT',
+    'glGetBufferParameteriv',
+    'glGetBufferParameterivARB',
+    'glGetNamedBufferParameteriv',
+    'glGetNamedBufferParameterivEXT',
+    'glGetBufferPointerv',
+    'glGetBufferPointervARB',
+    'glGetBufferPointervOES',
+    'glGetNamedBufferPointerv',
+    'glGetNamedBufferPointervEXT',
+])
+
+
+# Entry points which always return the same (successful) result
+constant_results = {
+    'glCheckFramebufferStatus': 'GL_FRAMEBUFFER_COMPLETE',
+    'glCheckFramebufferStatusEXT': 'GL_FRAMEBUFFER_COMPLETE',
+    'glCheckFramebufferStatusOES': 'GL_FRAMEBUFFER_COMPLETE',
+    'glCheckNamedFramebufferStatus': 'GL_FRAMEBUFFER_COMPLETE',
+    'glCheckNamedFramebufferStatusEXT': 'GL_FRAMEBUFFER_COMPLETE',
+    'glClientWaitSync': 'GL_ALREADY_SIGNALED',
+    'glClientWaitSyncAPPLE': 'GL_ALREADY_SIGNALED',
+}
+
+
+class NullDispatcher:
+
+    def functionName(self, function):
+        return '_null_' + function.name
+
+    def nameExpr(self, type, count='1'):
+        name = 'glnull::genNames(%s)' % count
+        if isinstance(type.type, stdapi.IntPointer):
+            return '(%s)(uintptr_t)%s' % (type, name)
+        return '(%s)%s' % (type, name)
+
+    def generatesNames(self, function):
+        # glGet*, glIs*, etc. merely return existing names
+        return not function.name.startswith('glGet')
+
+    def nullFunction(self, function):
+        if function.name in handwritten_functions:
+            print 'extern %s;' % function.prototype(self.functionName(function))
+            print
+            return
+
+        print 'static %s {' % function.prototype(self.functionName(function))
+
+        if self.generatesNames(function):
+            for arg in function.args:
+                if arg.output and \
+                   isinstance(arg.type, stdapi.Array) and \
+                   isinstance(arg.type.type, stdapi.Handle) and \
+                   arg.type.length in function.argNames():
+                    print '    for (GLsizei _i = 0; _i < %s; ++_i) {' % arg.type.length
+                    print '        %s[_i] = %s;' % (arg.name, self.nameExpr(arg.type.type))
+                    print '    }'
+
+        if function.type is not stdapi.Void:
+            if function.name in constant_results:
+                print '    return %s;' % constant_results[function.name]
+            elif isinstance(function.type, stdapi.Handle) and self.generatesNames(function):
+                count = function.type.range or '1'
+                print '    return %s;' % self.nameExpr(function.type, count)
+            else:
+                print '    return 0;'
+
+        print '}'
+        print
+
+    def nullModule(self, module):
+        for function in module.functions:
+            self.nullFunction(function)
+
+        print 'void'
+        print 'glnull::install(void)'
+        print '{'
+        for function in module.functions:
+            print '    _%s = &%s;' % (function.name, self.functionName(function))
+        print '}'
+        print
+
+
+if __name__ == '__main__':
+    print r'''
+#include <stdint.h>
+
+#include "glproc.hpp"
+#include "glnull.hpp"
+
+'''
+    dispatcher = NullDispatcher()
+    dispatcher.nullModule(glapi.glapi)
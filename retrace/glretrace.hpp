@@ -134,6 +134,11 @@ glfeatures::Profile
 parseContextAttribList(const trace::Value *attribs);
 
 
+/*
+ * Window system backend for all drawables and contexts, chosen by setUp().
+ */
+extern glws::Backend *wsBackend;
+
 glws::Drawable *
 createDrawable(glfeatures::Profile profile);
 
@@ -796,6 +796,16 @@ debugOutputCallback(GLenum source, GLenum type, GLuint id, GLenum severity,
 } /* namespace glretrace */
 
 
+class GLSnapshotReadback : public retrace::SnapshotReadback {
+public:
+    glstate::DrawBufferReadback *readback;
+
+    GLSnapshotReadback(glstate::DrawBufferReadback *_readback) :
+        readback(_readback)
+    {}
+};
+
+
 class GLDumper : public retrace::Dumper {
 public:
     int
@@ -814,6 +824,26 @@ public:
         return glstate::getDrawBufferImage(n);
     }
 
+    retrace::SnapshotReadback *
+    beginSnapshot(int n) override {
+        if (!glretrace::getCurrentContext()) {
+            return NULL;
+        }
+        glstate::DrawBufferReadback *readback = glstate::beginDrawBufferImage(n);
+        if (!readback) {
+            return NULL;
+        }
+        return new GLSnapshotReadback(readback);
+    }
+
+    image::Image *
+    endSnapshot(retrace::SnapshotReadback *readback) override {
+        GLSnapshotReadback *glReadback = static_cast<GLSnapshotReadback *>(readback);
+        image::Image *image = glstate::endDrawBufferImage(glReadback->readback);
+        delete glReadback;
+        return image;
+    }
+
     bool
     canDump(void) override {
         glretrace::Context *currentContext = glretrace::getCurrentContext();
@@ -843,7 +873,12 @@ retrace::setFeatureLevel(const char *featureLevel)
 
 void
 retrace::setUp(void) {
-    glws::init();
+    if (retrace::driver == retrace::DRIVER_NULL) {
+        glretrace::wsBackend = glws::getNullBackend();
+    } else {
+        glretrace::wsBackend = glws::getNativeBackend();
+    }
+    glretrace::wsBackend->init();
     dumper = &glDumper;
 }
 
@@ -911,12 +946,12 @@ retrace::finishRendering(void) {
 void
 retrace::waitForInput(void) {
     flushRendering();
-    while (glws::processEvents()) {
+    while (glretrace::wsBackend->processEvents()) {
         os::sleep(100*1000);
     }
 }
 
 void
 retrace::cleanUp(void) {
-    glws::cleanup();
+    glretrace::wsBackend->cleanup();
 }
@@ -44,6 +44,10 @@
 namespace glretrace {
 
 
+glws::Backend *
+wsBackend = NULL;
+
+
 static std::map<glfeatures::Profile, glws::Visual *>
 visuals;
 
@@ -56,7 +60,7 @@ getVisual(glfeatures::Profile profile) {
         unsigned samples = retrace::samples;
         /* The requested number of samples might not be available, try fewer until we succeed */
         while (!visual && samples > 0) {
-            visual = glws::createVisual(retrace::doubleBuffer, samples, profile);
+            visual = wsBackend->createVisual(retrace::doubleBuffer, samples, profile);
             if (!visual) {
                 samples--;
             }
@@ -79,7 +83,7 @@ static glws::Drawable *
 createDrawableHelper(glfeatures::Profile profile, int width = 32, int height = 32,
                      const glws::pbuffer_info *pbInfo = NULL) {
     glws::Visual *visual = getVisual(profile);
-    glws::Drawable *draw = glws::createDrawable(visual, width, height, pbInfo);
+    glws::Drawable *draw = wsBackend->createDrawable(visual, width, height, pbInfo);
     if (!draw) {
         std::cerr << "error: failed to create OpenGL drawable\n";
         exit(1);
@@ -119,7 +123,7 @@ Context *
 createContext(Context *shareContext, glfeatures::Profile profile) {
     glws::Visual *visual = getVisual(profile);
     glws::Context *shareWsContext = shareContext ? shareContext->wsContext : NULL;
-    glws::Context *ctx = glws::createContext(visual, shareWsContext, retrace::debug);
+    glws::Context *ctx = wsBackend->createContext(visual, shareWsContext, retrace::debug);
     if (!ctx) {
         std::cerr << "error: failed to create " << profile << " context.\n";
         exit(1);
@@ -164,13 +168,15 @@ makeCurrent(trace::Call &call, glws::Drawable *drawable, Context *context)
         if (!retrace::doubleBuffer) {
             frame_complete(call);
         }
+        retrace::flushSnapshots();
     }
 
     flushQueries();
 
     beforeContextSwitch();
 
-    bool success = glws::makeCurrent(drawable, context ? context->wsContext : NULL);
+    glws::Context *wsContext = context ? context->wsContext : NULL;
+    bool success = wsBackend->makeCurrent(drawable, wsContext);
 
     if (!success) {
         std::cerr << "error: failed to make current OpenGL context and drawable\n";
@@ -338,19 +344,19 @@ parseContextAttribList(const trace::Value *attribs)
 // WGL_ARB_render_texture / wglBindTexImageARB()
 bool
 bindTexImage(glws::Drawable *pBuffer, int iBuffer) {
-    return glws::bindTexImage(pBuffer, iBuffer);
+    return wsBackend->bindTexImage(pBuffer, iBuffer);
 }
 
 // WGL_ARB_render_texture / wglReleaseTexImageARB()
 bool
 releaseTexImage(glws::Drawable *pBuffer, int iBuffer) {
-    return glws::releaseTexImage(pBuffer, iBuffer);
+    return wsBackend->releaseTexImage(pBuffer, iBuffer);
 }
 
 // WGL_ARB_render_texture / wglSetPbufferAttribARB()
 bool
 setPbufferAttrib(glws::Drawable *pBuffer, const int *attribs) {
-    return glws::setPbufferAttrib(pBuffer, attribs);
+    return wsBackend->setPbufferAttrib(pBuffer, attribs);
 }
 
 } /* namespace glretrace */
@@ -70,6 +70,23 @@ getDrawBufferImageCount(void);
 image::Image *
 getDrawBufferImage(int n);
 
+struct DrawBufferReadback;
+
+/**
+ * Asynchronous variant of getDrawBufferImage: read the draw buffer into a
+ * pixel pack buffer and fence it, so the image can be fetched later without
+ * stalling.  Returns NULL if unsupported by the current context.
+ */
+DrawBufferReadback *
+beginDrawBufferImage(int n);
+
+/**
+ * Wait for the readback to complete, and return its image.  Must be called
+ * with the same context current.
+ */
+image::Image *
+endDrawBufferImage(DrawBufferReadback *readback);
+
 
 } /* namespace glstate */
 
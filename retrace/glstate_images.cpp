@@ -976,11 +976,30 @@ getDrawBufferImageCount()
 }
 
 
-image::Image *
-getDrawBufferImage(int n)
+/**
+ * Describes how to read back one of the current draw buffers.
+ */
+struct DrawBufferRead
 {
-    Context context;
+    GLint framebuffer = 0;
+    GLint buffer = GL_NONE;
+    ImageDesc desc;
+    GLenum format = GL_RGB;
+    GLenum type = GL_UNSIGNED_BYTE;
+    GLint channels = 0;
+    image::ChannelType channelType = image::TYPE_UNORM8;
+
+    inline size_t
+    size(void) const {
+        size_t bytesPerChannel = channelType == image::TYPE_FLOAT ? 4 : 1;
+        return (size_t)desc.width * desc.height * channels * bytesPerChannel;
+    }
+};
 
+
+static bool
+getDrawBufferRead(Context &context, int n, DrawBufferRead &read)
+{
     GLenum framebuffer_binding;
     GLenum framebuffer_target;
     if (context.read_framebuffer_object) {
@@ -1000,7 +1019,7 @@ getDrawBufferImage(int n)
     if (context.ES) {
         format = GL_RGBA;
         if ((n < 0) && !context.NV_read_depth_stencil) {
-            return NULL;
+            return false;
         }
     }
 
@@ -1020,7 +1039,7 @@ getDrawBufferImage(int n)
         if (context.ARB_draw_buffers) {
             glGetIntegerv(GL_DRAW_BUFFER0 + n, &draw_buffer);
             if (draw_buffer == GL_NONE) {
-                return NULL;
+                return false;
             }
         } else {
             // GL_COLOR_ATTACHMENT0 is implied
@@ -1028,7 +1047,7 @@ getDrawBufferImage(int n)
         }
 
         if (!getFramebufferAttachmentDesc(context, framebuffer_target, draw_buffer, desc)) {
-            return NULL;
+            return false;
         }
     } else if (n == 0) {
         if (context.ES) {
@@ -1040,22 +1059,22 @@ getDrawBufferImage(int n)
         } else {
             glGetIntegerv(GL_DRAW_BUFFER, &draw_buffer);
             if (draw_buffer == GL_NONE) {
-                return NULL;
+                return false;
             }
         }
 
         if (!getDrawableBounds(&desc.width, &desc.height)) {
-            return NULL;
+            return false;
         }
 
         desc.depth = 1;
     } else {
-        return NULL;
+        return false;
     }
 
     GLint channels = _gl_format_channels(format);
     if (channels > 4) {
-        return NULL;
+        return false;
     }
 
     image::ChannelType channelType = image::TYPE_UNORM8;
@@ -1066,45 +1085,94 @@ getDrawBufferImage(int n)
         channelType = image::TYPE_FLOAT;
     }
 
-    image::Image *image = new image::Image(desc.width, desc.height, channels, true, channelType);
-    if (!image) {
-        return NULL;
-    }
+    read.framebuffer = draw_framebuffer;
+    read.buffer = draw_buffer;
+    read.desc = desc;
+    read.format = format;
+    read.type = type;
+    read.channels = channels;
+    read.channelType = channelType;
+
+    return true;
+}
 
-    flushErrors();
 
+/**
+ * Issue the glReadPixels for a draw buffer, either into client memory, or
+ * into the given pixel pack buffer when non-zero.
+ */
+static void
+readDrawBuffer(Context &context, const DrawBufferRead &read,
+               GLuint pixel_pack_buffer, GLvoid *pixels)
+{
     GLint read_framebuffer = 0;
     GLint read_buffer = GL_NONE;
     if (context.read_framebuffer_object) {
         glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &read_framebuffer);
-        glBindFramebuffer(GL_READ_FRAMEBUFFER, draw_framebuffer);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, read.framebuffer);
     }
 
     if (context.read_buffer) {
         glGetIntegerv(GL_READ_BUFFER, &read_buffer);
-        glReadBuffer(draw_buffer);
+        glReadBuffer(read.buffer);
     }
 
     {
         // TODO: reset imaging state too
         PixelPackState pps(context);
-        glReadPixels(0, 0, desc.width, desc.height, format, type, image->pixels);
+        if (pixel_pack_buffer) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pixel_pack_buffer);
+            glBufferData(GL_PIXEL_PACK_BUFFER, read.size(), NULL, GL_STREAM_READ);
+        }
+        glReadPixels(0, 0, read.desc.width, read.desc.height, read.format, read.type, pixels);
     }
 
-
     if (context.read_buffer) {
         glReadBuffer(read_buffer);
     }
     if (context.read_framebuffer_object) {
         glBindFramebuffer(GL_READ_FRAMEBUFFER, read_framebuffer);
     }
+}
+
 
+static bool
+checkSnapshotErrors(void)
+{
     GLenum error = glGetError();
-    if (error != GL_NO_ERROR) {
-        do {
-            std::cerr << "warning: " << enumToString(error) << " while getting snapshot\n";
-            error = glGetError();
-        } while(error != GL_NO_ERROR);
+    if (error == GL_NO_ERROR) {
+        return true;
+    }
+
+    do {
+        std::cerr << "warning: " << enumToString(error) << " while getting snapshot\n";
+        error = glGetError();
+    } while(error != GL_NO_ERROR);
+
+    return false;
+}
+
+
+image::Image *
+getDrawBufferImage(int n)
+{
+    Context context;
+
+    DrawBufferRead read;
+    if (!getDrawBufferRead(context, n, read)) {
+        return NULL;
+    }
+
+    image::Image *image = new image::Image(read.desc.width, read.desc.height, read.channels, true, read.channelType);
+    if (!image) {
+        return NULL;
+    }
+
+    flushErrors();
+
+    readDrawBuffer(context, read, 0, image->pixels);
+
+    if (!checkSnapshotErrors()) {
         delete image;
         return NULL;
     }
@@ -1113,6 +1181,99 @@ getDrawBufferImage(int n)
 }
 
 
+struct DrawBufferReadback
+{
+    DrawBufferRead read;
+    GLuint buffer;
+    GLsync fence;
+};
+
+
+DrawBufferReadback *
+beginDrawBufferImage(int n)
+{
+    Context context;
+
+    if (!context.pixel_buffer_object || !context.sync) {
+        return NULL;
+    }
+
+    DrawBufferRead read;
+    if (!getDrawBufferRead(context, n, read)) {
+        return NULL;
+    }
+
+    flushErrors();
+
+    GLuint buffer = 0;
+    glGenBuffers(1, &buffer);
+
+    readDrawBuffer(context, read, buffer, NULL);
+
+    GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    if (!checkSnapshotErrors()) {
+        glDeleteSync(fence);
+        glDeleteBuffers(1, &buffer);
+        return NULL;
+    }
+
+    DrawBufferReadback *readback = new DrawBufferReadback;
+    readback->read = read;
+    readback->buffer = buffer;
+    readback->fence = fence;
+    return readback;
+}
+
+
+image::Image *
+endDrawBufferImage(DrawBufferReadback *readback)
+{
+    Context context;
+
+    const DrawBufferRead &read = readback->read;
+
+    flushErrors();
+
+    GLenum status;
+    do {
+        status = glClientWaitSync(readback->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+    } while (status == GL_TIMEOUT_EXPIRED);
+
+    image::Image *image = NULL;
+    if (status != GL_WAIT_FAILED) {
+        image = new image::Image(read.desc.width, read.desc.height, read.channels, true, read.channelType);
+
+        GLint pixel_pack_buffer = 0;
+        glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &pixel_pack_buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback->buffer);
+
+        if (context.ES) {
+            const void *map = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, read.size(), GL_MAP_READ_BIT);
+            if (map) {
+                memcpy(image->pixels, map, read.size());
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            }
+        } else {
+            glGetBufferSubData(GL_PIXEL_PACK_BUFFER, 0, read.size(), image->pixels);
+        }
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pixel_pack_buffer);
+    }
+
+    glDeleteSync(readback->fence);
+    glDeleteBuffers(1, &readback->buffer);
+    delete readback;
+
+    if (!checkSnapshotErrors() || status == GL_WAIT_FAILED) {
+        delete image;
+        return NULL;
+    }
+
+    return image;
+}
+
+
 /**
  * Dump the image of the currently bound read buffer.
  */
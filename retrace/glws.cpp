@@ -108,4 +108,83 @@ Context::initialize(void)
 }
 
 
+bool
+Backend::makeCurrent(Drawable *drawable, Context *context)
+{
+    bool success = makeCurrentInternal(drawable, context);
+    if (success && context && !context->initialized) {
+        context->initialize();
+    }
+    return success;
+}
+
+
+/*
+ * The backend this binary was built with.
+ */
+class NativeBackend : public Backend
+{
+public:
+    void
+    init(void) override {
+        glws::init();
+    }
+
+    void
+    cleanup(void) override {
+        glws::cleanup();
+    }
+
+    Visual *
+    createVisual(bool doubleBuffer, unsigned samples, Profile profile) override {
+        return glws::createVisual(doubleBuffer, samples, profile);
+    }
+
+    Drawable *
+    createDrawable(const Visual *visual, int width, int height,
+                   const glws::pbuffer_info *pbInfo) override {
+        return glws::createDrawable(visual, width, height, pbInfo);
+    }
+
+    Context *
+    createContext(const Visual *visual, Context *shareContext, bool debug) override {
+        return glws::createContext(visual, shareContext, debug);
+    }
+
+    bool
+    processEvents(void) override {
+        return glws::processEvents();
+    }
+
+    bool
+    bindTexImage(Drawable *pBuffer, int iBuffer) override {
+        return glws::bindTexImage(pBuffer, iBuffer);
+    }
+
+    bool
+    releaseTexImage(Drawable *pBuffer, int iBuffer) override {
+        return glws::releaseTexImage(pBuffer, iBuffer);
+    }
+
+    bool
+    setPbufferAttrib(Drawable *pBuffer, const int *attribList) override {
+        return glws::setPbufferAttrib(pBuffer, attribList);
+    }
+
+protected:
+    bool
+    makeCurrentInternal(Drawable *drawable, Context *context) override {
+        return glws::makeCurrentInternal(drawable, context);
+    }
+};
+
+
+Backend *
+getNativeBackend(void)
+{
+    static NativeBackend backend;
+    return &backend;
+}
+
+
 } /* namespace glws */
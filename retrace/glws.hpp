@@ -188,6 +188,7 @@ private:
     void initialize(void);
 
     friend bool makeCurrent(Drawable *, Context *);
+    friend class Backend;
 };
 
 
@@ -235,4 +236,61 @@ bool
 setPbufferAttrib(Drawable *pBuffer, const int *attribList);
 
 
+/*
+ * A window system backend, chosen at runtime.
+ *
+ * The native backend this binary was built with (glws_glx.cpp, glws_wgl.cpp,
+ * etc.) is reached through the functions above, which getNativeBackend()
+ * forwards to.  getNullBackend() returns the null backend (glws_null.cpp) for
+ * `--driver=null`, whose drawables and contexts never reach a window system
+ * or driver, and which installs the null GL dispatch (see glnull.hpp).
+ */
+class Backend
+{
+public:
+    virtual ~Backend() {}
+
+    virtual void
+    init(void) = 0;
+
+    virtual void
+    cleanup(void) = 0;
+
+    virtual Visual *
+    createVisual(bool doubleBuffer, unsigned samples, Profile profile) = 0;
+
+    virtual Drawable *
+    createDrawable(const Visual *visual, int width, int height,
+                   const glws::pbuffer_info *pbInfo = NULL) = 0;
+
+    virtual Context *
+    createContext(const Visual *visual, Context *shareContext = 0, bool debug = false) = 0;
+
+    bool
+    makeCurrent(Drawable *drawable, Context *context);
+
+    virtual bool
+    processEvents(void) = 0;
+
+    virtual bool
+    bindTexImage(Drawable *pBuffer, int iBuffer) = 0;
+
+    virtual bool
+    releaseTexImage(Drawable *pBuffer, int iBuffer) = 0;
+
+    virtual bool
+    setPbufferAttrib(Drawable *pBuffer, const int *attribList) = 0;
+
+protected:
+    virtual bool
+    makeCurrentInternal(Drawable *drawable, Context *context) = 0;
+};
+
+Backend *
+getNativeBackend(void);
+
+Backend *
+getNullBackend(void);
+
+
 } /* namespace glws */
@@ -0,0 +1,139 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Null window system, for `--driver=null`.
+ */
+
+
+#include "glws.hpp"
+#include "glnull.hpp"
+
+
+namespace glws {
+
+
+class NullDrawable : public Drawable
+{
+public:
+    NullDrawable(const Visual *vis, int w, int h, bool pb) :
+        Drawable(vis, w, h, pb)
+    {}
+
+    void
+    swapBuffers(void) override {
+    }
+};
+
+
+class NullContext : public Context
+{
+public:
+    glnull::Context *context;
+
+    NullContext(const Visual *vis, glnull::Context *ctx) :
+        Context(vis),
+        context(ctx)
+    {}
+
+    ~NullContext() {
+        glnull::destroyContext(context);
+    }
+};
+
+
+class NullBackend : public Backend
+{
+public:
+    void
+    init(void) override {
+        glnull::install();
+    }
+
+    void
+    cleanup(void) override {
+    }
+
+    Visual *
+    createVisual(bool doubleBuffer, unsigned samples, Profile profile) override {
+        Visual *visual = new Visual(profile);
+        visual->doubleBuffer = doubleBuffer;
+        return visual;
+    }
+
+    Drawable *
+    createDrawable(const Visual *visual, int width, int height,
+                   const glws::pbuffer_info *pbInfo) override {
+        return new NullDrawable(visual, width, height, pbInfo != NULL);
+    }
+
+    Context *
+    createContext(const Visual *visual, Context *shareContext, bool debug) override {
+        glnull::Context *share = NULL;
+        if (shareContext) {
+            share = static_cast<NullContext *>(shareContext)->context;
+        }
+        return new NullContext(visual, glnull::createContext(visual->profile, share));
+    }
+
+    bool
+    processEvents(void) override {
+        return false;
+    }
+
+    bool
+    bindTexImage(Drawable *pBuffer, int iBuffer) override {
+        return true;
+    }
+
+    bool
+    releaseTexImage(Drawable *pBuffer, int iBuffer) override {
+        return true;
+    }
+
+    bool
+    setPbufferAttrib(Drawable *pBuffer, const int *attribList) override {
+        return true;
+    }
+
+protected:
+    bool
+    makeCurrentInternal(Drawable *drawable, Context *context) override {
+        glnull::makeCurrent(context ? static_cast<NullContext *>(context)->context : NULL);
+        return true;
+    }
+};
+
+
+Backend *
+getNullBackend(void)
+{
+    static NullBackend backend;
+    return &backend;
+}
+
+
+} /* namespace glws */
@@ -29,24 +29,66 @@
 
 
 #include <assert.h>
+#include <locale.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <string.h>
 
-#include <sstream>
+#include <algorithm>
+#include <cmath> // for std::isinf, std::isnan; as C99 macros are unavailable in C++11
 
 #include "json.hpp"
 
 
+#if defined(__i386__) || defined(_M_IX86) || \
+    defined(__x86_64__) || defined(_M_X64) || defined(_M_AMD64)
+#  define HAVE_X86
+#endif
+
+
+// The SSSE3 code is built regardless of the baseline instruction set, and is
+// only used if the CPU supports it.
+#if defined(HAVE_X86) && (defined(__GNUC__) || defined(_MSC_VER))
+#  define HAVE_SSSE3_DISPATCH
+#  include <tmmintrin.h>
+#  ifdef _MSC_VER
+#    include <intrin.h>
+#    define TARGET_SSSE3
+#  else
+#    define TARGET_SSSE3 __attribute__((target("ssse3")))
+#  endif
+#endif
+
+
+// Buffered output is written out once it exceeds this size
+#define FLUSH_SIZE (64 * 1024)
+
+// Base64 lines are wrapped at 76 characters, i.e., 19 groups of 3 bytes
+#define BASE64_LINE_GROUPS (76/4)
+
+
+void
+JSONWriter::flush(void) {
+    os.write(buffer.data(), buffer.size());
+    buffer.clear();
+}
+
 void
 JSONWriter::newline(void) {
-    os << "\n";
+    write('\n');
     for (int i = 0; i < level; ++i)
-        os << "  ";
+        write("  ", 2);
 }
 
 void
 JSONWriter::separator(void) {
+    // Every value starts here, so this is where to write out the buffer
+    if (buffer.size() >= FLUSH_SIZE) {
+        flush();
+    }
+
     if (value) {
-        os << ",";
+        write(',');
         switch (space) {
         case '\0':
             break;
@@ -54,7 +96,7 @@ JSONWriter::separator(void) {
             newline();
             break;
         default:
-            os << space;
+            write(space);
             break;
         }
     } else {
@@ -64,9 +106,17 @@ JSONWriter::separator(void) {
     }
 }
 
-static void
-escapeAsciiString(std::ostream &os, const char *str) {
-    os << "\"";
+static inline bool
+isPassThrough(unsigned c) {
+    return (c >= 0x20 && c <= 0x7e) ||
+           c == '\t' ||
+           c == '\r' ||
+           c == '\n';
+}
+
+void
+JSONWriter::escapeString(const char *str) {
+    write('"');
 
     const unsigned char *src = (const unsigned char *)str;
     unsigned char c;
@@ -74,28 +124,54 @@ escapeAsciiString(std::ostream &os, const char *str) {
         if ((c == '\"') ||
             (c == '\\')) {
             // escape character
-            os << '\\' << (unsigned char)c;
-        } else if ((c >= 0x20 && c <= 0x7e) ||
-                    c == '\t' ||
-                    c == '\r' ||
-                    c == '\n') {
+            write('\\');
+            write(c);
+        } else if (isPassThrough(c)) {
             // pass-through character
-            os << (unsigned char)c;
+            write(c);
         } else {
             assert(0);
-            os << "?";
+            write('?');
         }
     }
 
-    os << "\"";
+    write('"');
 }
 
-static void
-escapeUnicodeString(std::ostream &os, const char *str) {
-    os << "\"";
+void
+JSONWriter::escapeUnicodeString(const char *str) {
+    static const char hexDigits[] = "0123456789abcdef";
+
+    write('"');
+
+    // Most strings are plain ASCII, which needs no locale conversion
+    const unsigned char *ascii = (const unsigned char *)str;
+    unsigned char a;
+    while ((a = *ascii) && a < 0x80) {
+        const unsigned char *run = ascii;
+        while (*ascii && isPassThrough(*ascii) && *ascii != '"' && *ascii != '\\') {
+            ++ascii;
+        }
+        write((const char *)run, ascii - run);
+        a = *ascii;
+        if (a == '"' || a == '\\') {
+            write('\\');
+            write(a);
+            ++ascii;
+        } else if (a && a < 0x80) {
+            char escape[6] = {'\\', 'u', '0', '0', hexDigits[a >> 4], hexDigits[a & 0xf]};
+            write(escape, sizeof escape);
+            ++ascii;
+        }
+    }
+
+    if (!a) {
+        write('"');
+        return;
+    }
 
     const char *locale = setlocale(LC_CTYPE, "");
-    const char *src = str;
+    const char *src = (const char *)ascii;
     mbstate_t state;
 
     memset(&state, 0, sizeof state);
@@ -110,83 +186,303 @@ escapeUnicodeString(std::ostream &os, const char *str) {
             break;
         } if (written == (size_t)-1) {
             // conversion error -- skip
-            os << "?";
+            write('?');
             do {
                 ++src;
             } while (*src & 0x80);
         } else if ((c == '\"') ||
                    (c == '\\')) {
             // escape character
-            os << '\\' << (unsigned char)c;
-        } else if ((c >= 0x20 && c <= 0x7e) ||
-                    c == '\t' ||
-                    c == '\r' ||
-                    c == '\n') {
+            write('\\');
+            write((unsigned char)c);
+        } else if (isPassThrough(c)) {
             // pass-through character
-            os << (unsigned char)c;
+            write((unsigned char)c);
         } else {
             // unicode
-            os << "\\u" << std::hex << std::setfill('0') << std::setw(4) << (unsigned)c << std::setfill(' ') << std::dec;
+            char escape[32];
+            int length = snprintf(escape, sizeof escape, "\\u%04x", (unsigned)c);
+            write(escape, length);
         }
     } while (src);
 
     setlocale(LC_CTYPE, locale);
 
-    os << "\"";
+    write('"');
 }
 
+static const char table64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/*
+ * Encode groups of 3 bytes into 4 characters each.
+ */
 static void
-encodeBase64String(std::ostream &os, const unsigned char *bytes, size_t size) {
-    const char *table64 = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-    unsigned char c0, c1, c2, c3;
-    char buf[4];
-    unsigned written;
-
-    os << "\"";
-
-    written = 0;
-    while (size >= 3) {
-        c0 = bytes[0] >> 2;
-        c1 = ((bytes[0] & 0x03) << 4) | ((bytes[1] & 0xf0) >> 4);
-        c2 = ((bytes[1] & 0x0f) << 2) | ((bytes[2] & 0xc0) >> 6);
-        c3 = bytes[2] & 0x3f;
-
-        buf[0] = table64[c0];
-        buf[1] = table64[c1];
-        buf[2] = table64[c2];
-        buf[3] = table64[c3];
+encodeBase64Groups_c(const unsigned char *bytes, size_t groups, char *dst)
+{
+    for (size_t i = 0; i < groups; ++i) {
+        uint32_t v = (bytes[0] << 16) | (bytes[1] << 8) | bytes[2];
+        dst[0] = table64[v >> 18];
+        dst[1] = table64[(v >> 12) & 0x3f];
+        dst[2] = table64[(v >> 6) & 0x3f];
+        dst[3] = table64[v & 0x3f];
+        bytes += 3;
+        dst += 4;
+    }
+}
 
-        os.write(buf, 4);
 
-        bytes += 3;
-        size -= 3;
-        ++written;
+#ifdef HAVE_SSSE3_DISPATCH
+
+/*
+ * Encode 4 groups at a time, by shuffling 12 bytes into 16 lanes, extracting
+ * 6 bits per lane with multiplies, and mapping each 6 bit range of the
+ * alphabet with a table lookup of the offset to add.
+ */
+TARGET_SSSE3 static void
+encodeBase64Groups_ssse3(const unsigned char *bytes, size_t groups, char *dst)
+{
+    const __m128i shuffle = _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                          '/' - 63, 'A', 0, 0);
+
+    // Each iteration loads 16 bytes but consumes 12
+    while (groups >= 6) {
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes));
+        in = _mm_shuffle_epi8(in, shuffle);
+
+        const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+        const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+        const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+        const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+        const __m128i indices = _mm_or_si128(t1, t3);
+
+        // 0 for a-z, 1-10 for 0-9, 11 for +, 12 for /, 13 for A-Z
+        __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+        const __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+        range = _mm_or_si128(range, _mm_and_si128(upper, _mm_set1_epi8(13)));
+        const __m128i out = _mm_add_epi8(indices, _mm_shuffle_epi8(offsets, range));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), out);
+
+        bytes += 12;
+        dst += 16;
+        groups -= 4;
+    }
+
+    encodeBase64Groups_c(bytes, groups, dst);
+}
+
+
+static bool
+haveSSSE3(void)
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 9)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("ssse3");
+#endif
+}
+
+#endif /* HAVE_SSSE3_DISPATCH */
+
+
+typedef void (*EncodeBase64GroupsFunc)(const unsigned char *bytes, size_t groups, char *dst);
+
+
+static EncodeBase64GroupsFunc
+selectEncodeBase64Groups(void)
+{
+#ifdef HAVE_SSSE3_DISPATCH
+    if (haveSSSE3()) {
+        return encodeBase64Groups_ssse3;
+    }
+#endif
+    return encodeBase64Groups_c;
+}
+
+
+void
+JSONWriter::encodeBase64(const unsigned char *bytes, size_t size) {
+    static const EncodeBase64GroupsFunc encodeBase64Groups = selectEncodeBase64Groups();
+
+    write('"');
+
+    while (size) {
+        size_t groups = std::min<size_t>(size / 3, BASE64_LINE_GROUPS);
+        if (groups) {
+            size_t offset = buffer.size();
+            buffer.resize(offset + groups * 4);
+            encodeBase64Groups(bytes, groups, &buffer[offset]);
+            bytes += groups * 3;
+            size -= groups * 3;
+        }
+
+        if (groups < BASE64_LINE_GROUPS) {
+            break;
+        }
 
-        if (written >= 76/4 && size) {
-            os << "\n";
-            written = 0;
+        if (size) {
+            write('\n');
+        }
+
+        // Don't hold whole blobs in memory
+        if (buffer.size() >= FLUSH_SIZE) {
+            flush();
         }
     }
 
     if (size > 0) {
-        c0 = bytes[0] >> 2;
-        c1 = ((bytes[0] & 0x03) << 4);
-
+        char buf[4];
+        unsigned char c1 = (bytes[0] & 0x03) << 4;
         buf[3] = '=';
         if (size > 1) {
-            c1 |= ((bytes[1] & 0xf0) >> 4);
-            c2 = ((bytes[1] & 0x0f) << 2);
-            buf[2] = table64[c2];
+            c1 |= (bytes[1] & 0xf0) >> 4;
+            buf[2] = table64[(bytes[1] & 0x0f) << 2];
         } else {
             buf[2] = '=';
         }
         buf[1] = table64[c1];
-        buf[0] = table64[c0];
+        buf[0] = table64[bytes[0] >> 2];
+        write(buf, 4);
+    }
 
-        os.write(buf, 4);
+    write('"');
+}
+
+void
+JSONWriter::formatUInt(unsigned long long n) {
+    char digits[20];
+    char *p = digits + sizeof digits;
+    do {
+        *--p = '0' + n % 10;
+        n /= 10;
+    } while (n);
+    write(p, digits + sizeof digits - p);
+}
+
+static const double powersOf10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8,
+    1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17
+};
+
+/*
+ * Same as snprintf("%.*g") for values which are formatted without exponent,
+ * when precision is low enough for the digits to be computed exactly in
+ * double precision.  Returns 0 when the result would be uncertain, so that
+ * snprintf() must be used instead.
+ */
+static int
+formatFixedFloat(char *dst, double n, int precision)
+{
+    if (precision > 9) {
+        return 0;
+    }
+
+    // %g uses exponents below 1e-4 or from 10^precision on
+    double magnitude = std::fabs(n);
+    if (!(magnitude >= 1e-4 && magnitude < powersOf10[precision])) {
+        return 0;
+    }
+
+    // Decimal exponent, i.e., position of the first significant digit
+    int exponent = precision - 1;
+    while (exponent >= 0 && magnitude < powersOf10[exponent]) {
+        --exponent;
+    }
+    while (exponent < 0 && magnitude * powersOf10[-exponent] < 1.0) {
+        --exponent;
+    }
+
+    // Scaling by an exact power of ten rounds once, so the digits are
+    // certain, unless the value is very close to halfway between two
+    // candidates, or rounds up to another power of ten.
+    double scaled = magnitude * powersOf10[precision - 1 - exponent];
+    double integral = std::floor(scaled);
+    double fraction = scaled - integral;
+    if (std::fabs(fraction - 0.5) < 1e-6) {
+        return 0;
+    }
+    unsigned long digits = (unsigned long)integral + (fraction > 0.5);
+    if (digits < powersOf10[precision - 1] || digits >= powersOf10[precision]) {
+        return 0;
+    }
+
+    char significand[9];
+    for (int i = precision - 1; i >= 0; --i) {
+        significand[i] = '0' + digits % 10;
+        digits /= 10;
+    }
+    int length = precision;
+    while (length > std::max(exponent + 1, 1) && significand[length - 1] == '0') {
+        --length;
+    }
+
+    char *p = dst;
+    if (std::signbit(n)) {
+        *p++ = '-';
+    }
+    if (exponent >= 0) {
+        memcpy(p, significand, exponent + 1);
+        p += exponent + 1;
+        if (length > exponent + 1) {
+            *p++ = '.';
+            memcpy(p, significand + exponent + 1, length - exponent - 1);
+            p += length - exponent - 1;
+        }
+    } else {
+        *p++ = '0';
+        *p++ = '.';
+        for (int i = -1; i > exponent; --i) {
+            *p++ = '0';
+        }
+        memcpy(p, significand, length);
+        p += length;
     }
+    return p - dst;
+}
+
+void
+JSONWriter::formatFloat(double n, int precision) {
+    assert(precision > 0 && precision < (int)(sizeof powersOf10 / sizeof powersOf10[0]));
 
-    os << "\"";
+    separator();
+    if (std::isnan(n)) {
+        // NaN is non-standard but widely supported
+        write("NaN");
+    } else if (std::isinf(n)) {
+        // Infinite is non-standard but widely supported
+        if (n < 0) {
+            write('-');
+        }
+        write("Infinity");
+    } else {
+        // Integers below 10^precision, which are very common, are formatted
+        // without exponent nor decimal point
+        double magnitude = std::fabs(n);
+        if (magnitude < powersOf10[precision] &&
+            magnitude == std::floor(magnitude)) {
+            if (std::signbit(n)) {
+                write('-');
+            }
+            formatUInt((unsigned long long)magnitude);
+        } else {
+            // Same conversion as std::num_put
+            char digits[32];
+            int length = formatFixedFloat(digits, n, precision);
+            if (!length) {
+                length = snprintf(digits, sizeof digits, "%.*g", precision, n);
+                assert(length > 0 && length < (int)sizeof digits);
+            }
+            write(digits, length);
+        }
+    }
+    value = true;
+    space = ' ';
 }
 
 JSONWriter::JSONWriter(std::ostream &_os) :
@@ -195,18 +491,20 @@ JSONWriter::JSONWriter(std::ostream &_os) :
     value(false),
     space(0)
 {
+    buffer.reserve(FLUSH_SIZE + 4096);
     beginObject();
 }
 
 JSONWriter::~JSONWriter() {
     endObject();
     newline();
+    flush();
 }
 
 void
 JSONWriter::beginObject() {
     separator();
-    os << "{";
+    write('{');
     ++level;
     value = false;
 }
@@ -216,7 +514,7 @@ JSONWriter::endObject() {
     --level;
     if (value)
         newline();
-    os << "}";
+    write('}');
     value = true;
     space = '\n';
 }
@@ -226,8 +524,8 @@ JSONWriter::beginMember(const char * name) {
     space = 0;
     separator();
     newline();
-    escapeAsciiString(os, name);
-    os << ": ";
+    escapeString(name);
+    write(": ", 2);
     value = false;
 }
 
@@ -241,7 +539,7 @@ JSONWriter::endMember(void) {
 void
 JSONWriter::beginArray() {
     separator();
-    os << "[";
+    write('[');
     ++level;
     value = false;
     space = 0;
@@ -253,7 +551,7 @@ JSONWriter::endArray(void) {
     if (space == '\n') {
         newline();
     }
-    os << "]";
+    write(']');
     value = true;
     space = '\n';
 }
@@ -266,7 +564,7 @@ JSONWriter::writeString(const char *s) {
     }
 
     separator();
-    escapeUnicodeString(os, s);
+    escapeUnicodeString(s);
     value = true;
     space = ' ';
 }
@@ -274,7 +572,7 @@ JSONWriter::writeString(const char *s) {
 void
 JSONWriter::writeBase64(const void *bytes, size_t size) {
     separator();
-    encodeBase64String(os, (const unsigned char *)bytes, size);
+    encodeBase64((const unsigned char *)bytes, size);
     value = true;
     space = ' ';
 }
@@ -282,7 +580,7 @@ JSONWriter::writeBase64(const void *bytes, size_t size) {
 void
 JSONWriter::writeNull(void) {
     separator();
-    os << "null";
+    write("null", 4);
     value = true;
     space = ' ';
 }
@@ -290,7 +588,32 @@ JSONWriter::writeNull(void) {
 void
 JSONWriter::writeBool(bool b) {
     separator();
-    os << (b ? "true" : "false");
+    if (b) {
+        write("true", 4);
+    } else {
+        write("false", 5);
+    }
+    value = true;
+    space = ' ';
+}
+
+void
+JSONWriter::writeSInt(signed long long n) {
+    separator();
+    if (n < 0) {
+        write('-');
+        formatUInt(0ULL - (unsigned long long)n);
+    } else {
+        formatUInt(n);
+    }
+    value = true;
+    space = ' ';
+}
+
+void
+JSONWriter::writeUInt(unsigned long long n) {
+    separator();
+    formatUInt(n);
     value = true;
     space = ' ';
 }
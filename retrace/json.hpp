@@ -34,9 +34,6 @@
 #include <stddef.h>
 #include <wchar.h>
 
-#include <cmath> // for std::isinf, std::isnan; as C99 macros are unavailable in C++11
-
-#include <iomanip>
 #include <limits>
 #include <ostream>
 #include <string>
@@ -47,21 +44,58 @@ class JSONWriter
 private:
     std::ostream &os;
 
+    // Output is formatted here, and written to os in large chunks
+    std::string buffer;
+
     int level;
     bool value;
     char space;
 
+    inline void
+    write(char c) {
+        buffer.push_back(c);
+    }
+
+    inline void
+    write(const char *s, size_t length) {
+        buffer.append(s, length);
+    }
+
+    inline void
+    write(const char *s) {
+        buffer.append(s);
+    }
+
     void
     newline(void);
 
     void
     separator(void);
 
+    void
+    escapeString(const char *s);
+
+    void
+    escapeUnicodeString(const char *s);
+
+    void
+    encodeBase64(const unsigned char *bytes, size_t size);
+
+    void
+    formatUInt(unsigned long long n);
+
+    void
+    formatFloat(double n, int precision);
+
 public:
     JSONWriter(std::ostream &_os);
 
     ~JSONWriter();
 
+    /* Write out any buffered output. */
+    void
+    flush(void);
+
     void
     beginObject();
 
@@ -102,52 +136,28 @@ public:
     void
     writeBool(bool b);
 
-    /**
-     * Special case for char to prevent it to be written as a literal
-     * character.
-     */
-    inline void
-    writeInt(signed char n) {
-        separator();
-        os << std::dec << static_cast<int>(n);
-        value = true;
-        space = ' ';
-    }
+    void
+    writeSInt(signed long long n);
 
-    inline void
-    writeInt(unsigned char n) {
-        separator();
-        os << std::dec << static_cast<unsigned>(n);
-        value = true;
-        space = ' ';
-    }
+    void
+    writeUInt(unsigned long long n);
 
+    /**
+     * Characters are written as numbers too.
+     */
     template<class T>
     inline void
     writeInt(T n) {
-        separator();
-        os << std::dec << n;
-        value = true;
-        space = ' ';
+        if (std::numeric_limits<T>::is_signed) {
+            writeSInt(static_cast<signed long long>(n));
+        } else {
+            writeUInt(static_cast<unsigned long long>(n));
+        }
     }
 
     template<class T>
     void
     writeFloat(T n) {
-        separator();
-        if (std::isnan(n)) {
-            // NaN is non-standard but widely supported
-            os << "NaN";
-        } else if (std::isinf(n)) {
-            // Infinite is non-standard but widely supported
-            if (n < 0) {
-                os << '-';
-            }
-            os << "Infinity";
-        } else {
-            os << std::dec << std::setprecision(std::numeric_limits<T>::digits10 + 1) << n;
-        }
-        value = true;
-        space = ' ';
+        formatFloat(n, std::numeric_limits<T>::digits10 + 1);
     }
 };
@@ -0,0 +1,328 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "os_time.hpp"
+#include "image.hpp"
+#include "json.hpp"
+#include "state_writer.hpp"
+
+#include "gtest/gtest.h"
+
+
+// Reference output, as formatted by the original iostream based writer
+static const char *
+expectedValues =
+    "{\n"
+    "  \"null\": null,\n"
+    "  \"bool\": true,\n"
+    "  \"ints\": [0, -1, 127, 255, -9223372036854775808, 18446744073709551615],\n"
+    "  \"floats\": [0, -0, 1, 0.1, 0.3333333333333333, 1e+16, 3.4e+38, 1.401298e-45, NaN, -Infinity],\n"
+    "  \"string\": \"a\\\"b\\\\c\td\\u0001\",\n"
+    "  \"base64\": \"AAECAwQ=\",\n"
+    "  \"nested\": {\n"
+    "    \"empty\": [],\n"
+    "    \"objects\": [{},\n"
+    "      {\n"
+    "        \"x\": 1\n"
+    "      }\n"
+    "    ]\n"
+    "  }\n"
+    "}\n";
+
+
+TEST(JSONWriter, values)
+{
+    std::ostringstream os;
+    {
+        JSONWriter json(os);
+        json.beginMember("null");
+        json.writeNull();
+        json.endMember();
+        json.beginMember("bool");
+        json.writeBool(true);
+        json.endMember();
+        json.beginMember("ints");
+        json.beginArray();
+        json.writeInt(0);
+        json.writeInt((signed char)-1);
+        json.writeInt((signed char)127);
+        json.writeInt((unsigned char)255);
+        json.writeInt(std::numeric_limits<long long>::min());
+        json.writeInt(std::numeric_limits<unsigned long long>::max());
+        json.endArray();
+        json.endMember();
+        json.beginMember("floats");
+        json.beginArray();
+        json.writeFloat(0.0f);
+        json.writeFloat(-0.0);
+        json.writeFloat(1.0f);
+        json.writeFloat(0.1f);
+        json.writeFloat(1.0/3.0);
+        json.writeFloat(1e16);
+        json.writeFloat(3.4e38f);
+        json.writeFloat(std::numeric_limits<float>::denorm_min());
+        json.writeFloat(NAN);
+        json.writeFloat(-INFINITY);
+        json.endArray();
+        json.endMember();
+        json.beginMember("string");
+        json.writeString("a\"b\\c\td\x01");
+        json.endMember();
+        json.beginMember("base64");
+        const unsigned char bytes[] = {0, 1, 2, 3, 4};
+        json.writeBase64(bytes, sizeof bytes);
+        json.endMember();
+        json.beginMember("nested");
+        json.beginObject();
+        json.beginMember("empty");
+        json.beginArray();
+        json.endArray();
+        json.endMember();
+        json.beginMember("objects");
+        json.beginArray();
+        json.beginObject();
+        json.endObject();
+        json.beginObject();
+        json.beginMember("x");
+        json.writeInt(1);
+        json.endMember();
+        json.endObject();
+        json.endArray();
+        json.endMember();
+        json.endObject();
+        json.endMember();
+    }
+    EXPECT_EQ(expectedValues, os.str());
+}
+
+
+template< class T >
+static std::string
+streamFloat(T n)
+{
+    std::ostringstream os;
+    os << std::setprecision(std::numeric_limits<T>::digits10 + 1) << n;
+    return os.str();
+}
+
+
+template< class T >
+static std::string
+writeFloat(T n)
+{
+    std::ostringstream os;
+    {
+        JSONWriter json(os);
+        json.beginMember("f");
+        json.writeFloat(n);
+        json.endMember();
+    }
+    std::string s = os.str();
+    size_t begin = strlen("{\n  \"f\": ");
+    return s.substr(begin, s.size() - begin - strlen("\n}\n"));
+}
+
+
+TEST(JSONWriter, floats)
+{
+    srand(0);
+    for (unsigned i = 0; i < 10000; ++i) {
+        // Mix integral values with arbitrary bit patterns
+        double d = (rand() % 4) ? (double)(rand() - RAND_MAX/2) * pow(10.0, rand() % 20 - 4)
+                                : (double)(rand() % 100000000);
+        if (rand() % 8 == 0) {
+            d = floor(d);
+        }
+        float f = (float)d;
+        if (std::isfinite(d)) {
+            EXPECT_EQ(streamFloat(d), writeFloat(d));
+        }
+        if (std::isfinite(f)) {
+            EXPECT_EQ(streamFloat(f), writeFloat(f));
+        }
+    }
+
+    // Typical uniform values, and values around the switch to exponents
+    for (int i = -5000; i < 5000; ++i) {
+        float f = (float)i / 7.0f;
+        EXPECT_EQ(streamFloat(f), writeFloat(f));
+        f = (float)i * 1e-7f;
+        EXPECT_EQ(streamFloat(f), writeFloat(f));
+        f = 9999999.0f + (float)i / 16.0f;
+        EXPECT_EQ(streamFloat(f), writeFloat(f));
+    }
+
+    // Arbitrary bit patterns
+    for (unsigned i = 0; i < 100000; ++i) {
+        uint32_t bits = (uint32_t)rand() * 2654435761U + (uint32_t)i;
+        float f;
+        memcpy(&f, &bits, sizeof f);
+        if (std::isfinite(f)) {
+            EXPECT_EQ(streamFloat(f), writeFloat(f));
+        }
+    }
+}
+
+
+/*
+ * Straightforward base64 encoding, wrapped every 76 characters.
+ */
+static std::string
+referenceBase64(const unsigned char *bytes, size_t size)
+{
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string s = "\"";
+    size_t column = 0;
+    for (size_t i = 0; i < size; i += 3) {
+        if (column == 76) {
+            s += '\n';
+            column = 0;
+        }
+        uint32_t v = bytes[i] << 16;
+        if (i + 1 < size) v |= bytes[i + 1] << 8;
+        if (i + 2 < size) v |= bytes[i + 2];
+        s += table[(v >> 18) & 63];
+        s += table[(v >> 12) & 63];
+        s += i + 1 < size ? table[(v >> 6) & 63] : '=';
+        s += i + 2 < size ? table[v & 63] : '=';
+        column += 4;
+    }
+    return s + "\"";
+}
+
+
+TEST(JSONWriter, base64)
+{
+    std::vector<unsigned char> bytes(1000);
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        bytes[i] = (unsigned char)(i * 131 + (i >> 3));
+    }
+
+    for (size_t size = 0; size < bytes.size(); size += size < 200 ? 1 : 97) {
+        std::ostringstream os;
+        {
+            JSONWriter json(os);
+            json.beginMember("b");
+            json.writeBase64(bytes.data() + 1, size);
+            json.endMember();
+        }
+        std::string s = os.str();
+        size_t begin = strlen("{\n  \"b\": ");
+        EXPECT_EQ(referenceBase64(bytes.data() + 1, size),
+                  s.substr(begin, s.size() - begin - strlen("\n}\n"))) << "size " << size;
+    }
+}
+
+
+/*
+ * Not really a test, but a benchmark of dumping a synthetic state with many
+ * uniforms, large buffers, and images, as `glretrace -D` would.
+ */
+TEST(JSONWriter, Benchmark)
+{
+    const unsigned numUniforms = 20000;
+    const unsigned numBuffers = 8;
+    const size_t bufferSize = 4 << 20;
+    const unsigned numImages = 4;
+
+    std::vector<unsigned char> buffer(bufferSize);
+    for (size_t i = 0; i < bufferSize; ++i) {
+        buffer[i] = (unsigned char)(i * 2654435761U >> 24);
+    }
+
+    // Float images are written as PNM, so their cost is mostly base64
+    std::unique_ptr<image::Image> image(new image::Image(512, 512, 4, false, image::TYPE_FLOAT));
+    float *pixels = reinterpret_cast<float *>(image->pixels);
+    for (size_t i = 0; i < 512 * 512 * 4; ++i) {
+        pixels[i] = (float)(i % 1000) / 999.0f;
+    }
+
+    std::ostringstream os;
+    long long start = os::getTime();
+    {
+        std::unique_ptr<StateWriter> writer(createJSONStateWriter(os));
+
+        writer->beginMember("uniforms");
+        writer->beginObject();
+        for (unsigned i = 0; i < numUniforms; ++i) {
+            writer->beginMember("u_matrix" + std::to_string(i));
+            writer->beginArray();
+            for (unsigned j = 0; j < 16; ++j) {
+                writer->writeFloat((float)(i + j) / 7.0f);
+            }
+            writer->endArray();
+            writer->endMember();
+            writer->writeIntMember(("u_index" + std::to_string(i)).c_str(), i * 1000003U);
+        }
+        writer->endObject();
+        writer->endMember();
+
+        writer->beginMember("buffers");
+        writer->beginArray();
+        for (unsigned i = 0; i < numBuffers; ++i) {
+            writer->writeBlob(buffer.data(), buffer.size());
+        }
+        writer->endArray();
+        writer->endMember();
+
+        writer->beginMember("textures");
+        writer->beginArray();
+        for (unsigned i = 0; i < numImages; ++i) {
+            StateWriter::ImageDesc desc;
+            desc.format = "GL_RGBA32F";
+            writer->writeImage(image.get(), desc);
+        }
+        writer->endArray();
+        writer->endMember();
+    }
+    long long time = os::getTime() - start;
+
+    double bytes = os.str().size();
+    std::cout << bytes / (1 << 20) << " MB in "
+              << time * 1.0e3 / os::timeFrequency << " ms: "
+              << bytes / (time * 1.0 / os::timeFrequency) / (1 << 20) << " MB/s\n";
+}
+
+
+int
+main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,424 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+#include <string.h>
+
+#include <iostream>
+
+#ifdef __linux__
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "metric_backend_perf.hpp"
+
+
+// largest number of counters in a group
+#define MAX_GROUP_SIZE 8
+
+
+#ifdef __linux__
+
+static int
+openEvent(uint32_t type, uint64_t config, bool excludeKernel, int groupFd)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof attr);
+    attr.size = sizeof attr;
+    attr.type = type;
+    attr.config = config;
+    attr.exclude_kernel = excludeKernel;
+    attr.exclude_hv = 1;
+    if (groupFd < 0) {
+        attr.read_format = PERF_FORMAT_GROUP |
+                           PERF_FORMAT_TOTAL_TIME_ENABLED |
+                           PERF_FORMAT_TOTAL_TIME_RUNNING;
+    }
+    return syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, PERF_FLAG_FD_CLOEXEC);
+}
+
+#endif /* __linux__ */
+
+
+Metric_perf::Metric_perf(unsigned gId, unsigned id, const std::string &name,
+                         const std::string &desc, MetricNumType nT, MetricType t)
+    : m_gId(gId), m_id(id), m_name(name), m_desc(desc), m_nType(nT),
+      m_type(t), eventType(0), eventConfig(0), excludeKernel(false),
+      available(false)
+{
+    for (int i = 0; i < QUERY_BOUNDARY_LIST_END; i++) {
+        enabled[i] = false;
+    }
+}
+
+unsigned Metric_perf::id() {
+    return m_id;
+}
+
+unsigned Metric_perf::groupId() {
+    return m_gId;
+}
+
+std::string Metric_perf::name() {
+    return m_name;
+}
+
+std::string Metric_perf::description() {
+    return m_desc;
+}
+
+MetricNumType Metric_perf::numType() {
+    return m_nType;
+}
+
+MetricType Metric_perf::type() {
+    return m_type;
+}
+
+MetricBackend_perf::MetricBackend_perf(MmapAllocator<char> &alloc)
+    : alloc(alloc)
+{
+    for (int i = 0; i < GROUP_LIST_END; i++) {
+        leaders[i] = -1;
+    }
+    for (int i = 0; i < QUERY_BOUNDARY_LIST_END; i++) {
+        boundaryEnabled[i] = false;
+        queryInProgress[i] = false;
+    }
+
+#ifdef __linux__
+    // Add metrics below
+    metrics.emplace_back(GROUP_SOFTWARE, 0, "Task Clock", "CPU time of the retracing thread, in nanoseconds",
+                         CNT_NUM_INT64, CNT_TYPE_DURATION);
+    metrics.back().eventType = PERF_TYPE_SOFTWARE;
+    metrics.back().eventConfig = PERF_COUNT_SW_TASK_CLOCK;
+    metrics.emplace_back(GROUP_SOFTWARE, 1, "Page Faults", "",
+                         CNT_NUM_INT64, CNT_TYPE_GENERIC);
+    metrics.back().eventType = PERF_TYPE_SOFTWARE;
+    metrics.back().eventConfig = PERF_COUNT_SW_PAGE_FAULTS;
+    metrics.emplace_back(GROUP_SOFTWARE, 2, "Context Switches", "",
+                         CNT_NUM_INT64, CNT_TYPE_GENERIC);
+    metrics.back().eventType = PERF_TYPE_SOFTWARE;
+    metrics.back().eventConfig = PERF_COUNT_SW_CONTEXT_SWITCHES;
+    metrics.emplace_back(GROUP_SOFTWARE, 3, "CPU Migrations", "",
+                         CNT_NUM_INT64, CNT_TYPE_GENERIC);
+    metrics.back().eventType = PERF_TYPE_SOFTWARE;
+    metrics.back().eventConfig = PERF_COUNT_SW_CPU_MIGRATIONS;
+    metrics.emplace_back(GROUP_HARDWARE, 0, "Instructions", "Retired instructions",
+                         CNT_NUM_INT64, CNT_TYPE_GENERIC);
+    metrics.back().eventType = PERF_TYPE_HARDWARE;
+    metrics.back().eventConfig = PERF_COUNT_HW_INSTRUCTIONS;
+    metrics.emplace_back(GROUP_HARDWARE, 1, "Cycles", "",
+                         CNT_NUM_INT64, CNT_TYPE_GENERIC);
+    metrics.back().eventType = PERF_TYPE_HARDWARE;
+    metrics.back().eventConfig = PERF_COUNT_HW_CPU_CYCLES;
+    metrics.emplace_back(GROUP_HARDWARE, 2, "Cache Misses", "Last level cache misses",
+                         CNT_NUM_INT64, CNT_TYPE_GENERIC);
+    metrics.back().eventType = PERF_TYPE_HARDWARE;
+    metrics.back().eventConfig = PERF_COUNT_HW_CACHE_MISSES;
+    metrics.emplace_back(GROUP_HARDWARE, 3, "Branch Misses", "",
+                         CNT_NUM_INT64, CNT_TYPE_GENERIC);
+    metrics.back().eventType = PERF_TYPE_HARDWARE;
+    metrics.back().eventConfig = PERF_COUNT_HW_BRANCH_MISSES;
+
+    // Probe which counters can be opened.  Like perf itself, count kernel
+    // activity too unless perf_event_paranoid forbids it.
+    for (auto &m : metrics) {
+        int fd = openEvent(m.eventType, m.eventConfig, false, -1);
+        if (fd < 0 && (errno == EACCES || errno == EPERM)) {
+            m.excludeKernel = true;
+            fd = openEvent(m.eventType, m.eventConfig, true, -1);
+        }
+        if (fd >= 0) {
+            m.available = true;
+            close(fd);
+        }
+    }
+#endif
+
+    // populate lookups
+    for (auto &m : metrics) {
+        idLookup[std::make_pair(m.groupId(), m.id())] = &m;
+        nameLookup[m.name()] = &m;
+    }
+
+    fds.resize(metrics.size(), -1);
+    groupIndex.resize(metrics.size(), 0);
+    counts.resize(metrics.size(), 0);
+}
+
+MetricBackend_perf::~MetricBackend_perf() {
+    closeEvents();
+}
+
+
+bool MetricBackend_perf::isSupported() {
+    for (auto &m : metrics) {
+        if (m.available) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void MetricBackend_perf::enumGroups(enumGroupsCallback callback, void* userData) {
+    for (unsigned g = 0; g < GROUP_LIST_END; g++) {
+        for (auto &m : metrics) {
+            if (m.groupId() == g && m.available) {
+                callback(g, 0, userData);
+                break;
+            }
+        }
+    }
+}
+
+std::string MetricBackend_perf::getGroupName(unsigned group) {
+    switch(group) {
+        case GROUP_SOFTWARE:
+            return "Software";
+        case GROUP_HARDWARE:
+            return "Hardware";
+        default:
+            return "";
+    }
+}
+
+void MetricBackend_perf::enumMetrics(unsigned group, enumMetricsCallback callback, void* userData) {
+    for (auto &m : metrics) {
+        if (m.groupId() == group && m.available) {
+            callback(&m, 0, userData);
+        }
+    }
+}
+
+std::unique_ptr<Metric>
+MetricBackend_perf::getMetricById(unsigned groupId, unsigned metricId) {
+    auto entryToCopy = idLookup.find(std::make_pair(groupId, metricId));
+    if (entryToCopy != idLookup.end()) {
+        return std::unique_ptr<Metric>(new Metric_perf(*entryToCopy->second));
+    } else {
+        return nullptr;
+    }
+}
+
+std::unique_ptr<Metric>
+MetricBackend_perf::getMetricByName(std::string metricName) {
+    auto entryToCopy = nameLookup.find(metricName);
+    if (entryToCopy != nameLookup.end()) {
+        return std::unique_ptr<Metric>(new Metric_perf(*entryToCopy->second));
+    } else {
+        return nullptr;
+    }
+}
+
+
+int MetricBackend_perf::enableMetric(Metric* metric, QueryBoundary pollingRule) {
+    // metric is not necessarily the same object as in metrics[]
+    auto entry = idLookup.find(std::make_pair(metric->groupId(), metric->id()));
+    if ((entry != idLookup.end()) && entry->second->available) {
+        entry->second->enabled[pollingRule] = true;
+        return 0;
+    }
+    return 1;
+}
+
+unsigned MetricBackend_perf::generatePasses() {
+    // draw calls profiling not needed if all calls are profiled
+    for (auto &m : metrics) {
+        if (m.enabled[QUERY_BOUNDARY_CALL]) {
+            m.enabled[QUERY_BOUNDARY_DRAWCALL] = false;
+        }
+    }
+    // setup storage for profiled metrics
+    for (int j = 0; j < QUERY_BOUNDARY_LIST_END; j++) {
+        data[j].resize(metrics.size());
+        starts[j].resize(metrics.size(), 0);
+        for (unsigned i = 0; i < metrics.size(); i++) {
+            if (metrics[i].enabled[j]) {
+                data[j][i] = std::unique_ptr<Storage>(new Storage(MmapAllocator<int64_t>(alloc)));
+                boundaryEnabled[j] = true;
+            }
+        }
+    }
+    // all counters are read together, so a single pass always suffices
+    return 1;
+}
+
+void MetricBackend_perf::beginPass() {
+#ifdef __linux__
+    // Open one group per kind of counter, so that software counters keep
+    // counting while hardware ones are multiplexed out.
+    for (unsigned i = 0; i < metrics.size(); i++) {
+        Metric_perf &m = metrics[i];
+        bool enabled = false;
+        for (int j = 0; j < QUERY_BOUNDARY_LIST_END; j++) {
+            enabled = enabled || m.enabled[j];
+        }
+        if (!enabled) {
+            continue;
+        }
+        int &leader = leaders[m.groupId()];
+        fds[i] = openEvent(m.eventType, m.eventConfig, m.excludeKernel, leader);
+        if (fds[i] < 0) {
+            std::cerr << "warning: failed to open perf event for metric \""
+                      << m.name() << "\": " << strerror(errno) << "\n";
+            continue;
+        }
+        if (leader < 0) {
+            leader = fds[i];
+        }
+    }
+
+    // Assign each counter its position in the group's read buffer, which
+    // follows the order in which the counters were added to the group.
+    unsigned groupSizes[GROUP_LIST_END] = {0};
+    for (unsigned i = 0; i < metrics.size(); i++) {
+        if (fds[i] >= 0) {
+            groupIndex[i] = groupSizes[metrics[i].groupId()]++;
+        }
+    }
+#endif
+}
+
+void MetricBackend_perf::closeEvents() {
+#ifdef __linux__
+    for (auto &fd : fds) {
+        if (fd >= 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+#endif
+    for (int i = 0; i < GROUP_LIST_END; i++) {
+        leaders[i] = -1;
+    }
+}
+
+void MetricBackend_perf::endPass() {
+    closeEvents();
+}
+
+void MetricBackend_perf::pausePass() {
+    // counters belong to the thread, not to the context, so keep counting
+}
+
+void MetricBackend_perf::continuePass() {
+}
+
+void MetricBackend_perf::readCounts() {
+#ifdef __linux__
+    for (int g = 0; g < GROUP_LIST_END; g++) {
+        if (leaders[g] < 0) {
+            continue;
+        }
+
+        // nr, time_enabled, time_running, then one value per counter
+        uint64_t values[3 + MAX_GROUP_SIZE];
+        ssize_t size = read(leaders[g], values, sizeof values);
+        if (size < (ssize_t)(3 * sizeof values[0])) {
+            continue;
+        }
+        uint64_t nr = values[0];
+        uint64_t enabled = values[1];
+        uint64_t running = values[2];
+
+        for (unsigned i = 0; i < metrics.size(); i++) {
+            if (fds[i] < 0 || metrics[i].groupId() != (unsigned)g ||
+                groupIndex[i] >= nr) {
+                continue;
+            }
+            uint64_t value = values[3 + groupIndex[i]];
+            // scale counts when the group was multiplexed
+            if (running && running < enabled) {
+                value = (uint64_t)((double)value * enabled / running);
+            }
+            counts[i] = (int64_t)value;
+        }
+    }
+#endif
+}
+
+void MetricBackend_perf::beginQuery(QueryBoundary boundary) {
+    // DRAWCALL is a CALL
+    bool call = boundary == QUERY_BOUNDARY_DRAWCALL && boundaryEnabled[QUERY_BOUNDARY_CALL];
+    if (boundaryEnabled[boundary] || call) {
+        readCounts();
+        if (boundaryEnabled[boundary]) {
+            starts[boundary] = counts;
+            queryInProgress[boundary] = true;
+        }
+        if (call) {
+            starts[QUERY_BOUNDARY_CALL] = counts;
+            queryInProgress[QUERY_BOUNDARY_CALL] = true;
+        }
+    }
+}
+
+void MetricBackend_perf::endQuery(QueryBoundary boundary) {
+    // DRAWCALL is a CALL
+    bool call = boundary == QUERY_BOUNDARY_DRAWCALL && queryInProgress[QUERY_BOUNDARY_CALL];
+    if (queryInProgress[boundary] || call) {
+        readCounts();
+        if (queryInProgress[boundary]) {
+            addData(boundary);
+        }
+        if (call) {
+            addData(QUERY_BOUNDARY_CALL);
+        }
+    }
+}
+
+void MetricBackend_perf::addData(QueryBoundary boundary) {
+    for (unsigned i = 0; i < metrics.size(); i++) {
+        if (metrics[i].enabled[boundary]) {
+            data[boundary][i]->push_back(counts[i] - starts[boundary][i]);
+        }
+    }
+    queryInProgress[boundary] = false;
+}
+
+void MetricBackend_perf::enumDataQueryId(unsigned id, enumDataCallback callback,
+                                         QueryBoundary boundary, void* userData) {
+    for (unsigned i = 0; i < metrics.size(); i++) {
+        Metric_perf &metric = metrics[i];
+        if (metric.enabled[boundary]) {
+            Storage &storage = *data[boundary][i];
+            void *value = id < storage.size() ? &storage[id] : nullptr;
+            callback(&metric, id, value, 0, userData);
+        }
+    }
+}
+
+unsigned MetricBackend_perf::getNumPasses() {
+    return 1;
+}
+
+MetricBackend_perf&
+MetricBackend_perf::getInstance(MmapAllocator<char> &alloc) {
+    static MetricBackend_perf backend(alloc);
+    return backend;
+}
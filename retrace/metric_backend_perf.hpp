@@ -0,0 +1,168 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Metric backend reading CPU counters through Linux perf events.
+ *
+ * Counters are opened on the thread which begins the pass, and read with a
+ * single read() per counter group at every query boundary.  Software
+ * counters are always available where perf events are; hardware counters
+ * are only listed if the PMU exposes them to this process (they are usually
+ * missing in virtual machines, or when perf_event_paranoid forbids them).
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "metric_backend.hpp"
+#include "mmap_allocator.hpp"
+
+
+class Metric_perf : public Metric
+{
+private:
+    unsigned m_gId, m_id;
+    std::string m_name, m_desc;
+    MetricNumType m_nType;
+    MetricType m_type;
+
+public:
+    Metric_perf(unsigned gId, unsigned id, const std::string &name,
+                const std::string &desc, MetricNumType nT, MetricType t);
+
+    unsigned id() override;
+
+    unsigned groupId() override;
+
+    std::string name() override;
+
+    std::string description() override;
+
+    MetricNumType numType() override;
+
+    MetricType type() override;
+
+    // should be set by backend
+    uint32_t eventType;
+    uint64_t eventConfig;
+    bool excludeKernel;
+    bool available;
+    bool enabled[QUERY_BOUNDARY_LIST_END]; // enabled for profiling
+};
+
+
+class MetricBackend_perf : public MetricBackend
+{
+private:
+    MmapAllocator<char> alloc;
+
+    // metric groups, each read with a single read() when enabled
+    enum {
+        GROUP_SOFTWARE = 0,
+        GROUP_HARDWARE,
+        GROUP_LIST_END
+    };
+
+    std::vector<Metric_perf> metrics;
+
+    // lookup tables
+    std::map<std::pair<unsigned,unsigned>, Metric_perf*> idLookup;
+    std::map<std::string, Metric_perf*> nameLookup;
+
+    // perf event file descriptors, indexed like metrics, and group leaders
+    std::vector<int> fds;
+    int leaders[GROUP_LIST_END];
+
+    // position of each metric in its group's read buffer
+    std::vector<unsigned> groupIndex;
+
+    bool boundaryEnabled[QUERY_BOUNDARY_LIST_END];
+    bool queryInProgress[QUERY_BOUNDARY_LIST_END];
+
+    // counter values at the beginning of each boundary, indexed like metrics
+    std::vector<int64_t> counts;
+    std::vector<int64_t> starts[QUERY_BOUNDARY_LIST_END];
+
+    typedef std::deque<int64_t, MmapAllocator<int64_t>> Storage;
+    std::vector<std::unique_ptr<Storage>> data[QUERY_BOUNDARY_LIST_END];
+
+    MetricBackend_perf(MmapAllocator<char> &alloc);
+
+    MetricBackend_perf(MetricBackend_perf const&) = delete;
+
+    void operator=(MetricBackend_perf const&)     = delete;
+
+public:
+    ~MetricBackend_perf();
+
+    bool isSupported() override;
+
+    void enumGroups(enumGroupsCallback callback, void* userData = nullptr) override;
+
+    void enumMetrics(unsigned group, enumMetricsCallback callback, void* userData = nullptr) override;
+
+    std::unique_ptr<Metric> getMetricById(unsigned groupId, unsigned metricId) override;
+
+    std::unique_ptr<Metric> getMetricByName(std::string metricName) override;
+
+    std::string getGroupName(unsigned group) override;
+
+    int enableMetric(Metric* metric, QueryBoundary pollingRule = QUERY_BOUNDARY_DRAWCALL) override;
+
+    unsigned generatePasses() override;
+
+    void beginPass() override;
+
+    void endPass() override;
+
+    void pausePass() override;
+
+    void continuePass() override;
+
+    void beginQuery(QueryBoundary boundary = QUERY_BOUNDARY_DRAWCALL) override;
+
+    void endQuery(QueryBoundary boundary = QUERY_BOUNDARY_DRAWCALL) override;
+
+    void enumDataQueryId(unsigned id, enumDataCallback callback,
+                         QueryBoundary boundary, void* userData = nullptr) override;
+
+    unsigned getNumPasses() override;
+
+    static MetricBackend_perf& getInstance(MmapAllocator<char> &alloc);
+
+private:
+    void closeEvents(void);
+
+    void readCounts(void);
+
+    void addData(QueryBoundary boundary);
+};
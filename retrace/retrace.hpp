@@ -225,6 +225,16 @@ public:
 };
 
 
+/**
+ * Handle to a snapshot whose readback is still in flight.
+ */
+class SnapshotReadback
+{
+public:
+    virtual ~SnapshotReadback() {}
+};
+
+
 class Dumper
 {
 public:
@@ -234,6 +244,26 @@ public:
     virtual image::Image *
     getSnapshot(int n) = 0;
 
+    /**
+     * Start reading back a snapshot without waiting for it.  Returns NULL
+     * when asynchronous readback isn't possible, in which case getSnapshot
+     * should be used instead.
+     */
+    virtual SnapshotReadback *
+    beginSnapshot(int n) {
+        return NULL;
+    }
+
+    /**
+     * Wait for a readback to complete and return its image, taking
+     * ownership of the readback.
+     */
+    virtual image::Image *
+    endSnapshot(SnapshotReadback *readback) {
+        delete readback;
+        return NULL;
+    }
+
     virtual bool
     canDump(void) = 0;
 
@@ -257,6 +287,13 @@ addCallbacks(retrace::Retracer &retracer);
 void
 frameComplete(trace::Call &call);
 
+/**
+ * Complete all pending asynchronous snapshot readbacks.  Must be called
+ * before the current context is released or another thread takes over.
+ */
+void
+flushSnapshots(void);
+
 
 /**
  * Flush rendering (called when switching threads).
@@ -30,6 +30,12 @@
 #include <limits.h> // for CHAR_MAX
 #include <memory> // for unique_ptr
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <deque>
+#include <map>
+#include <set>
+#include <vector>
 #include <getopt.h>
 #ifndef _WIN32
 #include <unistd.h> // for isatty()
@@ -55,14 +61,18 @@ static const char *snapshotPrefix = "";
 static enum {
     PNM_FMT,
     RAW_RGB,
-    RAW_MD5
+    RAW_MD5,
+    RAW_HASH
 } snapshotFormat = PNM_FMT;
 
 static trace::CallSet snapshotFrequency;
 static unsigned snapshotInterval = 0;
+static unsigned snapshotLatency = 0;
 
 static unsigned dumpStateCallNo = ~0;
 
+static bool serverMode = false;
+
 retrace::Retracer retracer;
 
 
@@ -156,11 +166,235 @@ Dumper *dumper = &defaultDumper;
 
 typedef StateWriter *(*StateWriterFactory)(std::ostream &);
 static StateWriterFactory stateWriterFactory = createJSONStateWriter;
+static const char *dumpImagesDirectory = NULL;
 
 
 static Snapshotter *snapshotter;
 
 
+/*
+ * Snapshot comparison against a golden file, as written by
+ * `-s - --snapshot-format=HASH`: one "<label> <hash>" line per snapshot.
+ */
+static bool comparingSnapshots = false;
+static std::map<std::string, std::string> goldenHashes;
+
+struct SnapshotMismatch {
+    std::string label;
+    std::string expected;
+    std::string actual;
+};
+
+static unsigned snapshotsMatched = 0;
+static std::vector<SnapshotMismatch> snapshotMismatches;
+static std::set<std::string> snapshotsTaken;
+
+
+static bool
+readGoldenHashes(const char *filename)
+{
+    std::ifstream is(filename);
+    if (!is) {
+        std::cerr << "error: failed to open " << filename << "\n";
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(is, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        size_t space = line.find(' ');
+        if (space == std::string::npos) {
+            std::cerr << "error: unexpected line `" << line << "` in " << filename << "\n";
+            return false;
+        }
+        goldenHashes[line.substr(0, space)] = line.substr(space + 1);
+    }
+
+    return true;
+}
+
+
+/**
+ * Check a snapshot against its golden hash, returning whether it matched.
+ */
+static bool
+compareSnapshot(const char *label, const image::Image *image)
+{
+    char actual[17];
+    snprintf(actual, sizeof actual, "%016llx", (unsigned long long)image->hash64());
+
+    snapshotsTaken.insert(label);
+
+    std::map<std::string, std::string>::const_iterator it = goldenHashes.find(label);
+    if (it != goldenHashes.end() && it->second == actual) {
+        ++snapshotsMatched;
+        return true;
+    }
+
+    SnapshotMismatch mismatch;
+    mismatch.label = label;
+    mismatch.expected = it != goldenHashes.end() ? it->second : "";
+    mismatch.actual = actual;
+    snapshotMismatches.push_back(mismatch);
+
+    std::cerr << label << ": warning: snapshot mismatch\n";
+
+    return false;
+}
+
+
+/**
+ * Print the comparison results as JSON, and return the exit code.
+ *
+ * Golden snapshots that were never taken (e.g. because the replay ended
+ * early) are reported as mismatches with a null actual hash.
+ */
+static int
+finishSnapshotComparison(void)
+{
+    if (!comparingSnapshots) {
+        return 0;
+    }
+
+    std::map<std::string, std::string>::const_iterator it;
+    for (it = goldenHashes.begin(); it != goldenHashes.end(); ++it) {
+        if (snapshotsTaken.find(it->first) == snapshotsTaken.end()) {
+            SnapshotMismatch mismatch;
+            mismatch.label = it->first;
+            mismatch.expected = it->second;
+            snapshotMismatches.push_back(mismatch);
+
+            std::cerr << it->first << ": warning: snapshot missing\n";
+        }
+    }
+
+    std::cout << "{\"matched\": " << snapshotsMatched
+              << ", \"mismatched\": " << snapshotMismatches.size()
+              << ", \"mismatches\": [";
+    for (size_t i = 0; i < snapshotMismatches.size(); ++i) {
+        const SnapshotMismatch &mismatch = snapshotMismatches[i];
+        std::cout << (i ? ", " : "")
+                  << "{\"snapshot\": \"" << mismatch.label << "\""
+                  << ", \"expected\": " ;
+        if (mismatch.expected.empty()) {
+            std::cout << "null";
+        } else {
+            std::cout << "\"" << mismatch.expected << "\"";
+        }
+        std::cout << ", \"actual\": ";
+        if (mismatch.actual.empty()) {
+            std::cout << "null";
+        } else {
+            std::cout << "\"" << mismatch.actual << "\"";
+        }
+        std::cout << "}";
+    }
+    std::cout << "]}" << std::endl;
+
+    return snapshotMismatches.empty() ? 0 : 1;
+}
+
+
+/**
+ * Label, compare, and/or write out a snapshot, taking ownership of the image.
+ */
+static void
+writeSnapshot(unsigned call_no, int mrt, unsigned snapshot_no, image::Image *image) {
+    std::unique_ptr<image::Image> src(image);
+
+    unsigned no = useCallNos ? call_no : snapshot_no;
+
+    /* Name snapshots the same way for files, hashes, and comparison */
+    os::String label;
+    if (!retrace::snapshotMRT) {
+        assert(mrt == 0);
+        label = os::String::format("%010u", no);
+    } else if (mrt == -2) {
+        /* stencil */
+        label = os::String::format("%010u-s", no);
+    } else if (mrt == -1) {
+        /* depth */
+        label = os::String::format("%010u-z", no);
+    } else {
+        label = os::String::format("%010u-mrt%u", no, mrt);
+    }
+
+    if (comparingSnapshots) {
+        if (compareSnapshot(label, src.get()) ||
+            snapshotPrefix[0] == 0 ||
+            (snapshotPrefix[0] == '-' && snapshotPrefix[1] == 0)) {
+            return;
+        }
+    } else if (snapshotPrefix[0] == '-' && snapshotPrefix[1] == 0) {
+        char comment[21];
+        snprintf(comment, sizeof comment, "%u", no);
+        switch (snapshotFormat) {
+        case PNM_FMT:
+            src->writePNM(std::cout, comment);
+            break;
+        case RAW_RGB:
+            src->writeRAW(std::cout);
+            break;
+        case RAW_MD5:
+            src->writeMD5(std::cout);
+            break;
+        case RAW_HASH:
+            src->writeHash(std::cout, label);
+            break;
+        default:
+            assert(0);
+            break;
+        }
+        return;
+    }
+
+    os::String filename = os::String::format("%s%s.png", snapshotPrefix, (const char *)label);
+
+    // Here we release our ownership on the Image, it is now the
+    // responsibility of the snapshotter to delete it.
+    snapshotter->writePNG(filename, src.release());
+}
+
+
+/*
+ * Snapshots being read back asynchronously (with --snapshot-latency), oldest
+ * first.
+ */
+struct PendingSnapshot {
+    SnapshotReadback *readback;
+    unsigned call_no;
+    int mrt;
+    unsigned snapshot_no;
+};
+
+static std::deque<PendingSnapshot> pendingSnapshots;
+
+
+static void
+finishSnapshot(const PendingSnapshot &pending) {
+    image::Image *src = dumper->endSnapshot(pending.readback);
+    if (!src) {
+        if (pending.mrt == 0)
+            std::cerr << pending.call_no << ": warning: failed to get snapshot\n";
+        return;
+    }
+
+    writeSnapshot(pending.call_no, pending.mrt, pending.snapshot_no, src);
+}
+
+
+void
+flushSnapshots(void) {
+    while (!pendingSnapshots.empty()) {
+        PendingSnapshot pending = pendingSnapshots.front();
+        pendingSnapshots.pop_front();
+        finishSnapshot(pending);
+    }
+}
+
+
 /**
  * Take snapshots.
  */
@@ -170,59 +404,36 @@ takeSnapshot(unsigned call_no, int mrt, unsigned snapshot_no) {
     assert(dumpingSnapshots);
     assert(snapshotPrefix);
 
-    std::unique_ptr<image::Image> src(dumper->getSnapshot(mrt));
-    if (!src) {
-        /* TODO for mrt>0 we probably don't want to treat this as an error: */
-        if (mrt == 0)
-            std::cerr << call_no << ": warning: failed to get snapshot\n";
+    if (snapshotInterval != 0 &&
+        (snapshot_no % snapshotInterval) != 0) {
         return;
     }
 
-    if ((snapshotInterval == 0 ||
-        (snapshot_no % snapshotInterval) == 0)) {
+    if (snapshotLatency) {
+        SnapshotReadback *readback = dumper->beginSnapshot(mrt);
+        if (readback) {
+            PendingSnapshot pending;
+            pending.readback = readback;
+            pending.call_no = call_no;
+            pending.mrt = mrt;
+            pending.snapshot_no = snapshot_no;
+            pendingSnapshots.push_back(pending);
+            return;
+        }
 
-        if (snapshotPrefix[0] == '-' && snapshotPrefix[1] == 0) {
-            char comment[21];
-            snprintf(comment, sizeof comment, "%u",
-                     useCallNos ? call_no : snapshot_no);
-            switch (snapshotFormat) {
-            case PNM_FMT:
-                src->writePNM(std::cout, comment);
-                break;
-            case RAW_RGB:
-                src->writeRAW(std::cout);
-                break;
-            case RAW_MD5:
-                src->writeMD5(std::cout);
-                break;
-            default:
-                assert(0);
-                break;
-            }
-        } else {
-            os::String filename;
-            unsigned no = useCallNos ? call_no : snapshot_no;
-
-            if (!retrace::snapshotMRT) {
-                assert(mrt == 0);
-                filename = os::String::format("%s%010u.png", snapshotPrefix, no);
-            } else if (mrt == -2) {
-                /* stencil */
-                filename = os::String::format("%s%010u-s.png", snapshotPrefix, no);
-            } else if (mrt == -1) {
-                /* depth */
-                filename = os::String::format("%s%010u-z.png", snapshotPrefix, no);
-            } else {
-                filename = os::String::format("%s%010u-mrt%u.png", snapshotPrefix, no, mrt);
-            }
+        // Keep snapshots in order
+        flushSnapshots();
+    }
 
-            // Here we release our ownership on the Image, it is now the
-            // responsibility of the snapshotter to delete it.
-            snapshotter->writePNG(filename, src.release());
-        }
+    image::Image *src = dumper->getSnapshot(mrt);
+    if (!src) {
+        /* TODO for mrt>0 we probably don't want to treat this as an error: */
+        if (mrt == 0)
+            std::cerr << call_no << ": warning: failed to get snapshot\n";
+        return;
     }
 
-    return;
+    writeSnapshot(call_no, mrt, snapshot_no, src);
 }
 
 static void
@@ -238,6 +449,14 @@ takeSnapshot(unsigned call_no) {
         takeSnapshot(call_no, 0, snapshot_no);
     }
 
+    // Complete the readbacks issued snapshotLatency snapshots ago
+    while (!pendingSnapshots.empty() &&
+           pendingSnapshots.front().snapshot_no + snapshotLatency <= snapshot_no) {
+        PendingSnapshot pending = pendingSnapshots.front();
+        pendingSnapshots.pop_front();
+        finishSnapshot(pending);
+    }
+
     snapshot_no++;
 }
 
@@ -276,13 +495,19 @@ retraceCall(trace::Call *call) {
             takeSnapshot(call->no);
         }
         if (call->no >= snapshotFrequency.getLast()) {
-            exit(0);
+            // Wait for pending snapshots
+            flushSnapshots();
+            delete snapshotter;
+            exit(finishSnapshotComparison());
         }
     }
 
     if (call->no >= dumpStateCallNo &&
         dumper->canDump()) {
         StateWriter *writer = stateWriterFactory(std::cout);
+        if (dumpImagesDirectory) {
+            writer->setImageDirectory(dumpImagesDirectory);
+        }
         dumper->dumpState(*writer);
         delete writer;
         exit(0);
@@ -428,6 +653,9 @@ public:
 
         } while (call && call->thread_id == leg);
 
+        /* Readbacks can only complete on this thread's contexts */
+        flushSnapshots();
+
         if (call) {
             /* Pass the baton */
             assert(call->thread_id != leg);
@@ -599,6 +827,7 @@ mainLoop() {
             retraceCall(call);
             delete call;
         }
+        flushSnapshots();
     } else {
         RelayRace race;
         race.run();
@@ -623,6 +852,132 @@ mainLoop() {
 }
 
 
+/*
+ * Server mode (`--server`): rather than replaying the whole trace, read
+ * requests from stdin, one per line:
+ *
+ *   state CALL      dump the state after CALL
+ *   snapshot CALL   snapshot the draw buffer after CALL (or before it, when
+ *                   CALL swaps render targets, just like `-S`)
+ *   quit
+ *
+ * The replay only ever moves forward, so a sequence of requests for
+ * increasing calls costs as much as a single replay.  Each request is
+ * answered on stdout with a "STATUS LENGTH" line followed by LENGTH bytes of
+ * payload: `ok` with the state dump or PNM image, `error` with a message, or
+ * `rewind` when CALL has already been replayed, after which the server exits
+ * so that the client can start a fresh one.
+ */
+
+
+/* Next call to replay, already parsed */
+static trace::Call *serverNextCall = NULL;
+static bool serverStarted = false;
+
+
+static trace::Call *
+serverPeekCall(void) {
+    if (!serverNextCall) {
+        serverNextCall = parser->parse_call();
+    }
+    return serverNextCall;
+}
+
+
+static void
+serverRetraceCall(void) {
+    trace::Call *call = serverPeekCall();
+    assert(call);
+    serverNextCall = NULL;
+    serverStarted = true;
+    retraceCall(call);
+    delete call;
+}
+
+
+static void
+serverRespond(const char *status, const std::string &payload) {
+    std::cout << status << " " << payload.size() << "\n";
+    std::cout.write(payload.data(), payload.size());
+    std::cout.flush();
+}
+
+
+static void
+serverLoop(void) {
+    addCallbacks(retracer);
+
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        std::istringstream request(line);
+        std::string command;
+        request >> command;
+        if (command.empty()) {
+            continue;
+        }
+        if (command == "quit") {
+            break;
+        }
+
+        bool state = command == "state";
+        bool snapshot = command == "snapshot";
+        unsigned call_no;
+        if ((!state && !snapshot) || !(request >> call_no)) {
+            serverRespond("error", "invalid request `" + line + "`");
+            continue;
+        }
+
+        if (serverStarted && call_no < callNo) {
+            serverRespond("rewind", "");
+            break;
+        }
+
+        trace::Call *call;
+        while ((call = serverPeekCall()) &&
+               call->no <= call_no &&
+               !(snapshot && call->no == call_no &&
+                 (call->flags & trace::CALL_FLAG_SWAP_RENDERTARGET))) {
+            serverRetraceCall();
+        }
+        if (!call && callNo < call_no) {
+            serverRespond("error", "call not found");
+            continue;
+        }
+
+        std::ostringstream payload;
+        if (state) {
+            // Like `-D`, keep going until there is something to dump
+            while (!dumper->canDump() && serverPeekCall()) {
+                serverRetraceCall();
+            }
+            if (!dumper->canDump()) {
+                serverRespond("error", "no state to dump");
+                continue;
+            }
+            StateWriter *writer = stateWriterFactory(payload);
+            if (dumpImagesDirectory) {
+                writer->setImageDirectory(dumpImagesDirectory);
+            }
+            dumper->dumpState(*writer);
+            delete writer;
+        } else {
+            std::unique_ptr<image::Image> image(dumper->getSnapshot(0));
+            if (!image) {
+                serverRespond("error", "failed to get snapshot");
+                continue;
+            }
+            char comment[21];
+            snprintf(comment, sizeof comment, "%u", call_no);
+            image->writePNM(payload, comment);
+        }
+        serverRespond("ok", payload.str());
+    }
+
+    delete serverNextCall;
+    serverNextCall = NULL;
+}
+
+
 } /* namespace retrace */
 
 
@@ -639,6 +994,7 @@ usage(const char *argv0) {
         "      --pgpu              gpu profiling (gpu times per draw call)\n"
         "      --ppd               pixels drawn profiling (pixels drawn per draw call)\n"
         "      --pmem              memory usage profiling (vsize rss per call)\n"
+        "      --profile-format=FORMAT  --pcpu/--pgpu/--ppd/--pmem output format (`text` or `binary`; default is text)\n"
         "      --pcalls            call profiling metrics selection\n"
         "      --pframes           frame profiling metrics selection\n"
         "      --pdrawcalls        draw call profiling metrics selection\n"
@@ -654,16 +1010,22 @@ usage(const char *argv0) {
         "      --sb                use a single buffer visual\n"
         "  -m, --mrt               dump all MRTs and depth/stencil\n"
         "  -s, --snapshot-prefix=PREFIX    take snapshots; `-` for PNM stdout output\n"
-        "      --snapshot-format=FMT       use (PNM, RGB, or MD5; default is PNM) when writing to stdout output\n"
+        "      --snapshot-format=FMT       use (PNM, RGB, MD5, or HASH; default is PNM) when writing to stdout output\n"
+        "      --compare-snapshots=FILE    compare snapshots against the hashes in FILE (as written by `-s - --snapshot-format=HASH`),\n"
+        "                                  only saving mismatching snapshots, and print a JSON summary (missing snapshots count as mismatches)\n"
         "  -S, --snapshot=CALLSET  calls to snapshot (default is every frame)\n"
         "      --snapshot-interval=N    specify a frame interval when generating snaphots (default is 0)\n"
+        "      --snapshot-latency=N     read snapshots back asynchronously, completing them N snapshots later (default is 0)\n"
         "  -t, --snapshot-threaded encode screenshots on multiple threads\n"
         "  -v, --verbose           increase output verbosity\n"
         "  -D, --dump-state=CALL   dump state at specific call no\n"
         "      --dump-format=FORMAT dump state format (`json` or `ubjson`)\n"
+        "      --dump-images=DIR   write dumped state images into DIR, named by content, instead of inline\n"
         "  -w, --wait              waitOnFinish on final frame\n"
         "      --loop[=N]          loop N times (N<0 continuously) replaying final frame.\n"
-        "      --singlethread      use a single thread to replay command stream\n";
+        "      --overlay=FILE      apply the calls edited in FILE (an edit overlay written by qapitrace)\n"
+        "      --singlethread      use a single thread to replay command stream\n"
+        "      --server            replay on request, reading `state CALL`/`snapshot CALL` lines from stdin\n";
 }
 
 enum {
@@ -688,8 +1050,14 @@ enum {
     LOOP_OPT,
     SINGLETHREAD_OPT,
     SNAPSHOT_INTERVAL_OPT,
+    SNAPSHOT_LATENCY_OPT,
     DUMP_FORMAT_OPT,
-    MARKERS_OPT
+    MARKERS_OPT,
+    OVERLAY_OPT,
+    PROFILE_FORMAT_OPT,
+    DUMP_IMAGES_OPT,
+    COMPARE_SNAPSHOTS_OPT,
+    SERVER_OPT
 };
 
 const static char *
@@ -707,6 +1075,7 @@ longOptions[] = {
     {"driver", required_argument, 0, DRIVER_OPT},
     {"dump-state", required_argument, 0, 'D'},
     {"dump-format", required_argument, 0, DUMP_FORMAT_OPT},
+    {"dump-images", required_argument, 0, DUMP_IMAGES_OPT},
     {"fullscreen", no_argument, 0, FULLSCREEN_OPT},
     {"headless", no_argument, 0, HEADLESS_OPT},
     {"help", no_argument, 0, 'h'},
@@ -723,13 +1092,18 @@ longOptions[] = {
     {"sb", no_argument, 0, SB_OPT},
     {"snapshot-prefix", required_argument, 0, 's'},
     {"snapshot-format", required_argument, 0, SNAPSHOT_FORMAT_OPT},
+    {"compare-snapshots", required_argument, 0, COMPARE_SNAPSHOTS_OPT},
     {"snapshot", required_argument, 0, 'S'},
     {"snapshot-interval", required_argument, 0, SNAPSHOT_INTERVAL_OPT},
+    {"snapshot-latency", required_argument, 0, SNAPSHOT_LATENCY_OPT},
     {"snapshot-threaded", no_argument, 0, 't'},
     {"verbose", no_argument, 0, 'v'},
     {"wait", no_argument, 0, 'w'},
     {"loop", optional_argument, 0, LOOP_OPT},
+    {"overlay", required_argument, 0, OVERLAY_OPT},
+    {"profile-format", required_argument, 0, PROFILE_FORMAT_OPT},
     {"singlethread", no_argument, 0, SINGLETHREAD_OPT},
+    {"server", no_argument, 0, SERVER_OPT},
     {0, 0, 0, 0}
 };
 
@@ -745,8 +1119,10 @@ int main(int argc, char **argv)
 {
     using namespace retrace;
     int loopCount = 0;
+    const char *overlayFilename = NULL;
     int i;
     bool snapshotThreaded = false;
+    bool binaryProfile = false;
 
     os::setDebugOutput(os::OUTPUT_STDERR);
 
@@ -787,6 +1163,9 @@ int main(int argc, char **argv)
                 return EXIT_FAILURE;
             }
             break;
+        case DUMP_IMAGES_OPT:
+            dumpImagesDirectory = optarg;
+            break;
         case CORE_OPT:
             retrace::setFeatureLevel("3_2_core");
             break;
@@ -825,6 +1204,14 @@ int main(int argc, char **argv)
         case SINGLETHREAD_OPT:
             retrace::singleThread = true;
             break;
+        case SERVER_OPT:
+            serverMode = true;
+            os::setBinaryMode(stdout);
+            dumpingState = true;
+            dumpingSnapshots = true;
+            retrace::singleThread = true;
+            retrace::verbosity = -2;
+            break;
         case 's':
             dumpingSnapshots = true;
             snapshotPrefix = optarg;
@@ -858,9 +1245,23 @@ int main(int argc, char **argv)
                 snapshotFormat = RAW_RGB;
             else if (strcmp(optarg, "MD5") == 0)
                 snapshotFormat = RAW_MD5;
+            else if (strcmp(optarg, "HASH") == 0)
+                snapshotFormat = RAW_HASH;
             else
                 snapshotFormat = PNM_FMT;
             break;
+        case COMPARE_SNAPSHOTS_OPT:
+            if (!readGoldenHashes(optarg)) {
+                return EXIT_FAILURE;
+            }
+            comparingSnapshots = true;
+            dumpingSnapshots = true;
+            // Keep stdout for the summary
+            retrace::verbosity = -2;
+            if (snapshotFrequency.empty()) {
+                snapshotFrequency = trace::CallSet(trace::FREQUENCY_FRAME);
+            }
+            break;
         case 'S':
             dumpingSnapshots = true;
             snapshotFrequency.merge(optarg);
@@ -868,6 +1269,9 @@ int main(int argc, char **argv)
         case SNAPSHOT_INTERVAL_OPT:
             snapshotInterval = atoi(optarg);
             break;
+        case SNAPSHOT_LATENCY_OPT:
+            snapshotLatency = atoi(optarg);
+            break;
         case 't':
             snapshotThreaded = true;
             break;
@@ -880,6 +1284,20 @@ int main(int argc, char **argv)
         case LOOP_OPT:
             loopCount = trace::intOption(optarg, -1);
             break;
+        case OVERLAY_OPT:
+            overlayFilename = optarg;
+            break;
+        case PROFILE_FORMAT_OPT:
+            if (strcasecmp(optarg, "text") == 0) {
+                binaryProfile = false;
+            } else if (strcasecmp(optarg, "binary") == 0) {
+                os::setBinaryMode(stdout);
+                binaryProfile = true;
+            } else {
+                std::cerr << "error: unsupported profile format `" << optarg << "`\n";
+                return EXIT_FAILURE;
+            }
+            break;
         case PGPU_OPT:
             retrace::debug = 0;
             retrace::profiling = true;
@@ -974,7 +1392,7 @@ int main(int argc, char **argv)
 
     retrace::setUp();
     if (retrace::profiling && !retrace::profilingWithBackends) {
-        retrace::profiler.setup(retrace::profilingCpuTimes, retrace::profilingGpuTimes, retrace::profilingPixelsDrawn, retrace::profilingMemoryUsage);
+        retrace::profiler.setup(retrace::profilingCpuTimes, retrace::profilingGpuTimes, retrace::profilingPixelsDrawn, retrace::profilingMemoryUsage, binaryProfile);
     }
 
     os::setExceptionCallback(exceptionCallback);
@@ -984,6 +1402,9 @@ int main(int argc, char **argv)
     {
         for (i = optind; i < argc; ++i) {
             parser = new trace::Parser;
+            if (overlayFilename) {
+                parser = overlayParser(parser, overlayFilename);
+            }
             if (loopCount) {
                 parser = lastFrameLoopParser(parser, loopCount);
             }
@@ -992,7 +1413,11 @@ int main(int argc, char **argv)
                 return 1;
             }
 
-            retrace::mainLoop();
+            if (serverMode) {
+                retrace::serverLoop();
+            } else {
+                retrace::mainLoop();
+            }
 
             parser->close();
 
@@ -1005,6 +1430,8 @@ int main(int argc, char **argv)
 
     delete snapshotter;
 
+    int status = finishSnapshotComparison();
+
     // XXX: X often hangs on XCloseDisplay
     //retrace::cleanUp();
 
@@ -1014,7 +1441,7 @@ int main(int argc, char **argv)
     }
 #endif
 
-    return 0;
+    return status;
 }
 
 
@@ -28,14 +28,95 @@
 #include "state_writer.hpp"
 
 #include <assert.h>
+#include <stdio.h>
+#include <string.h>
 
+#include <iostream>
 #include <sstream>
 
 #include "image.hpp"
+#include "os_process.hpp"
+#include "os_string.hpp"
+#include "os_thread.hpp"
+#include "thread_pool.hpp"
+
+
+StateWriter::StateWriter() :
+    imagePool(NULL)
+{
+}
 
 
 StateWriter::~StateWriter()
 {
+    // Wait for pending images
+    delete imagePool;
+}
+
+
+void
+StateWriter::setImageDirectory(const char *directory)
+{
+    imageDirectory = directory;
+
+    os::String path(directory);
+    if (!path.exists()) {
+        os::createDirectory(path);
+    }
+
+    if (!imagePool) {
+        unsigned threads = os::thread::hardware_concurrency();
+        imagePool = new ThreadPool(threads ? threads : 1);
+    }
+}
+
+
+static void
+encodeImageFile(const std::string &filename, image::Image *image)
+{
+    // Write under a temporary name, so that an interrupted dump never leaves
+    // a truncated file behind a valid content hash.  The name is unique to
+    // this process, as other retraces may be writing the same image.
+    std::ostringstream suffix;
+    suffix << '.' << os::getCurrentProcessId() << ".tmp";
+    std::string temporary = filename + suffix.str();
+
+    bool ok;
+    if (image->channelType == image::TYPE_UNORM8) {
+        ok = image->writePNG(temporary.c_str());
+    } else {
+        ok = image->writePNM(temporary.c_str());
+    }
+    if (!ok || rename(temporary.c_str(), filename.c_str()) != 0) {
+        std::cerr << "error: failed to write " << filename << "\n";
+        remove(temporary.c_str());
+    }
+    delete image;
+}
+
+
+void
+StateWriter::writeImageFile(image::Image *image)
+{
+    std::string filename = imageDirectory;
+    filename += '/';
+    filename += image->contentHash();
+    filename += image->channelType == image::TYPE_UNORM8 ? ".png" : ".pnm";
+
+    beginMember("__file__");
+    writeString(filename);
+    endMember();
+
+    if (!imageFiles.insert(filename).second ||
+        os::String(filename.c_str()).exists()) {
+        return;
+    }
+
+    // The caller owns the image, so encode a copy
+    image::Image *copy = new image::Image(image->width, image->height, image->channels,
+                                          image->flipped, image->channelType);
+    memcpy(copy->pixels, image->pixels, image->height * image->_stride());
+    imagePool->enqueue(encodeImageFile, filename, copy);
 }
 
 
@@ -64,6 +145,12 @@ StateWriter::writeImage(image::Image *image,
         writeStringMember("__label__", image->label.c_str());
     }
 
+    if (!imageDirectory.empty()) {
+        writeImageFile(image);
+        endObject();
+        return;
+    }
+
     beginMember("__data__");
     std::stringstream ss;
 
@@ -33,6 +33,7 @@
 
 #include <ostream>
 #include <type_traits>
+#include <set>
 #include <string>
 
 
@@ -40,6 +41,8 @@ namespace image {
     class Image;
 }
 
+class ThreadPool;
+
 
 /*
  * Abstract base class for writing state.
@@ -47,6 +50,8 @@ namespace image {
 class StateWriter
 {
 public:
+    StateWriter();
+
     virtual ~StateWriter();
 
     virtual void
@@ -171,6 +176,22 @@ public:
         writeImage(image, desc);
     }
 
+    /*
+     * Write images into directory, as files named after the hash of their
+     * contents, and only refer to them from the state.  Images already in
+     * the directory are not written again.  Encoding is done on a pool of
+     * threads, which is drained when the writer is destroyed.
+     */
+    void
+    setImageDirectory(const char *directory);
+
+private:
+    void
+    writeImageFile(image::Image *image);
+
+    std::string imageDirectory;
+    ThreadPool *imagePool;
+    std::set<std::string> imageFiles;
 };
 
 
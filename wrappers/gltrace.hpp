@@ -26,6 +26,10 @@
 #pragma once
 
 
+#include <atomic>
+#include <map>
+#include <tuple>
+
 #include "glimports.hpp"
 
 #include "glfeatures.hpp"
@@ -38,6 +42,19 @@ void APIENTRY _fake_glViewport(GLint x, GLint y, GLsizei width, GLsizei height);
 namespace gltrace {
 
 
+/*
+ * Incremented by every call which may modify the contents of buffer objects.
+ */
+extern std::atomic<unsigned> bufferWriteGeneration;
+
+
+/*
+ * Element array buffer, offset, count, type, primitive restart enabled, and
+ * restart index.
+ */
+typedef std::tuple<GLuint, GLintptr, GLuint, GLenum, bool, GLuint> IndexRangeKey;
+
+
 class Context {
 public:
     glfeatures::Profile profile;
@@ -56,6 +73,11 @@ public:
     // whether glLockArraysEXT() has ever been called
     GLuint lockedArrayCount = 0;
 
+    // Maximum index of element array buffer ranges, valid while
+    // bufferWriteGeneration stays at indexRangesGeneration
+    std::map<IndexRangeKey, GLuint> indexRanges;
+    unsigned indexRangesGeneration = 0;
+
     Context(void) :
         profile(glfeatures::API_GL, 1, 0)
     { }
@@ -88,5 +110,27 @@ _glGetIntegerv_override(GLenum pname, GLint *params);
 const GLubyte *
 _glGetStringi_override(GLenum name, GLuint index);
 
+/*
+ * Persistent buffer mappings which the application writes without explicit
+ * flushes (e.g., coherent ones).  Their contents are shadowed, and the blocks
+ * changed since are written into the trace as fake memcpys by
+ * flushMappings(), which is called before draws, fences, and swaps.
+ */
+void
+shadowMapping(GLuint buffer, void *map, size_t length, bool discard);
+
+// Whether any mapping is shadowed, to skip looking up buffer bindings
+bool
+haveMappings(void);
+
+void
+unshadowMapping(GLuint buffer, bool flush);
+
+void
+unshadowMappings(Context *context);
+
+void
+flushMappings(void);
+
 
 } /* namespace gltrace */
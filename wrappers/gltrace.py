@@ -604,7 +604,26 @@ class GlTracer(Tracer):
             self.emit_memcpy('(const char *)map + offset', 'length')
             print '    }'
 
-        # FIXME: We don't support coherent/pinned memory mappings
+        # Flush and forget shadowed mappings, without querying the binding
+        # when nothing is shadowed
+        if function.name in ('glUnmapBuffer', 'glUnmapBufferARB', 'glUnmapBufferOES'):
+            print '    if (gltrace::haveMappings()) {'
+            print '        gltrace::unshadowMapping(_gl_buffer_binding(target), true);'
+            print '    }'
+        if function.name in ('glUnmapNamedBuffer', 'glUnmapNamedBufferEXT'):
+            print '    gltrace::unshadowMapping(buffer, true);'
+        if function.name in ('glBufferData', 'glBufferDataARB'):
+            print '    if (gltrace::haveMappings()) {'
+            print '        gltrace::unshadowMapping(_gl_buffer_binding(target), false);'
+            print '    }'
+        if function.name in ('glNamedBufferData', 'glNamedBufferDataEXT'):
+            print '    gltrace::unshadowMapping(buffer, false);'
+        if function.name in ('glDeleteBuffers', 'glDeleteBuffersARB'):
+            print '    for (GLsizei _i = 0; _i < n; ++_i) {'
+            print '        gltrace::unshadowMapping(buffers[_i], false);'
+            print '    }'
+
+        # FIXME: We don't support pinned memory mappings
         if function.name in ('glBufferStorage', 'glNamedBufferStorage', 'glNamedBufferStorageEXT'):
             print r'    if (flags & GL_MAP_NOTIFY_EXPLICIT_BIT_VMWX) {'
             print r'        if (!(flags & GL_MAP_PERSISTENT_BIT)) {'
@@ -616,6 +635,7 @@ class GlTracer(Tracer):
             print r'        flags &= ~GL_MAP_NOTIFY_EXPLICIT_BIT_VMWX;'
             print r'    }'
         if function.name in ('glMapBufferRange', 'glMapBufferRangeEXT', 'glMapNamedBufferRange', 'glMapNamedBufferRangeEXT'):
+            print r'    bool _shadow = false;'
             print r'    if (access & GL_MAP_NOTIFY_EXPLICIT_BIT_VMWX) {'
             print r'        if (!(access & GL_MAP_PERSISTENT_BIT)) {'
             print r'            os::log("apitrace: warning: %s: MAP_NOTIFY_EXPLICIT_BIT_VMWX set w/o MAP_PERSISTENT_BIT\n", __FUNCTION__);'
@@ -628,12 +648,9 @@ class GlTracer(Tracer):
             print r'        }'
             print r'        access &= ~GL_MAP_NOTIFY_EXPLICIT_BIT_VMWX;'
             print r'    } else if (access & GL_MAP_WRITE_BIT) {'
-            print r'        if (access & GL_MAP_COHERENT_BIT) {'
-            print r'            os::log("apitrace: warning: %s: MAP_COHERENT_BIT|MAP_WRITE_BIT unsupported <https://git.io/vV9kM>\n", __FUNCTION__);'
-            print r'        } else if ((access & GL_MAP_PERSISTENT_BIT) &&'
-            print r'                   !(access & GL_MAP_FLUSH_EXPLICIT_BIT)) {'
-            print r'            os::log("apitrace: warning: %s: MAP_PERSISTENT_BIT|MAP_WRITE_BIT w/o MAP_FLUSH_EXPLICIT_BIT unsupported <https://git.io/vV9kM>\n", __FUNCTION__);'
-            print r'        }'
+            print r'        // Writes which will never be flushed explicitly'
+            print r'        _shadow = (access & GL_MAP_COHERENT_BIT) ||'
+            print r'                  ((access & GL_MAP_PERSISTENT_BIT) && !(access & GL_MAP_FLUSH_EXPLICIT_BIT));'
             print r'    }'
         if function.name in ('glBufferData', 'glBufferDataARB'):
             print r'    if (target == GL_EXTERNAL_VIRTUAL_MEMORY_BUFFER_AMD) {'
@@ -686,8 +703,56 @@ class GlTracer(Tracer):
             print '        }'
             print '    }'
 
+        # Emit the writes to shadowed mappings before they can be consumed
+        if self.flushesMappings(function):
+            print '    gltrace::flushMappings();'
+
         Tracer.traceFunctionImplBody(self, function)
 
+        if function.name in ('glMapBufferRange', 'glMapBufferRangeEXT', 'glMapNamedBufferRange', 'glMapNamedBufferRangeEXT'):
+            if 'Named' in function.name:
+                buffer = 'buffer'
+            else:
+                buffer = '_gl_buffer_binding(target)'
+            print r'    if (_shadow && _result) {'
+            print r'        bool _discard = (access & (GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT)) != 0;'
+            print r'        gltrace::shadowMapping(%s, _result, length, _discard);' % buffer
+            print r'    }'
+
+        # Invalidate the index ranges cached by _glDraw_count
+        if self.mayWriteBuffers(function):
+            print '    ++gltrace::bufferWriteGeneration;'
+
+    def flushesMappings(self, function):
+        """Whether the contents of mappings may be consumed from this function
+        onwards, either by the GPU or by other threads."""
+
+        name = function.name
+        if self.draw_function_regex.match(name):
+            return True
+        if name.startswith(('glDispatchCompute', 'glDrawTransformFeedback', 'glMemoryBarrier', 'glCopyBufferSubData', 'glCopyNamedBufferSubData')):
+            return True
+        # Pixel transfers, which may unpack from or pack into mapped buffers
+        if name.startswith(('glTexImage', 'glTexSubImage', 'glTextureImage', 'glTextureSubImage',
+                            'glMultiTexImage', 'glMultiTexSubImage', 'glCompressedTex', 'glCompressedMultiTex',
+                            'glDrawPixels', 'glReadPixels', 'glReadnPixels')):
+            return True
+        if 'SwapBuffers' in name:
+            return True
+        return name in ('glFenceSync', 'glFlush', 'glFinish', 'glFrameTerminatorGREMEDY', 'CGLFlushDrawable')
+
+    def mayWriteBuffers(self, function):
+        """Whether the function may modify the contents of buffer objects,
+        either directly, or by making writes from pixel packing, queries,
+        transform feedback, shaders, other contexts, or other APIs visible."""
+
+        name = function.name
+        if name.startswith(('glBind', 'glIs', 'glGen', 'glDelete')):
+            return False
+        if name.startswith('glGet'):
+            return any(word in name for word in ('TexImage', 'TextureImage', 'TextureSubImage', 'Query'))
+        return any(word in name for word in ('Buffer', 'Barrier', 'Pixels', 'TransformFeedback', 'Sync', 'Semaphore', 'Memory'))
+
     # These entrypoints are only expected to be implemented by tools;
     # drivers will probably not implement them.
     marker_functions = [
@@ -985,6 +1050,7 @@ class GlTracer(Tracer):
 
             # Emit a fake function
             self.array_trace_intermezzo(api, uppercase_name)
+            print '            unsigned long long _address = _glTrace_user_array(pointer, _size);'
             print '            unsigned _call = trace::localWriter.beginEnter(&_%s_sig, true);' % (function.name,)
             for arg in function.args:
                 assert not arg.output
@@ -992,7 +1058,7 @@ class GlTracer(Tracer):
                 if arg.name != 'pointer':
                     self.serializeValue(arg.type, arg.name)
                 else:
-                    print '            trace::localWriter.writeBlob((const void *)%s, _size);' % (arg.name)
+                    print '            trace::localWriter.writePointer(_address);'
                 print '            trace::localWriter.endArg();'
             
             print '            trace::localWriter.endEnter();'
@@ -1044,6 +1110,7 @@ class GlTracer(Tracer):
         print '                size_t _size = _%s_size(%s, count);' % (function.name, arg_names)
 
         # Emit a fake function
+        print '                unsigned long long _address = _glTrace_user_array(pointer, _size);'
         print '                unsigned _call = trace::localWriter.beginEnter(&_%s_sig, true);' % (function.name,)
         for arg in function.args:
             assert not arg.output
@@ -1051,7 +1118,7 @@ class GlTracer(Tracer):
             if arg.name != 'pointer':
                 self.serializeValue(arg.type, arg.name)
             else:
-                print '                trace::localWriter.writeBlob((const void *)%s, _size);' % (arg.name)
+                print '                trace::localWriter.writePointer(_address);'
             print '                trace::localWriter.endArg();'
 
         print '                trace::localWriter.endEnter();'
@@ -24,8 +24,14 @@
  **************************************************************************/
 
 
+#include <map>
+
+#include "os_thread.hpp"
+#include "trace_writer_local.hpp"
+#include "memtrace.hpp"
 #include "gltrace_arrays.hpp"
 #include "gltrace.hpp"
+#include "glindices.hpp"
 
 
 /* FIXME take in consideration instancing */
@@ -57,12 +63,29 @@ _glDraw_count(gltrace::Context *ctx, const DrawElementsParams &params)
     GLenum type = params.type;
     const void *indices = params.indices;
 
-    GLvoid *temp = 0;
-
     if (!count) {
         return 0;
     }
 
+    if (type != GL_UNSIGNED_BYTE &&
+        type != GL_UNSIGNED_SHORT &&
+        type != GL_UNSIGNED_INT) {
+        os::log("apitrace: warning: %s: unknown GLenum 0x%04X\n", __FUNCTION__, type);
+        return params.basevertex + 1;
+    }
+
+    GLboolean restart_enabled = GL_FALSE;
+    GLuint restart_index = 0;
+    if (ctx->features.primitive_restart) {
+        restart_enabled = _glIsEnabled(GL_PRIMITIVE_RESTART);
+        if (restart_enabled) {
+            restart_index = (GLuint)_glGetInteger(GL_PRIMITIVE_RESTART_INDEX);
+        }
+    }
+
+    GLuint minindex = 0;
+    GLuint maxindex = 0;
+
     GLint element_array_buffer = _element_array_buffer_binding();
     if (element_array_buffer) {
         // Read indices from index buffer object
@@ -73,71 +96,50 @@ _glDraw_count(gltrace::Context *ctx, const DrawElementsParams &params)
         }
 
         GLintptr offset = (GLintptr)indices;
-        GLsizeiptr size = count*_gl_type_size(type);
-        temp = malloc(size);
-        if (!temp) {
-            return 0;
-        }
-        memset(temp, 0, size);
-        _glGetBufferSubData(GL_ELEMENT_ARRAY_BUFFER, offset, size, temp);
-        indices = temp;
-    } else {
-        if (!indices) {
-            return 0;
-        }
-    }
 
-    GLuint maxindex = 0;
-
-    GLboolean restart_enabled = GL_FALSE;
-    GLuint restart_index = 0;
-    if (ctx->features.primitive_restart) {
-        _glIsEnabled(GL_PRIMITIVE_RESTART);
-        if (restart_enabled) {
-            restart_index = (GLuint)_glGetInteger(GL_PRIMITIVE_RESTART_INDEX);
+        // Reading the indices back stalls the pipeline, so remember the
+        // result for draws from unchanged buffers.  Buffers persistently
+        // mapped can change at any time, so they are never cached.
+        unsigned generation = gltrace::bufferWriteGeneration;
+        if (ctx->indexRangesGeneration != generation ||
+            ctx->indexRanges.size() >= 4096) {
+            ctx->indexRanges.clear();
+            ctx->indexRangesGeneration = generation;
         }
-    }
 
-    GLsizei i;
-    if (type == GL_UNSIGNED_BYTE) {
-        const GLubyte *p = (const GLubyte *)indices;
-        for (i = 0; i < count; ++i) {
-            GLuint index = p[i];
-            if (restart_enabled && index == restart_index) {
-                continue;
-            }
-            if (index > maxindex) {
-                maxindex = index;
-            }
-        }
-    } else if (type == GL_UNSIGNED_SHORT) {
-        const GLushort *p = (const GLushort *)indices;
-        for (i = 0; i < count; ++i) {
-            GLuint index = p[i];
-            if (restart_enabled && index == restart_index) {
-                continue;
+        GLint mapped = GL_FALSE;
+        _glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_MAPPED, &mapped);
+
+        gltrace::IndexRangeKey key(element_array_buffer, offset, count, type,
+                                   restart_enabled, restart_index);
+        auto it = ctx->indexRanges.find(key);
+        if (!mapped && it != ctx->indexRanges.end()) {
+            maxindex = it->second;
+        } else {
+            GLsizeiptr size = count*_gl_type_size(type);
+            GLvoid *temp = malloc(size);
+            if (!temp) {
+                return 0;
             }
-            if (index > maxindex) {
-                maxindex = index;
+            memset(temp, 0, size);
+            _glGetBufferSubData(GL_ELEMENT_ARRAY_BUFFER, offset, size, temp);
+            if (!_gl_index_range(type, temp, count, restart_enabled, restart_index, minindex, maxindex)) {
+                maxindex = 0;
             }
-        }
-    } else if (type == GL_UNSIGNED_INT) {
-        const GLuint *p = (const GLuint *)indices;
-        for (i = 0; i < count; ++i) {
-            GLuint index = p[i];
-            if (restart_enabled && index == restart_index) {
-                continue;
-            }
-            if (index > maxindex) {
-                maxindex = index;
+            free(temp);
+
+            if (!mapped) {
+                ctx->indexRanges[key] = maxindex;
             }
         }
     } else {
-        os::log("apitrace: warning: %s: unknown GLenum 0x%04X\n", __FUNCTION__, type);
-    }
+        if (!indices) {
+            return 0;
+        }
 
-    if (element_array_buffer) {
-        free(temp);
+        if (!_gl_index_range(type, indices, count, restart_enabled, restart_index, minindex, maxindex)) {
+            maxindex = 0;
+        }
     }
 
     maxindex += params.basevertex;
@@ -191,3 +193,113 @@ _glDraw_count(gltrace::Context *ctx, const MultiDrawElementsParams &params)
     return _count;
 }
 
+
+/*
+ * User arrays are written into the trace as fake malloc/memcpy calls, and
+ * shadowed, so that subsequent draws only need to write the blocks which
+ * changed.
+ *
+ * Each array gets its own fake allocation, at made up addresses which do not
+ * clash with real ones, so that allocations never overlap on replay, not even
+ * for interleaved arrays.
+ *
+ * Later draws depend on every one of these calls, so tools trimming the trace
+ * must keep them all (see trace_fake_memory.hpp).
+ */
+
+struct UserArrayShadow
+{
+    const void *pointer = nullptr;
+    unsigned long long address = 0;
+    MemoryShadow shadow;
+};
+
+static os::mutex _user_arrays_mutex;
+static std::map<const void *, UserArrayShadow> _user_arrays;
+static unsigned long long _user_arrays_next_address = 0xa000000000000000ULL;
+
+
+static void
+_fakeMalloc(unsigned long long address, size_t size)
+{
+    unsigned _call = trace::localWriter.beginEnter(&trace::malloc_sig, true);
+    trace::localWriter.beginArg(0);
+    trace::localWriter.writeUInt(size);
+    trace::localWriter.endArg();
+    trace::localWriter.endEnter();
+    trace::localWriter.beginLeave(_call);
+    trace::localWriter.beginReturn();
+    trace::localWriter.writePointer(address);
+    trace::localWriter.endReturn();
+    trace::localWriter.endLeave();
+}
+
+
+static void
+_fakeMemcpy(unsigned long long address, const void *ptr, size_t size)
+{
+    unsigned _call = trace::localWriter.beginEnter(&trace::memcpy_sig, true);
+    trace::localWriter.beginArg(0);
+    trace::localWriter.writePointer(address);
+    trace::localWriter.endArg();
+    trace::localWriter.beginArg(1);
+    trace::localWriter.writeBlob(ptr, size);
+    trace::localWriter.endArg();
+    trace::localWriter.beginArg(2);
+    trace::localWriter.writeUInt(size);
+    trace::localWriter.endArg();
+    trace::localWriter.endEnter();
+    trace::localWriter.beginLeave(_call);
+    trace::localWriter.endLeave();
+}
+
+
+static void
+_user_array_changed(void *data, size_t offset, size_t size)
+{
+    const UserArrayShadow *array = static_cast<const UserArrayShadow *>(data);
+    _fakeMemcpy(array->address + offset,
+                static_cast<const uint8_t *>(array->pointer) + offset,
+                size);
+}
+
+
+unsigned long long
+_glTrace_user_array(const void *pointer, size_t size)
+{
+    if (!pointer || !size) {
+        return 0;
+    }
+
+    os::unique_lock<os::mutex> lock(_user_arrays_mutex);
+
+    auto it = _user_arrays.find(pointer);
+    if (it == _user_arrays.end()) {
+        // Bound the shadow memory of applications which keep allocating
+        // new arrays.
+        if (_user_arrays.size() >= 4096) {
+            _user_arrays.clear();
+        }
+        it = _user_arrays.emplace(std::piecewise_construct,
+                                  std::forward_as_tuple(pointer),
+                                  std::forward_as_tuple()).first;
+    }
+
+    UserArrayShadow &array = it->second;
+    if (array.address && size <= array.shadow.coveredSize()) {
+        array.shadow.update(size, _user_array_changed, &array);
+        return array.address;
+    }
+
+    // First draw, or a draw reaching further than before, so start afresh.
+    // NOTE: Memory for the superseded allocation is leaked on replay.
+    array.pointer = pointer;
+    array.address = _user_arrays_next_address;
+    _user_arrays_next_address += (size + 63) & ~size_t(63);
+    array.shadow.cover(const_cast<void *>(pointer), size, false);
+
+    _fakeMalloc(array.address, size);
+    _fakeMemcpy(array.address, pointer, size);
+
+    return array.address;
+}
@@ -95,3 +95,12 @@ _glDraw_count(gltrace::Context *ctx, const MultiDrawArraysParams &params);
 
 GLuint
 _glDraw_count(gltrace::Context *ctx, const MultiDrawElementsParams &params);
+
+
+/*
+ * Write the first `size` bytes of the user array at `pointer` into the trace
+ * (only the blocks changed since the previous draw, when possible), and
+ * return the address it should be given in the fake gl*Pointer call.
+ */
+unsigned long long
+_glTrace_user_array(const void *pointer, size_t size);
@@ -0,0 +1,155 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+#include <atomic>
+#include <map>
+
+#include "os_thread.hpp"
+#include "trace_writer_local.hpp"
+#include "memtrace.hpp"
+#include "gltrace.hpp"
+
+
+namespace gltrace {
+
+
+struct Mapping
+{
+    Context *context = nullptr;
+    uint8_t *map = nullptr;
+    MemoryShadow shadow;
+};
+
+
+/*
+ * Keyed by buffer name alone, as we don't track share groups.  Should two
+ * unrelated contexts map a buffer of the same name, the latest mapping wins.
+ */
+static std::map<GLuint, Mapping> mappings;
+static os::mutex mappings_mutex;
+
+// Spare draws the lock when nothing is mapped, which is the common case
+static std::atomic<bool> have_mappings(false);
+
+
+static void
+emitChanges(void *data, size_t offset, size_t size)
+{
+    const Mapping *mapping = static_cast<const Mapping *>(data);
+    trace::fakeMemcpy(mapping->map + offset, size);
+}
+
+
+void
+shadowMapping(GLuint buffer, void *map, size_t length, bool discard)
+{
+    if (!buffer || !map || !length) {
+        return;
+    }
+
+    os::unique_lock<os::mutex> lock(mappings_mutex);
+
+    Mapping &mapping = mappings[buffer];
+    mapping.context = getContext();
+    mapping.map = static_cast<uint8_t *>(map);
+    mapping.shadow.cover(map, length, discard);
+
+    have_mappings = true;
+}
+
+
+bool
+haveMappings(void)
+{
+    return have_mappings;
+}
+
+
+void
+unshadowMapping(GLuint buffer, bool flush)
+{
+    if (!have_mappings) {
+        return;
+    }
+
+    os::unique_lock<os::mutex> lock(mappings_mutex);
+
+    auto it = mappings.find(buffer);
+    if (it == mappings.end()) {
+        return;
+    }
+
+    if (flush) {
+        Mapping &mapping = it->second;
+        mapping.shadow.update(mapping.shadow.coveredSize(), emitChanges, &mapping);
+    }
+
+    mappings.erase(it);
+    have_mappings = !mappings.empty();
+}
+
+
+void
+flushMappings(void)
+{
+    if (!have_mappings) {
+        return;
+    }
+
+    os::unique_lock<os::mutex> lock(mappings_mutex);
+
+    for (auto &it : mappings) {
+        Mapping &mapping = it.second;
+        mapping.shadow.update(mapping.shadow.coveredSize(), emitChanges, &mapping);
+    }
+}
+
+
+/*
+ * Forget the mappings made through a context being destroyed, as they might
+ * go away with it.
+ */
+void
+unshadowMappings(Context *context)
+{
+    if (!have_mappings) {
+        return;
+    }
+
+    os::unique_lock<os::mutex> lock(mappings_mutex);
+
+    for (auto it = mappings.begin(); it != mappings.end(); ) {
+        if (it->second.context == context) {
+            it = mappings.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    have_mappings = !mappings.empty();
+}
+
+
+} /* namespace gltrace */
@@ -36,6 +36,8 @@
 
 namespace gltrace {
 
+std::atomic<unsigned> bufferWriteGeneration(0);
+
 typedef std::shared_ptr<Context> context_ptr_t;
 static std::map<uintptr_t, context_ptr_t> context_map;
 static os::recursive_mutex context_map_mutex;
@@ -100,8 +102,10 @@ bool releaseContext(uintptr_t context_id)
      */
     if (context_map.find(context_id) != context_map.end()) {
         res = _releaseContext(context_map[context_id]);
-        if (res)
+        if (res) {
+            unshadowMappings(context_map[context_id].get());
             context_map.erase(context_id);
+        }
     }
     context_map_mutex.unlock();
 
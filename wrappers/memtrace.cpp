@@ -35,34 +35,39 @@
 #include "crc32c.hpp"
 
 
-#if \
-    (defined(__i386__) && defined(__SSE2__)) /* gcc */ || \
-    defined(_M_IX86) /* msvc */ || \
-    defined(__x86_64__) /* gcc */ || \
-    defined(_M_X64) /* msvc */ || \
-    defined(_M_AMD64) /* msvc */
-
-#  define HAVE_SSE2
-
-// TODO: Detect and leverage SSE 4.1 and 4.2 at runtime
-#  undef HAVE_SSE41
-#  undef HAVE_SSE42
-
+#if defined(__i386__) || defined(_M_IX86)
+#  define HAVE_X86_32
+#elif defined(__x86_64__) || defined(_M_X64) || defined(_M_AMD64)
+#  define HAVE_X86_64
 #endif
 
 
-#if defined(HAVE_SSE42)
+// The SSE 4.2 code is built regardless of the baseline instruction set, as
+// wrappers must run everywhere, and is only used if the CPU supports it.
+#if (defined(HAVE_X86_32) || defined(HAVE_X86_64)) && \
+    (defined(__GNUC__) || defined(_MSC_VER))
+#  define HAVE_SSE42_DISPATCH
 #  include <nmmintrin.h>
-#elif defined(HAVE_SSE41)
-#  include <smmintrin.h>
-#elif defined(HAVE_SSE2)
-#  include <emmintrin.h>
+#  ifdef _MSC_VER
+#    include <intrin.h>
+#    define TARGET_SSE42
+#  else
+#    define TARGET_SSE42 __attribute__((target("sse4.2")))
+#  endif
 #endif
 
 
 #define BLOCK_ALIGN 64
 #define BLOCK_SIZE 512
 
+// Blocks are hashed as the CRC32C of the CRC32Cs of their quarters, rather
+// than as a whole, so that the independent CRC chains can overlap.
+#define BLOCK_STREAMS 4
+#define STREAM_SIZE (BLOCK_SIZE / BLOCK_STREAMS)
+
+// Blocks hashed at once while scanning
+#define BLOCK_BATCH 64
+
 
 template< class T >
 static inline T *
@@ -80,93 +85,123 @@ rAlignPtr(T *p, uintptr_t alignment)
 }
 
 
-#ifdef HAVE_SSE2
-
-#ifdef HAVE_SSE41
-    #define mm_stream_load_si128 _mm_stream_load_si128
-    #define mm_extract_epi32_0(x) _mm_extract_epi32(x, 0)
-    #define mm_extract_epi32_1(x) _mm_extract_epi32(x, 1)
-    #define mm_extract_epi32_2(x) _mm_extract_epi32(x, 2)
-    #define mm_extract_epi32_3(x) _mm_extract_epi32(x, 3)
-#else /* !HAVE_SSE41 */
-    #define mm_stream_load_si128 _mm_load_si128
-    #define mm_extract_epi32_0(x) _mm_cvtsi128_si32(x)
-    #define mm_extract_epi32_1(x) _mm_cvtsi128_si32(_mm_shuffle_epi32(x,_MM_SHUFFLE(1,1,1,1)))
-    #define mm_extract_epi32_2(x) _mm_cvtsi128_si32(_mm_shuffle_epi32(x,_MM_SHUFFLE(2,2,2,2)))
-    #define mm_extract_epi32_3(x) _mm_cvtsi128_si32(_mm_shuffle_epi32(x,_MM_SHUFFLE(3,3,3,3)))
-#endif /* !HAVE_SSE41 */
-
-#ifdef HAVE_SSE42
-
-#define mm_crc32_u32 _mm_crc32_u32
-
-#else /* !HAVE_SSE42 */
-
-static inline uint32_t
-mm_crc32_u32(uint32_t crc, uint32_t current)
+static void
+hashBlocks_c(const uint8_t *p, size_t count, uint32_t *hashes)
 {
-    uint32_t one = current ^ crc;
-    crc  = crc32c_8x256_table[0][ one >> 24        ] ^
-           crc32c_8x256_table[1][(one >> 16) & 0xff] ^
-           crc32c_8x256_table[2][(one >>  8) & 0xff] ^
-           crc32c_8x256_table[3][ one        & 0xff];
-    return crc;
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t crcs[BLOCK_STREAMS];
+        for (unsigned j = 0; j < BLOCK_STREAMS; ++j) {
+            crcs[j] = crc32c_8bytes(p + j * STREAM_SIZE, STREAM_SIZE);
+        }
+        hashes[i] = crc32c_8bytes(crcs, sizeof crcs);
+        p += BLOCK_SIZE;
+    }
 }
 
-#endif /* !HAVE_SSE42 */
-
-#endif /* HAVE_SSE2 */
 
+#ifdef HAVE_SSE42_DISPATCH
 
-uint32_t
-hashBlock(const void *p)
+TARGET_SSE42 static void
+hashBlocks_sse42(const uint8_t *p, size_t count, uint32_t *hashes)
 {
-    assert(lAlignPtr(p, BLOCK_ALIGN) == p);
+    static_assert(BLOCK_STREAMS == 4, "unexpected number of streams");
+
+    for (size_t i = 0; i < count; ++i) {
+#ifdef HAVE_X86_64
+        uint64_t crc0 = 0xffffffff;
+        uint64_t crc1 = 0xffffffff;
+        uint64_t crc2 = 0xffffffff;
+        uint64_t crc3 = 0xffffffff;
+        for (size_t j = 0; j < STREAM_SIZE; j += 8) {
+            uint64_t v0, v1, v2, v3;
+            memcpy(&v0, p + 0 * STREAM_SIZE + j, 8);
+            memcpy(&v1, p + 1 * STREAM_SIZE + j, 8);
+            memcpy(&v2, p + 2 * STREAM_SIZE + j, 8);
+            memcpy(&v3, p + 3 * STREAM_SIZE + j, 8);
+            crc0 = _mm_crc32_u64(crc0, v0);
+            crc1 = _mm_crc32_u64(crc1, v1);
+            crc2 = _mm_crc32_u64(crc2, v2);
+            crc3 = _mm_crc32_u64(crc3, v3);
+        }
+#else
+        uint32_t crc0 = 0xffffffff;
+        uint32_t crc1 = 0xffffffff;
+        uint32_t crc2 = 0xffffffff;
+        uint32_t crc3 = 0xffffffff;
+        for (size_t j = 0; j < STREAM_SIZE; j += 4) {
+            uint32_t v0, v1, v2, v3;
+            memcpy(&v0, p + 0 * STREAM_SIZE + j, 4);
+            memcpy(&v1, p + 1 * STREAM_SIZE + j, 4);
+            memcpy(&v2, p + 2 * STREAM_SIZE + j, 4);
+            memcpy(&v3, p + 3 * STREAM_SIZE + j, 4);
+            crc0 = _mm_crc32_u32(crc0, v0);
+            crc1 = _mm_crc32_u32(crc1, v1);
+            crc2 = _mm_crc32_u32(crc2, v2);
+            crc3 = _mm_crc32_u32(crc3, v3);
+        }
+#endif
 
-    uint32_t crc;
+        uint32_t crc = 0xffffffff;
+        crc = _mm_crc32_u32(crc, ~(uint32_t)crc0);
+        crc = _mm_crc32_u32(crc, ~(uint32_t)crc1);
+        crc = _mm_crc32_u32(crc, ~(uint32_t)crc2);
+        crc = _mm_crc32_u32(crc, ~(uint32_t)crc3);
+        hashes[i] = ~crc;
 
-#ifdef HAVE_SSE2
-    crc = 0;
+        p += BLOCK_SIZE;
+    }
+}
 
-    __m128i *q = (__m128i *)(void *)p;
 
-    crc = ~crc;
+static bool
+haveSSE42(void)
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 20)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2");
+#endif
+}
 
-    for (unsigned c = BLOCK_SIZE / (4 * sizeof *q); c; --c) {
-        __m128i m0 = mm_stream_load_si128(q++);
-        __m128i m1 = mm_stream_load_si128(q++);
-        __m128i m2 = mm_stream_load_si128(q++);
-        __m128i m3 = mm_stream_load_si128(q++);
+#endif /* HAVE_SSE42_DISPATCH */
 
-        crc = mm_crc32_u32(crc, mm_extract_epi32_0(m0));
-        crc = mm_crc32_u32(crc, mm_extract_epi32_1(m0));
-        crc = mm_crc32_u32(crc, mm_extract_epi32_2(m0));
-        crc = mm_crc32_u32(crc, mm_extract_epi32_3(m0));
 
-        crc = mm_crc32_u32(crc, mm_extract_epi32_0(m1));
-        crc = mm_crc32_u32(crc, mm_extract_epi32_1(m1));
-        crc = mm_crc32_u32(crc, mm_extract_epi32_2(m1));
-        crc = mm_crc32_u32(crc, mm_extract_epi32_3(m1));
+typedef void (*HashBlocksFunc)(const uint8_t *p, size_t count, uint32_t *hashes);
 
-        crc = mm_crc32_u32(crc, mm_extract_epi32_0(m2));
-        crc = mm_crc32_u32(crc, mm_extract_epi32_1(m2));
-        crc = mm_crc32_u32(crc, mm_extract_epi32_2(m2));
-        crc = mm_crc32_u32(crc, mm_extract_epi32_3(m2));
 
-        crc = mm_crc32_u32(crc, mm_extract_epi32_0(m3));
-        crc = mm_crc32_u32(crc, mm_extract_epi32_1(m3));
-        crc = mm_crc32_u32(crc, mm_extract_epi32_2(m3));
-        crc = mm_crc32_u32(crc, mm_extract_epi32_3(m3));
+static HashBlocksFunc
+selectHashBlocks(void)
+{
+#ifdef HAVE_SSE42_DISPATCH
+    if (haveSSE42()) {
+        return hashBlocks_sse42;
     }
+#endif
+    return hashBlocks_c;
+}
 
-    crc = ~crc;
 
-#else /* !HAVE_SSE2 */
+void
+hashBlocks(const void *p, size_t count, uint32_t *hashes)
+{
+    assert(lAlignPtr(p, BLOCK_ALIGN) == p);
 
-    crc = crc32c_8bytes(p, BLOCK_SIZE);
+    // Resolved on first use, as wrappers might be called before static
+    // constructors run
+    static const HashBlocksFunc pfnHashBlocks = selectHashBlocks();
 
-#endif
+    pfnHashBlocks(static_cast<const uint8_t *>(p), count, hashes);
+}
 
+
+uint32_t
+hashBlock(const void *p)
+{
+    uint32_t crc;
+    hashBlocks(p, 1, &crc);
     return crc;
 }
 
@@ -183,6 +218,45 @@ void MemoryShadow::zero(void *_ptr, size_t _size)
 }
 
 
+// Partial blocks at either end of the first `limit` covered bytes are hashed
+// from a copy, as the memory around them might not be accessible.
+void MemoryShadow::hashBlocksAt(size_t first, size_t count, size_t limit, uint32_t *hashes) const
+{
+    assert(limit <= size);
+
+    const uint8_t *blockPtr = lAlignPtr(realPtr, BLOCK_ALIGN) + first * BLOCK_SIZE;
+    const uint8_t *stopPtr = realPtr + limit;
+
+    while (count) {
+        size_t whole = 0;
+        if (blockPtr >= realPtr) {
+            whole = std::min<size_t>(count, (stopPtr - blockPtr) / BLOCK_SIZE);
+        }
+
+        if (whole) {
+            hashBlocks(blockPtr, whole, hashes);
+        } else {
+            const uint8_t *start = std::max(blockPtr, realPtr);
+            const uint8_t *stop  = std::min(blockPtr + BLOCK_SIZE, stopPtr);
+
+            alignas(BLOCK_ALIGN) uint8_t block[BLOCK_SIZE] = {0};
+            memcpy(block + (start - blockPtr), start, stop - start);
+            hashBlocks(block, 1, hashes);
+
+            // The same block may be hashed with different limits, so tell
+            // the padding apart from actual zeros.
+            uint32_t mix[2] = {hashes[0], uint32_t(stop - start)};
+            hashes[0] = crc32c_8bytes(mix, sizeof mix);
+            whole = 1;
+        }
+
+        blockPtr += whole * BLOCK_SIZE;
+        hashes += whole;
+        count -= whole;
+    }
+}
+
+
 void MemoryShadow::cover(void *_ptr, size_t _size, bool _discard)
 {
     assert(_ptr);
@@ -202,19 +276,17 @@ void MemoryShadow::cover(void *_ptr, size_t _size, bool _discard)
 
     if (_discard) {
         zero(_ptr, size);
-    }
 
-    const uint8_t *blockPtr = basePtr;
-    if (_discard) {
-        hashPtr[0] = hashBlock(blockPtr);
-        for (size_t i = 1; i < nBlocks; ++i) {
-            hashPtr[i] = hashPtr[0];
+        // Whole blocks all hold the same data once zeroed
+        hashBlocksAt(0, std::min<size_t>(nBlocks, 2), size, hashPtr);
+        for (size_t i = 2; i + 1 < nBlocks; ++i) {
+            hashPtr[i] = hashPtr[1];
         }
-    } else {
-        for (size_t i = 0; i < nBlocks; ++i) {
-            hashPtr[i] = hashBlock(blockPtr);
-            blockPtr += BLOCK_SIZE;
+        if (nBlocks > 2) {
+            hashBlocksAt(nBlocks - 1, 1, size, &hashPtr[nBlocks - 1]);
         }
+    } else {
+        hashBlocksAt(0, nBlocks, size, hashPtr);
     }
 }
 
@@ -224,14 +296,19 @@ void MemoryShadow::update(Callback callback) const
     const uint8_t *realStart   = realPtr   + size;
     const uint8_t *realStop    = realPtr;
 
-    const uint8_t *blockPtr = lAlignPtr(realPtr, BLOCK_ALIGN);
-    for (size_t i = 0; i < nBlocks; ++i) {
-        uint32_t crc = hashBlock(blockPtr);
-        if (crc != hashPtr[i]) {
-            realStart = std::min(realStart, blockPtr);
-            realStop  = std::max(realStop,  blockPtr + BLOCK_SIZE);
+    const uint8_t *basePtr = lAlignPtr(realPtr, BLOCK_ALIGN);
+    for (size_t first = 0; first < nBlocks; first += BLOCK_BATCH) {
+        size_t count = std::min<size_t>(nBlocks - first, BLOCK_BATCH);
+        uint32_t crcs[BLOCK_BATCH];
+        hashBlocksAt(first, count, size, crcs);
+
+        for (size_t i = 0; i < count; ++i) {
+            if (crcs[i] != hashPtr[first + i]) {
+                const uint8_t *blockPtr = basePtr + (first + i) * BLOCK_SIZE;
+                realStart = std::min(realStart, blockPtr);
+                realStop  = std::max(realStop,  blockPtr + BLOCK_SIZE);
+            }
         }
-        blockPtr += BLOCK_SIZE;
     }
 
     realStart = std::max(realStart, realPtr);
@@ -242,3 +319,45 @@ void MemoryShadow::update(Callback callback) const
         callback(realStart, realStop - realStart);
     }
 }
+
+
+void MemoryShadow::update(size_t _size, RunCallback callback, void *data)
+{
+    assert(_size <= size);
+
+    const uint8_t *basePtr = lAlignPtr(realPtr, BLOCK_ALIGN);
+    size_t n = (realPtr + _size - basePtr + BLOCK_SIZE - 1)/BLOCK_SIZE;
+
+    // Nothing past `_size` is read, as the memory might not be accessible
+    // anymore (e.g. reallocated smaller at the same address), so the block
+    // straddling it is hashed from a copy, and runs are clipped to it.
+    const uint8_t *stopPtr = realPtr + _size;
+    const uint8_t *runStart = nullptr;
+    uint32_t crcs[BLOCK_BATCH];
+    for (size_t i = 0; i <= n; ++i) {
+        const uint8_t *blockPtr = basePtr + i * BLOCK_SIZE;
+
+        bool changed = false;
+        if (i < n) {
+            if (i % BLOCK_BATCH == 0) {
+                hashBlocksAt(i, std::min<size_t>(n - i, BLOCK_BATCH), _size, crcs);
+            }
+            uint32_t crc = crcs[i % BLOCK_BATCH];
+            if (crc != hashPtr[i]) {
+                hashPtr[i] = crc;
+                changed = true;
+            }
+        }
+
+        if (changed) {
+            if (!runStart) {
+                runStart = blockPtr;
+            }
+        } else if (runStart) {
+            const uint8_t *start = std::max(runStart, realPtr);
+            const uint8_t *stop  = std::min(blockPtr, stopPtr);
+            callback(data, start - realPtr, stop - start);
+            runStart = nullptr;
+        }
+    }
+}
@@ -35,6 +35,13 @@
 uint32_t
 hashBlock(const void *p);
 
+/*
+ * Hash `count` consecutive blocks at once, using the fastest implementation
+ * the CPU supports.
+ */
+void
+hashBlocks(const void *p, size_t count, uint32_t *hashes);
+
 
 class MemoryShadow
 {
@@ -43,6 +50,8 @@ class MemoryShadow
     const uint8_t *realPtr = nullptr;
     uint32_t *hashPtr = nullptr;
 
+    void hashBlocksAt(size_t first, size_t count, size_t limit, uint32_t *hashes) const;
+
 public:
     MemoryShadow()
     {
@@ -60,4 +69,18 @@ public:
     void cover(void *ptr, size_t size, bool discard);
 
     void update(Callback callback) const;
+
+    typedef void (*RunCallback)(void *data, size_t offset, size_t size);
+
+    /*
+     * Incremental variant of update(), which only reads the first `size`
+     * covered bytes, invokes the callback once per run of changed blocks
+     * (with offsets relative to the covered pointer, and clipped to `size`),
+     * and remembers their new contents for the next call.
+     */
+    void update(size_t size, RunCallback callback, void *data);
+
+    size_t coveredSize(void) const {
+        return size;
+    }
 };
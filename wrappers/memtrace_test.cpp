@@ -0,0 +1,308 @@
+/**************************************************************************
+ *
+ * Copyright 2026 The apitrace authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+#include <string.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <iostream>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "os_time.hpp"
+#include "crc32c.hpp"
+#include "memtrace.hpp"
+
+
+// As in memtrace.cpp
+static const size_t blockSize = 512;
+static const size_t blockAlign = 64;
+
+
+static uint8_t *
+alignBlocks(std::vector<uint8_t> &storage)
+{
+    uintptr_t p = reinterpret_cast<uintptr_t>(storage.data());
+    return reinterpret_cast<uint8_t *>((p + blockAlign - 1) & ~(blockAlign - 1));
+}
+
+
+static std::vector<uint8_t>
+makeBlocks(size_t count)
+{
+    std::vector<uint8_t> storage(count * blockSize + blockAlign);
+    unsigned seed = 1;
+    for (auto &byte : storage) {
+        seed = seed * 1103515245 + 12345;
+        byte = seed >> 16;
+    }
+    return storage;
+}
+
+
+// Hash of a block, as defined by the portable implementation.
+static uint32_t
+referenceHash(const uint8_t *p)
+{
+    uint32_t crcs[4];
+    for (unsigned i = 0; i < 4; ++i) {
+        crcs[i] = crc32c_8bytes(p + i * blockSize / 4, blockSize / 4);
+    }
+    return crc32c_8bytes(crcs, sizeof crcs);
+}
+
+
+// Whichever implementation is selected for this CPU must match the portable
+// one.
+TEST(hashBlock, Reference)
+{
+    const size_t count = 100;
+    std::vector<uint8_t> storage = makeBlocks(count);
+    const uint8_t *blocks = alignBlocks(storage);
+
+    std::vector<uint32_t> hashes(count);
+    hashBlocks(blocks, count, hashes.data());
+
+    for (size_t i = 0; i < count; ++i) {
+        const uint8_t *block = blocks + i * blockSize;
+        EXPECT_EQ(referenceHash(block), hashes[i]);
+        EXPECT_EQ(hashes[i], hashBlock(block));
+    }
+}
+
+
+static volatile uint32_t sink;
+
+
+/*
+ * Not really a test, but a microbenchmark of the hashing against the plain
+ * CRC32C, over typical mapped buffer sizes.
+ */
+TEST(hashBlock, Benchmark)
+{
+    for (size_t size : {64 << 10, 1 << 20, 16 << 20}) {
+        size_t count = size / blockSize;
+        std::vector<uint8_t> storage = makeBlocks(count);
+        const uint8_t *blocks = alignBlocks(storage);
+        std::vector<uint32_t> hashes(count);
+
+        const unsigned iterations = std::max<size_t>(1, (32 << 20) / size);
+
+        uint32_t scalar_sum = 0;
+        long long start = os::getTime();
+        for (unsigned i = 0; i < iterations; ++i) {
+            for (size_t j = 0; j < count; ++j) {
+                scalar_sum += crc32c_8bytes(blocks + j * blockSize, blockSize);
+            }
+        }
+        long long scalar_time = os::getTime() - start;
+
+        uint32_t sum = 0;
+        start = os::getTime();
+        for (unsigned i = 0; i < iterations; ++i) {
+            hashBlocks(blocks, count, hashes.data());
+            sum += hashes[i % count];
+        }
+        long long time = os::getTime() - start;
+
+        // Keep the loops from being optimized away
+        sink = scalar_sum + sum;
+
+        double bytes = double(iterations) * size;
+        std::cout << (size >> 10) << " KB: "
+                  << bytes / (scalar_time * 1.0e9 / os::timeFrequency) << " GB/s crc32c, "
+                  << bytes / (time * 1.0e9 / os::timeFrequency) << " GB/s\n";
+    }
+}
+
+
+struct Replica
+{
+    const uint8_t *source;
+    std::vector<uint8_t> copy;
+    size_t calls = 0;
+};
+
+
+static void
+applyRun(void *data, size_t offset, size_t size)
+{
+    Replica *replica = static_cast<Replica *>(data);
+    ASSERT_LE(offset + size, replica->copy.size());
+    memcpy(&replica->copy[offset], replica->source + offset, size);
+    ++replica->calls;
+}
+
+
+TEST(MemoryShadow, Unchanged)
+{
+    std::vector<uint8_t> buffer(5000, 0x55);
+
+    MemoryShadow shadow;
+    shadow.cover(&buffer[3], buffer.size() - 3, false);
+    EXPECT_EQ(buffer.size() - 3, shadow.coveredSize());
+
+    Replica replica;
+    replica.source = &buffer[3];
+    replica.copy.assign(buffer.begin() + 3, buffer.end());
+
+    shadow.update(shadow.coveredSize(), applyRun, &replica);
+    EXPECT_EQ(0u, replica.calls);
+}
+
+
+// Mutate the buffer at random, and check the reported runs are enough to
+// reconstruct it, for all sorts of alignments and partial updates.
+TEST(MemoryShadow, RoundTrip)
+{
+    unsigned seed = 1;
+    auto rand = [&seed] () -> unsigned {
+        seed = seed * 1103515245 + 12345;
+        return seed >> 8;
+    };
+
+    std::vector<uint8_t> buffer(20000);
+    for (auto &byte : buffer) {
+        byte = rand();
+    }
+
+    for (size_t offset = 0; offset < 80; offset += 7) {
+        size_t size = buffer.size() - offset - rand() % 2000;
+        const uint8_t *source = &buffer[offset];
+
+        MemoryShadow shadow;
+        shadow.cover(&buffer[offset], size, false);
+
+        Replica replica;
+        replica.source = source;
+        replica.copy.assign(source, source + size);
+
+        for (unsigned iteration = 0; iteration < 50; ++iteration) {
+            // Only part of the covered range is used in most iterations
+            size_t used = iteration % 3 ? 1 + rand() % size : size;
+
+            unsigned writes = rand() % 8;
+            for (unsigned i = 0; i < writes; ++i) {
+                size_t start = rand() % used;
+                size_t length = std::min<size_t>(1 + rand() % 1500, used - start);
+                for (size_t j = 0; j < length; ++j) {
+                    buffer[offset + start + j] = rand();
+                }
+            }
+
+            shadow.update(used, applyRun, &replica);
+
+            ASSERT_EQ(0, memcmp(replica.copy.data(), source, used))
+                << "offset " << offset << ", iteration " << iteration;
+        }
+    }
+}
+
+
+#ifndef _WIN32
+
+// Updating fewer bytes than covered must not read past them, as they might
+// have been reallocated smaller at the same address, nor miss changes past
+// them once they are updated again.
+TEST(MemoryShadow, Shrink)
+{
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    uint8_t *pages = static_cast<uint8_t *>(mmap(NULL, 2 * pageSize,
+                                                 PROT_READ | PROT_WRITE,
+                                                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    ASSERT_TRUE(pages != MAP_FAILED);
+    memset(pages, 0x55, 2 * pageSize);
+
+    // Blocks start at the covered pointer, so one straddles the two pages
+    uint8_t *source = pages + blockAlign;
+    size_t size = 2 * pageSize - blockAlign;
+
+    MemoryShadow shadow;
+    shadow.cover(source, size, false);
+
+    Replica replica;
+    replica.source = source;
+    replica.copy.assign(source, source + size);
+
+    size_t used = pageSize - blockAlign - 100;
+    ASSERT_EQ(0, mprotect(pages + pageSize, pageSize, PROT_NONE));
+    source[used - 1] ^= 0xff;
+    shadow.update(used, applyRun, &replica);
+    EXPECT_EQ(1u, replica.calls);
+    EXPECT_EQ(0, memcmp(replica.copy.data(), source, used));
+
+    ASSERT_EQ(0, mprotect(pages + pageSize, pageSize, PROT_READ | PROT_WRITE));
+    memset(source + used, 0, pageSize - used);
+    shadow.update(size, applyRun, &replica);
+    EXPECT_EQ(0, memcmp(replica.copy.data(), source, size));
+
+    munmap(pages, 2 * pageSize);
+}
+
+#endif /* !_WIN32 */
+
+
+/*
+ * Not really a test, but a measure of the overhead of scanning a large
+ * persistent mapping on every draw, when only a few blocks change.
+ */
+TEST(MemoryShadow, Benchmark)
+{
+    std::vector<uint8_t> buffer(32 << 20, 0x55);
+    const unsigned iterations = 4;
+
+    MemoryShadow shadow;
+    shadow.cover(&buffer[0], buffer.size(), false);
+
+    Replica replica;
+    replica.source = &buffer[0];
+    replica.copy = buffer;
+
+    long long start = os::getTime();
+    for (unsigned i = 0; i < iterations; ++i) {
+        buffer[(i * 7919 * 4096) % buffer.size()] ^= 0xff;
+        shadow.update(buffer.size(), applyRun, &replica);
+    }
+    long long time = os::getTime() - start;
+
+    EXPECT_EQ(iterations, replica.calls);
+    EXPECT_TRUE(replica.copy == buffer);
+
+    double bytes = double(iterations) * buffer.size();
+    std::cout << bytes / (time * 1.0e9 / os::timeFrequency) << " GB/s\n";
+}
+
+
+int
+main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}